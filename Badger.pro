@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
 
@@ -17,19 +17,48 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     BioModels/Celltype.cpp \
+    BioModels/ExpressionMatrix.cpp \
     BioModels/Feature.cpp \
     BioModels/FeatureCollection.cpp \
+    BioModels/GeneDictionary.cpp \
+    BioModels/SparseMatrix.cpp \
+    GeneExpressionTableModel.cpp \
+    GeneFilterProxyModel.cpp \
+    Graphics/ExpressionHeatmap.cpp \
+    Graphics/ReportRenderer.cpp \
     Graphics/qcustomplot.cpp \
     StartDialog.cpp \
+    Statistics/CellAnnotator.cpp \
     Statistics/Correlator.cpp \
     Statistics/Expressioncomparator.cpp \
+    Statistics/MaskedCorrelator.cpp \
+    Statistics/PseudoBulkAggregator.cpp \
+    Statistics/RankCache.cpp \
+    System/AllocationTracker.cpp \
+    System/AnnotationServer.cpp \
+    System/BatchRunner.cpp \
+    System/CellAnnotationRunner.cpp \
     System/ConfigFile.cpp \
     System/Coordinator.cpp \
     System/InformationCenter.cpp \
+    System/MemoryBudget.cpp \
+    System/ParameterSweep.cpp \
+    System/PerfCounters.cpp \
+    System/RunSummary.cpp \
+    System/SharedReference.cpp \
+    System/ThreadPools.cpp \
+    System/Trace.cpp \
     TabWidget.cpp \
     Test.cpp \
     Utils/FileOperators/CSVReader.cpp \
+    Utils/FileOperators/CSVWriter.cpp \
+    Utils/FileOperators/CellAnnotationFileOperator.cpp \
+    Utils/FileOperators/Hdf5Reader.cpp \
+    Utils/FileOperators/MtxReader.cpp \
+    Utils/FileOperators/ProjectFileOperator.cpp \
+    Utils/FileOperators/SpillFileOperator.cpp \
     Utils/FileOperators/ConfigFileOperator.cpp \
+    Utils/GeneSearchIndex.cpp \
     Utils/Helper.cpp \
     Utils/Math.cpp \
     Utils/Sorter.cpp \
@@ -38,24 +67,87 @@ SOURCES += \
 
 HEADERS += \
     BioModels/Celltype.h \
+    BioModels/ExpressionMatrix.h \
     BioModels/Feature.h \
     BioModels/FeatureCollection.h \
+    BioModels/GeneDictionary.h \
+    BioModels/SparseMatrix.h \
+    GeneExpressionTableModel.h \
+    GeneFilterProxyModel.h \
+    Graphics/ExpressionHeatmap.h \
+    Graphics/ReportRenderer.h \
     Graphics/qcustomplot.h \
     Mainwindow.h \
     StartDialog.h \
+    Statistics/CellAnnotator.h \
     Statistics/Correlator.h \
     Statistics/Expressioncomparator.h \
+    Statistics/MaskedCorrelator.h \
+    Statistics/PseudoBulkAggregator.h \
+    Statistics/RankCache.h \
+    System/AllocationTracker.h \
+    System/AnnotationServer.h \
+    System/BatchRunner.h \
+    System/CellAnnotationRunner.h \
     System/ConfigFile.h \
     System/Coordinator.h \
     System/InformationCenter.h \
+    System/MemoryBudget.h \
+    System/ParameterSweep.h \
+    System/PerfCounters.h \
+    System/RunSummary.h \
+    System/SharedReference.h \
+    System/StageScope.h \
+    System/ThreadPools.h \
+    System/Trace.h \
     TabWidget.h \
     Test.h \
     Utils/FileOperators/CSVReader.h \
+    Utils/FileOperators/CSVWriter.h \
+    Utils/FileOperators/CellAnnotationFileOperator.h \
+    Utils/FileOperators/Hdf5Reader.h \
+    Utils/FileOperators/MtxReader.h \
+    Utils/FileOperators/ProjectFileOperator.h \
+    Utils/FileOperators/SpillFileOperator.h \
     Utils/FileOperators/ConfigFileOperator.h \
+    Utils/GeneSearchIndex.h \
     Utils/Helper.h \
     Utils/Math.h \
     Utils/Sorter.h
 
+# Allocations are accounted per stage in the run summary when built with "qmake CONFIG+=allocation_tracking" - this replaces malloc
+allocation_tracking {
+    DEFINES += BADGER_ALLOCATION_TRACKING
+}
+
+# Plots render through OpenGL framebuffers when built with "qmake CONFIG+=opengl_plots"
+opengl_plots {
+    DEFINES += QCUSTOMPLOT_USE_OPENGL
+    win32: LIBS += -lopengl32
+}
+
+# The per cell scoring kernels use the widest vectors of the build machine when built with "qmake CONFIG+=native_simd"
+native_simd {
+    QMAKE_CXXFLAGS += -march=native
+}
+
+# Shared memory (shm_open) lives in librt on older glibc versions
+linux: LIBS += -lrt
+
+# Compressed feature-barcode matrices are decompressed by zlib
+LIBS += -lz
+
+# HDF5 feature-barcode matrices are read when built with "qmake CONFIG+=hdf5"
+hdf5 {
+    DEFINES += BADGER_HDF5
+    packagesExist(hdf5) {
+        CONFIG += link_pkgconfig
+        PKGCONFIG += hdf5
+    } else {
+        LIBS += -lhdf5
+    }
+}
+
 FORMS += \
     Mainwindow.ui \
     StartDialog.ui \
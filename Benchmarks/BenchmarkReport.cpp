@@ -0,0 +1,100 @@
+#include "BenchmarkReport.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QString>
+#include <QSysInfo>
+#include <QThread>
+#include <QXmlStreamReader>
+
+namespace BenchmarkReport {
+
+/**
+ * @brief writeJsonReport - Collects every benchmark result of a QTest XML log and writes them as JSON.
+ *        QTest logs the accumulated value of all iterations, the report additionally contains the value of a single iteration.
+ * @param xmlLogFilePath - Log written by QTest with "-o <file>,xml"
+ * @param jsonFilePath - Destination of the JSON report
+ * @return True if the report has been written
+ */
+bool writeJsonReport(const QString xmlLogFilePath, const QString jsonFilePath) {
+    QFile xmlLogFile(xmlLogFilePath);
+
+    if (!xmlLogFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "BENCHMARK REPORT:" << xmlLogFilePath << "-" << xmlLogFile.errorString();
+        return false;
+    }
+
+    QJsonArray benchmarks;
+    QString testCaseName, testFunctionName, qtVersion;
+    bool isFailed = false;
+
+    QXmlStreamReader xmlReader(&xmlLogFile);
+    while (!xmlReader.atEnd()) {
+        if (xmlReader.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+
+        QStringRef elementName = xmlReader.name();
+        QXmlStreamAttributes attributes = xmlReader.attributes();
+
+        if (elementName == "TestCase") {
+            testCaseName = attributes.value("name").toString();
+        } else if (elementName == "QtVersion") {
+            qtVersion = xmlReader.readElementText();
+        } else if (elementName == "TestFunction") {
+            testFunctionName = attributes.value("name").toString();
+        } else if (elementName == "Incident") {
+            QStringRef incidentType = attributes.value("type");
+            isFailed = isFailed || incidentType == "fail" || incidentType == "xpass";
+        } else if (elementName == "BenchmarkResult") {
+            double value = attributes.value("value").toDouble();
+            int iterations = attributes.value("iterations").toInt();
+
+            QJsonObject benchmark;
+            benchmark.insert("function", testFunctionName);
+            benchmark.insert("tag", attributes.value("tag").toString());
+            benchmark.insert("metric", attributes.value("metric").toString());
+            benchmark.insert("iterations", iterations);
+            benchmark.insert("value", value);
+            benchmark.insert("valuePerIteration", iterations > 0 ? value / iterations : value);
+            benchmarks.append(benchmark);
+        }
+    }
+
+    if (xmlReader.hasError()) {
+        qDebug() << "BENCHMARK REPORT:" << xmlLogFilePath << "-" << xmlReader.errorString();
+        return false;
+    }
+
+    QJsonObject machine;
+    machine.insert("hostName", QSysInfo::machineHostName());
+    machine.insert("cpuArchitecture", QSysInfo::currentCpuArchitecture());
+    machine.insert("kernel", QSysInfo::kernelType() + " " + QSysInfo::kernelVersion());
+    machine.insert("os", QSysInfo::prettyProductName());
+    machine.insert("idealThreadCount", QThread::idealThreadCount());
+
+    QJsonObject report;
+    report.insert("testCase", testCaseName);
+    report.insert("qtVersion", qtVersion);
+    report.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert("machine", machine);
+    report.insert("isFailed", isFailed);
+    report.insert("benchmarks", benchmarks);
+
+    QSaveFile jsonFile(jsonFilePath);
+
+    if (!jsonFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "BENCHMARK REPORT:" << jsonFilePath << "-" << jsonFile.errorString();
+        return false;
+    }
+
+    jsonFile.write(QJsonDocument(report).toJson());
+    return jsonFile.commit();
+}
+
+}
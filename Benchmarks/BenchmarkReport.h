@@ -0,0 +1,16 @@
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <QString>
+
+/**
+ * @brief The BenchmarkReport namespace turns the XML log of a QTest benchmark run into a JSON report.
+ *        The report holds one entry per benchmark function and data tag together with the machine it was measured on,
+ *        so runs before and after a change can be compared by scripts.
+ */
+namespace BenchmarkReport
+{
+    extern bool writeJsonReport(const QString xmlLogFilePath, const QString jsonFilePath);
+};
+
+#endif // BENCHMARKREPORT_H
@@ -0,0 +1,415 @@
+#include "BenchmarkSuite.h"
+
+#include <QtTest>
+#include <QBuffer>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <cstring>
+
+#include "TabWidget.h"
+#include "BioModels/ExpressionMatrix.h"
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+#include "Statistics/CellAnnotator.h"
+#include "Statistics/Correlator.h"
+#include "Statistics/Expressioncomparator.h"
+#include "Statistics/RankCache.h"
+#include "Utils/Sorter.h"
+#include "Utils/FileOperators/CSVReader.h"
+#include "Utils/FileOperators/CellAnnotationFileOperator.h"
+#include "Utils/FileOperators/MtxReader.h"
+#include "Tools/DatasetGenerator/DatasetGenerator.h"
+
+// Cutoffs the application parses with by default
+const double clusterCutoff = 15,
+             referenceCutoff = 100;
+
+// Number of top types the main window shows per cluster
+const int numberOfTopTypes = 5;
+
+/**
+ * @brief BenchmarkSuite::addDataSizeRows - Adds a row for every generated data size to the data table of the current benchmark
+ */
+void BenchmarkSuite::addDataSizeRows() {
+    QTest::addColumn<QString>("dataSize");
+
+    for (QString dataSize : { QString("small"), QString("large") }) {
+        QTest::newRow(qPrintable(dataSize)) << dataSize;
+    }
+}
+
+
+/**
+ * @brief BenchmarkSuite::initTestCase - Generates the files of every data size with the dataset generator's fixed seed and parses them once
+ *        for the benchmarks that start from parsed data
+ */
+void BenchmarkSuite::initTestCase() {
+    QVERIFY(this->dataDirectory.isValid());
+
+    DataSize smallDataSize, largeDataSize;
+    smallDataSize.generatorParameters.numberOfGenes = 2000;
+    smallDataSize.generatorParameters.numberOfClusters = 8;
+    smallDataSize.generatorParameters.numberOfProfiles = 16;
+    largeDataSize.generatorParameters.numberOfGenes = 20000;
+    largeDataSize.generatorParameters.numberOfClusters = 24;
+    largeDataSize.generatorParameters.numberOfProfiles = 48;
+
+    this->dataSizes.insert("small", smallDataSize);
+    this->dataSizes.insert("large", largeDataSize);
+
+    for (auto dataSize = this->dataSizes.begin(); dataSize != this->dataSizes.end(); dataSize++) {
+        QDir dataSizeDirectory(this->dataDirectory.filePath(dataSize.key()));
+        QVERIFY(DatasetGenerator::generateFiles(dataSize->generatorParameters, dataSizeDirectory.path()));
+
+        dataSize->datasetFilePath = dataSizeDirectory.filePath(DatasetGenerator::datasetFileName);
+        dataSize->referenceFilePath = dataSizeDirectory.filePath(DatasetGenerator::referenceFileName);
+        dataSize->markerFilePath = dataSizeDirectory.filePath(DatasetGenerator::markerFileName);
+
+        dataSize->clusters = CSVReader::getClusterFeatureExpressions(dataSize->datasetFilePath, clusterCutoff);
+        dataSize->tissues = CSVReader::getTissuesWithGeneExpression(dataSize->referenceFilePath, referenceCutoff);
+    }
+}
+
+
+/**
+ * @brief BenchmarkSuite::cleanupTestCase - Waits for the search indices the table benchmarks started in the background
+ */
+void BenchmarkSuite::cleanupTestCase() {
+    QThreadPool::globalInstance()->waitForDone();
+}
+
+
+// ++++++++++++++++++++++++++++++++ PARSERS ++++++++++++++++++++++++++++++++
+void BenchmarkSuite::getClusterFeatureExpressions_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::getClusterFeatureExpressions() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QVector<FeatureCollection> clusters = CSVReader::getClusterFeatureExpressions(data.datasetFilePath, clusterCutoff);
+        QCOMPARE(clusters.length(), data.generatorParameters.numberOfClusters);
+    }
+}
+
+
+void BenchmarkSuite::parseClusterFeatureExpressions_data() {
+    this->addDataSizeRows();
+}
+
+/**
+ * @brief BenchmarkSuite::parseClusterFeatureExpressions - Parses the dataset from memory, which separates the parsing from the file system
+ */
+void BenchmarkSuite::parseClusterFeatureExpressions() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QFile datasetFile(data.datasetFilePath);
+    QVERIFY(datasetFile.open(QIODevice::ReadOnly));
+    QByteArray content = datasetFile.readAll();
+
+    QBENCHMARK {
+        QBuffer datasetBuffer(&content);
+        datasetBuffer.open(QIODevice::ReadOnly);
+
+        QVector<FeatureCollection> clusters = CSVReader::parseClusterFeatureExpressions(datasetBuffer, clusterCutoff);
+        QCOMPARE(clusters.length(), data.generatorParameters.numberOfClusters);
+    }
+}
+
+
+void BenchmarkSuite::getTissuesWithGeneExpression_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::getTissuesWithGeneExpression() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QVector<FeatureCollection> tissues = CSVReader::getTissuesWithGeneExpression(data.referenceFilePath, referenceCutoff);
+        QCOMPARE(tissues.length(), data.generatorParameters.numberOfProfiles);
+    }
+}
+
+
+void BenchmarkSuite::getCellTypesWithMarkers_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::getCellTypesWithMarkers() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QVector<CellType> cellTypes = CSVReader::getCellTypesWithMarkers(data.markerFilePath);
+        QVERIFY(!cellTypes.isEmpty());
+    }
+}
+
+
+void BenchmarkSuite::sortCsvByMarker_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::sortCsvByMarker() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QHash<QString, QVector<QPair<QString, QString>>> markers = CSVReader::sortCsvByMarker(data.markerFilePath);
+        QVERIFY(!markers.isEmpty());
+    }
+}
+
+
+/**
+ * @brief BenchmarkSuite::readFeatureBarcodeMatrix_data - Single cells in an uncompressed feature-barcode matrix directory: ten thousand and
+ *        a hundred thousand shallow cells (200 counts) of 16 profiles
+ */
+void BenchmarkSuite::readFeatureBarcodeMatrix_data() {
+    QTest::addColumn<int>("numberOfCells");
+
+    QTest::newRow("small") << 10000;
+    QTest::newRow("large") << 100000;
+}
+
+/**
+ * @brief BenchmarkSuite::readFeatureBarcodeMatrix - Reads the cells the dataset generator wrote into a feature-barcode matrix directory.
+ *        The generator samples the same cells again into memory, which the matrix read from the files has to reproduce exactly
+ */
+void BenchmarkSuite::readFeatureBarcodeMatrix() {
+    QFETCH(int, numberOfCells);
+
+    DatasetGenerator::GeneratorParameters generatorParameters;
+    generatorParameters.numberOfProfiles = 16;
+    generatorParameters.numberOfCells = numberOfCells;
+    generatorParameters.countsPerCell = 200;
+
+    QDir cellDirectory(this->dataDirectory.filePath(QString("feature_barcode_matrix_%1").arg(numberOfCells)));
+    QVERIFY(DatasetGenerator::generateFiles(generatorParameters, cellDirectory.path()));
+
+    // The generator writes the genes in the order of an empty dictionary, like the reader fills one
+    GeneDictionary generatedGeneDictionary;
+    SparseMatrix generatedMatrix;
+    QVector<int> cellProfiles;
+    QVERIFY(DatasetGenerator::generateCells(generatorParameters, generatedGeneDictionary, generatedMatrix, cellProfiles));
+
+    SparseMatrix sparseMatrix;
+    QBENCHMARK {
+        GeneDictionary geneDictionary;
+        QVERIFY(MtxReader::readFeatureBarcodeMatrix(cellDirectory.filePath(DatasetGenerator::cellMatrixDirectoryName), geneDictionary, sparseMatrix));
+    }
+
+    QCOMPARE(sparseMatrix.getGeneIDs(), generatedMatrix.getGeneIDs());
+    QCOMPARE(sparseMatrix.getCellBarcodes(), generatedMatrix.getCellBarcodes());
+    QCOMPARE(sparseMatrix.getNumberOfNonZeros(), generatedMatrix.getNumberOfNonZeros());
+
+    size_t numberOfNonZeros = size_t(generatedMatrix.getNumberOfNonZeros());
+    QVERIFY(std::memcmp(sparseMatrix.getColumnOffsets(), generatedMatrix.getColumnOffsets(), (size_t(numberOfCells) + 1) * sizeof(qint64)) == 0);
+    QVERIFY(std::memcmp(sparseMatrix.getGeneIndices(), generatedMatrix.getGeneIndices(), numberOfNonZeros * sizeof(quint32)) == 0);
+    QVERIFY(std::memcmp(sparseMatrix.getValues(), generatedMatrix.getValues(), numberOfNonZeros * sizeof(float)) == 0);
+}
+// ++++++++++++++++++++++++++++++++ PARSERS ++++++++++++++++++++++++++++++++
+
+
+// ++++++++++++++++++++++++++++++++ STATISTICS ++++++++++++++++++++++++++++++++
+void BenchmarkSuite::findEquallyExpressedFeatures_data() {
+    this->addDataSizeRows();
+}
+
+/**
+ * @brief BenchmarkSuite::findEquallyExpressedFeatures - Intersects a single cluster with a single tissue
+ */
+void BenchmarkSuite::findEquallyExpressedFeatures() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QVector<QPair<Feature, Feature>> equallyExpressedFeatures = Sorter::findEquallyExpressedFeatures(data.clusters.first(), data.tissues.first());
+        QVERIFY(!equallyExpressedFeatures.isEmpty());
+    }
+}
+
+
+void BenchmarkSuite::calculateSpearmanCorrelation_data() {
+    this->addDataSizeRows();
+}
+
+/**
+ * @brief BenchmarkSuite::calculateSpearmanCorrelation - Correlates the counts of the genes a cluster and a tissue share, as the comparator does for every pair
+ */
+void BenchmarkSuite::calculateSpearmanCorrelation() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QVector<double> clusterCounts, tissueCounts;
+    for (const QPair<Feature, Feature> & equallyExpressedFeature : Sorter::findEquallyExpressedFeatures(data.clusters.first(), data.tissues.first())) {
+        clusterCounts.append(equallyExpressedFeature.first.count);
+        tissueCounts.append(equallyExpressedFeature.second.count);
+    }
+
+    QBENCHMARK {
+        double correlation = Correlator::calculateSpearmanCorrelation(clusterCounts, tissueCounts);
+        QVERIFY(correlation >= -1 && correlation <= 1);
+    }
+}
+
+
+void BenchmarkSuite::findClusterTissueCorrelations_data() {
+    this->addDataSizeRows();
+}
+
+/**
+ * @brief BenchmarkSuite::findClusterTissueCorrelations - Correlates every cluster of the dataset with every tissue of the reference
+ */
+void BenchmarkSuite::findClusterTissueCorrelations() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QBENCHMARK {
+        QVector<QVector<QPair<QString, double>>> correlations = ExpressionComparator::findClusterTissueCorrelations(data.clusters, data.tissues);
+        QCOMPARE(correlations.length(), data.generatorParameters.numberOfClusters);
+    }
+}
+
+
+void BenchmarkSuite::findClusterTissueCorrelationsRanked_data() {
+    this->addDataSizeRows();
+}
+
+/**
+ * @brief BenchmarkSuite::findClusterTissueCorrelationsRanked - Same as above on full expression matrices, including building the matrices and their rank caches
+ */
+void BenchmarkSuite::findClusterTissueCorrelationsRanked() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QVector<FeatureCollection> fullClusters = CSVReader::getClusterFeatureExpressions(data.datasetFilePath, 0),
+                               fullTissues = CSVReader::getTissuesWithGeneExpression(data.referenceFilePath, 0);
+
+    QBENCHMARK {
+        GeneDictionary geneDictionary;
+        ExpressionMatrix clusterMatrix(fullClusters, geneDictionary),
+                         tissueMatrix(fullTissues, geneDictionary);
+
+        QVector<QVector<QPair<QString, double>>> correlations = ExpressionComparator::findClusterTissueCorrelations(RankCache(clusterMatrix), RankCache(tissueMatrix), clusterCutoff,
+                                                                                                                   referenceCutoff, ExpressionComparator::SpearmanCorrelation);
+        QCOMPARE(correlations.length(), data.generatorParameters.numberOfClusters);
+    }
+}
+
+
+/**
+ * @brief BenchmarkSuite::annotateCells_data - The single cells are no data size of their own: a thousandth and the full million cells
+ *        against 500 profiles. The cells are shallow (200 counts), so the matrix of a million cells stays below 2 GB
+ */
+void BenchmarkSuite::annotateCells_data() {
+    QTest::addColumn<int>("numberOfCells");
+
+    QTest::newRow("small") << 1000;
+    QTest::newRow("million") << 1000000;
+}
+
+/**
+ * @brief BenchmarkSuite::annotateCells - Scores every cell against every profile of the reference. The cells are sampled from the same reference
+ *        by the dataset generator, the annotations are written to and read back from a cell annotation file afterwards, which has to reproduce them exactly
+ */
+void BenchmarkSuite::annotateCells() {
+    QFETCH(int, numberOfCells);
+
+    DatasetGenerator::GeneratorParameters generatorParameters;
+    generatorParameters.numberOfProfiles = 500;
+
+    QDir cellDirectory(this->dataDirectory.filePath("cells"));
+    QVERIFY(DatasetGenerator::generateFiles(generatorParameters, cellDirectory.path()));
+
+    GeneDictionary geneDictionary;
+    CellAnnotator::ReferenceProfiles referenceProfiles = CellAnnotator::buildTissueProfiles(
+                CSVReader::getTissuesWithGeneExpression(cellDirectory.filePath(DatasetGenerator::referenceFileName), referenceCutoff), geneDictionary);
+
+    generatorParameters.numberOfCells = numberOfCells;
+    generatorParameters.countsPerCell = 200;
+
+    SparseMatrix sparseMatrix;
+    QVector<int> cellProfiles;
+    QVERIFY(DatasetGenerator::generateCells(generatorParameters, geneDictionary, sparseMatrix, cellProfiles));
+
+    CellAnnotator::CellAnnotations cellAnnotations;
+    QBENCHMARK {
+        cellAnnotations = CellAnnotator::annotateCells(sparseMatrix, referenceProfiles, numberOfTopTypes);
+        QCOMPARE(cellAnnotations.numberOfTopProfiles, numberOfTopTypes);
+    }
+
+    // The best profile of a clear majority of the cells has to be the profile they were drawn from
+    int numberOfCorrectCells = 0;
+    for (int c = 0; c < numberOfCells; c++) {
+        quint16 profileIndex = cellAnnotations.profileIndices[size_t(c) * numberOfTopTypes];
+
+        if (profileIndex != CellAnnotator::unassignedProfileIndex
+                && cellAnnotations.profileIDs.at(profileIndex) == QString(DatasetGenerator::getProfileName(cellProfiles.at(c)))) {
+            numberOfCorrectCells++;
+        }
+    }
+    QVERIFY2(numberOfCorrectCells >= 0.9 * numberOfCells, qPrintable(QString("%1 of %2 cells annotated correctly").arg(numberOfCorrectCells).arg(numberOfCells)));
+
+    QString cellAnnotationFilePath = cellDirectory.filePath("cells.bin");
+    CellAnnotator::CellAnnotations readCellAnnotations;
+    QVERIFY(CellAnnotationFileOperator::writeCellAnnotations(cellAnnotationFilePath, cellAnnotations));
+    QVERIFY(CellAnnotationFileOperator::readCellAnnotations(cellAnnotationFilePath, readCellAnnotations));
+
+    // Scores are compared bit by bit - unassigned cells score NaN, which never equals itself
+    QCOMPARE(readCellAnnotations.profileIDs, cellAnnotations.profileIDs);
+    QCOMPARE(readCellAnnotations.cellBarcodes, cellAnnotations.cellBarcodes);
+    QCOMPARE(readCellAnnotations.numberOfTopProfiles, cellAnnotations.numberOfTopProfiles);
+    QVERIFY(readCellAnnotations.profileIndices == cellAnnotations.profileIndices);
+    QCOMPARE(readCellAnnotations.scores.size(), cellAnnotations.scores.size());
+    QVERIFY(std::memcmp(readCellAnnotations.scores.data(), cellAnnotations.scores.data(), cellAnnotations.scores.size() * sizeof(float)) == 0);
+}
+// ++++++++++++++++++++++++++++++++ STATISTICS ++++++++++++++++++++++++++++++++
+
+
+// ++++++++++++++++++++++++++++++++ TABLES ++++++++++++++++++++++++++++++++
+void BenchmarkSuite::populateTableTypeCorrelations_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::populateTableTypeCorrelations() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    QVector<QVector<QPair<QString, double>>> correlations = ExpressionComparator::findClusterTissueCorrelations(data.clusters, data.tissues);
+    TabWidget tabWidget;
+
+    QBENCHMARK {
+        tabWidget.populateTableTypeCorrelations(correlations, numberOfTopTypes);
+    }
+}
+
+
+void BenchmarkSuite::populateTableGeneExpressions_data() {
+    this->addDataSizeRows();
+}
+
+void BenchmarkSuite::populateTableGeneExpressions() {
+    QFETCH(QString, dataSize);
+    const DataSize & data = this->dataSizes[dataSize];
+
+    GeneDictionary geneDictionary;
+    ExpressionMatrix expressionMatrix(data.clusters, geneDictionary);
+    TabWidget tabWidget;
+
+    QBENCHMARK {
+        tabWidget.populateTableGeneExpressions(expressionMatrix);
+    }
+}
+// ++++++++++++++++++++++++++++++++ TABLES ++++++++++++++++++++++++++++++++
@@ -0,0 +1,80 @@
+#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include "BioModels/FeatureCollection.h"
+#include "Tools/DatasetGenerator/DatasetGenerator.h"
+
+/**
+ * @brief The BenchmarkSuite class measures the hot paths of Badger with QBENCHMARK: the CSV parsers, the intersection of expressed genes,
+ *        the correlation, the cluster - type comparison end to end, the population of the result tables and the annotation of single cells.
+ *        Every benchmark runs on synthetic files of a small and a large size that are generated by the dataset generator with a fixed seed, so numbers are reproducible.
+ *        The single cells are sampled by the generator as well, up to a million cells against 500 profiles.
+ */
+class BenchmarkSuite : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief The DataSize struct describes the synthetic files of one data tag
+     */
+    struct DataSize
+    {
+        DatasetGenerator::GeneratorParameters generatorParameters;
+
+        QString datasetFilePath;
+        QString referenceFilePath;
+        QString markerFilePath;
+
+        QVector<FeatureCollection> clusters;
+        QVector<FeatureCollection> tissues;
+    };
+
+private:
+    QTemporaryDir dataDirectory;
+    QHash<QString, DataSize> dataSizes;
+
+    void addDataSizeRows();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void getClusterFeatureExpressions_data();
+    void getClusterFeatureExpressions();
+    void parseClusterFeatureExpressions_data();
+    void parseClusterFeatureExpressions();
+    void getTissuesWithGeneExpression_data();
+    void getTissuesWithGeneExpression();
+    void getCellTypesWithMarkers_data();
+    void getCellTypesWithMarkers();
+    void sortCsvByMarker_data();
+    void sortCsvByMarker();
+    void readFeatureBarcodeMatrix_data();
+    void readFeatureBarcodeMatrix();
+
+    void findEquallyExpressedFeatures_data();
+    void findEquallyExpressedFeatures();
+    void calculateSpearmanCorrelation_data();
+    void calculateSpearmanCorrelation();
+
+    void findClusterTissueCorrelations_data();
+    void findClusterTissueCorrelations();
+    void findClusterTissueCorrelationsRanked_data();
+    void findClusterTissueCorrelationsRanked();
+    void annotateCells_data();
+    void annotateCells();
+
+    void populateTableTypeCorrelations_data();
+    void populateTableTypeCorrelations();
+    void populateTableGeneExpressions_data();
+    void populateTableGeneExpressions();
+};
+
+#endif // BENCHMARKSUITE_H
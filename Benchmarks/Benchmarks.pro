@@ -0,0 +1,89 @@
+# Benchmark suite of Badger - built separately from the application:
+#   qmake Benchmarks/Benchmarks.pro && make && ./BadgerBenchmarks -json results.json
+QT       += core gui concurrent testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = BadgerBenchmarks
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# The sources of the application are included relative to the repository root
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    ../BioModels/Celltype.cpp \
+    ../BioModels/ExpressionMatrix.cpp \
+    ../BioModels/Feature.cpp \
+    ../BioModels/FeatureCollection.cpp \
+    ../BioModels/GeneDictionary.cpp \
+    ../BioModels/SparseMatrix.cpp \
+    ../GeneExpressionTableModel.cpp \
+    ../GeneFilterProxyModel.cpp \
+    ../Graphics/ExpressionHeatmap.cpp \
+    ../Graphics/qcustomplot.cpp \
+    ../Statistics/CellAnnotator.cpp \
+    ../Statistics/Correlator.cpp \
+    ../Statistics/Expressioncomparator.cpp \
+    ../Statistics/RankCache.cpp \
+    ../System/AllocationTracker.cpp \
+    ../System/ConfigFile.cpp \
+    ../System/PerfCounters.cpp \
+    ../System/ThreadPools.cpp \
+    ../System/Trace.cpp \
+    ../TabWidget.cpp \
+    ../Utils/FileOperators/CSVReader.cpp \
+    ../Utils/FileOperators/CellAnnotationFileOperator.cpp \
+    ../Utils/FileOperators/MtxReader.cpp \
+    ../Utils/GeneSearchIndex.cpp \
+    ../Utils/Math.cpp \
+    ../Utils/Sorter.cpp \
+    ../Tools/DatasetGenerator/DatasetGenerator.cpp \
+    BenchmarkReport.cpp \
+    BenchmarkSuite.cpp \
+    main.cpp
+
+HEADERS += \
+    ../BioModels/Celltype.h \
+    ../BioModels/ExpressionMatrix.h \
+    ../BioModels/Feature.h \
+    ../BioModels/FeatureCollection.h \
+    ../BioModels/GeneDictionary.h \
+    ../BioModels/SparseMatrix.h \
+    ../GeneExpressionTableModel.h \
+    ../GeneFilterProxyModel.h \
+    ../Graphics/ExpressionHeatmap.h \
+    ../Graphics/qcustomplot.h \
+    ../Statistics/CellAnnotator.h \
+    ../Statistics/Correlator.h \
+    ../Statistics/Expressioncomparator.h \
+    ../Statistics/RankCache.h \
+    ../System/AllocationTracker.h \
+    ../System/ConfigFile.h \
+    ../System/PerfCounters.h \
+    ../System/ThreadPools.h \
+    ../System/Trace.h \
+    ../TabWidget.h \
+    ../Utils/FileOperators/CSVReader.h \
+    ../Utils/FileOperators/CellAnnotationFileOperator.h \
+    ../Utils/FileOperators/MtxReader.h \
+    ../Utils/GeneSearchIndex.h \
+    ../Utils/Math.h \
+    ../Utils/Sorter.h \
+    ../Tools/DatasetGenerator/DatasetGenerator.h \
+    BenchmarkReport.h \
+    BenchmarkSuite.h
+
+# Compressed feature-barcode matrices are decompressed by zlib
+LIBS += -lz
+
+FORMS += \
+    ../TabWidget.ui
+
+# The per cell scoring kernels use the widest vectors of the build machine when built with "qmake CONFIG+=native_simd", like the application
+native_simd {
+    QMAKE_CXXFLAGS += -march=native
+}
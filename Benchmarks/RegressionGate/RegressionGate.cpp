@@ -0,0 +1,450 @@
+#include "RegressionGate.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QProcess>
+#include <QSaveFile>
+#include <QString>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace RegressionGate {
+
+namespace {
+
+// Scales the MAD to the standard deviation of normally distributed values
+const double madToStandardDeviation = 1.4826;
+// Standard error of the median relative to the standard error of the mean for normally distributed values
+const double medianStandardErrorFactor = 1.2533;
+// Used for benchmarks that have no tolerance in the baseline file
+const double defaultTolerance = 0.1;
+
+QString getBenchmarkKey(const QString function, const QString tag, const QString metric) {
+    return function + "/" + tag + "/" + metric;
+}
+
+QString getBenchmarkName(const BenchmarkStatistics & statistics) {
+    return statistics.tag.isEmpty() ? statistics.function : statistics.function + " (" + statistics.tag + ")";
+}
+
+/**
+ * @brief readJsonFile - Reads a JSON object from a file
+ * @param filePath - Path of the file
+ * @param jsonObject - Filled with the object of the file
+ * @return True if the file contains a JSON object
+ */
+bool readJsonFile(const QString filePath, QJsonObject & jsonObject) {
+    QFile jsonFile(filePath);
+
+    if (!jsonFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "REGRESSION GATE:" << filePath << "-" << jsonFile.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument jsonDocument = QJsonDocument::fromJson(jsonFile.readAll(), &parseError);
+
+    if (parseError.error != QJsonParseError::NoError || !jsonDocument.isObject()) {
+        qDebug() << "REGRESSION GATE:" << filePath << "-" << parseError.errorString();
+        return false;
+    }
+
+    jsonObject = jsonDocument.object();
+    return true;
+}
+
+/**
+ * @brief getStandardError - Estimates the standard error of a median from the MAD of its repetitions
+ */
+double getStandardError(const BenchmarkStatistics & statistics) {
+    if (statistics.numberOfRepetitions <= 0) {
+        return 0;
+    }
+
+    return medianStandardErrorFactor * madToStandardDeviation * statistics.medianAbsoluteDeviation / std::sqrt(double(statistics.numberOfRepetitions));
+}
+
+/**
+ * @brief getTolerance - Returns the tolerance of a benchmark: the one given on the command line, the one of "function/tag" or "function" in the baseline file
+ *        or the default tolerance of the baseline file - in this order
+ */
+double getTolerance(const BenchmarkStatistics & statistics, const GateParameters & parameters, const QJsonObject & baseline) {
+    if (parameters.tolerance >= 0) {
+        return parameters.tolerance;
+    }
+
+    QJsonObject tolerances = baseline.value("tolerances").toObject();
+    QString functionWithTag = statistics.function + "/" + statistics.tag;
+
+    if (tolerances.contains(functionWithTag)) {
+        return tolerances.value(functionWithTag).toDouble();
+    }
+    if (tolerances.contains(statistics.function)) {
+        return tolerances.value(statistics.function).toDouble();
+    }
+
+    return baseline.value("defaultTolerance").toDouble(defaultTolerance);
+}
+
+QString formatValue(const double value) {
+    return QString::number(value, 'g', 5);
+}
+
+}
+
+
+/**
+ * @brief median - Returns the median of the given values
+ * @param values - Values in any order
+ * @return Median - 0 for no values
+ */
+double median(QVector<double> values) {
+    if (values.isEmpty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    int middle = values.length() / 2;
+
+    return values.length() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+
+/**
+ * @brief medianAbsoluteDeviation - Returns the median of the absolute deviations from the median, a spread that ignores single outliers
+ * @param values - Values in any order
+ * @param median - Median of the values
+ * @return MAD - 0 for no values
+ */
+double medianAbsoluteDeviation(const QVector<double> values, const double median) {
+    QVector<double> deviations;
+    deviations.reserve(values.length());
+
+    for (double value : values) {
+        deviations.append(std::abs(value - median));
+    }
+
+    return RegressionGate::median(deviations);
+}
+
+
+/**
+ * @brief runBenchmarks - Runs the benchmark suite repeatedly and summarizes the value per iteration of every benchmark
+ * @param parameters - Gate parameters
+ * @param statistics - Filled with median and MAD of every benchmark, sorted by function, tag and metric
+ * @return True if every run has passed
+ */
+bool runBenchmarks(const GateParameters parameters, QVector<BenchmarkStatistics> & statistics) {
+    QTemporaryDir reportDirectory;
+    QMap<QString, BenchmarkStatistics> benchmarks;
+    QMap<QString, QVector<double>> samples;
+
+    for (int repetition = 0; repetition < parameters.numberOfRepetitions; repetition++) {
+        cout << "Benchmark run " << repetition + 1 << " of " << parameters.numberOfRepetitions << endl;
+
+        QString reportFilePath = reportDirectory.filePath(QString("run%1.json").arg(repetition));
+        QProcess benchmarkProcess;
+        // The console log of QTest is not needed, failures are part of the report
+        benchmarkProcess.setStandardOutputFile(QProcess::nullDevice());
+        benchmarkProcess.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        benchmarkProcess.start(parameters.benchmarksFilePath, QStringList() << "-json" << reportFilePath << parameters.benchmarkFunctions);
+
+        if (!benchmarkProcess.waitForFinished(-1) || benchmarkProcess.exitStatus() != QProcess::NormalExit || benchmarkProcess.exitCode() != 0) {
+            qDebug() << "REGRESSION GATE:" << parameters.benchmarksFilePath << "failed -" << benchmarkProcess.errorString();
+            return false;
+        }
+
+        QJsonObject report;
+        if (!readJsonFile(reportFilePath, report)) {
+            return false;
+        }
+
+        if (report.value("isFailed").toBool()) {
+            qDebug() << "REGRESSION GATE: A benchmark has failed in run" << repetition + 1;
+            return false;
+        }
+
+        for (const QJsonValue & benchmarkValue : report.value("benchmarks").toArray()) {
+            QJsonObject benchmark = benchmarkValue.toObject();
+            QString function = benchmark.value("function").toString(),
+                    tag = benchmark.value("tag").toString(),
+                    metric = benchmark.value("metric").toString();
+            QString key = getBenchmarkKey(function, tag, metric);
+
+            benchmarks.insert(key, { function, tag, metric, 0, 0, 0 });
+            samples[key].append(benchmark.value("valuePerIteration").toDouble());
+        }
+    }
+
+    statistics.clear();
+    for (auto benchmark = benchmarks.begin(); benchmark != benchmarks.end(); ++benchmark) {
+        QVector<double> values = samples.value(benchmark.key());
+        BenchmarkStatistics benchmarkStatistics = benchmark.value();
+
+        benchmarkStatistics.numberOfRepetitions = values.length();
+        benchmarkStatistics.median = median(values);
+        benchmarkStatistics.medianAbsoluteDeviation = medianAbsoluteDeviation(values, benchmarkStatistics.median);
+        statistics.append(benchmarkStatistics);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief compareToBaseline - Compares the measured benchmarks with the baseline file. Benchmarks of the baseline that have not been run
+ *        are reported as missing if the whole suite has been run or their function has been selected
+ * @param statistics - Measured benchmarks
+ * @param parameters - Gate parameters
+ * @param comparisons - Filled with one comparison per benchmark
+ * @param baselineDescription - Filled with when and where the baseline has been recorded
+ * @param isBaselineRecorded - Set if the baseline file holds any values - the checked-in file only holds tolerances until it is recorded
+ * @return True if the baseline file could be read
+ */
+bool compareToBaseline(const QVector<BenchmarkStatistics> statistics, const GateParameters parameters, QVector<Comparison> & comparisons, QString & baselineDescription,
+                       bool & isBaselineRecorded) {
+    QJsonObject baseline;
+    if (!readJsonFile(parameters.baselineFilePath, baseline)) {
+        return false;
+    }
+
+    QString baselineHostName = baseline.value("machine").toObject().value("hostName").toString();
+    baselineDescription = parameters.baselineFilePath + ", recorded " + baseline.value("timestamp").toString("never") + " on "
+                          + (baselineHostName.isEmpty() ? QString("no machine") : baselineHostName);
+    if (!baselineHostName.isEmpty() && baselineHostName != QSysInfo::machineHostName()) {
+        baselineDescription += " - the benchmarks now run on " + QSysInfo::machineHostName() + ", the values may not be comparable";
+    }
+
+    QJsonArray baselineValues = baseline.value("benchmarks").toArray();
+    isBaselineRecorded = !baselineValues.isEmpty();
+
+    QMap<QString, BenchmarkStatistics> baselineBenchmarks;
+    for (const QJsonValue & benchmarkValue : baselineValues) {
+        QJsonObject benchmark = benchmarkValue.toObject();
+        BenchmarkStatistics baselineStatistics = { benchmark.value("function").toString(), benchmark.value("tag").toString(), benchmark.value("metric").toString(),
+                                                   benchmark.value("repetitions").toInt(), benchmark.value("median").toDouble(), benchmark.value("medianAbsoluteDeviation").toDouble() };
+        baselineBenchmarks.insert(getBenchmarkKey(baselineStatistics.function, baselineStatistics.tag, baselineStatistics.metric), baselineStatistics);
+    }
+
+    comparisons.clear();
+    for (const BenchmarkStatistics & current : statistics) {
+        QString key = getBenchmarkKey(current.function, current.tag, current.metric);
+        Comparison comparison = { baselineBenchmarks.value(key), current, getTolerance(current, parameters, baseline), 0, 0, NewBenchmark };
+
+        if (baselineBenchmarks.contains(key)) {
+            const BenchmarkStatistics & previous = comparison.baseline;
+            double difference = current.median - previous.median;
+            double standardError = std::sqrt(std::pow(getStandardError(previous), 2) + std::pow(getStandardError(current), 2));
+
+            if (previous.median > 0) {
+                comparison.relativeChange = difference / previous.median;
+            } else {
+                comparison.relativeChange = difference > 0 ? std::numeric_limits<double>::infinity() : 0;
+            }
+
+            // Without any spread every difference is significant
+            if (standardError > 0) {
+                comparison.zScore = difference / standardError;
+            } else {
+                comparison.zScore = difference == 0 ? 0 : std::copysign(std::numeric_limits<double>::infinity(), difference);
+            }
+
+            if (comparison.relativeChange > comparison.tolerance && comparison.zScore > parameters.confidence) {
+                comparison.verdict = Regression;
+            } else if (comparison.relativeChange < -comparison.tolerance && comparison.zScore < -parameters.confidence) {
+                comparison.verdict = Improvement;
+            } else {
+                comparison.verdict = Unchanged;
+            }
+
+            baselineBenchmarks.remove(key);
+        }
+
+        comparisons.append(comparison);
+    }
+
+    for (const BenchmarkStatistics & previous : baselineBenchmarks) {
+        if (parameters.benchmarkFunctions.isEmpty() || parameters.benchmarkFunctions.contains(previous.function)) {
+            comparisons.append({ previous, { previous.function, previous.tag, previous.metric, 0, 0, 0 }, 0, 0, 0, MissingBenchmark });
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief writeDiff - Writes the comparisons as markdown table and prints the benchmarks that have changed
+ * @param comparisons - Compared benchmarks
+ * @param parameters - Gate parameters
+ * @param baselineDescription - When and where the baseline has been recorded
+ * @return True if the diff has been written
+ */
+bool writeDiff(const QVector<Comparison> comparisons, const GateParameters parameters, const QString baselineDescription) {
+    const char * verdictNames[] = { "ok", "REGRESSION", "improved", "new", "missing" };
+
+    QString diff;
+    QTextStream diffStream(&diff);
+    diffStream << "# Benchmark comparison\n\n"
+               << "Baseline: " << baselineDescription << "  \n"
+               << "Current: " << parameters.numberOfRepetitions << " runs on " << QSysInfo::machineHostName() << ", "
+               << QDateTime::currentDateTimeUtc().toString(Qt::ISODate) << "  \n"
+               << "Values per iteration as median (MAD). A benchmark regresses if it is slower by more than its tolerance with a robust z score above "
+               << parameters.confidence << ".\n\n"
+               << "| Benchmark | Metric | Baseline | Current | Change | Tolerance | z | Result |\n"
+               << "| ------ | ------ | ------ | ------ | ------ | ------ | ------ | ------ |\n";
+
+    for (const Comparison & comparison : comparisons) {
+        bool isBaselineKnown = comparison.verdict != NewBenchmark,
+             isCurrentKnown = comparison.verdict != MissingBenchmark,
+             isCompared = isBaselineKnown && isCurrentKnown;
+        const BenchmarkStatistics & benchmark = isCurrentKnown ? comparison.current : comparison.baseline;
+
+        diffStream << "| " << getBenchmarkName(benchmark) << " | " << benchmark.metric << " | "
+                   << (isBaselineKnown ? formatValue(comparison.baseline.median) + " (" + formatValue(comparison.baseline.medianAbsoluteDeviation) + ")" : QString("-")) << " | "
+                   << (isCurrentKnown ? formatValue(comparison.current.median) + " (" + formatValue(comparison.current.medianAbsoluteDeviation) + ")" : QString("-")) << " | "
+                   << (isCompared ? QString("%1%2 %").arg(comparison.relativeChange >= 0 ? "+" : "").arg(comparison.relativeChange * 100, 0, 'f', 1) : QString("-")) << " | "
+                   << (isCompared ? QString::number(comparison.tolerance * 100) + " %" : QString("-")) << " | "
+                   << (isCompared ? QString::number(comparison.zScore, 'f', 1) : QString("-")) << " | "
+                   << verdictNames[comparison.verdict] << " |\n";
+
+        if (comparison.verdict == Regression || comparison.verdict == Improvement) {
+            cout << verdictNames[comparison.verdict] << ": " << getBenchmarkName(benchmark).toStdString() << " " << formatValue(comparison.baseline.median).toStdString()
+                 << " -> " << formatValue(comparison.current.median).toStdString() << " " << benchmark.metric.toStdString() << endl;
+        }
+    }
+    diffStream.flush();
+
+    QSaveFile diffFile(parameters.diffFilePath);
+
+    if (!diffFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "REGRESSION GATE:" << parameters.diffFilePath << "-" << diffFile.errorString();
+        return false;
+    }
+
+    diffFile.write(diff.toUtf8());
+    return diffFile.commit();
+}
+
+
+/**
+ * @brief writeBaseline - Writes the measured benchmarks as new baseline. Tolerances of an existing baseline file are kept
+ * @param statistics - Measured benchmarks
+ * @param parameters - Gate parameters
+ * @return True if the baseline has been written
+ */
+bool writeBaseline(const QVector<BenchmarkStatistics> statistics, const GateParameters parameters) {
+    QJsonObject baseline;
+    QJsonObject previousBaseline;
+
+    if (QFile::exists(parameters.baselineFilePath) && readJsonFile(parameters.baselineFilePath, previousBaseline)) {
+        baseline.insert("defaultTolerance", previousBaseline.value("defaultTolerance").toDouble(defaultTolerance));
+        baseline.insert("tolerances", previousBaseline.value("tolerances").toObject());
+    } else {
+        baseline.insert("defaultTolerance", defaultTolerance);
+        baseline.insert("tolerances", QJsonObject());
+    }
+
+    QJsonObject machine;
+    machine.insert("hostName", QSysInfo::machineHostName());
+    machine.insert("cpuArchitecture", QSysInfo::currentCpuArchitecture());
+    machine.insert("kernel", QSysInfo::kernelType() + " " + QSysInfo::kernelVersion());
+
+    QJsonArray benchmarks;
+    for (const BenchmarkStatistics & benchmarkStatistics : statistics) {
+        QJsonObject benchmark;
+        benchmark.insert("function", benchmarkStatistics.function);
+        benchmark.insert("tag", benchmarkStatistics.tag);
+        benchmark.insert("metric", benchmarkStatistics.metric);
+        benchmark.insert("repetitions", benchmarkStatistics.numberOfRepetitions);
+        benchmark.insert("median", benchmarkStatistics.median);
+        benchmark.insert("medianAbsoluteDeviation", benchmarkStatistics.medianAbsoluteDeviation);
+        benchmarks.append(benchmark);
+    }
+
+    baseline.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    baseline.insert("machine", machine);
+    baseline.insert("benchmarks", benchmarks);
+
+    QSaveFile baselineFile(parameters.baselineFilePath);
+
+    if (!baselineFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "REGRESSION GATE:" << parameters.baselineFilePath << "-" << baselineFile.errorString();
+        return false;
+    }
+
+    baselineFile.write(QJsonDocument(baseline).toJson());
+    return baselineFile.commit();
+}
+
+
+/**
+ * @brief runGate - Runs the benchmarks and compares them to the baseline - or records a new baseline
+ * @param parameters - Gate parameters
+ * @return 0 if no benchmark has regressed or no baseline has been recorded yet, 1 on regressions,
+ *         2 if the benchmarks could not be run or a recorded baseline has no values for them
+ */
+int runGate(const GateParameters parameters) {
+    QVector<BenchmarkStatistics> statistics;
+
+    if (!runBenchmarks(parameters, statistics)) {
+        return 2;
+    }
+
+    if (parameters.isUpdateBaseline) {
+        if (!writeBaseline(statistics, parameters)) {
+            return 2;
+        }
+
+        cout << "Baseline of " << statistics.length() << " benchmarks written to " << parameters.baselineFilePath.toStdString() << endl;
+        return 0;
+    }
+
+    QVector<Comparison> comparisons;
+    QString baselineDescription;
+    bool isBaselineRecorded = false;
+
+    if (!compareToBaseline(statistics, parameters, comparisons, baselineDescription, isBaselineRecorded) || !writeDiff(comparisons, parameters, baselineDescription)) {
+        return 2;
+    }
+
+    // Values depend on the machine, so a fresh checkout has nothing to compare with - the gate is skipped instead of failing every time
+    if (!isBaselineRecorded) {
+        cout << "SKIPPED: " << parameters.baselineFilePath.toStdString() << " has not been recorded yet - record it on this machine with --update-baseline" << endl;
+        return 0;
+    }
+
+    // A recorded baseline without values for the benchmarks that were run would let every change pass
+    int numberOfComparedBenchmarks = int(std::count_if(comparisons.begin(), comparisons.end(), [](const Comparison & comparison) {
+        return comparison.verdict != NewBenchmark && comparison.verdict != MissingBenchmark;
+    }));
+
+    if (numberOfComparedBenchmarks == 0) {
+        cout << "None of the " << statistics.length() << " benchmarks has a baseline value in " << parameters.baselineFilePath.toStdString()
+             << " - record it on this machine with --update-baseline" << endl;
+        return 2;
+    }
+
+    int numberOfRegressions = int(std::count_if(comparisons.begin(), comparisons.end(), [](const Comparison & comparison) { return comparison.verdict == Regression; }));
+
+    cout << numberOfRegressions << " of " << comparisons.length() << " benchmarks regressed, see " << parameters.diffFilePath.toStdString() << endl;
+    return numberOfRegressions > 0 ? 1 : 0;
+}
+
+}
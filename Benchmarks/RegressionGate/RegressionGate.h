@@ -0,0 +1,64 @@
+#ifndef REGRESSIONGATE_H
+#define REGRESSIONGATE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The RegressionGate namespace runs the benchmark suite repeatedly and compares every benchmark to a checked-in baseline.
+ *        Runs are summarized by median and median absolute deviation (MAD), so single outliers do not decide the result.
+ *        A benchmark regresses if its median is slower than the baseline by more than the tolerance and the difference is
+ *        larger than the noise of both sides by the given confidence (robust z score).
+ */
+namespace RegressionGate
+{
+    struct GateParameters
+    {
+        QString benchmarksFilePath;
+        QString baselineFilePath;
+        QString diffFilePath;
+        // Benchmark functions to run - empty runs the whole suite
+        QStringList benchmarkFunctions;
+        int numberOfRepetitions = 5;
+        // Allowed slowdown as share of the baseline median - negative uses the tolerances of the baseline file
+        double tolerance = -1;
+        // Robust z score a difference has to exceed to count as regression or improvement
+        double confidence = 3;
+        // Writes the measured medians as new baseline instead of comparing against it
+        bool isUpdateBaseline = false;
+    };
+
+    struct BenchmarkStatistics
+    {
+        QString function;
+        QString tag;
+        QString metric;
+        int numberOfRepetitions;
+        double median;
+        double medianAbsoluteDeviation;
+    };
+
+    enum Verdict { Unchanged, Regression, Improvement, NewBenchmark, MissingBenchmark };
+
+    struct Comparison
+    {
+        BenchmarkStatistics baseline;
+        BenchmarkStatistics current;
+        double tolerance;
+        double relativeChange;
+        double zScore;
+        Verdict verdict;
+    };
+
+    extern double median(QVector<double> values);
+    extern double medianAbsoluteDeviation(const QVector<double> values, const double median);
+    extern bool runBenchmarks(const GateParameters parameters, QVector<BenchmarkStatistics> & statistics);
+    extern bool compareToBaseline(const QVector<BenchmarkStatistics> statistics, const GateParameters parameters, QVector<Comparison> & comparisons, QString & baselineDescription,
+                                  bool & isBaselineRecorded);
+    extern bool writeDiff(const QVector<Comparison> comparisons, const GateParameters parameters, const QString baselineDescription);
+    extern bool writeBaseline(const QVector<BenchmarkStatistics> statistics, const GateParameters parameters);
+    extern int runGate(const GateParameters parameters);
+};
+
+#endif // REGRESSIONGATE_H
@@ -0,0 +1,23 @@
+# Performance regression gate - runs the benchmark suite and compares it with Benchmarks/baseline.json.
+# Built next to the benchmark suite, "make check" fails on regressions:
+#   qmake -o Makefile.gate Benchmarks/RegressionGate/RegressionGate.pro && make -f Makefile.gate check
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = BadgerRegressionGate
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += BADGER_BASELINE_FILE=\\\"$$PWD/../baseline.json\\\"
+
+# Sources are included relative to the repository root
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    RegressionGate.cpp \
+    main.cpp
+
+HEADERS += \
+    RegressionGate.h
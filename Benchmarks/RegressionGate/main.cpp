@@ -0,0 +1,52 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDir>
+#include <QString>
+
+#include "Benchmarks/RegressionGate/RegressionGate.h"
+
+/**
+ * Runs the benchmark suite repeatedly and fails if a benchmark is slower than the checked-in baseline.
+ * Exit code 0 means no regression, 1 regressions and 2 that the benchmarks could not be run or compared.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    RegressionGate::GateParameters defaults;
+
+    QCommandLineParser commandLineParser;
+    commandLineParser.setApplicationDescription("Compares the benchmark suite with a baseline by median and MAD of repeated runs.");
+    commandLineParser.addHelpOption();
+
+    QCommandLineOption benchmarksOption("benchmarks", "Benchmark suite executable.", "file path", QDir(application.applicationDirPath()).filePath("BadgerBenchmarks")),
+                       baselineOption("baseline", "Baseline the benchmarks are compared with.", "file path", BADGER_BASELINE_FILE),
+                       diffOption("diff", "Markdown file the comparison is written to.", "file path", "benchmark_diff.md"),
+                       repetitionsOption("repetitions", "Runs of the benchmark suite.", "number", QString::number(defaults.numberOfRepetitions)),
+                       toleranceOption("tolerance", "Allowed slowdown as share of the baseline, overrides the tolerances of the baseline file.", "share"),
+                       confidenceOption("confidence", "Robust z score a difference has to exceed.", "value", QString::number(defaults.confidence)),
+                       updateBaselineOption("update-baseline", "Writes the measured benchmarks as new baseline instead of comparing them.");
+    commandLineParser.addOptions({ benchmarksOption, baselineOption, diffOption, repetitionsOption, toleranceOption, confidenceOption, updateBaselineOption });
+    commandLineParser.addPositionalArgument("functions", "Benchmark functions to run - defaults to the whole suite.", "[function...]");
+    commandLineParser.process(application);
+
+    RegressionGate::GateParameters parameters;
+    parameters.benchmarksFilePath = commandLineParser.value(benchmarksOption);
+    parameters.baselineFilePath = commandLineParser.value(baselineOption);
+    parameters.diffFilePath = commandLineParser.value(diffOption);
+    parameters.benchmarkFunctions = commandLineParser.positionalArguments();
+    parameters.numberOfRepetitions = commandLineParser.value(repetitionsOption).toInt();
+    parameters.confidence = commandLineParser.value(confidenceOption).toDouble();
+    parameters.isUpdateBaseline = commandLineParser.isSet(updateBaselineOption);
+
+    if (commandLineParser.isSet(toleranceOption)) {
+        parameters.tolerance = commandLineParser.value(toleranceOption).toDouble();
+    }
+
+    if (parameters.numberOfRepetitions < 1) {
+        commandLineParser.showHelp(2);
+    }
+
+    return RegressionGate::runGate(parameters);
+}
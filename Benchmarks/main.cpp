@@ -0,0 +1,63 @@
+#include <QApplication>
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "Benchmarks/BenchmarkReport.h"
+#include "Benchmarks/BenchmarkSuite.h"
+
+/**
+ * Runs the benchmark suite. Every QTest argument is supported (e.g. a single benchmark function, -iterations, -callgrind),
+ * additionally "-json <file>" writes the results as JSON report.
+ */
+int main(int argc, char *argv[])
+{
+    // The tables are populated without X server
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication application(argc, argv);
+
+    // Take the JSON destination out of the arguments, QTest does not know it
+    QStringList testArguments = application.arguments();
+    QString jsonFilePath;
+
+    int jsonArgumentIndex = testArguments.indexOf("-json");
+    if (jsonArgumentIndex >= 0) {
+        if (jsonArgumentIndex + 1 >= testArguments.length()) {
+            cout << "-json needs a file path." << endl;
+            return 1;
+        }
+
+        jsonFilePath = testArguments[jsonArgumentIndex + 1];
+        testArguments.removeAt(jsonArgumentIndex + 1);
+        testArguments.removeAt(jsonArgumentIndex);
+    }
+
+    // QTest has no JSON logger - its XML log is converted after the run, the usual output stays on the console
+    QTemporaryDir logDirectory;
+    QString xmlLogFilePath = logDirectory.filePath("benchmarks.xml");
+
+    if (!jsonFilePath.isEmpty()) {
+        testArguments << "-o" << xmlLogFilePath + ",xml" << "-o" << "-,txt";
+    }
+
+    BenchmarkSuite benchmarkSuite;
+    int result = QTest::qExec(&benchmarkSuite, testArguments);
+
+    if (!jsonFilePath.isEmpty()) {
+        if (!BenchmarkReport::writeJsonReport(xmlLogFilePath, jsonFilePath)) {
+            return 1;
+        }
+        cout << "Benchmark results written to " << QDir::toNativeSeparators(jsonFilePath).toStdString() << endl;
+    }
+
+    return result;
+}
@@ -0,0 +1,152 @@
+#include "ExpressionMatrix.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <cmath>
+#include <limits>
+
+ExpressionMatrix::ExpressionMatrix() {}
+
+/**
+ * @brief ExpressionMatrix::ExpressionMatrix - Builds the matrix in a single pass over the clusters. Gene IDs are looked up by hash,
+ *        so the cost is linear in the number of expressed features instead of genes x clusters x features.
+ *        Genes of the clusters that are not part of the dictionary yet are added to it, so every expressed gene gets a row.
+ * @param clusters - Clusters with their expressed features - unsorted
+ * @param geneDictionary - Dictionary of the project that assigns the rows
+ */
+ExpressionMatrix::ExpressionMatrix(const QVector<FeatureCollection> & clusters, GeneDictionary & geneDictionary) {
+    int numberOfClusters = clusters.length();
+
+    QVector<QVector<int>> clusterGeneIndices(numberOfClusters);
+    this->clusterIDs.reserve(numberOfClusters);
+
+    for (int j = 0; j < numberOfClusters; j++) {
+        const FeatureCollection & cluster = clusters[j];
+        this->clusterIDs.append(cluster.ID);
+
+        QStringList featureIDs;
+        featureIDs.reserve(cluster.getNumberOfFeatures());
+        for (int k = 0; k < cluster.getNumberOfFeatures(); k++) {
+            featureIDs.append(cluster.getFeatureID(k));
+        }
+
+        clusterGeneIndices[j] = geneDictionary.insertGenes(featureIDs);
+    }
+
+    // Taken after the insertion, so every gene of this dataset has a row. Genes that other datasets add later on have none
+    this->geneIDs = geneDictionary.getGeneIDs();
+    this->values.fill(std::numeric_limits<float>::quiet_NaN(), this->geneIDs.length() * numberOfClusters);
+
+    for (int j = 0; j < numberOfClusters; j++) {
+        const FeatureCollection & cluster = clusters[j];
+        const QVector<int> & geneIndices = clusterGeneIndices[j];
+
+        for (int k = 0; k < cluster.getNumberOfFeatures(); k++) {
+            this->values[geneIndices[k] * numberOfClusters + j] = float(cluster.getFeatureExpressionCount(k));
+        }
+    }
+}
+
+/**
+ * @brief ExpressionMatrix::ExpressionMatrix - Uses the values in place without copying them
+ * @param geneIDs - Gene ID of every row
+ * @param clusterIDs - Cluster ID of every column
+ * @param externalValues - Row-wise genes x clusters values
+ * @param externalValuesOwner - Keeps the memory of the values alive as long as any copy of the matrix exists
+ */
+ExpressionMatrix::ExpressionMatrix(const QStringList & geneIDs, const QStringList & clusterIDs, const float * externalValues, const QSharedPointer<const void> externalValuesOwner)
+    : geneIDs {geneIDs}, clusterIDs {clusterIDs}, externalValues {externalValues}, externalValuesOwner {externalValuesOwner}
+{}
+
+
+int ExpressionMatrix::getNumberOfGenes() const {
+    return this->geneIDs.length();
+}
+
+int ExpressionMatrix::getNumberOfClusters() const {
+    return this->clusterIDs.length();
+}
+
+QString ExpressionMatrix::getGeneID(int geneIndex) const {
+    return this->geneIDs[geneIndex];
+}
+
+QString ExpressionMatrix::getClusterID(int clusterIndex) const {
+    return this->clusterIDs[clusterIndex];
+}
+
+const QStringList & ExpressionMatrix::getGeneIDs() const {
+    return this->geneIDs;
+}
+
+const QStringList & ExpressionMatrix::getClusterIDs() const {
+    return this->clusterIDs;
+}
+
+/**
+ * @brief ExpressionMatrix::getValues
+ * @return Row-wise genes x clusters values - owned or external
+ */
+const float * ExpressionMatrix::getValues() const {
+    return this->externalValues != nullptr ? this->externalValues : this->values.constData();
+}
+
+/**
+ * @brief ExpressionMatrix::getValue
+ * @param geneIndex - Row of the gene
+ * @param clusterIndex - Column of the cluster
+ * @return Expression count - NaN if the gene is not expressed in the cluster
+ */
+float ExpressionMatrix::getValue(int geneIndex, int clusterIndex) const {
+    return this->getValues()[geneIndex * this->clusterIDs.length() + clusterIndex];
+}
+
+bool ExpressionMatrix::isExpressed(int geneIndex, int clusterIndex) const {
+    return !std::isnan(this->getValue(geneIndex, clusterIndex));
+}
+
+
+/**
+ * @brief ExpressionMatrix::getClusterValues - Copies the column of a single cluster
+ * @param clusterIndex - Column of the cluster
+ * @return Expression count of every gene in row order - NaN if the gene is not expressed
+ */
+QVector<float> ExpressionMatrix::getClusterValues(int clusterIndex) const {
+    int numberOfGenes = this->getNumberOfGenes(),
+        numberOfClusters = this->getNumberOfClusters();
+
+    const float * values = this->getValues();
+
+    QVector<float> clusterValues(numberOfGenes);
+    for (int i = 0; i < numberOfGenes; i++) {
+        clusterValues[i] = values[i * numberOfClusters + clusterIndex];
+    }
+
+    return clusterValues;
+}
+
+
+/**
+ * @brief ExpressionMatrix::toClusterCollections - Turns the matrix back into clusters of expressed features, e.g. for a matrix loaded from a project file
+ * @return One FeatureCollection per cluster containing every expressed gene
+ */
+QVector<FeatureCollection> ExpressionMatrix::toClusterCollections() const {
+    QVector<FeatureCollection> clusters;
+    clusters.reserve(this->getNumberOfClusters());
+
+    for (int j = 0; j < this->getNumberOfClusters(); j++) {
+        FeatureCollection cluster(this->clusterIDs[j]);
+
+        for (int i = 0; i < this->getNumberOfGenes(); i++) {
+            if (this->isExpressed(i, j)) {
+                cluster.addFeature(this->geneIDs[i], double(this->getValue(i, j)));
+            }
+        }
+
+        clusters.append(cluster);
+    }
+
+    return clusters;
+}
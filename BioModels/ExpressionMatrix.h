@@ -0,0 +1,48 @@
+#ifndef EXPRESSIONMATRIX_H
+#define EXPRESSIONMATRIX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSharedPointer>
+
+#include "BioModels/FeatureCollection.h"
+#include "BioModels/GeneDictionary.h"
+
+/**
+ * @brief The ExpressionMatrix class holds the expression counts of a dataset as dense genes x clusters matrix.
+ *        Every value is stored row-wise in one contiguous block, genes that are not expressed in a cluster are NaN.
+ *        The rows are a prefix of the project's gene dictionary as it was when the matrix was built.
+ *        The block is either owned by the matrix or lives in external memory (e.g. a mapped project file) that is kept alive by the matrix.
+ */
+class ExpressionMatrix
+{
+private:
+    QStringList geneIDs;
+    QStringList clusterIDs;
+    QVector<float> values;
+
+    // Values in external memory and its owner - null if the values are owned
+    const float * externalValues = nullptr;
+    QSharedPointer<const void> externalValuesOwner;
+
+public:
+    ExpressionMatrix();
+    ExpressionMatrix(const QVector<FeatureCollection> & clusters, GeneDictionary & geneDictionary);
+    ExpressionMatrix(const QStringList & geneIDs, const QStringList & clusterIDs, const float * externalValues, const QSharedPointer<const void> externalValuesOwner);
+
+    int getNumberOfGenes() const;
+    int getNumberOfClusters() const;
+    QString getGeneID(int geneIndex) const;
+    QString getClusterID(int clusterIndex) const;
+    const QStringList & getGeneIDs() const;
+    const QStringList & getClusterIDs() const;
+    const float * getValues() const;
+
+    float getValue(int geneIndex, int clusterIndex) const;
+    bool isExpressed(int geneIndex, int clusterIndex) const;
+    QVector<float> getClusterValues(int clusterIndex) const;
+    QVector<FeatureCollection> toClusterCollections() const;
+};
+
+#endif // EXPRESSIONMATRIX_H
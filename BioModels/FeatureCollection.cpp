@@ -44,7 +44,7 @@ void FeatureCollection::addFeature(Feature feature) {
  * @brief FeatureCollection::filterFeatures - Keep only $number most expressed features
  * @param number - Number of features to keep
  */
-QVector<double> FeatureCollection::getMostExpressedFeaturesCounts(int number) {
+QVector<double> FeatureCollection::getMostExpressedFeaturesCounts(int number) const {
     QVector<double> sortedFeaturesExpressions;
     sortedFeaturesExpressions.reserve(this->getNumberOfFeatures());
     for (int i = 0; i < this->getNumberOfFeatures(); i++) {
@@ -56,7 +56,7 @@ QVector<double> FeatureCollection::getMostExpressedFeaturesCounts(int number) {
     return sortedFeaturesExpressions;
 }
 
-bool FeatureCollection::isFeatureExpressed(QString markerID) {
+bool FeatureCollection::isFeatureExpressed(QString markerID) const {
     //REMEMBER: MAYBE -> WOULDTHAT WORK?
 //    Feature feature(markerID, COUNT);
 //    return features.contains(feature);
@@ -68,7 +68,7 @@ bool FeatureCollection::isFeatureExpressed(QString markerID) {
     return false;
 }
 
-bool FeatureCollection::isFeatureExpressed(Feature feature) {
+bool FeatureCollection::isFeatureExpressed(Feature feature) const {
     return this->isFeatureExpressed(feature.ID);
 }
 
@@ -77,7 +77,7 @@ bool FeatureCollection::isFeatureExpressed(Feature feature) {
  * @param index
  * @return
  */
-Feature FeatureCollection::getFeature(int index) {
+Feature FeatureCollection::getFeature(int index) const {
     return features[index];
 }
 
@@ -86,7 +86,7 @@ Feature FeatureCollection::getFeature(int index) {
  * @param ID
  * @return
  */
-Feature FeatureCollection::getFeature(QString featureID) {
+Feature FeatureCollection::getFeature(QString featureID) const {
     for (Feature feature : this->features) {
         if (feature.ID == featureID)
             return feature;
@@ -100,7 +100,7 @@ Feature FeatureCollection::getFeature(QString featureID) {
  * @param index
  * @return
  */
-QString FeatureCollection::getFeatureID(int index) {
+QString FeatureCollection::getFeatureID(int index) const {
     return features[index].ID;
 }
 
@@ -109,7 +109,7 @@ QString FeatureCollection::getFeatureID(int index) {
  * @param index
  * @return
  */
-double FeatureCollection::getFeatureExpressionCount(int index) {
+double FeatureCollection::getFeatureExpressionCount(int index) const {
     return features[index].count;
 }
 
@@ -117,7 +117,7 @@ double FeatureCollection::getFeatureExpressionCount(int index) {
  * @brief FeatureCollection::getNumberOfFeatures
  * @return Number of expressed features
  */
-int FeatureCollection::getNumberOfFeatures() {
+int FeatureCollection::getNumberOfFeatures() const {
     return features.length();
 }
 
@@ -125,7 +125,7 @@ int FeatureCollection::getNumberOfFeatures() {
  * @brief FeatureCollection::getFeatures
  * @return List of features associated with FeatureCollection
  */
-QVector<Feature> FeatureCollection::getFeatures() {
+QVector<Feature> FeatureCollection::getFeatures() const {
     QVector<Feature> copyCollection = this->features;
     return copyCollection;
 }
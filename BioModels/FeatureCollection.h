@@ -24,16 +24,16 @@ public:
     void addFeature(QString featureID, double expressionCount);
     void addFeature(Feature feature);
 
-    bool isFeatureExpressed(QString markerID);
-    bool isFeatureExpressed(Feature feature);
-
-    Feature getFeature(int index);
-    Feature getFeature(QString featureID);
-    QString getFeatureID(int index);
-    double getFeatureExpressionCount(int index);
-    int getNumberOfFeatures();
-    QVector<Feature> getFeatures();
-    QVector<double> getMostExpressedFeaturesCounts(int number);
+    bool isFeatureExpressed(QString markerID) const;
+    bool isFeatureExpressed(Feature feature) const;
+
+    Feature getFeature(int index) const;
+    Feature getFeature(QString featureID) const;
+    QString getFeatureID(int index) const;
+    double getFeatureExpressionCount(int index) const;
+    int getNumberOfFeatures() const;
+    QVector<Feature> getFeatures() const;
+    QVector<double> getMostExpressedFeaturesCounts(int number) const;
     //REMEMBER: Maybe write a function to get a vector of all feature expression counts?
 
 };
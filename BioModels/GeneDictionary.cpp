@@ -0,0 +1,57 @@
+#include "GeneDictionary.h"
+
+#include <QHash>
+#include <QMutexLocker>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief GeneDictionary::GeneDictionary
+ * @param geneIDs - Initial genes in row order - duplicates are skipped
+ */
+GeneDictionary::GeneDictionary(const QStringList & geneIDs) {
+    this->insertGenes(geneIDs);
+}
+
+int GeneDictionary::getNumberOfGenes() const {
+    QMutexLocker locker(&this->mutex);
+    return this->geneIDs.length();
+}
+
+/**
+ * @brief GeneDictionary::getGeneIDs
+ * @return Snapshot of every gene ID in row order - implicitly shared, so later insertions do not change it
+ */
+QStringList GeneDictionary::getGeneIDs() const {
+    QMutexLocker locker(&this->mutex);
+    return this->geneIDs;
+}
+
+/**
+ * @brief GeneDictionary::insertGenes - Looks up the rows of the given genes, genes that are not part of the dictionary yet are appended
+ * @param geneIDs - Gene IDs of e.g. a cluster
+ * @return Row index of every given gene
+ */
+QVector<int> GeneDictionary::insertGenes(const QStringList & geneIDs) {
+    QVector<int> indices;
+    indices.reserve(geneIDs.length());
+
+    QMutexLocker locker(&this->mutex);
+
+    for (const QString & geneID : geneIDs) {
+        auto geneIndex = this->geneIndices.constFind(geneID);
+
+        if (geneIndex != this->geneIndices.constEnd()) {
+            indices.append(geneIndex.value());
+            continue;
+        }
+
+        int newGeneIndex = this->geneIDs.length();
+        this->geneIDs.append(geneID);
+        this->geneIndices.insert(geneID, newGeneIndex);
+        indices.append(newGeneIndex);
+    }
+
+    return indices;
+}
@@ -0,0 +1,31 @@
+#ifndef GENEDICTIONARY_H
+#define GENEDICTIONARY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The GeneDictionary class assigns every gene ID of a project a fixed row index. Genes are only ever appended, so the rows of
+ *        expression matrices that were built earlier stay valid when later datasets bring in new genes - they simply have no row for them.
+ *        Datasets are added concurrently from the pool threads, every access is guarded by a mutex.
+ */
+class GeneDictionary
+{
+private:
+    mutable QMutex mutex;
+    QStringList geneIDs;
+    QHash<QString, int> geneIndices;
+
+public:
+    GeneDictionary(const QStringList & geneIDs = QStringList());
+
+    int getNumberOfGenes() const;
+    QStringList getGeneIDs() const;
+
+    QVector<int> insertGenes(const QStringList & geneIDs);
+};
+
+#endif // GENEDICTIONARY_H
@@ -0,0 +1,79 @@
+#include "SparseMatrix.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <utility>
+
+SparseMatrix::SparseMatrix()
+    : columnOffsets {0}
+{}
+
+/**
+ * @brief SparseMatrix::SparseMatrix - Takes over the CSC arrays without copying them
+ * @param geneIDs - Gene ID of every row
+ * @param cellBarcodes - Barcode of every column
+ * @param columnOffsets - Start of every column in the value arrays, followed by the number of non-zeros
+ * @param geneIndices - Row of every value - a row may appear more than once per column, its values add up
+ * @param values - Non-zero counts, column by column
+ */
+SparseMatrix::SparseMatrix(const QStringList & geneIDs, const QStringList & cellBarcodes, std::vector<qint64> && columnOffsets, std::vector<quint32> && geneIndices, std::vector<float> && values)
+    : geneIDs {geneIDs}, cellBarcodes {cellBarcodes}, columnOffsets {std::move(columnOffsets)}, geneIndices {std::move(geneIndices)}, values {std::move(values)}
+{}
+
+int SparseMatrix::getNumberOfGenes() const {
+    return this->geneIDs.length();
+}
+
+int SparseMatrix::getNumberOfCells() const {
+    return this->cellBarcodes.length();
+}
+
+qint64 SparseMatrix::getNumberOfNonZeros() const {
+    return qint64(this->values.size());
+}
+
+const QStringList & SparseMatrix::getGeneIDs() const {
+    return this->geneIDs;
+}
+
+const QStringList & SparseMatrix::getCellBarcodes() const {
+    return this->cellBarcodes;
+}
+
+const qint64 * SparseMatrix::getColumnOffsets() const {
+    return this->columnOffsets.data();
+}
+
+const quint32 * SparseMatrix::getGeneIndices() const {
+    return this->geneIndices.data();
+}
+
+const float * SparseMatrix::getValues() const {
+    return this->values.data();
+}
+
+qint64 SparseMatrix::getColumnStart(int cellIndex) const {
+    return this->columnOffsets[size_t(cellIndex)];
+}
+
+qint64 SparseMatrix::getColumnEnd(int cellIndex) const {
+    return this->columnOffsets[size_t(cellIndex) + 1];
+}
+
+/**
+ * @brief SparseMatrix::getValue - Looks up a single count by scanning the column of the cell - meant for single lookups, not for loops over the matrix
+ * @param geneIndex - Row of the gene
+ * @param cellIndex - Column of the cell
+ * @return Count - the sum of every entry of the gene, features of the same gene name share a row
+ */
+float SparseMatrix::getValue(int geneIndex, int cellIndex) const {
+    float value = 0;
+
+    for (qint64 k = this->getColumnStart(cellIndex); k < this->getColumnEnd(cellIndex); k++) {
+        if (this->geneIndices[size_t(k)] == quint32(geneIndex)) {
+            value += this->values[size_t(k)];
+        }
+    }
+    return value;
+}
@@ -0,0 +1,44 @@
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <vector>
+
+/**
+ * @brief The SparseMatrix class holds the per cell counts of a dataset as genes x cells matrix in compressed sparse column (CSC) layout:
+ *        the counts of cell j are values[columnOffsets[j] .. columnOffsets[j + 1]) with their gene in geneIndices at the same positions.
+ *        Genes are 32 bit row indices into the project's gene dictionary (a gene may appear more than once per cell if features share its name, the counts add up), the rows are a prefix of the dictionary as it was when the matrix was built.
+ *        The arrays are std::vectors, a million cells easily exceed the 2^31 elements a QVector can hold.
+ */
+class SparseMatrix
+{
+private:
+    QStringList geneIDs;
+    QStringList cellBarcodes;
+    std::vector<qint64> columnOffsets;
+    std::vector<quint32> geneIndices;
+    std::vector<float> values;
+
+public:
+    SparseMatrix();
+    SparseMatrix(const QStringList & geneIDs, const QStringList & cellBarcodes, std::vector<qint64> && columnOffsets, std::vector<quint32> && geneIndices, std::vector<float> && values);
+
+    int getNumberOfGenes() const;
+    int getNumberOfCells() const;
+    qint64 getNumberOfNonZeros() const;
+    const QStringList & getGeneIDs() const;
+    const QStringList & getCellBarcodes() const;
+
+    const qint64 * getColumnOffsets() const;
+    const quint32 * getGeneIndices() const;
+    const float * getValues() const;
+
+    qint64 getColumnStart(int cellIndex) const;
+    qint64 getColumnEnd(int cellIndex) const;
+    float getValue(int geneIndex, int cellIndex) const;
+};
+
+#endif // SPARSEMATRIX_H
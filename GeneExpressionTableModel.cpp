@@ -0,0 +1,184 @@
+#include "GeneExpressionTableModel.h"
+
+#include <QString>
+#include <QtConcurrent/QtConcurrent>
+
+#include "Utils/Sorter.h"
+
+namespace {
+
+// Pending sort column while no sort waits for its permutation
+const int noPendingSort = -2;
+
+}
+
+
+GeneExpressionTableModel::GeneExpressionTableModel(QObject * parent)
+    : QAbstractTableModel(parent), pendingSortColumn {noPendingSort}, pendingSortOrder {Qt::AscendingOrder}
+{
+    QObject::connect(&this->sortPermutationWatcher, &QFutureWatcherBase::finished, this, &GeneExpressionTableModel::applyPendingSort);
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::setExpressionMatrix - Replaces the shown matrix. The matrix is implicitly shared, so this does not copy any values
+ * @param expressionMatrix - Genes x clusters matrix of the dataset
+ */
+void GeneExpressionTableModel::setExpressionMatrix(const ExpressionMatrix & expressionMatrix) {
+    this->beginResetModel();
+    this->expressionMatrix = expressionMatrix;
+    this->rowGeneIndices.clear();
+    this->geneRowIndices.clear();
+    this->pendingSortColumn = noPendingSort;
+    this->endResetModel();
+
+    // Every cluster is sorted in its own task, sorting by a column is deferred until its permutation is finished
+    this->futureSortPermutations.clear();
+    for (int j = 0; j < expressionMatrix.getNumberOfClusters(); j++) {
+        this->futureSortPermutations.append(QtConcurrent::run([expressionMatrix, j]() {
+            return Sorter::calculateSortPermutation(expressionMatrix.getClusterValues(j));
+        }));
+    }
+}
+
+
+const ExpressionMatrix & GeneExpressionTableModel::getExpressionMatrix() const {
+    return this->expressionMatrix;
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::getGeneIndex - Maps a row of the (possibly sorted) table to its row in the expression matrix
+ * @param row - Row of the table
+ * @return Index of the gene shown in the row
+ */
+int GeneExpressionTableModel::getGeneIndex(int row) const {
+    return this->rowGeneIndices.isEmpty() ? row : this->rowGeneIndices[row];
+}
+
+
+int GeneExpressionTableModel::rowCount(const QModelIndex & parent) const {
+    return parent.isValid() ? 0 : this->expressionMatrix.getNumberOfGenes();
+}
+
+
+int GeneExpressionTableModel::columnCount(const QModelIndex & parent) const {
+    return parent.isValid() ? 0 : this->expressionMatrix.getNumberOfClusters();
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::data - Reads the expression count of a single cell from the matrix
+ * @param index - Cell of the table
+ * @param role - Only the display and alignment roles are served
+ * @return The expression count, "< 1" if the gene is not expressed in the cluster
+ */
+QVariant GeneExpressionTableModel::data(const QModelIndex & index, int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (role == Qt::TextAlignmentRole) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    int geneIndex = this->getGeneIndex(index.row());
+
+    if (!this->expressionMatrix.isExpressed(geneIndex, index.column())) {
+        return QString("< 1");
+    }
+
+    return double(this->expressionMatrix.getValue(geneIndex, index.column()));
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::headerData - Clusters are numbered in the horizontal header, genes are named in the vertical header
+ */
+QVariant GeneExpressionTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    if (orientation == Qt::Horizontal) {
+        return QString("Cluster " + QString::number(section + 1));
+    }
+
+    return this->expressionMatrix.getGeneID(this->getGeneIndex(section));
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::sort - Shows the genes in the order of their expression in the given cluster. Genes that are not expressed count as smallest value.
+ *        If the permutation of the cluster is still being calculated the sort is applied once it is finished
+ * @param column - Cluster to sort by - a negative column restores the original order
+ * @param order - Ascending or descending
+ */
+void GeneExpressionTableModel::sort(int column, Qt::SortOrder order) {
+    if (column >= this->futureSortPermutations.length()) {
+        return;
+    }
+
+    this->pendingSortColumn = noPendingSort;
+
+    if (column >= 0 && !this->futureSortPermutations[column].isFinished()) {
+        this->pendingSortColumn = column;
+        this->pendingSortOrder = order;
+        this->sortPermutationWatcher.setFuture(this->futureSortPermutations[column]);
+        return;
+    }
+
+    emit this->layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+    // Remember the gene behind every persistent index (e.g. the selection) before the rows change
+    QModelIndexList persistentIndices = this->persistentIndexList();
+    QVector<int> persistentGeneIndices;
+    persistentGeneIndices.reserve(persistentIndices.length());
+    for (const QModelIndex & persistentIndex : persistentIndices) {
+        persistentGeneIndices.append(this->getGeneIndex(persistentIndex.row()));
+    }
+
+    if (column < 0) {
+        this->rowGeneIndices.clear();
+        this->geneRowIndices.clear();
+    } else {
+        this->rowGeneIndices = this->futureSortPermutations[column].result();
+
+        if (order == Qt::DescendingOrder) {
+            std::reverse(this->rowGeneIndices.begin(), this->rowGeneIndices.end());
+        }
+
+        this->geneRowIndices.resize(this->rowGeneIndices.length());
+        for (int row = 0; row < this->rowGeneIndices.length(); row++) {
+            this->geneRowIndices[this->rowGeneIndices[row]] = row;
+        }
+    }
+
+    QModelIndexList movedIndices;
+    movedIndices.reserve(persistentIndices.length());
+    for (int i = 0; i < persistentIndices.length(); i++) {
+        int row = this->geneRowIndices.isEmpty() ? persistentGeneIndices[i] : this->geneRowIndices[persistentGeneIndices[i]];
+        movedIndices.append(this->index(row, persistentIndices[i].column()));
+    }
+    this->changePersistentIndexList(persistentIndices, movedIndices);
+
+    emit this->layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+
+/**
+ * @brief GeneExpressionTableModel::applyPendingSort - Applies the sort that waited for the permutation of its cluster, unless a newer sort or matrix replaced it
+ */
+void GeneExpressionTableModel::applyPendingSort() {
+    int column = this->pendingSortColumn;
+
+    if (column < 0 || column >= this->futureSortPermutations.length() || !this->futureSortPermutations[column].isFinished()) {
+        return;
+    }
+
+    this->sort(column, this->pendingSortOrder);
+}
@@ -0,0 +1,56 @@
+#ifndef GENEEXPRESSIONTABLEMODEL_H
+#define GENEEXPRESSIONTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QModelIndex>
+#include <QVariant>
+#include <QObject>
+#include <QVector>
+#include <QFuture>
+#include <QFutureWatcher>
+
+#include "BioModels/ExpressionMatrix.h"
+
+/**
+ * @brief The GeneExpressionTableModel class exposes an expression matrix to a table view. Cells are never stored,
+ *        the view asks for the values of the visible cells only and they are read from the matrix on demand.
+ *        Sorting never compares cells - the sort permutation of every cluster is computed once in the background and sorting just swaps the row order.
+ *        Sorting by a cluster whose permutation is not finished yet is applied once it is, the GUI thread never waits for it.
+ */
+class GeneExpressionTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+private:
+    ExpressionMatrix expressionMatrix;
+
+    // Genes of every cluster in ascending order of expression - computed on worker threads
+    QVector<QFuture<QVector<int>>> futureSortPermutations;
+
+    // Sort that waits for the permutation of its cluster - a newer sort replaces it
+    QFutureWatcher<QVector<int>> sortPermutationWatcher;
+    int pendingSortColumn;
+    Qt::SortOrder pendingSortOrder;
+
+    // Gene shown in every row and row of every gene - empty while the table is unsorted
+    QVector<int> rowGeneIndices;
+    QVector<int> geneRowIndices;
+
+public:
+    explicit GeneExpressionTableModel(QObject * parent = nullptr);
+
+    void setExpressionMatrix(const ExpressionMatrix & expressionMatrix);
+    const ExpressionMatrix & getExpressionMatrix() const;
+    int getGeneIndex(int row) const;
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private slots:
+    void applyPendingSort();
+};
+
+#endif // GENEEXPRESSIONTABLEMODEL_H
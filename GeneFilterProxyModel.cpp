@@ -0,0 +1,37 @@
+#include "GeneFilterProxyModel.h"
+
+#include "GeneExpressionTableModel.h"
+
+GeneFilterProxyModel::GeneFilterProxyModel(QObject * parent)
+    : QSortFilterProxyModel(parent)
+{}
+
+
+/**
+ * @brief GeneFilterProxyModel::setRowMask - Shows only the genes whose bit is set
+ * @param rowMask - One bit per gene of the expression matrix - an empty mask shows every row
+ */
+void GeneFilterProxyModel::setRowMask(const QBitArray & rowMask) {
+    this->rowMask = rowMask;
+    this->invalidateFilter();
+}
+
+
+bool GeneFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex & sourceParent) const {
+    Q_UNUSED(sourceParent)
+
+    // The mask is indexed by gene, the rows of the source model may be sorted
+    int geneIndex = static_cast<const GeneExpressionTableModel *>(this->sourceModel())->getGeneIndex(sourceRow);
+
+    return geneIndex >= this->rowMask.size() || this->rowMask.testBit(geneIndex);
+}
+
+
+/**
+ * @brief GeneFilterProxyModel::sort - Forwards the sorting to the source model. The proxy keeps the source order and only filters
+ * @param column - Cluster to sort by
+ * @param order - Ascending or descending
+ */
+void GeneFilterProxyModel::sort(int column, Qt::SortOrder order) {
+    this->sourceModel()->sort(column, order);
+}
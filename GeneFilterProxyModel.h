@@ -0,0 +1,31 @@
+#ifndef GENEFILTERPROXYMODEL_H
+#define GENEFILTERPROXYMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QBitArray>
+#include <QModelIndex>
+#include <QObject>
+
+/**
+ * @brief The GeneFilterProxyModel class hides the rows of the gene expression table that are not part of a precomputed gene mask.
+ *        The mask is computed elsewhere - filtering itself is a single bit test per row. Sorting is left to the source model,
+ *        which already knows the sort order of every cluster.
+ */
+class GeneFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+private:
+    QBitArray rowMask;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex & sourceParent) const override;
+
+public:
+    explicit GeneFilterProxyModel(QObject * parent = nullptr);
+
+    void setRowMask(const QBitArray & rowMask);
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+};
+
+#endif // GENEFILTERPROXYMODEL_H
@@ -0,0 +1,230 @@
+#include "ExpressionHeatmap.h"
+
+#include <QVector>
+#include <QString>
+#include <QSharedPointer>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief ExpressionHeatmap::ExpressionHeatmap - Sets up an empty color map with clusters on the x axis and genes on the (reversed) y axis.
+ *        Only the gene axis can be dragged and zoomed
+ * @param parent
+ */
+ExpressionHeatmap::ExpressionHeatmap(QWidget * parent)
+    : QCustomPlot(parent), numberOfGenes {0}, numberOfClusters {0}, poolingMode {MaximumPooling}
+{
+#ifdef QCUSTOMPLOT_USE_OPENGL
+    // Renders through an OpenGL framebuffer - see opengl_plots in Badger.pro
+    this->setOpenGl(true);
+#endif
+
+    this->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    this->axisRect()->setRangeDrag(Qt::Vertical);
+    this->axisRect()->setRangeZoom(Qt::Vertical);
+
+    this->xAxis->setLabel("Cluster");
+    this->yAxis->setLabel("Gene");
+    this->yAxis->setRangeReversed(true);
+
+    this->colorMap = new QCPColorMap(this->xAxis, this->yAxis);
+    this->colorMap->setInterpolate(false);
+    this->colorMap->setTightBoundary(true);
+
+    this->colorScale = new QCPColorScale(this);
+    this->colorScale->setLabel("log2(count + 1)");
+    this->plotLayout()->addElement(0, 1, this->colorScale);
+    this->colorMap->setColorScale(this->colorScale);
+    this->colorMap->setGradient(QCPColorGradient::gpThermal);
+
+    QObject::connect(this->yAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged), this, &ExpressionHeatmap::on_geneRangeChanged);
+    QObject::connect(&this->pyramidWatcher, &QFutureWatcherBase::finished, this, &ExpressionHeatmap::on_pyramidBuilt);
+}
+
+
+/**
+ * @brief ExpressionHeatmap::buildPyramid - Pools the matrix into levels of halving row count until a single row is left.
+ *        Counts are plotted as log2(count + 1), genes that are not expressed count as 0
+ * @param expressionMatrix - Genes x clusters matrix
+ * @return Levels of the pyramid - level 0 holds the unpooled rows
+ */
+QVector<ExpressionHeatmap::PyramidLevel> ExpressionHeatmap::buildPyramid(const ExpressionMatrix & expressionMatrix) {
+    QVector<PyramidLevel> pyramid;
+
+    int numberOfRows = expressionMatrix.getNumberOfGenes(),
+        numberOfClusters = expressionMatrix.getNumberOfClusters();
+
+    if (numberOfRows == 0 || numberOfClusters == 0) {
+        return pyramid;
+    }
+
+    PyramidLevel baseLevel;
+    baseLevel.numberOfRows = numberOfRows;
+    baseLevel.maximumValues.resize(numberOfRows * numberOfClusters);
+
+    for (int i = 0; i < numberOfRows; i++) {
+        for (int j = 0; j < numberOfClusters; j++) {
+            float value = expressionMatrix.getValue(i, j);
+            baseLevel.maximumValues[i * numberOfClusters + j] = std::isnan(value) ? 0.0f : std::log2(1.0f + value);
+        }
+    }
+
+    // The mean and the maximum of a single gene are the same - the vectors share their data
+    baseLevel.meanValues = baseLevel.maximumValues;
+    pyramid.append(baseLevel);
+
+    // Every level pools pairs of rows of the level below. The last row of an odd level is carried over on its own
+    while (pyramid.last().numberOfRows > 1) {
+        const PyramidLevel & lowerLevel = pyramid.last();
+
+        PyramidLevel level;
+        level.numberOfRows = (lowerLevel.numberOfRows + 1) / 2;
+        level.maximumValues.resize(level.numberOfRows * numberOfClusters);
+        level.meanValues.resize(level.numberOfRows * numberOfClusters);
+
+        for (int i = 0; i < level.numberOfRows; i++) {
+            int firstRow = 2 * i,
+                secondRow = qMin(2 * i + 1, lowerLevel.numberOfRows - 1);
+
+            for (int j = 0; j < numberOfClusters; j++) {
+                int first = firstRow * numberOfClusters + j,
+                    second = secondRow * numberOfClusters + j;
+
+                level.maximumValues[i * numberOfClusters + j] = qMax(lowerLevel.maximumValues[first], lowerLevel.maximumValues[second]);
+                level.meanValues[i * numberOfClusters + j] = (lowerLevel.meanValues[first] + lowerLevel.meanValues[second]) / 2;
+            }
+        }
+
+        pyramid.append(level);
+    }
+
+    return pyramid;
+}
+
+
+/**
+ * @brief ExpressionHeatmap::setExpressionMatrix - Starts building the pyramid of the matrix in the background. The plot is filled once it is finished
+ * @param expressionMatrix - Genes x clusters matrix of the dataset - implicitly shared, the values are not copied
+ */
+void ExpressionHeatmap::setExpressionMatrix(const ExpressionMatrix & expressionMatrix) {
+    this->numberOfGenes = expressionMatrix.getNumberOfGenes();
+    this->numberOfClusters = expressionMatrix.getNumberOfClusters();
+
+    // Cluster ticks are labeled like the table headers
+    QSharedPointer<QCPAxisTickerText> clusterTicker(new QCPAxisTickerText);
+    for (int j = 0; j < this->numberOfClusters; j++) {
+        clusterTicker->addTick(j, QString::number(j + 1));
+    }
+    this->xAxis->setTicker(clusterTicker);
+    this->xAxis->setRange(-0.5, this->numberOfClusters - 0.5);
+
+    this->pyramidWatcher.setFuture(QtConcurrent::run([expressionMatrix]() {
+        return ExpressionHeatmap::buildPyramid(expressionMatrix);
+    }));
+}
+
+
+/**
+ * @brief ExpressionHeatmap::setPoolingMode - Maximum pooling keeps single highly expressed genes visible when zoomed out, mean pooling shows the overall level
+ * @param poolingMode - One of MaximumPooling or MeanPooling
+ */
+void ExpressionHeatmap::setPoolingMode(const PoolingMode poolingMode) {
+    this->poolingMode = poolingMode;
+    this->updateVisibleRows();
+}
+
+
+void ExpressionHeatmap::resizeEvent(QResizeEvent * resizeEvent) {
+    QCustomPlot::resizeEvent(resizeEvent);
+    this->updateVisibleRows();
+}
+
+
+// ++++++++++++++++++++++++++++++++ SLOTS ++++++++++++++++++++++++++++++++
+/**
+ * @brief ExpressionHeatmap::on_pyramidBuilt - Shows the whole dataset. The color range is fixed to the complete data, so colors do not change while zooming
+ */
+void ExpressionHeatmap::on_pyramidBuilt() {
+    this->pyramid = this->pyramidWatcher.result();
+
+    if (this->pyramid.isEmpty()) {
+        return;
+    }
+
+    const QVector<float> & baseValues = this->pyramid.first().maximumValues;
+    float maximumValue = *std::max_element(baseValues.begin(), baseValues.end());
+    this->colorMap->setDataRange(QCPRange(0, qMax(maximumValue, 1.0f)));
+
+    this->yAxis->setRange(-0.5, this->numberOfGenes - 0.5);
+    this->updateVisibleRows();
+}
+
+
+/**
+ * @brief ExpressionHeatmap::on_geneRangeChanged - Keeps dragging and zooming within the genes of the dataset
+ * @param newRange - Range the user dragged or zoomed to
+ */
+void ExpressionHeatmap::on_geneRangeChanged(const QCPRange & newRange) {
+    QCPRange boundedRange = newRange.bounded(-0.5, qMax(this->numberOfGenes, 1) - 0.5);
+
+    if (boundedRange != newRange) {
+        this->yAxis->setRange(boundedRange);
+        return;
+    }
+
+    this->updateVisibleRows();
+}
+
+
+/**
+ * @brief ExpressionHeatmap::updateVisibleRows - Picks the coarsest level with at least one row per pixel for the visible genes
+ *        and hands the visible rows of that level to the color map
+ */
+void ExpressionHeatmap::updateVisibleRows() {
+    if (this->pyramid.isEmpty()) {
+        return;
+    }
+
+    QCPRange geneRange = this->yAxis->range();
+    int plotHeight = qMax(this->axisRect()->height(), 1);
+
+    // Level n pools 2^n genes - take the first level that fits the visible genes into the plot height
+    int levelIndex = 0;
+    while (levelIndex + 1 < this->pyramid.length() && geneRange.size() / (1 << levelIndex) > plotHeight) {
+        levelIndex++;
+    }
+
+    const PyramidLevel & level = this->pyramid[levelIndex];
+    const QVector<float> & values = this->poolingMode == MaximumPooling ? level.maximumValues : level.meanValues;
+    int genesPerRow = 1 << levelIndex;
+
+    int firstRow = qBound(0, int(std::floor(geneRange.lower / genesPerRow)), level.numberOfRows - 1),
+        lastRow = qBound(0, int(std::ceil(geneRange.upper / genesPerRow)), level.numberOfRows - 1);
+    int numberOfVisibleRows = lastRow - firstRow + 1;
+
+    // The cells are centered on their rows - a pooled row sits in the middle of its genes
+    double firstRowCenter = firstRow * genesPerRow + (genesPerRow - 1) / 2.0,
+           lastRowCenter = lastRow * genesPerRow + (genesPerRow - 1) / 2.0;
+
+    if (numberOfVisibleRows == 1) {
+        firstRowCenter -= 0.5;
+        lastRowCenter += 0.5;
+    }
+
+    QCPColorMapData * colorMapData = this->colorMap->data();
+    colorMapData->setSize(this->numberOfClusters, numberOfVisibleRows);
+    colorMapData->setRange(QCPRange(0, qMax(this->numberOfClusters - 1, 1)), QCPRange(firstRowCenter, lastRowCenter));
+
+    for (int i = 0; i < numberOfVisibleRows; i++) {
+        const float * rowValues = values.constData() + (firstRow + i) * this->numberOfClusters;
+
+        for (int j = 0; j < this->numberOfClusters; j++) {
+            colorMapData->setCell(j, i, rowValues[j]);
+        }
+    }
+
+    this->replot(QCustomPlot::rpQueuedReplot);
+}
+// ++++++++++++++++++++++++++++++++ SLOTS ++++++++++++++++++++++++++++++++
@@ -0,0 +1,62 @@
+#ifndef EXPRESSIONHEATMAP_H
+#define EXPRESSIONHEATMAP_H
+
+#include <QWidget>
+#include <QVector>
+#include <QFutureWatcher>
+#include <QResizeEvent>
+
+#include "Graphics/qcustomplot.h"
+#include "BioModels/ExpressionMatrix.h"
+
+/**
+ * @brief The ExpressionHeatmap class plots the genes x clusters expression matrix of a dataset as color map.
+ *        Zoomed out, neighbouring genes are pooled: a pyramid of levels that halve the number of rows is precomputed on a worker thread,
+ *        and only the rows of the level that fits the visible range into the plot height are handed to the color map.
+ *        This keeps every replot bounded by the plot size instead of the number of genes.
+ */
+class ExpressionHeatmap : public QCustomPlot
+{
+    Q_OBJECT
+
+public:
+    enum PoolingMode { MaximumPooling = 0, MeanPooling = 1 };
+
+    /**
+     * @brief The PyramidLevel struct holds the pooled rows of one level - level n pools 2^n genes into a row
+     */
+    struct PyramidLevel
+    {
+        int numberOfRows;
+        QVector<float> maximumValues;
+        QVector<float> meanValues;
+    };
+
+private:
+    QCPColorMap * colorMap;
+    QCPColorScale * colorScale;
+
+    int numberOfGenes;
+    int numberOfClusters;
+    PoolingMode poolingMode;
+
+    QVector<PyramidLevel> pyramid;
+    QFutureWatcher<QVector<PyramidLevel>> pyramidWatcher;
+
+    void resizeEvent(QResizeEvent * resizeEvent) override;
+
+public:
+    explicit ExpressionHeatmap(QWidget * parent = nullptr);
+
+    static QVector<PyramidLevel> buildPyramid(const ExpressionMatrix & expressionMatrix);
+
+    void setExpressionMatrix(const ExpressionMatrix & expressionMatrix);
+    void setPoolingMode(const PoolingMode poolingMode);
+
+private slots:
+    void on_pyramidBuilt();
+    void on_geneRangeChanged(const QCPRange & newRange);
+    void updateVisibleRows();
+};
+
+#endif // EXPRESSIONHEATMAP_H
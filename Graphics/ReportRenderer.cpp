@@ -0,0 +1,222 @@
+#include "ReportRenderer.h"
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Graphics/qcustomplot.h"
+
+namespace ReportRenderer {
+
+namespace {
+
+// Size of the rendered reports in pixels (PNG) or points (PDF)
+const int reportWidth = 1200,
+          reportHeight = 800;
+
+// Number of most expressed genes of every top type that are shown in the marker heatmap
+const int numberOfMarkersPerType = 5;
+
+/**
+ * @brief ensureOffscreenApplication - Creates the application the plots need on the offscreen platform, unless the process already has one.
+ *        The application lives until the process exits
+ */
+void ensureOffscreenApplication() {
+    if (QCoreApplication::instance() != nullptr) {
+        return;
+    }
+
+    static int argc = 1;
+    static char applicationName[] = "Badger";
+    static char * argv[] = { applicationName, nullptr };
+
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    new QApplication(argc, argv);
+}
+
+
+/**
+ * @brief savePlot - Writes the plot in the requested format
+ */
+bool savePlot(QCustomPlot & plot, const QString filePath, const QString reportFormat) {
+    if (reportFormat == "pdf") {
+        return plot.savePdf(filePath, reportWidth, reportHeight);
+    }
+    return plot.savePng(filePath, reportWidth, reportHeight);
+}
+
+
+/**
+ * @brief renderCorrelationChart - Horizontal bar chart with the correlations of the top n types of every cluster, grouped by cluster.
+ *        The best type is named in the cluster label
+ */
+bool renderCorrelationChart(const QString filePath, const QString reportFormat,
+                            const QVector<FeatureCollection> & clusters, const QVector<QVector<QPair<QString, double>>> & correlations, const int numberOfTopTypes) {
+    QCustomPlot plot;
+    QCPBarsGroup * barsGroup = new QCPBarsGroup(&plot);
+
+    QSharedPointer<QCPAxisTickerText> clusterTicker(new QCPAxisTickerText);
+    for (int i = 0; i < correlations.length(); i++) {
+        QString topType = correlations[i].isEmpty() ? QString("-") : correlations[i].first().first;
+        clusterTicker->addTick(i, clusters[i].ID + ": " + topType);
+    }
+
+    // The best type is always shown - the ranks share the width of a cluster
+    int numberOfRanks = qMax(numberOfTopTypes, 1);
+
+    for (int rank = 0; rank < numberOfRanks; rank++) {
+        QVector<double> keys, values;
+
+        for (int i = 0; i < correlations.length(); i++) {
+            if (rank < correlations[i].length()) {
+                keys.append(i);
+                values.append(correlations[i][rank].second);
+            }
+        }
+
+        QCPBars * bars = new QCPBars(plot.yAxis, plot.xAxis);
+        bars->setName("Rank " + QString::number(rank + 1));
+        bars->setWidth(0.8 / numberOfRanks);
+        bars->setBrush(QColor::fromHsv(210, 255 - rank * 160 / numberOfRanks, 220));
+        bars->setPen(Qt::NoPen);
+        bars->setBarsGroup(barsGroup);
+        bars->setData(keys, values, true);
+    }
+
+    plot.yAxis->setTicker(clusterTicker);
+    plot.yAxis->setRangeReversed(true);
+    plot.yAxis->setRange(-0.5, correlations.length() - 0.5);
+    plot.xAxis->setLabel("Correlation");
+    plot.xAxis->setRange(-1, 1);
+    plot.legend->setVisible(true);
+
+    return savePlot(plot, filePath, reportFormat);
+}
+
+
+/**
+ * @brief renderMarkerHeatmap - Heatmap of the expression of the markers of every cluster's top types in every cluster.
+ *        The markers of a type are its most expressed genes in the reference
+ */
+bool renderMarkerHeatmap(const QString filePath, const QString reportFormat,
+                         const QVector<FeatureCollection> & clusters, const QVector<QVector<QPair<QString, double>>> & correlations,
+                         const QVector<FeatureCollection> & reference) {
+    QHash<QString, int> referenceIndices;
+    for (int i = 0; i < reference.length(); i++) {
+        referenceIndices.insert(reference[i].ID, i);
+    }
+
+    // Collect the markers of the top type of every cluster - every gene only once
+    QStringList markerIDs;
+    for (const QVector<QPair<QString, double>> & clusterCorrelations : correlations) {
+        if (clusterCorrelations.isEmpty() || !referenceIndices.contains(clusterCorrelations.first().first)) {
+            continue;
+        }
+
+        FeatureCollection topType = reference[referenceIndices.value(clusterCorrelations.first().first)];
+        QVector<Feature> features = topType.getFeatures();
+        std::partial_sort(features.begin(), features.begin() + qMin(numberOfMarkersPerType, features.length()), features.end(),
+                          [](const Feature & a, const Feature & b) { return a.count > b.count; });
+
+        for (int k = 0; k < qMin(numberOfMarkersPerType, features.length()); k++) {
+            if (!markerIDs.contains(features[k].ID)) {
+                markerIDs.append(features[k].ID);
+            }
+        }
+    }
+
+    QCustomPlot plot;
+    QCPColorMap * colorMap = new QCPColorMap(plot.xAxis, plot.yAxis);
+    QCPColorScale * colorScale = new QCPColorScale(&plot);
+    plot.plotLayout()->addElement(0, 1, colorScale);
+    colorScale->setLabel("log2(count + 1)");
+    colorMap->setColorScale(colorScale);
+    colorMap->setGradient(QCPColorGradient::gpThermal);
+    colorMap->setInterpolate(false);
+
+    int numberOfClusters = clusters.length(),
+        numberOfMarkers = markerIDs.length();
+
+    if (numberOfClusters > 0 && numberOfMarkers > 0) {
+        colorMap->data()->setSize(numberOfClusters, numberOfMarkers);
+        colorMap->data()->setRange(QCPRange(0, qMax(numberOfClusters - 1, 1)), QCPRange(0, qMax(numberOfMarkers - 1, 1)));
+
+        for (int i = 0; i < numberOfClusters; i++) {
+            QHash<QString, double> clusterCounts;
+            for (const Feature & feature : clusters[i].getFeatures()) {
+                clusterCounts.insert(feature.ID, feature.count);
+            }
+
+            for (int k = 0; k < numberOfMarkers; k++) {
+                colorMap->data()->setCell(i, k, std::log2(1.0 + clusterCounts.value(markerIDs[k], 0.0)));
+            }
+        }
+        colorMap->rescaleDataRange(true);
+    }
+
+    QSharedPointer<QCPAxisTickerText> clusterTicker(new QCPAxisTickerText), markerTicker(new QCPAxisTickerText);
+    for (int i = 0; i < numberOfClusters; i++) {
+        clusterTicker->addTick(i, clusters[i].ID);
+    }
+    for (int k = 0; k < numberOfMarkers; k++) {
+        markerTicker->addTick(k, markerIDs[k]);
+    }
+
+    plot.xAxis->setTicker(clusterTicker);
+    plot.xAxis->setLabel("Cluster");
+    plot.xAxis->setRange(-0.5, numberOfClusters - 0.5);
+    plot.yAxis->setTicker(markerTicker);
+    plot.yAxis->setRangeReversed(true);
+    plot.yAxis->setRange(-0.5, numberOfMarkers - 0.5);
+
+    return savePlot(plot, filePath, reportFormat);
+}
+
+}
+
+
+/**
+ * @brief isSupportedFormat
+ * @param reportFormat - Requested file format
+ * @return True if reports can be rendered in the format - one of png or pdf
+ */
+bool isSupportedFormat(const QString reportFormat) {
+    return reportFormat == "png" || reportFormat == "pdf";
+}
+
+
+/**
+ * @brief renderReports - Renders the correlation bar chart and the marker heatmap of an annotated dataset
+ * @param reportFilePathPrefix - Path the report names are appended to, e.g. results/dataset -> results/dataset.correlations.png
+ * @param reportFormat - One of png or pdf
+ * @param clusters - Clusters of the dataset
+ * @param correlations - Correlations of every cluster as returned by ExpressionComparator - sorted descending
+ * @param reference - Reference the clusters have been correlated with
+ * @param numberOfTopTypes - Number of best correlated types shown per cluster
+ * @return True if both reports have been written
+ */
+bool renderReports(const QString reportFilePathPrefix, const QString reportFormat,
+                   const QVector<FeatureCollection> & clusters, const QVector<QVector<QPair<QString, double>>> & correlations,
+                   const QVector<FeatureCollection> & reference, const int numberOfTopTypes) {
+    if (!isSupportedFormat(reportFormat)) {
+        qDebug() << "REPORT RENDERER: Unsupported format" << reportFormat;
+        return false;
+    }
+
+    ensureOffscreenApplication();
+
+    bool isCorrelationChartSaved = renderCorrelationChart(reportFilePathPrefix + ".correlations." + reportFormat, reportFormat, clusters, correlations, numberOfTopTypes),
+         isMarkerHeatmapSaved = renderMarkerHeatmap(reportFilePathPrefix + ".markers." + reportFormat, reportFormat, clusters, correlations, reference);
+
+    return isCorrelationChartSaved && isMarkerHeatmapSaved;
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef REPORTRENDERER_H
+#define REPORTRENDERER_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+
+#include "BioModels/FeatureCollection.h"
+
+/**
+ * @brief The ReportRenderer namespace renders the report images of an annotated dataset without any window.
+ *        It brings up its own application on Qt's offscreen platform, so it runs without X server and can be used in every batch worker process.
+ */
+namespace ReportRenderer
+{
+    extern bool isSupportedFormat(const QString reportFormat);
+
+    extern bool renderReports(const QString reportFilePathPrefix, const QString reportFormat,
+                              const QVector<FeatureCollection> & clusters, const QVector<QVector<QPair<QString, double>>> & correlations,
+                              const QVector<FeatureCollection> & reference, const int numberOfTopTypes);
+};
+
+#endif // REPORTRENDERER_H
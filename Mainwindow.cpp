@@ -1,6 +1,7 @@
 #include "Mainwindow.h"
 #include "ui_Mainwindow.h"
 
+#include <QApplication>
 #include <QVector>
 #include <QPair>
 #include <QString>
@@ -12,6 +13,8 @@
 #include <QListView>
 #include <QTableWidget>
 #include <QMouseEvent>
+#include <QVBoxLayout>
+#include <QDateTime>
 
 #include "StartDialog.h"
 #include "TabWidget.h"
@@ -22,6 +25,7 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , shownPlaceholder(nullptr)
 {
     ui->setupUi(this);
 
@@ -33,6 +37,14 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Remove the additional tab that is shown by default on tabwidgets
     this->ui->tabWidgetDatasets->removeTab(0);
+
+    // A zero interval timer fires as soon as the event loop is idle
+    this->prefetchTimer.setSingleShot(true);
+    this->prefetchTimer.setInterval(0);
+    QObject::connect(&this->prefetchTimer, &QTimer::timeout, this, &MainWindow::prefetchNextDatasetTab);
+
+    this->releaseTimer.setInterval(releaseAfterMilliseconds / 2);
+    QObject::connect(&this->releaseTimer, &QTimer::timeout, this, &MainWindow::releaseUnvisitedDatasetTabs);
 }
 
 MainWindow::~MainWindow()
@@ -42,20 +54,65 @@ MainWindow::~MainWindow()
 
 
 /**
- * @brief MainWindow::createDatasetItem - Generates a new tab and calls the new tab to populate its table-widgets
+ * @brief MainWindow::createDatasetItem - Generates a new tab for the dataset. The tab is only a placeholder until it is shown or prefetched
  * @param datasetName - File name of the given dataset
- * @param correlations - List of clusters with corresponding correlated types
+ * @param datasetIndex - Index of the dataset in the information center
+ */
+void MainWindow::createDatasetItem(const QString & datasetName, const int datasetIndex) {
+    QWidget * placeholder = new QWidget();
+    QVBoxLayout * placeholderLayout = new QVBoxLayout(placeholder);
+    placeholderLayout->setContentsMargins(0, 0, 0, 0);
+
+    // The tab is registered after inserting it, so the tab widget making it current does not build it yet
+    this->ui->tabWidgetDatasets->insertTab(0, placeholder, datasetName);
+
+    this->datasetTabs.append({ datasetIndex, placeholder, nullptr, 0, false });
+}
+
+
+/**
+ * @brief MainWindow::materializeDatasetTab - Creates the TabWidget of a placeholder and populates its tables from the snapshot
+ * @param datasetTab - Tab that should be shown
  */
-void MainWindow::createDatasetItem(QString datasetName, QVector<QVector<QPair<QString, double>>> correlations, QVector<FeatureCollection> geneExpressions, const QStringList completeGeneIDs) {
-    TabWidget * tabWidget = new TabWidget();
+void MainWindow::materializeDatasetTab(DatasetTab & datasetTab) {
+    datasetTab.lastUsedMilliseconds = QDateTime::currentMSecsSinceEpoch();
+
+    if (datasetTab.tabWidget != nullptr) {
+        return;
+    }
+
+    const InformationCenter & informationCenter = *this->informationCenterSnapshot;
+    int datasetIndex = datasetTab.datasetIndex;
 
-    this->ui->tabWidgetDatasets->insertTab(0, tabWidget, datasetName);
-    this->ui->tabWidgetDatasets->setCurrentIndex(0);
+    TabWidget * tabWidget = new TabWidget(datasetTab.placeholder);
+    datasetTab.placeholder->layout()->addWidget(tabWidget);
+    datasetTab.tabWidget = tabWidget;
 
     // Call the given tab widget to populate its table widgets with the given correlations.
-    // The number stands for the top n most correlated types to be shown in the correlation table widget
-    tabWidget->populateTableTypeCorrelations(correlations, 5);
-    tabWidget->populateTableGeneExpressions(geneExpressions, completeGeneIDs);
+    // The number stands for the top n most correlated types to be shown in the correlation table widget.
+    // The gene expression table reads the expression matrix, which stays in memory even if the clusters have been spilled
+    tabWidget->populateTableTypeCorrelations(informationCenter.correlatedDatasets.at(datasetIndex), 5);
+    tabWidget->populateTableGeneExpressions(informationCenter.expressionMatrices.at(datasetIndex));
+
+    if (!datasetTab.isRendered) {
+        datasetTab.isRendered = true;
+        emit datasetRendered(datasetIndex);
+    }
+}
+
+
+/**
+ * @brief MainWindow::findDatasetTab - Finds the dataset tab that belongs to a page of the tab widget
+ * @param placeholder - Page of the tab widget
+ * @return The dataset tab - nullptr if the page is no dataset tab
+ */
+MainWindow::DatasetTab * MainWindow::findDatasetTab(QWidget * placeholder) {
+    for (DatasetTab & datasetTab : this->datasetTabs) {
+        if (datasetTab.placeholder == placeholder) {
+            return &datasetTab;
+        }
+    }
+    return nullptr;
 }
 
 
@@ -63,9 +120,9 @@ void MainWindow::createDatasetItem(QString datasetName, QVector<QVector<QPair<QS
 /**
  * @brief MainWindow::on_buttonExit_clicked - Shutdown the program
  */
-__attribute__((noreturn)) void MainWindow::on_buttonExit_clicked() {
+void MainWindow::on_buttonExit_clicked() {
     qDebug() << "Exiting";
-    exit(0);
+    QApplication::quit();
 }
 
 /**
@@ -87,28 +144,168 @@ void MainWindow::on_buttonMinimize_clicked() {
     this->setWindowState(Qt::WindowMinimized);
 }
 
+/**
+ * @brief MainWindow::on_buttonAddDatasets_clicked - Lets the user pick further datasets and requests them to be added to the open project
+ */
+void MainWindow::on_buttonAddDatasets_clicked() {
+    QStringList csvMimeTypes = { "text/csv" };
+    QStringList datasetFilePaths = Helper::openFileDialog(this, csvMimeTypes, true);
+
+    if (datasetFilePaths.isEmpty()) {
+        return;
+    }
+
+    ui->labelStatus->setText("Adding datasets.");
+    emit addDatasets(datasetFilePaths);
+}
+
+/**
+ * @brief MainWindow::on_buttonApplyCutoffs_clicked - Requests the correlations of the open project at the cutoffs of the spin boxes
+ */
+void MainWindow::on_buttonApplyCutoffs_clicked() {
+    ui->labelStatus->setText("Applying cutoffs.");
+    emit cutoffsChanged(this->ui->doubleSpinBoxDatasetCutoff->value(), this->ui->doubleSpinBoxCellMarkersCutoff->value());
+}
+
+/**
+ * @brief MainWindow::on_buttonSaveProject_clicked - Asks for a project file and requests the current project to be saved to it
+ */
+void MainWindow::on_buttonSaveProject_clicked() {
+    QString projectFilePath = QFileDialog::getSaveFileName(this, "Save project", QDir::homePath(), "Badger project (*.badger)");
+
+    if (projectFilePath.isEmpty()) {
+        return;
+    }
+
+    if (!projectFilePath.endsWith(".badger")) {
+        projectFilePath.append(".badger");
+    }
+
+    emit saveProject(projectFilePath);
+}
+
 // REACTING TO CONTROLLER
 void MainWindow::on_clusterFileParsed() {
     ui->labelStatus->setText("Finished parsing.");
 }
 
-void MainWindow::on_correlatingFinished(const InformationCenter informationCenter) {
+void MainWindow::on_correlatingFinished(const InformationCenterSnapshot informationCenterSnapshot) {
     this->show();
     qDebug() << "Received signal after correlation finished.";
 
+    // The snapshot is immutable and shared with the coordinator - everything is read through const references
+    const InformationCenter & informationCenter = *informationCenterSnapshot;
+
     QStringList datasetNames;
     datasetNames.reserve(informationCenter.datasetFilePaths.length());
 
     // Get file names for tab titletab titles
     std::transform(informationCenter.datasetFilePaths.begin(), informationCenter.datasetFilePaths.end(), std::back_inserter(datasetNames), Helper::chopFileName);
 
-    for (int i = 0; i < informationCenter.correlatedDatasets.length(); i++) {
-        this->createDatasetItem(datasetNames.at(i), informationCenter.correlatedDatasets.at(i), informationCenter.xClusterCollections.at(i), informationCenter.completeSetOfGeneIDs);
+    // Tabs whose correlations changed - e.g. after new cutoffs - lose their TabWidget and are built again from the new snapshot
+    for (DatasetTab & datasetTab : this->datasetTabs) {
+        bool isOutdated = datasetTab.tabWidget != nullptr
+                && this->informationCenterSnapshot->correlatedDatasets.at(datasetTab.datasetIndex) != informationCenter.correlatedDatasets.at(datasetTab.datasetIndex);
+
+        if (isOutdated) {
+            delete datasetTab.tabWidget;
+            datasetTab.tabWidget = nullptr;
+        }
+    }
+
+    // Keep the snapshot - the tabs are populated from it once they are needed
+    this->informationCenterSnapshot = informationCenterSnapshot;
+
+    this->ui->doubleSpinBoxDatasetCutoff->setValue(informationCenter.datasetCutoff);
+    this->ui->doubleSpinBoxCellMarkersCutoff->setValue(informationCenter.cellMarkersCutoff);
+
+    // Only placeholders are created here, so the window is ready right away.
+    // Only the tab that is shown gets built - see on_tabWidgetDatasets_currentChanged.
+    // Datasets that were added to an open project only get new tabs, the tabs of the earlier datasets are kept
+    int firstNewDatasetIndex = this->datasetTabs.length();
+
+    for (int i = firstNewDatasetIndex; i < informationCenter.correlatedDatasets.length(); i++) {
+        this->createDatasetItem(datasetNames.at(i), i);
+    }
+
+    // Show the first new dataset - otherwise rebuild the current tab if it was outdated
+    if (firstNewDatasetIndex < this->datasetTabs.length()) {
+        int firstNewTabIndex = this->ui->tabWidgetDatasets->indexOf(this->datasetTabs[firstNewDatasetIndex].placeholder);
+        this->ui->tabWidgetDatasets->setCurrentIndex(firstNewTabIndex);
+    }
+    this->on_tabWidgetDatasets_currentChanged(this->ui->tabWidgetDatasets->currentIndex());
+
+    this->releaseTimer.start();
+}
+
+
+/**
+ * @brief MainWindow::on_datasetSpilled - Replaces the kept snapshot by the one without the spilled clusters, so their memory is freed.
+ *        Only the clusters changed, the tabs are kept as they are
+ * @param informationCenterSnapshot - Snapshot after spilling a dataset
+ */
+void MainWindow::on_datasetSpilled(const InformationCenterSnapshot informationCenterSnapshot) {
+    this->informationCenterSnapshot = informationCenterSnapshot;
+}
+
+
+/**
+ * @brief MainWindow::prefetchNextDatasetTab - Materializes the next unbuilt neighbour of the current tab while the GUI is idle.
+ *        The neighbours are the tabs the user most likely visits next, one tab is built per call to keep the GUI responsive
+ */
+void MainWindow::prefetchNextDatasetTab() {
+    int currentIndex = this->ui->tabWidgetDatasets->currentIndex();
+
+    for (int distance = 1; distance <= prefetchedNeighbours; distance++) {
+        for (int index : { currentIndex + distance, currentIndex - distance }) {
+            DatasetTab * datasetTab = this->findDatasetTab(this->ui->tabWidgetDatasets->widget(index));
+
+            if (datasetTab != nullptr && datasetTab->tabWidget == nullptr) {
+                this->materializeDatasetTab(*datasetTab);
+                this->prefetchTimer.start();
+                return;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief MainWindow::releaseUnvisitedDatasetTabs - Deletes the TabWidgets of tabs that have not been used for a while. They are rebuilt when they are shown again
+ */
+void MainWindow::releaseUnvisitedDatasetTabs() {
+    qint64 currentMilliseconds = QDateTime::currentMSecsSinceEpoch();
+    QWidget * currentPlaceholder = this->ui->tabWidgetDatasets->currentWidget();
+
+    for (DatasetTab & datasetTab : this->datasetTabs) {
+        bool isUnused = datasetTab.tabWidget != nullptr && datasetTab.placeholder != currentPlaceholder
+                && currentMilliseconds - datasetTab.lastUsedMilliseconds > releaseAfterMilliseconds;
+
+        if (isUnused) {
+            delete datasetTab.tabWidget;
+            datasetTab.tabWidget = nullptr;
+        }
     }
 }
 
 void MainWindow::on_tabWidgetDatasets_currentChanged(int index)
 {
+    // The tab that is left was used until now, so it is only released once it has not been shown for a while
+    DatasetTab * leftDatasetTab = this->findDatasetTab(this->shownPlaceholder);
+
+    if (leftDatasetTab != nullptr) {
+        leftDatasetTab->lastUsedMilliseconds = QDateTime::currentMSecsSinceEpoch();
+    }
+    this->shownPlaceholder = this->ui->tabWidgetDatasets->widget(index);
+
+    // The tab becomes visible - build it if it is still a placeholder and prefetch its neighbours afterwards
+    DatasetTab * datasetTab = this->findDatasetTab(this->shownPlaceholder);
+
+    if (datasetTab != nullptr) {
+        this->materializeDatasetTab(*datasetTab);
+        this->prefetchTimer.start();
+    }
+
     if (index == this->ui->tabWidgetDatasets->count() - 1) {
         qDebug() << "Trigger upload new dataset";
     }
@@ -8,8 +8,11 @@
 #include <QString>
 #include <QMouseEvent>
 #include <QStringList>
+#include <QTimer>
+#include <QWidget>
 
 #include "StartDialog.h"
+#include "TabWidget.h"
 #include "System/InformationCenter.h"
 #include "BioModels/FeatureCollection.h"
 
@@ -27,26 +30,68 @@ public:
 
 public slots:
     void on_clusterFileParsed();
-    void on_correlatingFinished(const InformationCenter informationCenter);
+    void on_correlatingFinished(const InformationCenterSnapshot informationCenterSnapshot);
+    void on_datasetSpilled(const InformationCenterSnapshot informationCenterSnapshot);
 
 signals:
     void newDatasetTabCreated(const QString datasetName, const QVector<QVector<QPair<QString, double>>> correlation);
+    void datasetRendered(const int datasetIndex);
+    void saveProject(const QString projectFilePath);
+    void addDatasets(const QStringList datasetFilePaths);
+    void cutoffsChanged(const double datasetCutoff, const double cellMarkersCutoff);
 
 private slots:
-    __attribute__((noreturn)) void on_buttonExit_clicked();
+    void on_buttonExit_clicked();
 
     void on_buttonMaximize_clicked();
 
     void on_buttonMinimize_clicked();
 
+    void on_buttonAddDatasets_clicked();
+
+    void on_buttonApplyCutoffs_clicked();
+
+    void on_buttonSaveProject_clicked();
+
     void on_tabWidgetDatasets_currentChanged(int index);
 
+    void prefetchNextDatasetTab();
+
+    void releaseUnvisitedDatasetTabs();
+
 private:
+    /**
+     * @brief The DatasetTab struct is the lightweight placeholder of a dataset tab. Its TabWidget only exists while it is materialized
+     */
+    struct DatasetTab
+    {
+        int datasetIndex;
+        QWidget * placeholder;
+        TabWidget * tabWidget;
+        qint64 lastUsedMilliseconds;
+        // Rebuilding a released tab does not count as rendering it again
+        bool isRendered;
+    };
+
+    // Number of tabs on each side of the current tab that are built in advance
+    static const int prefetchedNeighbours = 1;
+    // Tabs that have not been shown for this long lose their TabWidget
+    static const int releaseAfterMilliseconds = 120000;
+
     Ui::MainWindow *ui;
     QVector<QThread> workingThreads;
 
-    void createDatasetItem(const QString datasetName, const QVector<QVector<QPair<QString, double>>> correlations,
-                           const QVector<FeatureCollection> geneExpressions, const QStringList completeGeneIDs);
+    // The tabs are built from the published snapshot whenever they are needed
+    InformationCenterSnapshot informationCenterSnapshot;
+    QVector<DatasetTab> datasetTabs;
+    // Page that was shown last - it is in use until another page is shown
+    QWidget * shownPlaceholder;
+    QTimer prefetchTimer;
+    QTimer releaseTimer;
+
+    void createDatasetItem(const QString & datasetName, const int datasetIndex);
+    void materializeDatasetTab(DatasetTab & datasetTab);
+    DatasetTab * findDatasetTab(QWidget * placeholder);
 
     // Mouse interaction - Necessary for frameless windows
     void mousePressEvent(QMouseEvent * mousePressEvent);
@@ -1,6 +1,7 @@
 #include "StartDialog.h"
 #include "ui_StartDialog.h"
 
+#include <QApplication>
 #include <QStringList>
 #include <QFileDialog>
 #include <QDir>
@@ -86,30 +87,32 @@ void StartDialog::disableUseDefaultButton() {
 /**
  * @brief StartDialog::on_buttonMenuBarExit_clicked
  */
-__attribute__((noreturn)) void StartDialog::on_buttonMenuBarExit_clicked() {
-    exit(0);
+void StartDialog::on_buttonMenuBarExit_clicked() {
+    QApplication::quit();
 }
 
 
 /**
  * @brief StartDialog::on_buttonExit_clicked
  */
-__attribute__((noreturn)) void StartDialog::on_buttonExit_clicked() {
-    exit(0);
+void StartDialog::on_buttonExit_clicked() {
+    QApplication::quit();
 }
 
 
 /**
- * @brief StartDialog::on_buttonLoadProject_clicked
+ * @brief StartDialog::on_buttonLoadProject_clicked - Lets the user pick a saved project file and hands it over to be opened
  */
 void StartDialog::on_buttonLoadProject_clicked() {
-    QStringList csvMimeTypes = { "text/plain" };
-    QStringList fileNames = openFileDialog(this, csvMimeTypes, false);
+    QStringList projectMimeTypes = { "application/octet-stream" };
+    QStringList fileNames = openFileDialog(this, projectMimeTypes, false);
 
     if (fileNames.empty())
         return;
 
+    emit loadProject(fileNames);
     qDebug() << "Sent project file name.";
+    this->close();
 }
 
 
@@ -151,8 +154,8 @@ void StartDialog::on_checkBoxUseDefault_stateChanged(int state) {
 /**
  * @brief StartDialog::on_buttonMenuBarExit_2_clicked
  */
-__attribute__((noreturn)) void StartDialog::on_buttonMenuBarExit_2_clicked() {
-    exit(0);
+void StartDialog::on_buttonMenuBarExit_2_clicked() {
+    QApplication::quit();
 }
 
 
@@ -24,12 +24,13 @@ public:
 
 signals:
     void runNewProject(const QString markerFilePath, const QStringList datasetFileNames);
+    void loadProject(const QStringList projectFilePaths);
 
 private slots:
     // STACKED WIDGET PAGE ONE
-    __attribute__((noreturn)) void on_buttonMenuBarExit_clicked();
+    void on_buttonMenuBarExit_clicked();
 
-    __attribute__((noreturn)) void on_buttonExit_clicked();
+    void on_buttonExit_clicked();
 
     void on_buttonLoadProject_clicked();
 
@@ -40,7 +41,7 @@ private slots:
 
     void on_checkBoxUseDefault_stateChanged(int arg1);
 
-     __attribute__((noreturn)) void on_buttonMenuBarExit_2_clicked();
+     void on_buttonMenuBarExit_2_clicked();
 
      void on_buttonLoadCustom_clicked();
 
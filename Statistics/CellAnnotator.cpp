@@ -0,0 +1,405 @@
+#include "CellAnnotator.h"
+
+#include <QDebug>
+#include <QFuture>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+
+namespace CellAnnotator {
+
+namespace {
+
+// Profiles scored at once - the scores of a tile of a whole block of cells stay in the first level cache
+const int profilesPerTile = 64;
+
+// Bytes of the scores of a block of cells for every profile - they should fit into the second level cache
+const int blockScoreBytes = 256 * 1024;
+
+// The vector width follows the instruction set the file is compiled for (see "qmake CONFIG+=native_simd")
+#if defined(__AVX__)
+const int floatsPerVector = 8;
+#else
+const int floatsPerVector = 4;
+#endif
+
+// Vector of floats that may be loaded from and stored to any float address
+typedef float FloatVector __attribute__((vector_size(floatsPerVector * sizeof(float)), aligned(sizeof(float))));
+
+/**
+ * @brief addScaledTile - Adds the weights of a gene for a tile of profiles, scaled by the value of the gene in a cell, to the scores of the cell
+ * @param scores - Scores of the cell for the tile
+ * @param weights - Weights of the gene for the tile
+ * @param value - Value of the gene in the cell
+ */
+inline void addScaledTile(float * __restrict scores, const float * __restrict weights, const float value) {
+    for (int t = 0; t < profilesPerTile; t += floatsPerVector) {
+        *reinterpret_cast<FloatVector *>(scores + t) += value * *reinterpret_cast<const FloatVector *>(weights + t);
+    }
+}
+
+
+/**
+ * @brief createReferenceProfiles - Creates empty profiles over the genes of the dictionary with room for whole tiles
+ * @param profileIDs - ID of every profile
+ * @param numberOfGenes - Rows of the reference
+ * @param isCorrelation - Whether the scores are correlations
+ * @return Profiles with zero weights
+ */
+ReferenceProfiles createReferenceProfiles(const QStringList & profileIDs, const int numberOfGenes, const bool isCorrelation) {
+    int numberOfPaddedProfiles = (profileIDs.length() + profilesPerTile - 1) / profilesPerTile * profilesPerTile;
+
+    return { profileIDs, isCorrelation, numberOfGenes, numberOfPaddedProfiles,
+             std::vector<float>(size_t(numberOfPaddedProfiles) * size_t(numberOfGenes), 0), QVector<float>(numberOfPaddedProfiles, 1) };
+}
+
+
+/**
+ * @brief getWeight - Returns the position of the weight of a gene for a profile
+ * @param referenceProfiles - Profiles the weight belongs to
+ * @param geneIndex - Row of the gene
+ * @param profileIndex - Index of the profile
+ * @return Weight
+ */
+float & getWeight(ReferenceProfiles & referenceProfiles, const int geneIndex, const int profileIndex) {
+    size_t tileIndex = size_t(profileIndex / profilesPerTile);
+
+    return referenceProfiles.weights[(tileIndex * size_t(referenceProfiles.numberOfGenes) + size_t(geneIndex)) * profilesPerTile + size_t(profileIndex % profilesPerTile)];
+}
+
+
+/**
+ * @brief scoreCells - Scores a range of cells against every profile in blocks and stores the best profiles of every cell.
+ *        The entries of a block are staged cell by cell (genes that appear more than once in a cell are added up), transformed, and sorted by gene,
+ *        so the kernel walks the reference rows in order and applies every row to all cells of the block that express its gene
+ * @param sparseMatrix - Per cell counts - its first rows are the genes of the reference
+ * @param referenceProfiles - Profiles the cells are scored against
+ * @param firstCellIndex - First cell of the range
+ * @param endCellIndex - End of the range
+ * @param numberOfTopProfiles - Number of best profiles kept per cell - at least 1
+ * @param profileIndices - Best profiles of every cell, unassignedProfileIndex for slots no profile scored in
+ * @param scores - Scores of the best profiles of every cell, NaN for unassigned slots
+ */
+void scoreCells(const SparseMatrix & sparseMatrix, const ReferenceProfiles & referenceProfiles, const int firstCellIndex, const int endCellIndex,
+                const int numberOfTopProfiles, quint16 * profileIndices, float * scores) {
+    TRACE_SCOPE("CellAnnotator::scoreCells");
+
+    const quint32 numberOfGenes = quint32(referenceProfiles.numberOfGenes);
+    const int numberOfProfiles = referenceProfiles.profileIDs.length(),
+              numberOfPaddedProfiles = referenceProfiles.numberOfPaddedProfiles,
+              numberOfTiles = numberOfPaddedProfiles / profilesPerTile,
+              cellsPerBlock = std::max(16, std::min(1024, blockScoreBytes / int(sizeof(float)) / std::max(1, numberOfPaddedProfiles)));
+
+    const qint64 * columnOffsets = sparseMatrix.getColumnOffsets();
+    const quint32 * geneIndices = sparseMatrix.getGeneIndices();
+    const float * values = sparseMatrix.getValues();
+    const float * weights = referenceProfiles.weights.data();
+
+    // Last cell every gene has been staged for and the position of its entry
+    std::vector<int> lastCellIndices(numberOfGenes, -1), stagingPositions(numberOfGenes);
+    std::vector<quint32> stagedGenes;
+    std::vector<int> stagedCells;
+    std::vector<float> stagedValues;
+
+    // Entries of the block in gene order
+    std::vector<int> geneEntryCounts(numberOfGenes, 0), entryCells;
+    std::vector<quint32> blockGenes;
+    std::vector<int> blockGeneOffsets;
+    std::vector<float> entryValues;
+
+    std::vector<float> blockScores(size_t(cellsPerBlock) * size_t(numberOfPaddedProfiles));
+    std::vector<double> cellSums(cellsPerBlock), cellSumsOfSquares(cellsPerBlock);
+    std::vector<float> topScores(numberOfTopProfiles);
+    std::vector<int> topProfiles(numberOfTopProfiles);
+
+    for (int blockStart = firstCellIndex; blockStart < endCellIndex; blockStart += cellsPerBlock) {
+        int blockLength = std::min(cellsPerBlock, endCellIndex - blockStart);
+
+        // Stage the entries of the reference genes cell by cell
+        stagedGenes.clear();
+        stagedCells.clear();
+        stagedValues.clear();
+
+        for (int c = 0; c < blockLength; c++) {
+            int cellIndex = blockStart + c;
+
+            for (qint64 k = columnOffsets[cellIndex]; k < columnOffsets[cellIndex + 1]; k++) {
+                quint32 geneIndex = geneIndices[k];
+
+                if (geneIndex >= numberOfGenes) {
+                    continue;
+                }
+
+                if (lastCellIndices[geneIndex] == cellIndex) {
+                    stagedValues[size_t(stagingPositions[geneIndex])] += values[k];
+                    continue;
+                }
+
+                lastCellIndices[geneIndex] = cellIndex;
+                stagingPositions[geneIndex] = int(stagedGenes.size());
+                stagedGenes.push_back(geneIndex);
+                stagedCells.push_back(c);
+                stagedValues.push_back(values[k]);
+            }
+        }
+
+        // Correlations use log counts, marker scores whether a marker is expressed at all
+        std::fill(cellSums.begin(), cellSums.end(), 0);
+        std::fill(cellSumsOfSquares.begin(), cellSumsOfSquares.end(), 0);
+
+        for (size_t i = 0; i < stagedValues.size(); i++) {
+            float value = referenceProfiles.isCorrelation ? std::log1p(stagedValues[i]) : float(stagedValues[i] != 0);
+
+            stagedValues[i] = value;
+            cellSums[size_t(stagedCells[i])] += value;
+            cellSumsOfSquares[size_t(stagedCells[i])] += double(value) * value;
+        }
+
+        // Sort the entries by gene (counting sort) - the cells of a gene stay in ascending order
+        blockGenes.clear();
+        for (quint32 geneIndex : stagedGenes) {
+            if (geneEntryCounts[geneIndex]++ == 0) {
+                blockGenes.push_back(geneIndex);
+            }
+        }
+        std::sort(blockGenes.begin(), blockGenes.end());
+
+        blockGeneOffsets.resize(blockGenes.size() + 1);
+        blockGeneOffsets[0] = 0;
+        for (size_t b = 0; b < blockGenes.size(); b++) {
+            int geneEntries = geneEntryCounts[blockGenes[b]];
+
+            // The count becomes the fill position of the gene
+            geneEntryCounts[blockGenes[b]] = blockGeneOffsets[b];
+            blockGeneOffsets[b + 1] = blockGeneOffsets[b] + geneEntries;
+        }
+
+        entryCells.resize(stagedGenes.size());
+        entryValues.resize(stagedGenes.size());
+        for (size_t i = 0; i < stagedGenes.size(); i++) {
+            int position = geneEntryCounts[stagedGenes[i]]++;
+
+            entryCells[size_t(position)] = stagedCells[i];
+            entryValues[size_t(position)] = stagedValues[i];
+        }
+
+        for (quint32 geneIndex : blockGenes) {
+            geneEntryCounts[geneIndex] = 0;
+        }
+
+        // Kernel - every row of a tile is loaded once and added to the scores of every cell of the block that expresses its gene.
+        // The scores are stored tile by tile, so the scores of a tile are contiguous and do not compete for the same cache sets
+        std::fill(blockScores.begin(), blockScores.begin() + size_t(blockLength) * size_t(numberOfPaddedProfiles), 0.0f);
+
+        for (int tileIndex = 0; tileIndex < numberOfTiles; tileIndex++) {
+            const float * tileWeights = weights + size_t(tileIndex) * size_t(numberOfGenes) * profilesPerTile;
+            float * tileScores = blockScores.data() + size_t(tileIndex) * size_t(blockLength) * profilesPerTile;
+
+            for (size_t b = 0; b < blockGenes.size(); b++) {
+                const float * geneWeights = tileWeights + size_t(blockGenes[b]) * profilesPerTile;
+
+                for (int e = blockGeneOffsets[b]; e < blockGeneOffsets[b + 1]; e++) {
+                    addScaledTile(tileScores + size_t(entryCells[size_t(e)]) * profilesPerTile, geneWeights, entryValues[size_t(e)]);
+                }
+            }
+        }
+
+        // Keep the best profiles of every cell - slots without a profile that scored stay unassigned
+        for (int c = 0; c < blockLength; c++) {
+            double cellScale = 1;
+
+            // Norm of the centered cell over every gene of the reference - cells without any variance there correlate with no profile
+            if (referenceProfiles.isCorrelation) {
+                double cellVariance = cellSumsOfSquares[size_t(c)] - cellSums[size_t(c)] * cellSums[size_t(c)] / numberOfGenes;
+                cellScale = cellVariance > 0 ? 1 / std::sqrt(cellVariance) : 0;
+            }
+
+            std::fill(topScores.begin(), topScores.end(), -std::numeric_limits<float>::infinity());
+            std::fill(topProfiles.begin(), topProfiles.end(), int(unassignedProfileIndex));
+
+            for (int p = 0; p < numberOfProfiles && cellScale > 0; p++) {
+                float score = float(blockScores[(size_t(p / profilesPerTile) * size_t(blockLength) + size_t(c)) * profilesPerTile + size_t(p % profilesPerTile)]
+                                    * cellScale / referenceProfiles.profileNorms[p]);
+
+                // A cell that expresses none of the markers of a type is no evidence for it
+                bool isCandidate = referenceProfiles.isCorrelation || score > 0;
+
+                if (!isCandidate || score <= topScores[size_t(numberOfTopProfiles - 1)]) {
+                    continue;
+                }
+
+                int r = numberOfTopProfiles - 1;
+                for (; r > 0 && topScores[size_t(r - 1)] < score; r--) {
+                    topScores[size_t(r)] = topScores[size_t(r - 1)];
+                    topProfiles[size_t(r)] = topProfiles[size_t(r - 1)];
+                }
+                topScores[size_t(r)] = score;
+                topProfiles[size_t(r)] = p;
+            }
+
+            size_t cellOffset = size_t(blockStart + c) * size_t(numberOfTopProfiles);
+            for (int r = 0; r < numberOfTopProfiles; r++) {
+                bool isAssigned = topProfiles[size_t(r)] != int(unassignedProfileIndex);
+
+                profileIndices[cellOffset + size_t(r)] = quint16(topProfiles[size_t(r)]);
+                scores[cellOffset + size_t(r)] = isAssigned ? topScores[size_t(r)] : std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+}
+
+}
+
+
+/**
+ * @brief buildTissueProfiles - Builds correlation profiles from the tissues of a reference. The genes of the tissues are inserted into the dictionary,
+ *        which should be empty, so they become its first rows. Genes a tissue does not express (below the cutoff of the reference) count as 0
+ * @param tissues - Tissues with their expressed genes as parsed by CSVReader::getTissuesWithGeneExpression
+ * @param geneDictionary - Dictionary the per cell matrix is read with afterwards
+ * @return Centered log expression profiles
+ */
+ReferenceProfiles buildTissueProfiles(const QVector<FeatureCollection> & tissues, GeneDictionary & geneDictionary) {
+    TRACE_SCOPE("CellAnnotator::buildTissueProfiles");
+
+    QStringList profileIDs, featureIDs;
+    for (const FeatureCollection & tissue : tissues) {
+        profileIDs.append(tissue.ID);
+
+        for (int i = 0; i < tissue.getNumberOfFeatures(); i++) {
+            featureIDs.append(tissue.getFeatureID(i));
+        }
+    }
+
+    QVector<int> featureGeneIndices = geneDictionary.insertGenes(featureIDs);
+    int numberOfGenes = geneDictionary.getNumberOfGenes();
+
+    ReferenceProfiles referenceProfiles = createReferenceProfiles(profileIDs, numberOfGenes, true);
+    QVector<float> profileValues(numberOfGenes);
+    int featureNumber = 0;
+
+    for (int p = 0; p < tissues.length(); p++) {
+        profileValues.fill(0);
+        double sum = 0;
+
+        for (int i = 0; i < tissues[p].getNumberOfFeatures(); i++, featureNumber++) {
+            float value = std::log1p(float(tissues[p].getFeatureExpressionCount(i)));
+
+            profileValues[featureGeneIndices[featureNumber]] = value;
+            sum += value;
+        }
+
+        // Centered on the mean over every gene of the reference, so the correlation needs no mean of the cell
+        double mean = sum / std::max(1, numberOfGenes),
+               sumOfSquares = 0;
+
+        for (int g = 0; g < numberOfGenes; g++) {
+            float weight = float(profileValues[g] - mean);
+
+            getWeight(referenceProfiles, g, p) = weight;
+            sumOfSquares += double(weight) * weight;
+        }
+
+        // Profiles without variance score 0 against every cell
+        referenceProfiles.profileNorms[p] = sumOfSquares > 0 ? float(std::sqrt(sumOfSquares)) : 1;
+    }
+
+    return referenceProfiles;
+}
+
+
+/**
+ * @brief buildMarkerProfiles - Builds marker profiles from the cell types of a marker file. The markers are inserted into the dictionary,
+ *        which should be empty, so they become its first rows. Like ExpressionComparator::findCellTypeCorrelations a cell scores the fraction of the markers
+ *        of a type that it expresses
+ * @param cellTypes - Cell types with their markers as parsed by CSVReader::getCellTypesWithMarkers
+ * @param geneDictionary - Dictionary the per cell matrix is read with afterwards
+ * @return Marker profiles - their IDs are "cell type / tissue type"
+ */
+ReferenceProfiles buildMarkerProfiles(const QVector<CellType> & cellTypes, GeneDictionary & geneDictionary) {
+    TRACE_SCOPE("CellAnnotator::buildMarkerProfiles");
+
+    QStringList profileIDs, markerIDs;
+    for (const CellType & cellType : cellTypes) {
+        profileIDs.append(cellType.ID + " / " + cellType.associatedTissueType);
+        markerIDs.append(cellType.associatedMarkers);
+    }
+
+    QVector<int> markerGeneIndices = geneDictionary.insertGenes(markerIDs);
+    ReferenceProfiles referenceProfiles = createReferenceProfiles(profileIDs, geneDictionary.getNumberOfGenes(), false);
+    int markerNumber = 0;
+
+    for (int p = 0; p < cellTypes.length(); p++) {
+        int numberOfMarkers = cellTypes[p].associatedMarkers.length();
+
+        for (int i = 0; i < numberOfMarkers; i++, markerNumber++) {
+            getWeight(referenceProfiles, markerGeneIndices[markerNumber], p) += 1.0f / numberOfMarkers;
+        }
+    }
+
+    return referenceProfiles;
+}
+
+
+/**
+ * @brief annotateCells - Scores every cell against every profile and keeps the best profiles per cell. The cells are split into ranges
+ *        that are scored on the correlation pool, every range writes to its own part of the result
+ * @param sparseMatrix - Per cell counts, read with the dictionary the profiles have been built with
+ * @param referenceProfiles - Profiles the cells are scored against
+ * @param numberOfTopProfiles - Number of best profiles kept per cell
+ * @return Best profiles of every cell - no profiles if there are more profiles than 16 bit indices can address besides unassignedProfileIndex
+ */
+CellAnnotations annotateCells(const SparseMatrix & sparseMatrix, const ReferenceProfiles & referenceProfiles, const int numberOfTopProfiles) {
+    TRACE_SCOPE("CellAnnotator::annotateCells");
+
+    int numberOfCells = sparseMatrix.getNumberOfCells(),
+        numberOfProfiles = referenceProfiles.profileIDs.length(),
+        numberOfKeptProfiles = std::max(0, std::min(numberOfTopProfiles, numberOfProfiles));
+
+    if (numberOfProfiles > int(unassignedProfileIndex)) {
+        qDebug() << "CELL ANNOTATOR:" << numberOfProfiles << "profiles exceed the 16 bit profile indices";
+        numberOfKeptProfiles = 0;
+    }
+
+    CellAnnotations cellAnnotations { referenceProfiles.profileIDs, sparseMatrix.getCellBarcodes(), numberOfKeptProfiles,
+                                      std::vector<quint16>(size_t(numberOfCells) * size_t(numberOfKeptProfiles)),
+                                      std::vector<float>(size_t(numberOfCells) * size_t(numberOfKeptProfiles)) };
+
+    if (numberOfKeptProfiles == 0) {
+        return cellAnnotations;
+    }
+
+    // About four ranges per thread balance the cells of differing depth
+    int numberOfThreads = ThreadPools::getThreadPool(ThreadPools::CorrelationPool)->maxThreadCount(),
+        cellsPerRange = std::max(1024, (numberOfCells + 4 * numberOfThreads - 1) / std::max(1, 4 * numberOfThreads));
+
+    const SparseMatrix * matrix = &sparseMatrix;
+    const ReferenceProfiles * profiles = &referenceProfiles;
+    quint16 * profileIndices = cellAnnotations.profileIndices.data();
+    float * scores = cellAnnotations.scores.data();
+    QList<QFuture<void>> futureRanges;
+
+    for (int rangeStart = 0; rangeStart < numberOfCells; rangeStart += cellsPerRange) {
+        int rangeEnd = std::min(numberOfCells, rangeStart + cellsPerRange);
+
+        futureRanges.append(ThreadPools::run(ThreadPools::CorrelationPool, [matrix, profiles, rangeStart, rangeEnd, numberOfKeptProfiles, profileIndices, scores]() {
+            scoreCells(*matrix, *profiles, rangeStart, rangeEnd, numberOfKeptProfiles, profileIndices, scores);
+        }));
+    }
+
+    for (QFuture<void> & futureRange : futureRanges) {
+        futureRange.waitForFinished();
+    }
+
+    return cellAnnotations;
+}
+
+}
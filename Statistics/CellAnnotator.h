@@ -0,0 +1,62 @@
+#ifndef CELLANNOTATOR_H
+#define CELLANNOTATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+#include <vector>
+
+#include "BioModels/Celltype.h"
+#include "BioModels/FeatureCollection.h"
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+
+/**
+ * @brief The CellAnnotator namespace scores every single cell of a sparse matrix against the profiles of a reference and keeps the best profiles per cell.
+ *        Cells are scored in blocks that are transposed to gene order, so every reference row is loaded once per block and applied to all cells of the block
+ *        that express the gene. The profiles are processed in tiles whose scores stay in the first level cache, the kernel runs on vectors of floats.
+ */
+namespace CellAnnotator
+{
+    /**
+     * @brief The ReferenceProfiles struct holds the profiles as dense weight matrix over the genes of the reference - the first rows of the gene dictionary.
+     *        Tissue profiles are log expressions centered on their mean, so a dot product with the cell yields the Pearson correlation once divided by both norms.
+     *        Marker profiles weigh every marker of a cell type with the reciprocal number of its markers, so a cell scores the fraction of markers it expresses.
+     *        Thousands of profiles over every gene exceed what a QVector can hold, so the weights are a std::vector.
+     */
+    struct ReferenceProfiles
+    {
+        QStringList profileIDs;
+        bool isCorrelation;
+        int numberOfGenes;
+        // Profiles rounded up to whole tiles - weights are stored tile by tile, every tile gene by gene
+        int numberOfPaddedProfiles;
+        std::vector<float> weights;
+        QVector<float> profileNorms;
+    };
+
+    // Profile index of the slots of a cell that no profile scored in - cells without variance over the reference genes, or without any marker of the kept types.
+    // Their score is NaN
+    const quint16 unassignedProfileIndex = 0xFFFF;
+
+    /**
+     * @brief The CellAnnotations struct holds the best profiles of every cell in descending order of their scores, cell by cell
+     */
+    struct CellAnnotations
+    {
+        QStringList profileIDs;
+        QStringList cellBarcodes;
+        int numberOfTopProfiles;
+        std::vector<quint16> profileIndices;
+        std::vector<float> scores;
+    };
+
+    extern ReferenceProfiles buildTissueProfiles(const QVector<FeatureCollection> & tissues, GeneDictionary & geneDictionary);
+    extern ReferenceProfiles buildMarkerProfiles(const QVector<CellType> & cellTypes, GeneDictionary & geneDictionary);
+
+    extern CellAnnotations annotateCells(const SparseMatrix & sparseMatrix, const ReferenceProfiles & referenceProfiles, const int numberOfTopProfiles);
+};
+
+#endif // CELLANNOTATOR_H
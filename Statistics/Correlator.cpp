@@ -75,4 +75,36 @@ double calculateSpearmanCorrelation(QVector<double> variableOne, QVector<double>
     return result;
 }
 
+
+/**
+ * @brief calculatePearsonCorrelation - Calculates the pearson correlation coefficient for two given variables.
+ * @param variableOne - Vector of numbers representing the attributes of the first variable
+ * @param variableTwo - Vector of numbers representing the attributes of the second variable
+ * @return - Correlation coefficient in range [-1,1] with 1 = full correlation - NaN if a variable is constant or empty.
+ */
+double calculatePearsonCorrelation(QVector<double> variableOne, QVector<double> variableTwo) {
+
+    if (variableOne.length() != variableTwo.length()) {
+        qDebug() << "Variables do not have the same length.";
+        exit(1);
+    }
+
+    double variableOneMean = Math::mean(variableOne),
+           variableTwoMean = Math::mean(variableTwo);
+
+    // Same single loop over the three sums as for the spearman correlation
+    double counter = .0, denominatorFactorOne = .0, denominatorFactorTwo = .0;
+
+    for (int i = 0; i < variableOne.length(); i++) {
+        double deviationOne = variableOne[i] - variableOneMean,
+               deviationTwo = variableTwo[i] - variableTwoMean;
+
+        counter += deviationOne * deviationTwo;
+        denominatorFactorOne += deviationOne * deviationOne;
+        denominatorFactorTwo += deviationTwo * deviationTwo;
+    }
+
+    return counter / (sqrt(denominatorFactorOne) * sqrt(denominatorFactorTwo));
+}
+
 }
@@ -6,6 +6,7 @@
 #include <QString>
 #include <QStringList>
 
+#include <limits>
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -13,6 +14,7 @@ using std::endl;
 #include "BioModels/FeatureCollection.h"
 #include "Utils/Sorter.h"
 #include "Statistics/Correlator.h"
+#include "System/Trace.h"
 
 namespace ExpressionComparator {
 
@@ -24,10 +26,14 @@ namespace ExpressionComparator {
  * @return Sorted correlations between every cluster and every tissue
  */
 QVector<QVector<QPair<QString, double>>> findClusterTissueCorrelations(QVector<FeatureCollection> clusters, QVector<FeatureCollection> tissues) {
+    TRACE_SCOPE("ExpressionComparator::findClusterTissueCorrelations");
+
     QVector<QVector<QPair<QString, double>>> tissueCorrelationsForAllClusters;
     tissueCorrelationsForAllClusters.reserve(clusters.length());
 
     for (int i = 0; i < clusters.length(); i++) {
+        TRACE_SCOPE("ExpressionComparator::correlateCluster");
+
         QVector<QPair<QString, double>> clusterTissueCorrelations;
         clusterTissueCorrelations.reserve(tissues.length());
 
@@ -60,7 +66,114 @@ QVector<QVector<QPair<QString, double>>> findClusterTissueCorrelations(QVector<F
 }
 
 
+/**
+ * @brief findClusterTissueCorrelations - Same as above, but on full expression values whose cutoffs are applied on the fly.
+ *        The shared genes of a cluster and a tissue are found by walking the genes of both above their cutoffs in the cached order,
+ *        which gives the ranks within the shared genes without sorting. Ties get the lowest rank, just like the spearman correlation of the Correlator
+ * @param clusters - Cached order of the dataset matrix
+ * @param tissues - Cached order of the reference matrix - built from the same gene dictionary as the dataset matrix
+ * @param clusterCutoff - Cluster values below or equal to this are not expressed
+ * @param tissueCutoff - Tissue values below or equal to this are not expressed
+ * @param correlationMethod - Spearman correlation of the ranks or pearson correlation of the values
+ * @return Sorted correlations between every cluster and every tissue
+ */
+QVector<QVector<QPair<QString, double>>> findClusterTissueCorrelations(const RankCache & clusters, const RankCache & tissues, const double clusterCutoff,
+                                                                       const double tissueCutoff, const CorrelationMethod correlationMethod) {
+    TRACE_SCOPE("ExpressionComparator::findClusterTissueCorrelations (ranked)");
+
+    const ExpressionMatrix & clusterMatrix = clusters.getExpressionMatrix(),
+                           & tissueMatrix = tissues.getExpressionMatrix();
+
+    bool isSpearmanCorrelation = correlationMethod == SpearmanCorrelation;
+
+    // Rank of every shared gene of the current pair on the cluster side - indexed by gene row and reused for every pair
+    QVector<double> clusterRanks(clusterMatrix.getNumberOfGenes());
+
+    QVector<QVector<QPair<QString, double>>> tissueCorrelationsForAllClusters;
+    tissueCorrelationsForAllClusters.reserve(clusters.getNumberOfColumns());
+
+    for (int i = 0; i < clusters.getNumberOfColumns(); i++) {
+        TRACE_SCOPE("ExpressionComparator::correlateCluster (ranked)");
+
+        const QVector<int> & clusterGenes = clusters.getOrderedGenes(i);
+        int firstClusterGene = clusters.findFirstAboveCutoff(i, clusterCutoff);
+
+        QVector<QPair<QString, double>> clusterTissueCorrelations;
+        clusterTissueCorrelations.reserve(tissues.getNumberOfColumns());
+
+        for (int j = 0; j < tissues.getNumberOfColumns(); j++) {
+            const QVector<int> & tissueGenes = tissues.getOrderedGenes(j);
+            int firstTissueGene = tissues.findFirstAboveCutoff(j, tissueCutoff);
+
+            // Walk the cluster side in ascending order and rank the genes the tissue expresses as well
+            if (isSpearmanCorrelation) {
+                int numberOfRankedGenes = 0;
+                float previousValue = std::numeric_limits<float>::quiet_NaN();
+                double previousRank = 0;
+
+                for (int k = firstClusterGene; k < clusterGenes.length(); k++) {
+                    int geneIndex = clusterGenes[k];
+
+                    if (!tissues.isAboveCutoff(geneIndex, j, tissueCutoff)) {
+                        continue;
+                    }
+
+                    float value = clusterMatrix.getValue(geneIndex, i);
+                    previousRank = value == previousValue ? previousRank : numberOfRankedGenes;
+                    previousValue = value;
+                    clusterRanks[geneIndex] = previousRank;
+                    numberOfRankedGenes++;
+                }
+            }
+
+            QVector<double> clusterFeatureExpressionCounts,
+                            tissueFeatureExpressionCounts;
+
+            // Walk the tissue side the same way and pair every shared gene up with its cluster counterpart
+            int numberOfRankedGenes = 0;
+            float previousValue = std::numeric_limits<float>::quiet_NaN();
+            double previousRank = 0;
+
+            for (int k = firstTissueGene; k < tissueGenes.length(); k++) {
+                int geneIndex = tissueGenes[k];
+
+                if (!clusters.isAboveCutoff(geneIndex, i, clusterCutoff)) {
+                    continue;
+                }
+
+                float value = tissueMatrix.getValue(geneIndex, j);
+                previousRank = value == previousValue ? previousRank : numberOfRankedGenes;
+                previousValue = value;
+                numberOfRankedGenes++;
+
+                if (isSpearmanCorrelation) {
+                    clusterFeatureExpressionCounts.append(clusterRanks[geneIndex]);
+                    tissueFeatureExpressionCounts.append(previousRank);
+                } else {
+                    clusterFeatureExpressionCounts.append(double(clusterMatrix.getValue(geneIndex, i)));
+                    tissueFeatureExpressionCounts.append(double(value));
+                }
+            }
+
+            // The spearman correlation is the pearson correlation of the ranks
+            double correlation = Correlator::calculatePearsonCorrelation(clusterFeatureExpressionCounts, tissueFeatureExpressionCounts);
+
+            clusterTissueCorrelations.append(qMakePair(tissues.getColumnID(j), correlation));
+        }
+
+        std::sort(clusterTissueCorrelations.begin(), clusterTissueCorrelations.end(),
+                  [](QPair<QString, double> pairA, QPair<QString, double> pairB) { return pairA.second > pairB.second; });
+
+        tissueCorrelationsForAllClusters.append(clusterTissueCorrelations);
+    }
+
+    return tissueCorrelationsForAllClusters;
+}
+
+
 QVector<QVector<QPair<CellType, double>>> findCellTypeCorrelations(QVector<CellType> cellTypes, QVector<FeatureCollection> clusters) {
+    TRACE_SCOPE("ExpressionComparator::findCellTypeCorrelations");
+
     QVector<QVector<QPair<CellType, double>>> clustersWithCellMappingLikelihoods;
 
     qDebug() << "Go: Find cell type correlations";
@@ -8,13 +8,18 @@
 
 #include "BioModels/FeatureCollection.h"
 #include "BioModels/Celltype.h"
+#include "Statistics/RankCache.h"
 
 namespace ExpressionComparator
 {
+    enum CorrelationMethod { SpearmanCorrelation = 0, PearsonCorrelation = 1 };
+
     extern QVector<QVector<QPair<CellType, double>>> findCellTypeCorrelations(QVector<CellType> cellTypes, QVector<FeatureCollection> clusters);
 //    extern QVector<QVector<QPair<QPair<QString, QString>, double>>> findCellTypeCorrelationsCellWise(QHash <QString, QVector<QPair<QString, QString>>>, QVector<QStringList> clusterFeatureExpressions);
 
     extern QVector<QVector<QPair<QString, double>>> findClusterTissueCorrelations(QVector<FeatureCollection> clusters, QVector<FeatureCollection> tissues);
+    extern QVector<QVector<QPair<QString, double>>> findClusterTissueCorrelations(const RankCache & clusters, const RankCache & tissues, const double clusterCutoff,
+                                                                                  const double tissueCutoff, const CorrelationMethod correlationMethod);
 };
 
 #endif // EXPRESSIONCOMPARATOR_H
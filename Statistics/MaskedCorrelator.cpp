@@ -0,0 +1,231 @@
+#include "MaskedCorrelator.h"
+
+#include <QBitArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Statistics/Correlator.h"
+#include "System/Trace.h"
+
+namespace MaskedCorrelator {
+
+namespace {
+
+/**
+ * @brief isMaskedIntersectionChanged - Checks whether the genes a cluster and a type share changed between two pairs of masks
+ * @return True if at least one gene entered or left the intersection
+ */
+bool isMaskedIntersectionChanged(const QBitArray & oldClusterMask, const QBitArray & newClusterMask, const QBitArray & oldTypeMask, const QBitArray & newTypeMask) {
+    // Masks of different length are padded with unset bits by the bit operators
+    return ((oldClusterMask & oldTypeMask) ^ (newClusterMask & newTypeMask)).count(true) > 0;
+}
+
+}
+
+
+/**
+ * @brief calculateExpressionMasks - Marks the genes every column expresses above the cutoff. The matrix is read row by row in a single pass
+ * @param expressionMatrix - Full expression values - NaN is never expressed
+ * @param cutoff - Values below or equal to the cutoff are masked out, just like the parsers used to drop them
+ * @return One mask per column with a bit per gene
+ */
+QVector<QBitArray> calculateExpressionMasks(const ExpressionMatrix & expressionMatrix, const double cutoff) {
+    TRACE_SCOPE("MaskedCorrelator::calculateExpressionMasks");
+
+    int numberOfGenes = expressionMatrix.getNumberOfGenes(),
+        numberOfColumns = expressionMatrix.getNumberOfClusters();
+
+    const float * values = expressionMatrix.getValues();
+    float floatCutoff = float(cutoff);
+
+    QVector<QBitArray> masks(numberOfColumns, QBitArray(numberOfGenes));
+
+    for (int i = 0; i < numberOfGenes; i++) {
+        const float * row = values + qint64(i) * numberOfColumns;
+
+        for (int j = 0; j < numberOfColumns; j++) {
+            // NaN compares false, so genes without value are never set
+            if (row[j] > floatCutoff) {
+                masks[j].setBit(i);
+            }
+        }
+    }
+
+    return masks;
+}
+
+
+/**
+ * @brief calculatePairCorrelation - Correlates a cluster and a type on the genes both of them express within their masks
+ * @param clusters - Matrix of the dataset
+ * @param clusterIndex - Column of the cluster
+ * @param clusterMask - Expressed genes of the cluster
+ * @param types - Matrix of the reference
+ * @param typeIndex - Column of the type
+ * @param typeMask - Expressed genes of the type
+ * @return Spearman correlation of the shared genes
+ */
+double calculatePairCorrelation(const ExpressionMatrix & clusters, const int clusterIndex, const QBitArray & clusterMask,
+                                const ExpressionMatrix & types, const int typeIndex, const QBitArray & typeMask) {
+    // Both matrices take their rows from the same gene dictionary, but may cover a different number of its genes
+    int numberOfSharedRows = qMin(clusterMask.size(), typeMask.size());
+
+    QVector<double> clusterFeatureExpressionCounts,
+                    typeFeatureExpressionCounts;
+
+    for (int i = 0; i < numberOfSharedRows; i++) {
+        if (clusterMask.testBit(i) && typeMask.testBit(i)) {
+            clusterFeatureExpressionCounts.append(double(clusters.getValue(i, clusterIndex)));
+            typeFeatureExpressionCounts.append(double(types.getValue(i, typeIndex)));
+        }
+    }
+
+    return Correlator::calculateSpearmanCorrelation(clusterFeatureExpressionCounts, typeFeatureExpressionCounts);
+}
+
+
+/**
+ * @brief calculateCorrelationMatrix - Correlates every cluster with every type at the given cutoffs
+ * @param clusters - Full expression matrix of the dataset
+ * @param clusterCutoff - Cutoff for the cluster values
+ * @param types - Full expression matrix of the reference
+ * @param typeCutoff - Cutoff for the reference values
+ * @return Row-wise clusters x types correlations
+ */
+QVector<double> calculateCorrelationMatrix(const ExpressionMatrix & clusters, const double clusterCutoff, const ExpressionMatrix & types, const double typeCutoff) {
+    TRACE_SCOPE("MaskedCorrelator::calculateCorrelationMatrix");
+
+    QVector<QBitArray> clusterMasks = calculateExpressionMasks(clusters, clusterCutoff),
+                       typeMasks = calculateExpressionMasks(types, typeCutoff);
+
+    int numberOfClusters = clusters.getNumberOfClusters(),
+        numberOfTypes = types.getNumberOfClusters();
+
+    QVector<double> correlationMatrix(numberOfClusters * numberOfTypes);
+
+    for (int i = 0; i < numberOfClusters; i++) {
+        for (int j = 0; j < numberOfTypes; j++) {
+            correlationMatrix[i * numberOfTypes + j] = calculatePairCorrelation(clusters, i, clusterMasks[i], types, j, typeMasks[j]);
+        }
+    }
+
+    return correlationMatrix;
+}
+
+
+/**
+ * @brief updateCorrelationMatrix - Recalculates the correlations of the pairs whose shared genes changed with the new masks.
+ *        Pairs whose cluster and type masks both stayed the same are skipped without looking at their genes
+ * @param correlationMatrix - Row-wise clusters x types correlations at the old masks - NaN entries are always recalculated
+ * @param clusters - Full expression matrix of the dataset
+ * @param oldClusterMasks - Cluster masks the correlations were calculated with
+ * @param newClusterMasks - Cluster masks at the new cutoff
+ * @param types - Full expression matrix of the reference
+ * @param oldTypeMasks - Type masks the correlations were calculated with
+ * @param newTypeMasks - Type masks at the new cutoff
+ * @return Number of recalculated pairs
+ */
+int updateCorrelationMatrix(QVector<double> & correlationMatrix,
+                            const ExpressionMatrix & clusters, const QVector<QBitArray> & oldClusterMasks, const QVector<QBitArray> & newClusterMasks,
+                            const ExpressionMatrix & types, const QVector<QBitArray> & oldTypeMasks, const QVector<QBitArray> & newTypeMasks) {
+    TRACE_SCOPE("MaskedCorrelator::updateCorrelationMatrix");
+
+    int numberOfClusters = clusters.getNumberOfClusters(),
+        numberOfTypes = types.getNumberOfClusters(),
+        numberOfRecalculatedPairs = 0;
+
+    QVector<bool> isTypeMaskChanged(numberOfTypes);
+    for (int j = 0; j < numberOfTypes; j++) {
+        isTypeMaskChanged[j] = oldTypeMasks[j] != newTypeMasks[j];
+    }
+
+    for (int i = 0; i < numberOfClusters; i++) {
+        bool isClusterMaskChanged = oldClusterMasks[i] != newClusterMasks[i];
+
+        for (int j = 0; j < numberOfTypes; j++) {
+            double & correlation = correlationMatrix[i * numberOfTypes + j];
+
+            bool isRecalculated = std::isnan(correlation)
+                    || ((isClusterMaskChanged || isTypeMaskChanged[j])
+                        && isMaskedIntersectionChanged(oldClusterMasks[i], newClusterMasks[i], oldTypeMasks[j], newTypeMasks[j]));
+
+            if (isRecalculated) {
+                correlation = calculatePairCorrelation(clusters, i, newClusterMasks[i], types, j, newTypeMasks[j]);
+                numberOfRecalculatedPairs++;
+            }
+        }
+    }
+
+    return numberOfRecalculatedPairs;
+}
+
+
+/**
+ * @brief toSortedCorrelations - Turns a correlation matrix into the per cluster lists of types the GUI and the writers use
+ * @param correlationMatrix - Row-wise clusters x types correlations
+ * @param typeIDs - ID of every type in column order
+ * @return Correlations of every cluster - sorted from highest to lowest
+ */
+QVector<QVector<QPair<QString, double>>> toSortedCorrelations(const QVector<double> & correlationMatrix, const QStringList & typeIDs) {
+    int numberOfTypes = typeIDs.length(),
+        numberOfClusters = numberOfTypes > 0 ? correlationMatrix.length() / numberOfTypes : 0;
+
+    QVector<QVector<QPair<QString, double>>> sortedCorrelations;
+    sortedCorrelations.reserve(numberOfClusters);
+
+    for (int i = 0; i < numberOfClusters; i++) {
+        QVector<QPair<QString, double>> clusterTypeCorrelations;
+        clusterTypeCorrelations.reserve(numberOfTypes);
+
+        for (int j = 0; j < numberOfTypes; j++) {
+            clusterTypeCorrelations.append(qMakePair(typeIDs[j], correlationMatrix[i * numberOfTypes + j]));
+        }
+
+        std::sort(clusterTypeCorrelations.begin(), clusterTypeCorrelations.end(),
+                  [](QPair<QString, double> pairA, QPair<QString, double> pairB) { return pairA.second > pairB.second; });
+
+        sortedCorrelations.append(clusterTypeCorrelations);
+    }
+
+    return sortedCorrelations;
+}
+
+
+/**
+ * @brief fromSortedCorrelations - Rebuilds the correlation matrix from the sorted per cluster lists, e.g. of a loaded project
+ * @param sortedCorrelations - Correlations of every cluster - in any order
+ * @param typeIDs - ID of every type in column order
+ * @return Row-wise clusters x types correlations - NaN for types that are missing in a list
+ */
+QVector<double> fromSortedCorrelations(const QVector<QVector<QPair<QString, double>>> & sortedCorrelations, const QStringList & typeIDs) {
+    int numberOfTypes = typeIDs.length();
+
+    QHash<QString, int> typeIndices;
+    typeIndices.reserve(numberOfTypes);
+    for (int j = 0; j < numberOfTypes; j++) {
+        typeIndices.insert(typeIDs[j], j);
+    }
+
+    QVector<double> correlationMatrix(sortedCorrelations.length() * numberOfTypes, std::numeric_limits<double>::quiet_NaN());
+
+    for (int i = 0; i < sortedCorrelations.length(); i++) {
+        for (const QPair<QString, double> & correlation : sortedCorrelations[i]) {
+            int typeIndex = typeIndices.value(correlation.first, -1);
+
+            if (typeIndex >= 0) {
+                correlationMatrix[i * numberOfTypes + typeIndex] = correlation.second;
+            }
+        }
+    }
+
+    return correlationMatrix;
+}
+
+}
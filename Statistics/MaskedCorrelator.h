@@ -0,0 +1,34 @@
+#ifndef MASKEDCORRELATOR_H
+#define MASKEDCORRELATOR_H
+
+#include <QBitArray>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "BioModels/ExpressionMatrix.h"
+
+/**
+ * @brief The MaskedCorrelator namespace correlates the clusters of a dataset with the types of a reference on full expression matrices.
+ *        Cutoffs are applied as bit masks over the matrix columns, so a changed cutoff only needs new masks and the correlations
+ *        of the cluster-type pairs whose masked gene sets actually changed.
+ */
+namespace MaskedCorrelator
+{
+    extern QVector<QBitArray> calculateExpressionMasks(const ExpressionMatrix & expressionMatrix, const double cutoff);
+
+    extern double calculatePairCorrelation(const ExpressionMatrix & clusters, const int clusterIndex, const QBitArray & clusterMask,
+                                           const ExpressionMatrix & types, const int typeIndex, const QBitArray & typeMask);
+
+    extern QVector<double> calculateCorrelationMatrix(const ExpressionMatrix & clusters, const double clusterCutoff, const ExpressionMatrix & types, const double typeCutoff);
+
+    extern int updateCorrelationMatrix(QVector<double> & correlationMatrix,
+                                       const ExpressionMatrix & clusters, const QVector<QBitArray> & oldClusterMasks, const QVector<QBitArray> & newClusterMasks,
+                                       const ExpressionMatrix & types, const QVector<QBitArray> & oldTypeMasks, const QVector<QBitArray> & newTypeMasks);
+
+    extern QVector<QVector<QPair<QString, double>>> toSortedCorrelations(const QVector<double> & correlationMatrix, const QStringList & typeIDs);
+    extern QVector<double> fromSortedCorrelations(const QVector<QVector<QPair<QString, double>>> & sortedCorrelations, const QStringList & typeIDs);
+};
+
+#endif // MASKEDCORRELATOR_H
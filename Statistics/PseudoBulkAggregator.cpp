@@ -0,0 +1,415 @@
+#include "PseudoBulkAggregator.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <numeric>
+
+#include "BioModels/GeneDictionary.h"
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+#include "Utils/FileOperators/Hdf5Reader.h"
+#include "Utils/FileOperators/MtxReader.h"
+
+namespace PseudoBulkAggregator {
+
+namespace {
+
+// Fewer cells per slice do not pay off the accumulators of the slice
+const int minimumCellsPerSlice = 4096;
+
+/**
+ * @brief The PartialSums struct holds the sums of a slice of the cells of a cluster for every gene
+ */
+struct PartialSums
+{
+    int clusterIndex;
+    QVector<double> sums;
+    QVector<double> sumsOfSquares;
+    QVector<int> expressingCells;
+};
+
+/**
+ * @brief unquote - Removes the quotes R and pandas put around the values of a CSV file
+ * @param value - Value of a CSV column
+ * @return Trimmed value without quotes
+ */
+QByteArray unquote(const QByteArray & value) {
+    QByteArray trimmedValue = value.trimmed();
+
+    if (trimmedValue.length() >= 2 && trimmedValue.startsWith('"') && trimmedValue.endsWith('"')) {
+        return trimmedValue.mid(1, trimmedValue.length() - 2);
+    }
+    return trimmedValue;
+}
+
+
+/**
+ * @brief accumulateCells - Sums up the counts, squared counts and expressing cells of every gene over a slice of the cells of a cluster.
+ *        Features that share a gene name may put a gene more than once into a cell - the counts of the cell are added up before they are squared
+ * @param sparseMatrix - Per cell counts
+ * @param cellIndices - Columns of the cells of the slice
+ * @param numberOfCells - Number of cells of the slice
+ * @param clusterIndex - Cluster the cells belong to
+ * @return Sums of the slice
+ */
+PartialSums accumulateCells(const SparseMatrix & sparseMatrix, const int * cellIndices, const int numberOfCells, const int clusterIndex) {
+    TRACE_SCOPE("PseudoBulkAggregator::accumulateCells");
+
+    int numberOfGenes = sparseMatrix.getNumberOfGenes();
+    PartialSums partialSums { clusterIndex, QVector<double>(numberOfGenes, 0), QVector<double>(numberOfGenes, 0), QVector<int>(numberOfGenes, 0) };
+
+    // Last cell every gene has been seen in and its count in that cell
+    QVector<int> lastCellIndices(numberOfGenes, -1);
+    QVector<double> cellCounts(numberOfGenes, 0);
+
+    const qint64 * columnOffsets = sparseMatrix.getColumnOffsets();
+    const quint32 * geneIndices = sparseMatrix.getGeneIndices();
+    const float * values = sparseMatrix.getValues();
+
+    double * sums = partialSums.sums.data(),
+           * sumsOfSquares = partialSums.sumsOfSquares.data(),
+           * counts = cellCounts.data();
+    int * expressingCells = partialSums.expressingCells.data(),
+        * lastCells = lastCellIndices.data();
+
+    for (int c = 0; c < numberOfCells; c++) {
+        int cellIndex = cellIndices[c];
+
+        for (qint64 k = columnOffsets[cellIndex]; k < columnOffsets[cellIndex + 1]; k++) {
+            quint32 geneIndex = geneIndices[k];
+            double value = values[k];
+
+            sums[geneIndex] += value;
+
+            if (lastCells[geneIndex] != cellIndex) {
+                lastCells[geneIndex] = cellIndex;
+                counts[geneIndex] = value;
+                sumsOfSquares[geneIndex] += value * value;
+                expressingCells[geneIndex] += value != 0;
+            } else {
+                double previousCount = counts[geneIndex],
+                       count = previousCount + value;
+
+                counts[geneIndex] = count;
+                sumsOfSquares[geneIndex] += count * count - previousCount * previousCount;
+                expressingCells[geneIndex] += previousCount == 0 && count != 0;
+            }
+        }
+    }
+
+    return partialSums;
+}
+
+}
+
+
+/**
+ * @brief isClusterAssignmentFile - Returns whether the given dataset file assigns cells to clusters instead of holding the cluster expressions
+ * @param filePath - Path of a dataset file
+ * @return True for cellranger's clusters.csv and files named like it (e.g. leiden_clusters.csv)
+ */
+bool isClusterAssignmentFile(const QString filePath) {
+    return QFileInfo(filePath).fileName().endsWith("clusters.csv", Qt::CaseInsensitive);
+}
+
+
+/**
+ * @brief findFeatureBarcodeMatrix - Finds the per cell counts that belong to a cluster assignment file: next to the file or in the cellranger output
+ *        directory the file is part of (outs/analysis/clustering/<clustering>/clusters.csv). HDF5 files are preferred if they can be read
+ * @param clusterAssignmentFilePath - Path of the clusters.csv file
+ * @return Path of the feature-barcode matrix directory or HDF5 file - empty if there is none
+ */
+QString findFeatureBarcodeMatrix(const QString clusterAssignmentFilePath) {
+    QDir clusteringDirectory = QFileInfo(clusterAssignmentFilePath).absoluteDir();
+    QList<QDir> searchDirectories { clusteringDirectory };
+
+    QDir outputDirectory = clusteringDirectory;
+    if (outputDirectory.cd("../../..")) {
+        searchDirectories.append(outputDirectory);
+    }
+
+    QStringList candidateNames;
+    if (Hdf5Reader::isAvailable()) {
+        candidateNames << "filtered_feature_bc_matrix.h5" << "filtered_gene_bc_matrices_h5.h5";
+    }
+    candidateNames << "filtered_feature_bc_matrix";
+
+    for (const QDir & searchDirectory : searchDirectories) {
+        for (const QString & candidateName : candidateNames) {
+            if (searchDirectory.exists(candidateName)) {
+                return searchDirectory.filePath(candidateName);
+            }
+        }
+    }
+
+    return QString();
+}
+
+
+/**
+ * @brief readClusterAssignments - Reads the cluster of every cell from a "Barcode,Cluster" file.
+ *        Numeric clusters are ordered by number and named Cluster0, Cluster1, ... like the clusters of cellranger's differential expression file,
+ *        other cluster names are kept in the order they first appear
+ * @param clusterAssignmentFilePath - Path of the clusters.csv file
+ * @param cellBarcodes - Barcodes of the columns of the sparse matrix
+ * @param clusterIDs - Filled with the ID of every cluster
+ * @param cellClusterIndices - Filled with the cluster of every column, -1 for cells without cluster
+ * @return True if the file has been read
+ */
+bool readClusterAssignments(const QString clusterAssignmentFilePath, const QStringList & cellBarcodes, QStringList & clusterIDs, QVector<int> & cellClusterIndices) {
+    TRACE_SCOPE("PseudoBulkAggregator::readClusterAssignments");
+
+    QFile clusterAssignmentFile(clusterAssignmentFilePath);
+
+    if (!clusterAssignmentFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "PSEUDO BULK AGGREGATOR:" << clusterAssignmentFilePath << "-" << clusterAssignmentFile.errorString();
+        return false;
+    }
+
+    QHash<QString, int> cellIndices;
+    cellIndices.reserve(cellBarcodes.length());
+    for (int j = 0; j < cellBarcodes.length(); j++) {
+        cellIndices.insert(cellBarcodes[j], j);
+    }
+
+    // Skip title line
+    clusterAssignmentFile.readLine();
+
+    QStringList clusterNames;
+    QHash<QString, int> clusterNameIndices;
+    QVector<int> cellClusterNameIndices(cellBarcodes.length(), -1);
+    bool isNumeric = true;
+    int unknownBarcodes = 0;
+
+    while (!clusterAssignmentFile.atEnd()) {
+        QList<QByteArray> splitLine = clusterAssignmentFile.readLine().split(',');
+
+        // Skip incomplete lines (e.g. trailing empty lines)
+        if (splitLine.length() < 2) {
+            continue;
+        }
+
+        auto cellIndex = cellIndices.constFind(QString::fromLatin1(unquote(splitLine[0])));
+        if (cellIndex == cellIndices.constEnd()) {
+            unknownBarcodes++;
+            continue;
+        }
+
+        QString clusterName = QString::fromUtf8(unquote(splitLine[1]));
+        auto clusterNameIndex = clusterNameIndices.constFind(clusterName);
+
+        if (clusterNameIndex == clusterNameIndices.constEnd()) {
+            clusterNameIndex = clusterNameIndices.insert(clusterName, clusterNames.length());
+            clusterNames.append(clusterName);
+
+            bool isNumber;
+            clusterName.toLongLong(&isNumber);
+            isNumeric = isNumeric && isNumber;
+        }
+
+        cellClusterNameIndices[cellIndex.value()] = clusterNameIndex.value();
+    }
+
+    if (unknownBarcodes > 0) {
+        qDebug() << "PSEUDO BULK AGGREGATOR:" << clusterAssignmentFilePath << "-" << unknownBarcodes << "barcodes are not part of the matrix";
+    }
+
+    // Ranks of the cluster names in their final order
+    QVector<int> clusterOrder(clusterNames.length());
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+
+    if (isNumeric) {
+        std::sort(clusterOrder.begin(), clusterOrder.end(), [&clusterNames](const int a, const int b) {
+            return clusterNames[a].toLongLong() < clusterNames[b].toLongLong();
+        });
+    }
+
+    QVector<int> clusterRanks(clusterNames.length());
+    clusterIDs.clear();
+    for (int rank = 0; rank < clusterOrder.length(); rank++) {
+        clusterRanks[clusterOrder[rank]] = rank;
+        clusterIDs.append(isNumeric ? QString("Cluster").append(QString::number(rank)) : clusterNames[clusterOrder[rank]]);
+    }
+
+    cellClusterIndices = QVector<int>(cellBarcodes.length(), -1);
+    for (int j = 0; j < cellBarcodes.length(); j++) {
+        if (cellClusterNameIndices[j] >= 0) {
+            cellClusterIndices[j] = clusterRanks[cellClusterNameIndices[j]];
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief aggregateClusters - Computes the mean count, the fraction of expressing cells and the variance of every gene in every cluster in one pass over the cells.
+ *        The cells are grouped by cluster and every cluster is split into slices that are summed up on the correlation pool,
+ *        the sums of the slices are merged in the order they were started, so the result does not depend on the order the slices finish
+ * @param sparseMatrix - Per cell counts
+ * @param clusterIDs - ID of every cluster
+ * @param cellClusterIndices - Cluster of every column, -1 for cells without cluster
+ * @return Statistics of every cluster
+ */
+QVector<ClusterStatistics> aggregateClusters(const SparseMatrix & sparseMatrix, const QStringList & clusterIDs, const QVector<int> & cellClusterIndices) {
+    TRACE_SCOPE("PseudoBulkAggregator::aggregateClusters");
+
+    int numberOfGenes = sparseMatrix.getNumberOfGenes(),
+        numberOfClusters = clusterIDs.length();
+
+    // Group the cells by cluster (counting sort), so the slices of a cluster are contiguous
+    QVector<int> clusterOffsets(numberOfClusters + 1, 0);
+    for (int clusterIndex : cellClusterIndices) {
+        if (clusterIndex >= 0) {
+            clusterOffsets[clusterIndex + 1]++;
+        }
+    }
+    for (int i = 0; i < numberOfClusters; i++) {
+        clusterOffsets[i + 1] += clusterOffsets[i];
+    }
+
+    QVector<int> clusteredCellIndices(clusterOffsets[numberOfClusters]);
+    QVector<int> nextPositions = clusterOffsets;
+    for (int j = 0; j < cellClusterIndices.length(); j++) {
+        if (cellClusterIndices[j] >= 0) {
+            clusteredCellIndices[nextPositions[cellClusterIndices[j]]++] = j;
+        }
+    }
+
+    // About four slices per thread keep the pool busy while the sums of the slices stay small
+    int numberOfThreads = ThreadPools::getThreadPool(ThreadPools::CorrelationPool)->maxThreadCount(),
+        cellsPerSlice = std::max(minimumCellsPerSlice, clusteredCellIndices.length() / std::max(1, 4 * numberOfThreads));
+
+    const SparseMatrix * matrix = &sparseMatrix;
+    QList<QFuture<PartialSums>> futurePartialSums;
+
+    for (int i = 0; i < numberOfClusters; i++) {
+        for (int sliceStart = clusterOffsets[i]; sliceStart < clusterOffsets[i + 1]; sliceStart += cellsPerSlice) {
+            int sliceLength = std::min(cellsPerSlice, clusterOffsets[i + 1] - sliceStart);
+
+            futurePartialSums.append(ThreadPools::run(ThreadPools::CorrelationPool, [matrix, clusteredCellIndices, sliceStart, sliceLength, i]() {
+                return accumulateCells(*matrix, clusteredCellIndices.constData() + sliceStart, sliceLength, i);
+            }));
+        }
+    }
+
+    QVector<QVector<double>> sums(numberOfClusters, QVector<double>(numberOfGenes, 0)),
+                             sumsOfSquares(numberOfClusters, QVector<double>(numberOfGenes, 0));
+    QVector<QVector<int>> expressingCells(numberOfClusters, QVector<int>(numberOfGenes, 0));
+
+    for (QFuture<PartialSums> & futurePartialSum : futurePartialSums) {
+        PartialSums partialSums = futurePartialSum.result();
+        int i = partialSums.clusterIndex;
+
+        double * clusterSums = sums[i].data(),
+               * clusterSumsOfSquares = sumsOfSquares[i].data();
+        int * clusterExpressingCells = expressingCells[i].data();
+
+        for (int g = 0; g < numberOfGenes; g++) {
+            clusterSums[g] += partialSums.sums[g];
+            clusterSumsOfSquares[g] += partialSums.sumsOfSquares[g];
+            clusterExpressingCells[g] += partialSums.expressingCells[g];
+        }
+    }
+
+    QVector<ClusterStatistics> clusterStatistics;
+    clusterStatistics.reserve(numberOfClusters);
+
+    for (int i = 0; i < numberOfClusters; i++) {
+        int numberOfCells = clusterOffsets[i + 1] - clusterOffsets[i];
+        ClusterStatistics statistics { clusterIDs[i], numberOfCells, QVector<float>(numberOfGenes, 0), QVector<float>(numberOfGenes, 0), QVector<float>(numberOfGenes, 0) };
+
+        // Clusters without cells of the matrix keep their zeros
+        if (numberOfCells == 0) {
+            clusterStatistics.append(statistics);
+            continue;
+        }
+
+        for (int g = 0; g < numberOfGenes; g++) {
+            double mean = sums[i][g] / numberOfCells;
+
+            statistics.means[g] = float(mean);
+            statistics.fractionsExpressed[g] = float(double(expressingCells[i][g]) / numberOfCells);
+            // Sample variance over every cell of the cluster - rounding may push it slightly below 0
+            statistics.variances[g] = numberOfCells > 1 ? float(std::max(0.0, (sumsOfSquares[i][g] - sums[i][g] * mean) / (numberOfCells - 1))) : 0;
+        }
+
+        clusterStatistics.append(statistics);
+    }
+
+    return clusterStatistics;
+}
+
+
+/**
+ * @brief toClusterCollections - Turns the statistics into cluster feature collections like the ones parsed from the differential expression file
+ * @param clusterStatistics - Statistics of every cluster
+ * @param geneIDs - Gene ID of every row of the statistics
+ * @param cutOff - Features with a mean count below or equal to this value are dropped
+ * @return List of clusters with their expressed features and mean counts
+ */
+QVector<FeatureCollection> toClusterCollections(const QVector<ClusterStatistics> & clusterStatistics, const QStringList & geneIDs, const double cutOff) {
+    QVector<FeatureCollection> clusters;
+    clusters.reserve(clusterStatistics.length());
+
+    for (const ClusterStatistics & statistics : clusterStatistics) {
+        FeatureCollection cluster(statistics.clusterID);
+
+        for (int g = 0; g < statistics.means.length(); g++) {
+            if (statistics.means[g] > cutOff) {
+                cluster.addFeature(geneIDs[g], statistics.means[g]);
+            }
+        }
+
+        clusters.append(cluster);
+    }
+
+    return clusters;
+}
+
+
+/**
+ * @brief getClusterFeatureExpressions - Reads the per cell counts that belong to a cluster assignment file and aggregates them into cluster feature expressions.
+ *        Can be used wherever cellranger's differential expression file is parsed
+ * @param clusterAssignmentFilePath - Path of the clusters.csv file
+ * @param cutOff - Features with a mean count below or equal to this value are dropped
+ * @return List of clusters with their expressed features - empty if the counts or the clusters could not be read
+ */
+QVector<FeatureCollection> getClusterFeatureExpressions(const QString clusterAssignmentFilePath, const double cutOff) {
+    TRACE_SCOPE("PseudoBulkAggregator::getClusterFeatureExpressions");
+
+    QString matrixPath = findFeatureBarcodeMatrix(clusterAssignmentFilePath);
+
+    if (matrixPath.isEmpty()) {
+        qDebug() << "PSEUDO BULK AGGREGATOR:" << clusterAssignmentFilePath << "- no filtered_feature_bc_matrix next to the file or in its cellranger output directory";
+        return QVector<FeatureCollection>();
+    }
+
+    // The collections are keyed by gene ID, so the rows of the matrix only have to be consistent within the dataset
+    GeneDictionary geneDictionary;
+    SparseMatrix sparseMatrix;
+    bool isRead = matrixPath.endsWith(".h5") ? Hdf5Reader::readFeatureBarcodeMatrix(matrixPath, geneDictionary, sparseMatrix)
+                                             : MtxReader::readFeatureBarcodeMatrix(matrixPath, geneDictionary, sparseMatrix);
+
+    QStringList clusterIDs;
+    QVector<int> cellClusterIndices;
+
+    if (!isRead || !readClusterAssignments(clusterAssignmentFilePath, sparseMatrix.getCellBarcodes(), clusterIDs, cellClusterIndices)) {
+        return QVector<FeatureCollection>();
+    }
+
+    return toClusterCollections(aggregateClusters(sparseMatrix, clusterIDs, cellClusterIndices), sparseMatrix.getGeneIDs(), cutOff);
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef PSEUDOBULKAGGREGATOR_H
+#define PSEUDOBULKAGGREGATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "BioModels/FeatureCollection.h"
+#include "BioModels/SparseMatrix.h"
+
+/**
+ * @brief The PseudoBulkAggregator namespace turns the per cell counts of a dataset and a cell clustering (cellranger's analysis/clustering/.../clusters.csv
+ *        or any external clustering in the same "Barcode,Cluster" form) into per cluster expressions. The mean counts, fractions of expressing cells and
+ *        variances of every cluster are computed in one pass over the sparse columns, split into slices of the cells of every cluster on the correlation pool.
+ */
+namespace PseudoBulkAggregator
+{
+    /**
+     * @brief The ClusterStatistics struct holds the statistics of a cluster for every gene (row) of the sparse matrix, zero counts included
+     */
+    struct ClusterStatistics
+    {
+        QString clusterID;
+        int numberOfCells;
+        QVector<float> means;
+        QVector<float> fractionsExpressed;
+        QVector<float> variances;
+    };
+
+    extern bool isClusterAssignmentFile(const QString filePath);
+    extern QString findFeatureBarcodeMatrix(const QString clusterAssignmentFilePath);
+    extern bool readClusterAssignments(const QString clusterAssignmentFilePath, const QStringList & cellBarcodes, QStringList & clusterIDs, QVector<int> & cellClusterIndices);
+
+    extern QVector<ClusterStatistics> aggregateClusters(const SparseMatrix & sparseMatrix, const QStringList & clusterIDs, const QVector<int> & cellClusterIndices);
+    extern QVector<FeatureCollection> toClusterCollections(const QVector<ClusterStatistics> & clusterStatistics, const QStringList & geneIDs, const double cutOff);
+
+    extern QVector<FeatureCollection> getClusterFeatureExpressions(const QString clusterAssignmentFilePath, const double cutOff);
+};
+
+#endif // PSEUDOBULKAGGREGATOR_H
@@ -0,0 +1,86 @@
+#include "RankCache.h"
+
+#include <QString>
+#include <QVector>
+
+#include <algorithm>
+
+#include "Utils/Sorter.h"
+#include "System/Trace.h"
+
+RankCache::RankCache() {}
+
+/**
+ * @brief RankCache::RankCache - Sorts the genes of every column by value with the radix sort of the Sorter. Genes without value are left out
+ * @param expressionMatrix - Full expression values
+ */
+RankCache::RankCache(const ExpressionMatrix & expressionMatrix)
+    : expressionMatrix {expressionMatrix}
+{
+    TRACE_SCOPE("RankCache::RankCache");
+
+    int numberOfColumns = expressionMatrix.getNumberOfClusters();
+    this->orderedGenes.reserve(numberOfColumns);
+
+    for (int j = 0; j < numberOfColumns; j++) {
+        QVector<float> columnValues = expressionMatrix.getClusterValues(j);
+        QVector<int> permutation = Sorter::calculateSortPermutation(columnValues);
+
+        // NaN sorts first - only the expressed genes are kept
+        int firstExpressed = 0;
+        while (firstExpressed < permutation.length() && columnValues[permutation[firstExpressed]] != columnValues[permutation[firstExpressed]]) {
+            firstExpressed++;
+        }
+
+        this->orderedGenes.append(permutation.mid(firstExpressed));
+    }
+}
+
+const ExpressionMatrix & RankCache::getExpressionMatrix() const {
+    return this->expressionMatrix;
+}
+
+int RankCache::getNumberOfColumns() const {
+    return this->orderedGenes.length();
+}
+
+QString RankCache::getColumnID(int columnIndex) const {
+    return this->expressionMatrix.getClusterID(columnIndex);
+}
+
+/**
+ * @brief RankCache::getOrderedGenes
+ * @param columnIndex - Column of the matrix
+ * @return Row indices of the expressed genes in ascending order of their value
+ */
+const QVector<int> & RankCache::getOrderedGenes(int columnIndex) const {
+    return this->orderedGenes[columnIndex];
+}
+
+/**
+ * @brief RankCache::findFirstAboveCutoff - Binary search for the start of the genes that are expressed above the cutoff
+ * @param columnIndex - Column of the matrix
+ * @param cutoff - Values below or equal to the cutoff are not expressed
+ * @return Position in the ordered genes of the column - their length if no gene is above the cutoff
+ */
+int RankCache::findFirstAboveCutoff(int columnIndex, double cutoff) const {
+    const QVector<int> & columnGenes = this->orderedGenes[columnIndex];
+    float floatCutoff = float(cutoff);
+
+    auto firstAboveCutoff = std::upper_bound(columnGenes.begin(), columnGenes.end(), floatCutoff, [this, columnIndex](float value, int geneIndex) {
+        return value < this->expressionMatrix.getValue(geneIndex, columnIndex);
+    });
+
+    return int(firstAboveCutoff - columnGenes.begin());
+}
+
+/**
+ * @brief RankCache::isAboveCutoff
+ * @param geneIndex - Row of the gene - rows the matrix does not cover are never expressed
+ * @param columnIndex - Column of the matrix
+ * @param cutoff - Values below or equal to the cutoff are not expressed
+ * @return True if the gene is expressed above the cutoff
+ */
+bool RankCache::isAboveCutoff(int geneIndex, int columnIndex, double cutoff) const {
+    return geneIndex < this->expressionMatrix.getNumberOfGenes() && this->expressionMatrix.getValue(geneIndex, columnIndex) > float(cutoff);
+}
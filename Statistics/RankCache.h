@@ -0,0 +1,33 @@
+#ifndef RANKCACHE_H
+#define RANKCACHE_H
+
+#include <QString>
+#include <QVector>
+
+#include "BioModels/ExpressionMatrix.h"
+
+/**
+ * @brief The RankCache class keeps the expressed genes of every column of an expression matrix in ascending order of their value.
+ *        The genes above any cutoff are a suffix of this order, so ranks within any masked subset of genes can be read off by a single walk
+ *        instead of sorting the subset. The order is calculated once and shared by every cutoff and every correlation method.
+ */
+class RankCache
+{
+private:
+    ExpressionMatrix expressionMatrix;
+    QVector<QVector<int>> orderedGenes;
+
+public:
+    RankCache();
+    RankCache(const ExpressionMatrix & expressionMatrix);
+
+    const ExpressionMatrix & getExpressionMatrix() const;
+    int getNumberOfColumns() const;
+    QString getColumnID(int columnIndex) const;
+
+    const QVector<int> & getOrderedGenes(int columnIndex) const;
+    int findFirstAboveCutoff(int columnIndex, double cutoff) const;
+    bool isAboveCutoff(int geneIndex, int columnIndex, double cutoff) const;
+};
+
+#endif // RANKCACHE_H
@@ -0,0 +1,331 @@
+#include "AllocationTracker.h"
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#ifdef BADGER_ALLOCATION_TRACKING
+// The C library allocator the hooks forward to
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void * __libc_calloc(size_t numberOfElements, size_t elementSize);
+extern "C" void * __libc_realloc(void * block, size_t size);
+extern "C" void * __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void * block);
+#endif
+
+namespace AllocationTracker {
+
+namespace {
+
+// Stages beyond this number are accounted as allocations outside of any stage
+const int maximumNumberOfStages = 128;
+
+// Every counter is zero initialized before any allocation happens, the hooks do not depend on the order of static initialization
+struct alignas(64) StageCounters
+{
+    std::atomic<qint64> numberOfAllocations {0};
+    std::atomic<qint64> allocatedBytes {0};
+    std::atomic<qint64> liveBytes {0};
+    std::atomic<qint64> peakLiveBytes {0};
+};
+
+StageCounters stageCounters[maximumNumberOfStages];
+std::atomic<const char *> stageNames[maximumNumberOfStages];
+std::atomic<int> numberOfStages {1};
+std::atomic_flag registrationLock = ATOMIC_FLAG_INIT;
+
+thread_local int currentStageIndex = 0;
+
+/**
+ * @brief findStage - Looks up a registered stage by name, so string literals of the same name from different files share a stage
+ * @return Index of the stage - -1 if the stage has not been registered
+ */
+int findStage(const char * name, const int firstStageIndex, const int lastStageIndex) {
+    for (int i = firstStageIndex; i < lastStageIndex; i++) {
+        if (strcmp(stageNames[i].load(std::memory_order_relaxed), name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+}
+
+
+/**
+ * @brief isEnabled - Returns whether allocations are tracked
+ * @return True if built with allocation tracking
+ */
+bool isEnabled() {
+#ifdef BADGER_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief registerStage - Returns the index of a stage and registers it on its first use
+ * @param name - Name of the stage - must be a string literal
+ * @return Index of the stage
+ */
+int registerStage(const char * name) {
+    int registeredStages = numberOfStages.load(std::memory_order_acquire);
+    int stageIndex = findStage(name, 1, registeredStages);
+
+    if (stageIndex >= 0) {
+        return stageIndex;
+    }
+
+    // Registration is rare, a spin lock keeps it free of allocations
+    while (registrationLock.test_and_set(std::memory_order_acquire)) {}
+
+    int currentlyRegisteredStages = numberOfStages.load(std::memory_order_relaxed);
+    stageIndex = findStage(name, registeredStages, currentlyRegisteredStages);
+
+    if (stageIndex < 0 && currentlyRegisteredStages < maximumNumberOfStages) {
+        stageIndex = currentlyRegisteredStages;
+        stageNames[stageIndex].store(name, std::memory_order_relaxed);
+        numberOfStages.store(stageIndex + 1, std::memory_order_release);
+    }
+
+    registrationLock.clear(std::memory_order_release);
+
+    return stageIndex >= 0 ? stageIndex : 0;
+}
+
+
+/**
+ * @brief enterStage - Accounts the following allocations of the calling thread to the given stage
+ * @param stageIndex - Index of the stage
+ * @return Index of the stage that was active before
+ */
+int enterStage(const int stageIndex) {
+    int previousStageIndex = currentStageIndex;
+    currentStageIndex = stageIndex;
+    return previousStageIndex;
+}
+
+
+/**
+ * @brief leaveStage - Accounts the following allocations of the calling thread to the stage that was active before
+ * @param previousStageIndex - Index returned by enterStage
+ */
+void leaveStage(const int previousStageIndex) {
+    currentStageIndex = previousStageIndex;
+}
+
+
+/**
+ * @brief getStageAllocations - Returns the allocations of every stage that has allocated so far
+ * @return Allocations in the order the stages have been registered - the first entry holds the allocations outside of any stage
+ */
+QVector<StageAllocations> getStageAllocations() {
+    QVector<StageAllocations> stageAllocations;
+    int registeredStages = numberOfStages.load(std::memory_order_acquire);
+
+    for (int i = 0; i < registeredStages; i++) {
+        const StageCounters & counters = stageCounters[i];
+
+        if (counters.numberOfAllocations.load() == 0) {
+            continue;
+        }
+
+        stageAllocations.append({ i == 0 ? QString("Outside of stages") : QString::fromLatin1(stageNames[i].load()),
+                                  counters.numberOfAllocations.load(), counters.allocatedBytes.load(),
+                                  counters.peakLiveBytes.load(), counters.liveBytes.load() });
+    }
+
+    return stageAllocations;
+}
+
+
+#ifdef BADGER_ALLOCATION_TRACKING
+namespace {
+
+/**
+ * @brief The AllocationHeader struct precedes every tracked allocation. Blocks are freed by the stage they were allocated in,
+ *        so the live bytes of a stage go down again when a later stage frees its results
+ */
+struct AllocationHeader
+{
+    void * block;
+    size_t size;
+    int stageIndex;
+};
+
+// Space in front of plain allocations - a multiple of the alignment malloc guarantees
+const size_t headerSpace = 32;
+
+AllocationHeader * getHeader(void * pointer) {
+    return reinterpret_cast<AllocationHeader *>(static_cast<char *>(pointer) - sizeof(AllocationHeader));
+}
+
+/**
+ * @brief trackAllocation - Writes the header of a new block and accounts its bytes to the stage of the calling thread
+ * @param block - Block returned by the C library
+ * @param offset - Offset of the returned pointer in the block
+ * @param size - Bytes requested by the caller
+ * @return Pointer for the caller - null if the block is null
+ */
+void * trackAllocation(void * block, const size_t offset, const size_t size) {
+    if (block == nullptr) {
+        return nullptr;
+    }
+
+    void * pointer = static_cast<char *>(block) + offset;
+    int stageIndex = currentStageIndex;
+    *getHeader(pointer) = { block, size, stageIndex };
+
+    StageCounters & counters = stageCounters[stageIndex];
+    counters.numberOfAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.allocatedBytes.fetch_add(qint64(size), std::memory_order_relaxed);
+
+    qint64 liveBytes = counters.liveBytes.fetch_add(qint64(size), std::memory_order_relaxed) + qint64(size);
+    qint64 peakLiveBytes = counters.peakLiveBytes.load(std::memory_order_relaxed);
+    while (liveBytes > peakLiveBytes && !counters.peakLiveBytes.compare_exchange_weak(peakLiveBytes, liveBytes, std::memory_order_relaxed)) {}
+
+    return pointer;
+}
+
+/**
+ * @brief untrackAllocation - Takes the bytes of a block off the stage that allocated it
+ * @return Block to return to the C library
+ */
+void * untrackAllocation(void * pointer) {
+    AllocationHeader * header = getHeader(pointer);
+    stageCounters[header->stageIndex].liveBytes.fetch_sub(qint64(header->size), std::memory_order_relaxed);
+    return header->block;
+}
+
+void * allocateAligned(size_t alignment, const size_t size) {
+    if (alignment < alignof(max_align_t)) {
+        alignment = alignof(max_align_t);
+    }
+
+    // Power of two alignments larger than the header space leave room for the header in front of the first aligned address
+    size_t offset = alignment > headerSpace ? alignment : headerSpace;
+    if (size > size_t(-1) - offset) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return trackAllocation(__libc_memalign(alignment, size + offset), offset, size);
+}
+
+}
+#endif
+
+}
+
+
+#ifdef BADGER_ALLOCATION_TRACKING
+using AllocationTracker::headerSpace;
+
+// Replacements of the glibc allocation functions - every function that returns memory for free() has to be replaced, see "Replacing malloc" in the glibc manual
+extern "C" void * malloc(size_t size) noexcept {
+    if (size > size_t(-1) - headerSpace) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return AllocationTracker::trackAllocation(__libc_malloc(size + headerSpace), headerSpace, size);
+}
+
+extern "C" void free(void * pointer) noexcept {
+    if (pointer != nullptr) {
+        __libc_free(AllocationTracker::untrackAllocation(pointer));
+    }
+}
+
+extern "C" void * calloc(size_t numberOfElements, size_t elementSize) noexcept {
+    if (elementSize != 0 && numberOfElements > (size_t(-1) - headerSpace) / elementSize) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return AllocationTracker::trackAllocation(__libc_calloc(1, numberOfElements * elementSize + headerSpace), headerSpace, numberOfElements * elementSize);
+}
+
+extern "C" void * realloc(void * pointer, size_t size) noexcept {
+    if (pointer == nullptr) {
+        return malloc(size);
+    }
+
+    if (size == 0) {
+        free(pointer);
+        return nullptr;
+    }
+
+    AllocationTracker::AllocationHeader header = *AllocationTracker::getHeader(pointer);
+
+    // Aligned blocks cannot be resized in place without losing their alignment
+    if (static_cast<char *>(pointer) - static_cast<char *>(header.block) != ptrdiff_t(headerSpace)) {
+        void * newPointer = malloc(size);
+
+        if (newPointer != nullptr) {
+            memcpy(newPointer, pointer, header.size < size ? header.size : size);
+            free(pointer);
+        }
+        return newPointer;
+    }
+
+    if (size > size_t(-1) - headerSpace) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    // The old block stays valid - and accounted - if it cannot be resized
+    void * newBlock = __libc_realloc(header.block, size + headerSpace);
+    if (newBlock == nullptr) {
+        return nullptr;
+    }
+
+    // A resized block counts as new allocation of the stage that resizes it
+    AllocationTracker::stageCounters[header.stageIndex].liveBytes.fetch_sub(qint64(header.size), std::memory_order_relaxed);
+    return AllocationTracker::trackAllocation(newBlock, headerSpace, size);
+}
+
+extern "C" void * memalign(size_t alignment, size_t size) noexcept {
+    return AllocationTracker::allocateAligned(alignment, size);
+}
+
+extern "C" void * aligned_alloc(size_t alignment, size_t size) noexcept {
+    return AllocationTracker::allocateAligned(alignment, size);
+}
+
+extern "C" int posix_memalign(void ** pointer, size_t alignment, size_t size) noexcept {
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+
+    void * newPointer = AllocationTracker::allocateAligned(alignment, size);
+    if (newPointer == nullptr) {
+        return ENOMEM;
+    }
+
+    *pointer = newPointer;
+    return 0;
+}
+
+extern "C" void * valloc(size_t size) noexcept {
+    return AllocationTracker::allocateAligned(size_t(sysconf(_SC_PAGESIZE)), size);
+}
+
+extern "C" void * pvalloc(size_t size) noexcept {
+    size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    return AllocationTracker::allocateAligned(pageSize, (size + pageSize - 1) / pageSize * pageSize);
+}
+
+extern "C" size_t malloc_usable_size(void * pointer) noexcept {
+    return pointer != nullptr ? AllocationTracker::getHeader(pointer)->size : 0;
+}
+#endif
@@ -0,0 +1,64 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief The AllocationTracker namespace accounts every heap allocation to the stage that made it: number of allocations, allocated bytes,
+ *        peak live bytes and the bytes that are still live. It replaces malloc and its relatives, which operator new and the Qt containers
+ *        allocate through, so it is only compiled in when building with "qmake CONFIG+=allocation_tracking". Stages are tagged by STAGE_SCOPE
+ *        and the pool tasks, allocations outside of any stage are accounted to the first entry.
+ */
+namespace AllocationTracker
+{
+    struct StageAllocations
+    {
+        QString name;
+        qint64 numberOfAllocations;
+        qint64 allocatedBytes;
+        qint64 peakLiveBytes;
+        // Bytes allocated by the stage that have not been freed yet - memory that keeps growing over runs is leaking
+        qint64 liveBytes;
+    };
+
+    extern bool isEnabled();
+    extern int registerStage(const char * name);
+    extern int enterStage(const int stageIndex);
+    extern void leaveStage(const int previousStageIndex);
+    extern QVector<StageAllocations> getStageAllocations();
+
+    /**
+     * @brief The StageTag class accounts the allocations of the calling thread from its construction to its destruction to its stage
+     */
+    class StageTag
+    {
+    private:
+        int previousStageIndex;
+
+    public:
+#ifdef BADGER_ALLOCATION_TRACKING
+        /**
+         * @brief StageTag::StageTag
+         * @param name - Name of the stage - must be a string literal, only the pointer is stored
+         */
+        StageTag(const char * name)
+            : previousStageIndex {enterStage(registerStage(name))}
+        {}
+
+        ~StageTag() {
+            leaveStage(this->previousStageIndex);
+        }
+#else
+        StageTag(const char *)
+            : previousStageIndex {0}
+        {}
+#endif
+
+        StageTag(const StageTag &) = delete;
+        StageTag & operator=(const StageTag &) = delete;
+    };
+};
+
+#endif // ALLOCATIONTRACKER_H
@@ -0,0 +1,325 @@
+#include "AnnotationServer.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include <QDebug>
+
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+#include "Utils/Helper.h"
+#include "Utils/FileOperators/CSVReader.h"
+#include "Statistics/Expressioncomparator.h"
+#include "Statistics/PseudoBulkAggregator.h"
+
+namespace {
+// Unprocessed bytes a client may send ahead - raw data of ANNOTATE_DATA included. A client that exceeds it is dropped
+const int maximumBufferBytes = 256 * 1024 * 1024;
+}
+
+/**
+ * @brief AnnotationServer::AnnotationServer
+ * @param clusterCutoff - Cutoff that is used to parse every dataset that is sent to the server
+ * @param parent
+ */
+AnnotationServer::AnnotationServer(const double clusterCutoff, QObject * parent)
+    : QObject(parent), clusterCutoff {clusterCutoff}
+{
+    QObject::connect(&localServer, &QLocalServer::newConnection, this, &AnnotationServer::on_newConnection);
+}
+
+
+/**
+ * @brief AnnotationServer::loadReference - Parses the given reference once and keeps it resident under its file name
+ * @param referenceFilePath - Path to the tab separated tissue / cell type reference
+ * @param referenceCutoff - Cutoff that is used to parse the reference
+ */
+void AnnotationServer::loadReference(const QString referenceFilePath, const double referenceCutoff) {
+    QString referenceName = Helper::chopFileName(referenceFilePath);
+    QVector<FeatureCollection> reference = CSVReader::getTissuesWithGeneExpression(referenceFilePath, referenceCutoff);
+
+    this->references.insert(referenceName, reference);
+    qDebug() << "Loaded reference" << referenceName << "with" << reference.length() << "types.";
+}
+
+
+/**
+ * @brief AnnotationServer::listen - Starts listening on the given local socket name - a stale socket file from a crashed run is removed beforehand
+ * @param socketName - Name or absolute path of the local socket
+ * @return True if the server is listening
+ */
+bool AnnotationServer::listen(const QString socketName) {
+    QLocalServer::removeServer(socketName);
+
+    bool isListening = this->localServer.listen(socketName);
+
+    if (!isListening) {
+        qDebug() << "ANNOTATION SERVER:" << socketName << "-" << this->localServer.errorString();
+    }
+
+    return isListening;
+}
+
+
+/**
+ * @brief AnnotationServer::writeLine - Writes a single tab separated response line to the client
+ * @param socket - Client socket
+ * @param fields - Fields of the response line
+ */
+void AnnotationServer::writeLine(QLocalSocket * socket, const QStringList fields) {
+    socket->write(fields.join('\t').toUtf8().append('\n'));
+}
+
+
+/**
+ * @brief AnnotationServer::processNextRequest - Takes the next complete request from the client buffer and handles it. Requests of one client are handled one at a time
+ * @param socket - Client socket whose buffer should be processed
+ */
+void AnnotationServer::processNextRequest(QLocalSocket * socket) {
+    if (!this->clients.contains(socket) || this->clients[socket].isBusy) {
+        return;
+    }
+
+    QByteArray & buffer = this->clients[socket].buffer;
+
+    // Wait for more data if the request line is not complete yet
+    int lineEnd = buffer.indexOf('\n');
+    if (lineEnd < 0) {
+        return;
+    }
+
+    QStringList fields = QString::fromUtf8(buffer.left(lineEnd)).trimmed().split('\t');
+    QString command = fields.first();
+
+    if (command == "LIST_REFERENCES") {
+        buffer.remove(0, lineEnd + 1);
+
+        for (auto reference = this->references.constBegin(); reference != this->references.constEnd(); reference++) {
+            this->writeLine(socket, { "REFERENCE", reference.key(), QString::number(reference.value().length()) });
+        }
+        this->writeLine(socket, { "END", QString::number(this->references.size()) });
+
+        this->processNextRequest(socket);
+        return;
+    }
+
+    // The daemon runs until it is killed, so its trace is written on request
+    if (command == "WRITE_TRACE") {
+        buffer.remove(0, lineEnd + 1);
+
+        if (!Trace::isEnabled()) {
+            this->writeLine(socket, { "ERROR", "Tracing is disabled" });
+        } else if (!Trace::writeTrace()) {
+            this->writeLine(socket, { "ERROR", "Could not write trace to " + Trace::getTraceFilePath() });
+        } else {
+            this->writeLine(socket, { "END", "0" });
+        }
+
+        this->processNextRequest(socket);
+        return;
+    }
+
+    bool isAnnotationRequest = command == "ANNOTATE_FILE" || command == "ANNOTATE_DATA";
+    bool isValidNumberOfTopTypes = false;
+    int numberOfTopTypes = fields.length() == 4 ? fields[2].toInt(&isValidNumberOfTopTypes) : 0;
+
+    if (!isAnnotationRequest || !isValidNumberOfTopTypes) {
+        buffer.remove(0, lineEnd + 1);
+        this->writeLine(socket, { "ERROR", "Malformed request: " + command });
+        this->processNextRequest(socket);
+        return;
+    }
+
+    QString referenceName = fields[1];
+
+    if (command == "ANNOTATE_FILE") {
+        buffer.remove(0, lineEnd + 1);
+        this->startAnnotation(socket, referenceName, numberOfTopTypes, fields[3], QByteArray());
+        return;
+    }
+
+    bool isValidByteCount = false;
+    int byteCount = fields[3].toInt(&isValidByteCount);
+
+    if (!isValidByteCount || byteCount < 0 || byteCount > maximumBufferBytes - (lineEnd + 1)) {
+        buffer.remove(0, lineEnd + 1);
+        this->writeLine(socket, { "ERROR", "Invalid byte count: " + fields[3] });
+        this->processNextRequest(socket);
+        return;
+    }
+
+    // The raw data follows the request line - wait until it has been received completely
+    if (buffer.length() < lineEnd + 1 + byteCount) {
+        return;
+    }
+
+    QByteArray rawData = buffer.mid(lineEnd + 1, byteCount);
+    buffer.remove(0, lineEnd + 1 + byteCount);
+
+    this->startAnnotation(socket, referenceName, numberOfTopTypes, QString(), rawData);
+}
+
+
+/**
+ * @brief AnnotationServer::startAnnotation - Parses the given dataset on the parsing pool and correlates its clusters in parallel against the resident reference.
+ *        Every cluster is streamed back to the client as soon as its correlations are finished.
+ * @param socket - Client socket the rows are written to
+ * @param referenceName - Name of the resident reference to correlate against
+ * @param numberOfTopTypes - Number of best correlated types that are reported per cluster
+ * @param filePath - Path of the dataset file - empty if the raw data should be used instead
+ * @param rawData - Content of a cellranger differential expression file
+ */
+void AnnotationServer::startAnnotation(QLocalSocket * socket, const QString referenceName, const int numberOfTopTypes, const QString filePath, const QByteArray rawData) {
+    if (!this->references.contains(referenceName)) {
+        this->writeLine(socket, { "ERROR", "Unknown reference: " + referenceName });
+        this->processNextRequest(socket);
+        return;
+    }
+
+    // The CSVReader exits on unreadable files, so this has to be checked beforehand
+    if (!filePath.isEmpty() && !QFileInfo(filePath).isReadable()) {
+        this->writeLine(socket, { "ERROR", "Unreadable file: " + filePath });
+        this->processNextRequest(socket);
+        return;
+    }
+
+    this->clients[socket].isBusy = true;
+
+    QVector<FeatureCollection> reference = this->references.value(referenceName);
+    double cutoff = this->clusterCutoff;
+    QPointer<QLocalSocket> guardedSocket(socket);
+
+    // Parse the dataset in a separate thread of the parsing pool
+    QFuture<QVector<FeatureCollection>> futureClusters = ThreadPools::run(ThreadPools::ParsingPool, [filePath, rawData, cutoff]() {
+        if (!filePath.isEmpty()) {
+            return PseudoBulkAggregator::isClusterAssignmentFile(filePath) ? PseudoBulkAggregator::getClusterFeatureExpressions(filePath, cutoff)
+                                                                           : CSVReader::getClusterFeatureExpressions(filePath, cutoff);
+        }
+
+        QByteArray data = rawData;
+        QBuffer dataBuffer(&data);
+        dataBuffer.open(QIODevice::ReadOnly);
+        return CSVReader::parseClusterFeatureExpressions(dataBuffer, cutoff);
+    });
+
+    QFutureWatcher<QVector<FeatureCollection>> * parsingWatcher = new QFutureWatcher<QVector<FeatureCollection>>(this);
+
+    QObject::connect(parsingWatcher, &QFutureWatcherBase::finished, this, [=]() {
+        QVector<FeatureCollection> clusters = parsingWatcher->result();
+        parsingWatcher->deleteLater();
+
+        // The client may have left while the dataset was parsed
+        if (guardedSocket.isNull() || !this->clients.contains(socket)) {
+            return;
+        }
+
+        if (clusters.isEmpty()) {
+            this->writeLine(socket, { "ERROR", "No clusters found in dataset" });
+            this->clients[socket].isBusy = false;
+            this->processNextRequest(socket);
+            return;
+        }
+
+        // Every cluster is correlated in its own task so that finished clusters can be streamed right away
+        QSharedPointer<int> numberOfRows(new int(0)),
+                            numberOfRemainingClusters(new int(clusters.length()));
+
+        for (int clusterIndex = 0; clusterIndex < clusters.length(); clusterIndex++) {
+            FeatureCollection cluster = clusters[clusterIndex];
+
+            QFuture<QVector<QPair<QString, double>>> futureCorrelations = ThreadPools::run(ThreadPools::CorrelationPool, [cluster, reference]() {
+                return ExpressionComparator::findClusterTissueCorrelations({ cluster }, reference).first();
+            });
+
+            QFutureWatcher<QVector<QPair<QString, double>>> * correlationWatcher = new QFutureWatcher<QVector<QPair<QString, double>>>(this);
+
+            QObject::connect(correlationWatcher, &QFutureWatcherBase::finished, this, [=]() {
+                QVector<QPair<QString, double>> correlations = correlationWatcher->result();
+                correlationWatcher->deleteLater();
+
+                if (guardedSocket.isNull() || !this->clients.contains(socket)) {
+                    return;
+                }
+
+                int numberOfReportedTypes = qMin(numberOfTopTypes, correlations.length());
+
+                for (int rank = 0; rank < numberOfReportedTypes; rank++) {
+                    this->writeLine(socket, { "ROW", cluster.ID, QString::number(rank + 1), correlations[rank].first, QString::number(correlations[rank].second) });
+                }
+                *numberOfRows += numberOfReportedTypes;
+
+                // The last finished cluster closes the answer
+                if (--(*numberOfRemainingClusters) == 0) {
+                    this->writeLine(socket, { "END", QString::number(*numberOfRows) });
+                    this->clients[socket].isBusy = false;
+                    this->processNextRequest(socket);
+                }
+            });
+
+            correlationWatcher->setFuture(futureCorrelations);
+        }
+    });
+
+    parsingWatcher->setFuture(futureClusters);
+}
+
+
+// ++++++++++++++++++++++++++++++++ SLOTS ++++++++++++++++++++++++++++++++
+/**
+ * @brief AnnotationServer::on_newConnection - Registers every new client
+ */
+void AnnotationServer::on_newConnection() {
+    while (this->localServer.hasPendingConnections()) {
+        QLocalSocket * socket = this->localServer.nextPendingConnection();
+        this->clients.insert(socket, ClientState());
+
+        QObject::connect(socket, &QLocalSocket::readyRead, this, &AnnotationServer::on_socketReadyRead);
+        QObject::connect(socket, &QLocalSocket::disconnected, this, &AnnotationServer::on_socketDisconnected);
+    }
+}
+
+
+/**
+ * @brief AnnotationServer::on_socketReadyRead - Buffers the received data and handles every request that is complete.
+ *        A client whose unprocessed data would exceed the buffer limit is answered with an error and disconnected
+ */
+void AnnotationServer::on_socketReadyRead() {
+    QLocalSocket * socket = qobject_cast<QLocalSocket *>(this->sender());
+
+    if (!this->clients.contains(socket)) {
+        return;
+    }
+
+    QByteArray & buffer = this->clients[socket].buffer;
+
+    if (socket->bytesAvailable() > maximumBufferBytes - buffer.size()) {
+        qDebug() << "ANNOTATION SERVER: Dropping client that sent more than" << maximumBufferBytes << "unprocessed bytes";
+        this->writeLine(socket, { "ERROR", "Request exceeds " + QString::number(maximumBufferBytes) + " bytes" });
+
+        // Running jobs of the client finish without writing, the socket is deleted once it has disconnected
+        this->clients.remove(socket);
+        socket->disconnectFromServer();
+        return;
+    }
+
+    buffer.append(socket->readAll());
+    this->processNextRequest(socket);
+}
+
+
+/**
+ * @brief AnnotationServer::on_socketDisconnected - Forgets about the client. Running jobs of the client finish without writing
+ */
+void AnnotationServer::on_socketDisconnected() {
+    QLocalSocket * socket = qobject_cast<QLocalSocket *>(this->sender());
+
+    this->clients.remove(socket);
+    socket->deleteLater();
+}
+// ++++++++++++++++++++++++++++++++ SLOTS ++++++++++++++++++++++++++++++++
@@ -0,0 +1,57 @@
+#ifndef ANNOTATIONSERVER_H
+#define ANNOTATIONSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QString>
+#include <QByteArray>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "BioModels/FeatureCollection.h"
+
+/**
+ * @brief The AnnotationServer class keeps parsed references resident and answers annotation jobs sent over a local socket.
+ *
+ * Protocol (one tab-separated request line per job, answered by a stream of lines):
+ *   LIST_REFERENCES                                        -> REFERENCE <name> <number of types> ... END <count>
+ *   ANNOTATE_FILE <reference> <top n> <file path>          -> ROW <cluster> <rank> <type> <correlation> ... END <count>
+ *   ANNOTATE_DATA <reference> <top n> <byte count>\n<raw CSV bytes>
+ * Any failure is answered with a single ERROR <message> line.
+ */
+class AnnotationServer : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct ClientState
+    {
+        QByteArray buffer;
+        bool isBusy = false;
+    };
+
+    QLocalServer localServer;
+    double clusterCutoff;
+
+    QHash<QString, QVector<FeatureCollection>> references;
+    QHash<QLocalSocket *, ClientState> clients;
+
+    void processNextRequest(QLocalSocket * socket);
+    void startAnnotation(QLocalSocket * socket, const QString referenceName, const int numberOfTopTypes, const QString filePath, const QByteArray rawData);
+    void writeLine(QLocalSocket * socket, const QStringList fields);
+
+public:
+    AnnotationServer(const double clusterCutoff, QObject * parent = nullptr);
+
+    void loadReference(const QString referenceFilePath, const double referenceCutoff);
+    bool listen(const QString socketName);
+
+private slots:
+    void on_newConnection();
+    void on_socketReadyRead();
+    void on_socketDisconnected();
+};
+
+#endif // ANNOTATIONSERVER_H
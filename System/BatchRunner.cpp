@@ -0,0 +1,314 @@
+#include "BatchRunner.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "System/SharedReference.h"
+#include "System/Trace.h"
+#include "Graphics/ReportRenderer.h"
+#include "Utils/Helper.h"
+#include "Utils/FileOperators/CSVReader.h"
+#include "Utils/FileOperators/CSVWriter.h"
+#include "Statistics/Expressioncomparator.h"
+#include "Statistics/PseudoBulkAggregator.h"
+
+namespace BatchRunner {
+
+namespace {
+
+// States of the datasets in the shared work queue - positive values are the pid of the worker that is processing the dataset
+const int datasetPending = 0,
+          datasetFinished = -1,
+          datasetFailed = -2;
+
+// Types of the mapped reference that are rebuilt in the memory of a worker at a time
+const int typesPerChunk = 64;
+
+/**
+ * @brief correlateWithMappedReference - Correlates the clusters with the mapped reference chunk by chunk, so a worker only ever holds
+ *        the records of a few types besides the mapping that all workers share
+ * @param clusters - Clusters of the dataset
+ * @param reference - Reference in the shared segment
+ * @return Sorted correlations between every cluster and every type - same as ExpressionComparator::findClusterTissueCorrelations
+ */
+QVector<QVector<QPair<QString, double>>> correlateWithMappedReference(const QVector<FeatureCollection> & clusters, const SharedReference::MappedReference & reference) {
+    int numberOfTypes = reference.getNumberOfTypes();
+
+    QVector<QVector<QPair<QString, double>>> correlations(clusters.length());
+    for (QVector<QPair<QString, double>> & clusterCorrelations : correlations) {
+        clusterCorrelations.reserve(numberOfTypes);
+    }
+
+    for (int firstType = 0; firstType < numberOfTypes; firstType += typesPerChunk) {
+        QVector<FeatureCollection> types;
+        types.reserve(typesPerChunk);
+
+        for (int j = firstType; j < std::min(firstType + typesPerChunk, numberOfTypes); j++) {
+            types.append(reference.getType(j));
+        }
+
+        QVector<QVector<QPair<QString, double>>> chunkCorrelations = ExpressionComparator::findClusterTissueCorrelations(clusters, types);
+
+        for (int i = 0; i < clusters.length(); i++) {
+            correlations[i].append(chunkCorrelations[i]);
+        }
+    }
+
+    for (QVector<QPair<QString, double>> & clusterCorrelations : correlations) {
+        std::stable_sort(clusterCorrelations.begin(), clusterCorrelations.end(),
+                         [](const QPair<QString, double> & pairA, const QPair<QString, double> & pairB) { return pairA.second > pairB.second; });
+    }
+
+    return correlations;
+}
+
+
+/**
+ * @brief getTopTypes - Rebuilds the best correlated type of every cluster from the mapped reference - the reports only show these
+ * @param correlations - Sorted correlations of every cluster
+ * @param reference - Reference in the shared segment
+ * @return The top types, every type once
+ */
+QVector<FeatureCollection> getTopTypes(const QVector<QVector<QPair<QString, double>>> & correlations, const SharedReference::MappedReference & reference) {
+    QSet<QString> topTypeIDs;
+    for (const QVector<QPair<QString, double>> & clusterCorrelations : correlations) {
+        if (!clusterCorrelations.isEmpty()) {
+            topTypeIDs.insert(clusterCorrelations.first().first);
+        }
+    }
+
+    QVector<FeatureCollection> topTypes;
+    for (int j = 0; j < reference.getNumberOfTypes(); j++) {
+        if (topTypeIDs.contains(reference.getTypeID(j))) {
+            topTypes.append(reference.getType(j));
+        }
+    }
+
+    return topTypes;
+}
+
+
+/**
+ * @brief runWorker - Worker process main loop: takes the next dataset from the shared queue until it is empty
+ * @param parameters - Batch parameters
+ * @param outputFilePathPrefixes - Output path without extension for every dataset
+ * @param segmentDescriptor - Shared memory segment containing the reference
+ * @param workQueue - Shared queue: [0] is the index of the next dataset, [1 + i] the state of dataset i
+ */
+__attribute__((noreturn)) void runWorker(const BatchParameters & parameters, const QStringList & outputFilePathPrefixes, int segmentDescriptor, std::atomic<int> * workQueue) {
+    // The worker writes its own trace, which the parent merges into the trace of the batch
+    if (Trace::isEnabled()) {
+        Trace::resetAfterFork();
+    }
+
+    SharedReference::MappedReference reference = SharedReference::mapSegment(segmentDescriptor);
+
+    if (reference.getNumberOfTypes() == 0) {
+        _exit(2);
+    }
+
+    int numberOfDatasets = parameters.datasetFilePaths.length();
+
+    while (true) {
+        int datasetIndex = workQueue[0].fetch_add(1);
+
+        if (datasetIndex >= numberOfDatasets) {
+            break;
+        }
+
+        // Claim the dataset so the parent knows which one was lost if this worker dies
+        std::atomic<int> & datasetState = workQueue[datasetIndex + 1];
+        datasetState.store(int(getpid()));
+
+        TRACE_SCOPE("BatchRunner::annotateDataset");
+        const QString & datasetFilePath = parameters.datasetFilePaths[datasetIndex];
+        QVector<FeatureCollection> clusters = PseudoBulkAggregator::isClusterAssignmentFile(datasetFilePath)
+                                              ? PseudoBulkAggregator::getClusterFeatureExpressions(datasetFilePath, parameters.clusterCutoff)
+                                              : CSVReader::getClusterFeatureExpressions(datasetFilePath, parameters.clusterCutoff);
+        QVector<QVector<QPair<QString, double>>> correlations = correlateWithMappedReference(clusters, reference);
+
+        const QString & outputFilePathPrefix = outputFilePathPrefixes[datasetIndex];
+        bool isWritten = CSVWriter::writeClusterTissueCorrelations(outputFilePathPrefix + ".correlations.tsv", clusters, correlations, parameters.numberOfTopTypes);
+
+        // The reports are rendered by this worker as well, so rendering scales with the number of workers
+        if (isWritten && !parameters.reportFormat.isEmpty()) {
+            isWritten = ReportRenderer::renderReports(outputFilePathPrefix, parameters.reportFormat, clusters, correlations,
+                                                     getTopTypes(correlations, reference), parameters.numberOfTopTypes);
+        }
+        datasetState.store(isWritten ? datasetFinished : datasetFailed);
+    }
+
+    if (Trace::isEnabled()) {
+        Trace::writeTrace(Trace::getProcessTraceFilePath(getpid()));
+    }
+
+    _exit(0);
+}
+
+}
+
+
+/**
+ * @brief runBatch - Parses the reference once, puts it into a shared memory segment and lets a pool of forked workers annotate the datasets.
+ *        Workers that die are replaced as long as datasets are left, the dataset they were working on is reported as failed.
+ *        Must be called before any thread has been started, as the workers are created with fork().
+ * @param parameters - Reference, datasets, output directory and tuning of the batch
+ * @return 0 if every dataset has been annotated, 1 otherwise
+ */
+int runBatch(BatchParameters parameters) {
+    int numberOfDatasets = parameters.datasetFilePaths.length();
+
+    if (numberOfDatasets == 0) {
+        qDebug() << "BATCH: No datasets given.";
+        return 1;
+    }
+
+    QDir outputDirectory(parameters.outputDirectoryPath);
+    if (!outputDirectory.mkpath(".")) {
+        qDebug() << "BATCH: Could not create output directory" << parameters.outputDirectoryPath;
+        return 1;
+    }
+
+    if (!parameters.reportFormat.isEmpty() && !ReportRenderer::isSupportedFormat(parameters.reportFormat)) {
+        qDebug() << "BATCH: Unsupported report format" << parameters.reportFormat;
+        return 1;
+    }
+
+    // CellRanger names every dataset file the same, so duplicate names are made unique by their position
+    QStringList outputFilePathPrefixes;
+    QSet<QString> usedDatasetNames;
+    for (int i = 0; i < numberOfDatasets; i++) {
+        QString datasetName = Helper::chopFileName(parameters.datasetFilePaths[i]);
+
+        if (usedDatasetNames.contains(datasetName)) {
+            datasetName.append("_" + QString::number(i));
+        }
+
+        usedDatasetNames.insert(datasetName);
+        outputFilePathPrefixes.append(outputDirectory.filePath(datasetName));
+    }
+
+    // The reference is parsed once and only lives in the shared segment from now on
+    cout << "Parsing reference." << endl;
+    int segmentDescriptor = SharedReference::createSegment(CSVReader::getTissuesWithGeneExpression(parameters.referenceFilePath, parameters.referenceCutoff));
+
+    if (segmentDescriptor < 0) {
+        return 1;
+    }
+
+    // Anonymous shared memory survives fork() and is visible to parent and workers alike
+    size_t workQueueSize = sizeof(std::atomic<int>) * size_t(numberOfDatasets + 1);
+    void * workQueueMapping = mmap(nullptr, workQueueSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (workQueueMapping == MAP_FAILED) {
+        qDebug() << "BATCH: Could not create work queue.";
+        close(segmentDescriptor);
+        return 1;
+    }
+
+    std::atomic<int> * workQueue = static_cast<std::atomic<int> *>(workQueueMapping);
+    for (int i = 0; i < numberOfDatasets + 1; i++) {
+        new (&workQueue[i]) std::atomic<int>(datasetPending);
+    }
+
+    auto spawnWorker = [&]() {
+        pid_t pid = fork();
+        if (pid == 0) {
+            runWorker(parameters, outputFilePathPrefixes, segmentDescriptor, workQueue);
+        }
+
+        if (pid > 0 && Trace::isEnabled()) {
+            Trace::addMergedTraceFile(Trace::getProcessTraceFilePath(pid));
+        }
+        return pid;
+    };
+
+    int numberOfWorkers = qBound(1, parameters.numberOfWorkers, numberOfDatasets);
+    QSet<pid_t> workers;
+
+    cout << "Annotating " << numberOfDatasets << " datasets with " << numberOfWorkers << " workers." << endl;
+    for (int i = 0; i < numberOfWorkers; i++) {
+        pid_t pid = spawnWorker();
+
+        if (pid < 0) {
+            qDebug() << "BATCH: Could not fork worker -" << strerror(errno);
+            break;
+        }
+        workers.insert(pid);
+    }
+
+    while (!workers.isEmpty()) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        workers.remove(pid);
+
+        bool isCleanExit = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (isCleanExit) {
+            continue;
+        }
+
+        // The dataset the worker was busy with is lost - the rest of the batch goes on
+        qDebug() << "BATCH: Worker" << pid << "terminated abnormally.";
+        for (int i = 0; i < numberOfDatasets; i++) {
+            if (workQueue[i + 1].load() == int(pid)) {
+                workQueue[i + 1].store(datasetFailed);
+            }
+        }
+
+        if (workQueue[0].load() < numberOfDatasets) {
+            pid_t replacementPid = spawnWorker();
+            if (replacementPid > 0) {
+                workers.insert(replacementPid);
+            }
+        }
+    }
+
+    // Report the result for every dataset
+    int numberOfFinishedDatasets = 0;
+    for (int i = 0; i < numberOfDatasets; i++) {
+        int datasetState = workQueue[i + 1].load();
+
+        if (datasetState == datasetFinished) {
+            numberOfFinishedDatasets++;
+            cout << parameters.datasetFilePaths[i].toStdString() << " -> " << outputFilePathPrefixes[i].toStdString() << ".correlations.tsv" << endl;
+        } else if (datasetState == datasetFailed) {
+            cout << parameters.datasetFilePaths[i].toStdString() << " -> FAILED" << endl;
+        } else {
+            cout << parameters.datasetFilePaths[i].toStdString() << " -> NOT PROCESSED" << endl;
+        }
+    }
+    cout << "Annotated " << numberOfFinishedDatasets << " of " << numberOfDatasets << " datasets." << endl;
+
+    munmap(workQueueMapping, workQueueSize);
+    close(segmentDescriptor);
+
+    return numberOfFinishedDatasets == numberOfDatasets ? 0 : 1;
+}
+
+}
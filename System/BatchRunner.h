@@ -0,0 +1,29 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The BatchRunner namespace annotates many datasets with a pool of forked worker processes.
+ *        The reference is parsed once and shared read-only between the workers, a crashing dataset only takes its own worker down.
+ */
+namespace BatchRunner
+{
+    struct BatchParameters
+    {
+        QString referenceFilePath;
+        QStringList datasetFilePaths;
+        QString outputDirectoryPath;
+        int numberOfWorkers;
+        int numberOfTopTypes;
+        double referenceCutoff;
+        double clusterCutoff;
+        // Format of the report images of every dataset - no reports are rendered if empty
+        QString reportFormat;
+    };
+
+    extern int runBatch(BatchParameters parameters);
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,93 @@
+#include "CellAnnotationRunner.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "System/Trace.h"
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+#include "Statistics/CellAnnotator.h"
+#include "Utils/Helper.h"
+#include "Utils/FileOperators/CSVReader.h"
+#include "Utils/FileOperators/CellAnnotationFileOperator.h"
+#include "Utils/FileOperators/Hdf5Reader.h"
+#include "Utils/FileOperators/MtxReader.h"
+
+namespace CellAnnotationRunner {
+
+/**
+ * @brief runCellAnnotation - Builds the profiles of the reference or the marker file and annotates the cells of every matrix one after the other -
+ *        every matrix is scored on all cores. Writes "<matrix name>.cells.bin" per matrix
+ * @param parameters - Reference or marker file, matrix directories or HDF5 files, output directory and the number of profiles kept per cell
+ * @return 0 if every matrix has been annotated, 1 otherwise
+ */
+int runCellAnnotation(CellAnnotationParameters parameters) {
+    if (parameters.matrixPaths.isEmpty() || parameters.referenceFilePath.isEmpty() == parameters.markerFilePath.isEmpty()) {
+        qDebug() << "CELL ANNOTATION: Matrices and either a reference or a marker file are required.";
+        return 1;
+    }
+
+    QDir outputDirectory(parameters.outputDirectoryPath);
+    if (!outputDirectory.mkpath(".")) {
+        qDebug() << "CELL ANNOTATION: Could not create output directory" << parameters.outputDirectoryPath;
+        return 1;
+    }
+
+    // The genes of the profiles become the first rows of the dictionary, the matrices only append the genes the profiles do not know
+    GeneDictionary geneDictionary;
+    CellAnnotator::ReferenceProfiles referenceProfiles = parameters.markerFilePath.isEmpty()
+            ? CellAnnotator::buildTissueProfiles(CSVReader::getTissuesWithGeneExpression(parameters.referenceFilePath, parameters.referenceCutoff), geneDictionary)
+            : CellAnnotator::buildMarkerProfiles(CSVReader::getCellTypesWithMarkers(parameters.markerFilePath), geneDictionary);
+
+    cout << "Scoring against " << referenceProfiles.profileIDs.length() << " profiles over " << referenceProfiles.numberOfGenes << " genes." << endl;
+
+    QSet<QString> usedMatrixNames;
+    bool isEveryMatrixAnnotated = true;
+
+    for (int m = 0; m < parameters.matrixPaths.length(); m++) {
+        TRACE_SCOPE("CellAnnotationRunner::annotateMatrix");
+
+        QString matrixPath = QDir::cleanPath(parameters.matrixPaths[m]);
+        QElapsedTimer matrixTimer;
+        matrixTimer.start();
+
+        SparseMatrix sparseMatrix;
+        bool isRead = matrixPath.endsWith(".h5") ? Hdf5Reader::readFeatureBarcodeMatrix(matrixPath, geneDictionary, sparseMatrix)
+                                                 : MtxReader::readFeatureBarcodeMatrix(matrixPath, geneDictionary, sparseMatrix);
+
+        if (!isRead) {
+            isEveryMatrixAnnotated = false;
+            continue;
+        }
+
+        CellAnnotator::CellAnnotations cellAnnotations = CellAnnotator::annotateCells(sparseMatrix, referenceProfiles, parameters.numberOfTopProfiles);
+
+        // CellRanger names every matrix the same, so duplicate names are made unique by their position
+        QString matrixName = Helper::chopFileName(matrixPath);
+        if (usedMatrixNames.contains(matrixName)) {
+            matrixName.append("_" + QString::number(m));
+        }
+        usedMatrixNames.insert(matrixName);
+
+        QString cellAnnotationFilePath = outputDirectory.filePath(matrixName + ".cells.bin");
+
+        if (!CellAnnotationFileOperator::writeCellAnnotations(cellAnnotationFilePath, cellAnnotations)) {
+            isEveryMatrixAnnotated = false;
+            continue;
+        }
+
+        cout << "Annotated " << sparseMatrix.getNumberOfCells() << " cells in " << matrixTimer.elapsed() / 1000.0 << " s: " << cellAnnotationFilePath.toStdString() << endl;
+    }
+
+    return isEveryMatrixAnnotated ? 0 : 1;
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef CELLANNOTATIONRUNNER_H
+#define CELLANNOTATIONRUNNER_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The CellAnnotationRunner namespace annotates every single cell of feature-barcode matrices with the best profiles of a reference or marker file.
+ *        The profiles are built once, every matrix is read and scored on all cores and written as cell annotation file to the output directory
+ */
+namespace CellAnnotationRunner
+{
+    struct CellAnnotationParameters
+    {
+        QString referenceFilePath;
+        QString markerFilePath;
+        QStringList matrixPaths;
+        QString outputDirectoryPath;
+        double referenceCutoff;
+        int numberOfTopProfiles;
+    };
+
+    extern int runCellAnnotation(CellAnnotationParameters parameters);
+};
+
+#endif // CELLANNOTATIONRUNNER_H
@@ -9,6 +9,21 @@ struct ConfigFile
     QString cellMarkersFilePath;
     QString clusterExpressionFilePath;
 
+    // Memory budget for datasets in megabytes - 0 means half of the physical memory
+    qint64 memoryBudgetMegabytes = 0;
+    // Whether datasets are moved to disk as soon as their tab has been rendered
+    bool isSpillRenderedDatasets = false;
+
+    // Thread pool sizes - 0 means sized from the available cores
+    int parsingThreadCount = 0;
+    int correlationThreadCount = 0;
+    // Cores the thread pools may use in taskset list notation (e.g. "0-7,16") - empty means all cores the process may run on
+    QString cpuSet;
+    // Whether every pool thread is pinned to a single core
+    bool isPinThreads = false;
+    // Whether the hardware counters of the cpu are read around every stage (Linux only)
+    bool isPerfCounters = false;
+
     ConfigFile();
     ConfigFile(/*QString projectFilePath,*/ QString cellMarkersFilePath, QString clusterExpressionFilePath);
 };
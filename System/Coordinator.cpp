@@ -6,21 +6,45 @@
 #include <QtConcurrent/QtConcurrent>
 #include <QFuture>
 #include <QDebug>
+#include <QFileInfo>
+#include <QBitArray>
 
 #include <iostream>
 using std::cout;
 using std::endl;
 
 #include "System/InformationCenter.h"
+#include "System/MemoryBudget.h"
+#include "System/RunSummary.h"
+#include "System/ThreadPools.h"
 #include "Utils/FileOperators/CSVReader.h"
-#include "Statistics/Expressioncomparator.h"
+#include "Utils/FileOperators/SpillFileOperator.h"
+#include "Utils/FileOperators/ProjectFileOperator.h"
+#include "Statistics/MaskedCorrelator.h"
+#include "Statistics/PseudoBulkAggregator.h"
+#include "System/StageScope.h"
+
+namespace {
+
+// Files are parsed with every positive value - cutoffs are applied as masks on the expression matrices later on
+const double fullValuesCutoff = 0;
+
+}
 
 /**
  * @brief Coordinator::Coordinator
  */
 Coordinator::Coordinator(InformationCenter informationCenter)
-    : informationCenter {informationCenter}
-{}
+    : informationCenter {informationCenter},
+      memoryBudgetBytes {MemoryBudget::getBudgetBytes(informationCenter.configFile)},
+      reservedBytes {0},
+      retainedBytes {0},
+      isCutoffChangePending {false},
+      pendingDatasetCutoff {0},
+      pendingCellMarkersCutoff {0}
+{
+    QObject::connect(&this->cutoffUpdateWatcher, &QFutureWatcherBase::finished, this, &Coordinator::applyCutoffUpdate);
+}
 
 
 template<typename F>
@@ -32,8 +56,11 @@ template<typename F>
  */
 void Coordinator::parseFiles(const QStringList filePaths, const F & parsingFunction, const double cutoff) {
     for (QString filePath: filePaths) {
-        // Parse the file with given cutoff in a new thread with given function
-        QFuture<QVector<FeatureCollection>> futureParsedFile = QtConcurrent::run(parsingFunction, filePath, cutoff);
+        // Parse the file with given cutoff in a new thread of the parsing pool with given function
+        typename std::decay<F>::type function = parsingFunction;
+        QFuture<QVector<FeatureCollection>> futureParsedFile = ThreadPools::run(ThreadPools::ParsingPool, [function, filePath, cutoff]() {
+            return function(filePath, cutoff);
+        });
 
         // And let the multi-thread-watcher watch over the new process
         parsingThreadsWatcher.addFuture(futureParsedFile);
@@ -45,6 +72,8 @@ void Coordinator::parseFiles(const QStringList filePaths, const F & parsingFunct
  * @brief Coordinator::gatherInformationAfterParsingFinished - Gathers the parsed information from the opened threads and reports it to the information center
  */
 void Coordinator::saveInformationAfterParsingFinished() {
+    STAGE_SCOPE("Coordinator::saveInformationAfterParsingFinished");
+
     qDebug() << "Finished parsing.";
 
     // The first thread has been reserved for the marker file -> Report the result to the information center
@@ -59,43 +88,219 @@ void Coordinator::saveInformationAfterParsingFinished() {
         this->informationCenter.completeSetOfGeneIDs.append(feature.ID);
     }
 
+    // The datasets add their own genes to the dictionary while they are processed
+    this->geneDictionary.reset(new GeneDictionary(this->informationCenter.completeSetOfGeneIDs));
+
     // Removing of the marker-FeatureCollection leaves only the "real" FeatureCollections parsed from the files
     this->informationCenter.cellMarkersForTypes.removeFirst();
 
-    // Gather the results from the other finished threads,
-    for (int i = 1; i < this->parsingThreadsWatcher.futures().length(); i++) {
+    // The types are correlated like for reopened projects - see loadMissingCellMarkers
+    this->informationCenter.cellMarkersMatrix = ExpressionMatrix(this->informationCenter.cellMarkersForTypes, *this->geneDictionary);
+
+    // The datasets are parsed together with their correlation - see processDatasets
+}
+
+
+/**
+ * @brief Coordinator::processDatasets - Parses and correlates every dataset in a separate thread while keeping the datasets in memory within the memory budget.
+ *        A dataset is only started once its estimated size fits into the budget, finished datasets are spilled to disk to make room for the next ones.
+ *        The datasets are appended behind the datasets of the project, whose results are left untouched.
+ *        Every dataset is parsed with its full values and correlated at the cutoffs of the project.
+ * @param datasetFilePaths - List of file paths corresponding to the dataset files
+ */
+void Coordinator::processDatasets(const QStringList datasetFilePaths) {
+    STAGE_SCOPE("Coordinator::processDatasets");
+
+    int firstDatasetIndex = this->informationCenter.correlatedDatasets.length(),
+        numberOfDatasets = firstDatasetIndex + datasetFilePaths.length();
+
+    // Results are stored at the position of their dataset, no matter in which order they finish
+    this->informationCenter.xClusterCollections.resize(numberOfDatasets);
+    this->informationCenter.correlatedDatasets.resize(numberOfDatasets);
+    this->informationCenter.spilledDatasetFilePaths.resize(numberOfDatasets);
+    this->informationCenter.expressionMatrices.resize(numberOfDatasets);
+    this->estimatedDatasetBytes.resize(numberOfDatasets);
+
+    ExpressionMatrix cellMarkersMatrix = this->informationCenter.cellMarkersMatrix;
+    QSharedPointer<GeneDictionary> geneDictionary = this->geneDictionary;
+    double datasetCutoff = this->informationCenter.datasetCutoff,
+           cellMarkersCutoff = this->informationCenter.cellMarkersCutoff;
+
+    for (int i = firstDatasetIndex; i < numberOfDatasets; i++) {
+        QString datasetFilePath = datasetFilePaths[i - firstDatasetIndex];
+
+        this->estimatedDatasetBytes[i] = MemoryBudget::estimateDatasetBytes(datasetFilePath);
+
+        // Backpressure - the dataset is only started once it fits into the budget
+        this->freeMemoryBudget(this->estimatedDatasetBytes[i]);
+        this->reservedBytes += this->estimatedDatasetBytes[i];
+
+        // Parse the dataset on the parsing pool, which passes the clusters on to the correlation pool right away.
+        // This way I/O bound parsing and CPU bound correlation never wait for each other's threads
+        QFuture<ParsedDataset> futureParsedDataset = ThreadPools::run(ThreadPools::ParsingPool, [datasetFilePath, datasetCutoff, cellMarkersCutoff, cellMarkersMatrix, geneDictionary]() {
+            STAGE_SCOPE("Coordinator::parseDataset");
 
-        // and report it the the information center
-        this->informationCenter.xClusterCollections.append(this->parsingThreadsWatcher.futures()[i].result());
+            // Per cell datasets are given by their clusters.csv and aggregated into clusters first
+            QVector<FeatureCollection> clusters = PseudoBulkAggregator::isClusterAssignmentFile(datasetFilePath)
+                                                  ? PseudoBulkAggregator::getClusterFeatureExpressions(datasetFilePath, fullValuesCutoff)
+                                                  : CSVReader::getClusterFeatureExpressions(datasetFilePath, fullValuesCutoff);
+
+            QFuture<AnalyzedDataset> futureAnalyzedDataset = ThreadPools::run(ThreadPools::CorrelationPool, [clusters, datasetCutoff, cellMarkersCutoff, cellMarkersMatrix, geneDictionary]() {
+                STAGE_SCOPE("Coordinator::correlateDataset");
+
+                ExpressionMatrix expressionMatrix(clusters, *geneDictionary);
+                QVector<double> correlationMatrix = MaskedCorrelator::calculateCorrelationMatrix(expressionMatrix, datasetCutoff, cellMarkersMatrix, cellMarkersCutoff);
+                PerfCounters::addProcessedGenes(expressionMatrix.getNumberOfGenes());
+
+                return qMakePair(expressionMatrix, MaskedCorrelator::toSortedCorrelations(correlationMatrix, cellMarkersMatrix.getClusterIDs()));
+            });
+
+            return qMakePair(clusters, futureAnalyzedDataset);
+        });
+
+        this->datasetsInFlight.append({ i, futureParsedDataset });
+    }
+
+    // Gather the datasets that are still in flight
+    while (!this->datasetsInFlight.isEmpty()) {
+        this->saveOldestDatasetInFlight();
+        this->freeMemoryBudget(0);
+    }
+
+    // Genes are only appended, so the dictionary still fits the matrices of earlier datasets
+    this->informationCenter.completeSetOfGeneIDs = this->geneDictionary->getGeneIDs();
+}
+
+
+/**
+ * @brief Coordinator::freeMemoryBudget - Makes room for the given number of bytes by spilling finished datasets and - if none are left in memory - waiting for datasets in flight.
+ *        A single dataset that exceeds the budget on its own is let through once everything else has been freed.
+ * @param requiredBytes - Number of bytes that should fit into the budget afterwards
+ */
+void Coordinator::freeMemoryBudget(const qint64 requiredBytes) {
+    while (this->reservedBytes + this->retainedBytes + requiredBytes > this->memoryBudgetBytes) {
+        if (!this->retainedDatasetIndices.isEmpty()) {
+            this->spillDataset(this->retainedDatasetIndices.first());
+        } else if (!this->datasetsInFlight.isEmpty()) {
+            this->saveOldestDatasetInFlight();
+        } else {
+            break;
+        }
     }
 }
 
 
 /**
- * @brief Coordinator::correlateDatasets - Correlates the given datasets with the given set of cell markers in separate threads and hands them over to the thread watcher
- * @param xClusterDatasets - List of cluster datasets that are to be correlated
- * @param cellMarkersForTypes - Cell type cell markers that are used to correlate against
+ * @brief Coordinator::saveOldestDatasetInFlight - Waits for the oldest dataset in flight and reports its clusters and correlations to the information center
+ */
+void Coordinator::saveOldestDatasetInFlight() {
+    STAGE_SCOPE("Coordinator::saveOldestDatasetInFlight");
+
+    DatasetInFlight datasetInFlight = this->datasetsInFlight.takeFirst();
+    ParsedDataset parsedDataset = datasetInFlight.futureParsedDataset.result();
+    int datasetIndex = datasetInFlight.datasetIndex;
+
+    AnalyzedDataset analyzedDataset = parsedDataset.second.result();
+
+    this->informationCenter.xClusterCollections[datasetIndex] = std::move(parsedDataset.first);
+    this->informationCenter.expressionMatrices[datasetIndex] = std::move(analyzedDataset.first);
+    this->informationCenter.correlatedDatasets[datasetIndex] = std::move(analyzedDataset.second);
+
+    // The dataset is not in flight anymore, but still occupies memory
+    this->reservedBytes -= this->estimatedDatasetBytes[datasetIndex];
+    this->retainedBytes += this->estimatedDatasetBytes[datasetIndex];
+    this->retainedDatasetIndices.append(datasetIndex);
+}
+
+
+/**
+ * @brief Coordinator::spillDataset - Moves the clusters of a finished dataset to a spill file. The correlations are small and stay in memory.
+ *        The GUI keeps the published snapshot, so it is replaced by a snapshot without the clusters - otherwise the memory would not be freed
+ * @param datasetIndex - Index of the dataset that should be spilled
  */
-void Coordinator::correlateDatasets(const QVector<QVector<FeatureCollection>> xClusterDatasets, const QVector<FeatureCollection> cellMarkersForTypes) {
-    for (QVector<FeatureCollection> xClusterDataset : xClusterDatasets) {
-        // Correlate the single dataset with the given set of cell type markers
-        QFuture<QVector<QVector<QPair<QString, double>>>> futureCorrelations = QtConcurrent::run(ExpressionComparator::findClusterTissueCorrelations, xClusterDataset, cellMarkersForTypes);
+void Coordinator::spillDataset(const int datasetIndex) {
+    STAGE_SCOPE("Coordinator::spillDataset");
+
+    // Only finished datasets that are still in memory can be spilled
+    if (!this->retainedDatasetIndices.removeOne(datasetIndex)) {
+        return;
+    }
+
+    QString spillFilePath = this->spillDirectory.filePath(QString("dataset_%1.spill").arg(datasetIndex));
+    bool isSpilled = this->spillDirectory.isValid()
+            && SpillFileOperator::writeClusterCollections(spillFilePath, this->informationCenter.xClusterCollections[datasetIndex]);
 
-        // And let the corresponding multi-thread-watcher watch over the new process
-        this->correlatorThreadsWatcher.addFuture(futureCorrelations);
+    // If spilling fails the dataset simply stays in memory
+    if (!isSpilled) {
+        qDebug() << "Could not spill dataset" << datasetIndex << "- keeping it in memory.";
+        return;
     }
+
+    this->informationCenter.spilledDatasetFilePaths[datasetIndex] = spillFilePath;
+    this->informationCenter.xClusterCollections[datasetIndex] = QVector<FeatureCollection>();
+    this->retainedBytes -= this->estimatedDatasetBytes[datasetIndex];
+
+    // The clusters are read back from the spill file on demand - see InformationCenter::getClusterCollections
+    emit datasetSpilled(this->createInformationCenterSnapshot());
 }
 
 
 /**
- * @brief Coordinator::saveInformationAfterCorrelatingFinished - Gathers the information from the finished correlation from the opened threads and reports it to the information center
+ * @brief Coordinator::loadMissingCellMarkers - Projects loaded from a project file only contain the results. Their cell markers are parsed
+ *        the first time they are needed again, e.g. to add datasets or to apply new cutoffs
+ * @return True if the cell markers of the project are available
  */
-void Coordinator::saveInformationAfterCorrelatingFinished() {
-    // Gather the results from every finished thread
-    for (int i = 0; i < correlatorThreadsWatcher.futures().length(); i++) {
-        // and report it to the information center
-        this->informationCenter.correlatedDatasets.append(correlatorThreadsWatcher.futures()[i].result());
+bool Coordinator::loadMissingCellMarkers() {
+    STAGE_SCOPE("Coordinator::loadMissingCellMarkers");
+
+    if (!this->informationCenter.cellMarkersForTypes.isEmpty()) {
+        return true;
     }
+
+    if (!QFileInfo(this->informationCenter.cellMarkersFilePath).isReadable()) {
+        qDebug() << "COORDINATOR: Cell marker file of the project is not readable -" << this->informationCenter.cellMarkersFilePath;
+        return false;
+    }
+
+    cout << "Parsing cell marker file." << endl;
+    this->informationCenter.cellMarkersForTypes = CSVReader::getTissuesWithGeneExpression(this->informationCenter.cellMarkersFilePath, fullValuesCutoff);
+
+    // A marker file without types yields no marker-FeatureCollection either
+    if (this->informationCenter.cellMarkersForTypes.isEmpty()) {
+        qDebug() << "COORDINATOR: Cell marker file of the project contains no cell types -" << this->informationCenter.cellMarkersFilePath;
+        return false;
+    }
+
+    // Same as for a new project - see saveInformationAfterParsingFinished
+    this->informationCenter.cellMarkersForTypes.removeFirst();
+
+    this->informationCenter.cellMarkersMatrix = ExpressionMatrix(this->informationCenter.cellMarkersForTypes, *this->geneDictionary);
+    this->informationCenter.completeSetOfGeneIDs = this->geneDictionary->getGeneIDs();
+
+    return true;
+}
+
+
+/**
+ * @brief Coordinator::createInformationCenterSnapshot - Turns the current information center into an immutable snapshot.
+ *        The working state is moved into the snapshot and only keeps implicitly shared references to it for the next reanalysis, so no data is copied.
+ * @return Snapshot of the current information center
+ */
+InformationCenterSnapshot Coordinator::createInformationCenterSnapshot() {
+    InformationCenterSnapshot informationCenterSnapshot(new InformationCenter(std::move(this->informationCenter)));
+    this->informationCenter = *informationCenterSnapshot;
+
+    return informationCenterSnapshot;
+}
+
+
+/**
+ * @brief Coordinator::publishInformationCenter - Hands the finished information center over to the GUI as an immutable snapshot
+ */
+void Coordinator::publishInformationCenter() {
+    STAGE_SCOPE("Coordinator::publishInformationCenter");
+
+    emit finishedCorrelating(this->createInformationCenterSnapshot());
 }
 
 
@@ -122,6 +327,8 @@ void Coordinator::printResults() {
  * @param cellMarkerFilePath - One of: File path to cell marker file OR "nAn" if none was given
  */
 void Coordinator::on_newProjectStarted(const QString cellMarkerFilePath, const QStringList datasetFilePaths) {
+    STAGE_SCOPE("Coordinator::on_newProjectStarted");
+
     // Add file-paths of newly uploaded datasets to file-path list
     this->informationCenter.datasetFilePaths = datasetFilePaths;
 
@@ -135,15 +342,12 @@ void Coordinator::on_newProjectStarted(const QString cellMarkerFilePath, const Q
     } else {
         cellMarkerFilePaths.append(cellMarkerFilePath);
     }
+    this->informationCenter.cellMarkersFilePath = cellMarkerFilePaths.first();
 
     qDebug() << "Parsing:" << cellMarkerFilePaths.first();
     // Parse the cell marker file in separate thread
     cout << "Parsing cell marker file." << endl;
-    this->parseFiles(cellMarkerFilePaths, CSVReader::getTissuesWithGeneExpression, 100);
-
-    // Parse the dataset files in separate threads
-    cout << "Parsing datasets." << endl;
-    this->parseFiles(datasetFilePaths, CSVReader::getClusterFeatureExpressions, 15);
+    this->parseFiles(cellMarkerFilePaths, CSVReader::getTissuesWithGeneExpression, fullValuesCutoff);
 
     // Wait for finished to avoid loosing scope before parsing has finished
     this->parsingThreadsWatcher.waitForFinished();
@@ -153,45 +357,238 @@ void Coordinator::on_newProjectStarted(const QString cellMarkerFilePath, const Q
     this->saveInformationAfterParsingFinished();
     cout << "Saving information successfull." << endl;
 
+    // Parse and correlate the datasets with the given cell type markers in separate threads - throttled by the memory budget
+    cout << "Parsing and correlating datasets." << endl;
+    this->processDatasets(datasetFilePaths);
+    cout << "Saving correlation data successfull." << endl;
+
     // Report that the last parsing thread has finished to the main window
     emit finishedFileParsing();
 
-    cout << "Correlating datasets" << endl;
-    // Correlate the datasets with the given cell type markers in separate threads
-    this->correlateDatasets(informationCenter.xClusterCollections, informationCenter.cellMarkersForTypes);
-    cout << "Finished correlating. Gathering information" << endl;
-
-    // Gather and save the information from the correlation from the different threads
-    this->saveInformationAfterCorrelatingFinished();
-    cout << "Saving correlation data successfull." << endl;
-
     // Report that the last correlation thread has finished to the main window
 //    emit finishedCorrelating(informationCenter.correlatedDatasets);
-    emit finishedCorrelating(this->informationCenter);
+    this->publishInformationCenter();
 
     qDebug() << "Finished workflow. YEAY." << endl;
+    RunSummary::printRunSummary();
 }
 
 
 // ###################################### INTERACTION WITH MAIN WINDOW ###########################################
 /**
- * @brief Coordinator::on_filesUploaded
- * @param filePaths
+ * @brief Coordinator::on_filesUploaded - Adds datasets to the open project. They are parsed with the cutoff of the project and correlated against
+ *        its cell markers, the results of the datasets that are already part of the project are not touched
+ * @param filePaths - File paths of the datasets that should be added
  */
 void Coordinator::on_filesUploaded(const QStringList filePaths) {
+    STAGE_SCOPE("Coordinator::on_filesUploaded");
+
     qDebug() << "on_filesUploaded: received" << filePaths;
-    //REMEMBER: How to handle the cutoff here -> Should the user be able to change the value beforehand?
-    // Parse the cluster file with default cutoff
 
-    // and report back to the main window when parsing has finished
-//    emit finishedClusterFileParsing();
+    if (this->geneDictionary.isNull()) {
+        qDebug() << "COORDINATOR: No open project to add datasets to.";
+        return;
+    }
+
+    // Datasets that are already part of the project are not added twice
+    QStringList newDatasetFilePaths;
+    for (const QString & filePath : filePaths) {
+        if (!this->informationCenter.datasetFilePaths.contains(filePath) && !newDatasetFilePaths.contains(filePath)) {
+            newDatasetFilePaths.append(filePath);
+        }
+    }
+
+    if (newDatasetFilePaths.isEmpty()) {
+        return;
+    }
+
+    if (!this->loadMissingCellMarkers()) {
+        return;
+    }
+
+    this->informationCenter.datasetFilePaths.append(newDatasetFilePaths);
+
+    cout << "Parsing and correlating datasets." << endl;
+    this->processDatasets(newDatasetFilePaths);
+
+    emit finishedFileParsing();
+    this->publishInformationCenter();
+
+    RunSummary::printRunSummary();
+}
+
+
+/**
+ * @brief Coordinator::on_datasetRendered - Spills the dataset once its tab has been rendered if this is enabled in the config file
+ * @param datasetIndex - Index of the rendered dataset
+ */
+void Coordinator::on_datasetRendered(const int datasetIndex) {
+    if (this->informationCenter.configFile.isSpillRenderedDatasets) {
+        this->spillDataset(datasetIndex);
+    }
+}
+
+
+/**
+ * @brief Coordinator::on_cutoffsChanged - Applies new cutoffs to the open project. Nothing is parsed again: the cutoffs only change the masks
+ *        over the full expression matrices and only the cluster-type pairs whose shared genes changed are correlated again.
+ *        The update runs on the correlation pool, the project is published once it finished - and right away if there is nothing to update
+ * @param datasetCutoff - New cutoff for the dataset values
+ * @param cellMarkersCutoff - New cutoff for the cell marker values
+ */
+void Coordinator::on_cutoffsChanged(const double datasetCutoff, const double cellMarkersCutoff) {
+    STAGE_SCOPE("Coordinator::on_cutoffsChanged");
+
+    // Only the newest cutoffs requested during an update are applied after it
+    if (this->cutoffUpdateWatcher.isRunning()) {
+        this->isCutoffChangePending = true;
+        this->pendingDatasetCutoff = datasetCutoff;
+        this->pendingCellMarkersCutoff = cellMarkersCutoff;
+        return;
+    }
+
+    this->startCutoffUpdate(datasetCutoff, cellMarkersCutoff);
 }
 
 
 /**
- * @brief Coordinator::on_projectFileUploaded
- * @param filePath
+ * @brief Coordinator::startCutoffUpdate - Starts the update of all correlations to the given cutoffs on the correlation pool.
+ *        Without anything to update the unchanged project is published, so the GUI never waits for a result that does not come
+ * @param datasetCutoff - New cutoff for the dataset values
+ * @param cellMarkersCutoff - New cutoff for the cell marker values
  */
-void Coordinator::on_projectFileUploaded(const QStringList filePath) {
-    qDebug() << "on_projectFileUploaded: received" << filePath;
+void Coordinator::startCutoffUpdate(const double datasetCutoff, const double cellMarkersCutoff) {
+    bool isUnchanged = datasetCutoff == this->informationCenter.datasetCutoff && cellMarkersCutoff == this->informationCenter.cellMarkersCutoff;
+
+    if (this->geneDictionary.isNull() || isUnchanged || !this->loadMissingCellMarkers()) {
+        this->publishInformationCenter();
+        return;
+    }
+
+    // The task works on implicitly shared copies, the information center is only changed once the update finished
+    ExpressionMatrix cellMarkersMatrix = this->informationCenter.cellMarkersMatrix;
+    QVector<ExpressionMatrix> expressionMatrices = this->informationCenter.expressionMatrices;
+    QVector<QVector<QVector<QPair<QString, double>>>> correlatedDatasets = this->informationCenter.correlatedDatasets;
+    double oldDatasetCutoff = this->informationCenter.datasetCutoff,
+           oldCellMarkersCutoff = this->informationCenter.cellMarkersCutoff;
+
+    this->cutoffUpdateWatcher.setFuture(ThreadPools::run(ThreadPools::CorrelationPool, [=]() {
+        STAGE_SCOPE("Coordinator::updateCorrelations");
+
+        QVector<QBitArray> oldTypeMasks = MaskedCorrelator::calculateExpressionMasks(cellMarkersMatrix, oldCellMarkersCutoff),
+                           newTypeMasks = MaskedCorrelator::calculateExpressionMasks(cellMarkersMatrix, cellMarkersCutoff);
+
+        // Every dataset is updated in its own task on the correlation pool - waiting for a task that has not started yet runs it on this thread
+        QVector<QFuture<QPair<QVector<QVector<QPair<QString, double>>>, int>>> futureCorrelations;
+
+        for (int i = 0; i < expressionMatrices.length(); i++) {
+            ExpressionMatrix expressionMatrix = expressionMatrices.at(i);
+            QVector<QVector<QPair<QString, double>>> sortedCorrelations = correlatedDatasets.at(i);
+
+            futureCorrelations.append(ThreadPools::run(ThreadPools::CorrelationPool, [=]() {
+                STAGE_SCOPE("Coordinator::updateDatasetCorrelations");
+
+                QStringList typeIDs = cellMarkersMatrix.getClusterIDs();
+                QVector<double> correlationMatrix = MaskedCorrelator::fromSortedCorrelations(sortedCorrelations, typeIDs);
+
+                int numberOfRecalculatedPairs = MaskedCorrelator::updateCorrelationMatrix(correlationMatrix,
+                        expressionMatrix, MaskedCorrelator::calculateExpressionMasks(expressionMatrix, oldDatasetCutoff), MaskedCorrelator::calculateExpressionMasks(expressionMatrix, datasetCutoff),
+                        cellMarkersMatrix, oldTypeMasks, newTypeMasks);
+                PerfCounters::addProcessedGenes(expressionMatrix.getNumberOfGenes());
+
+                return qMakePair(MaskedCorrelator::toSortedCorrelations(correlationMatrix, typeIDs), numberOfRecalculatedPairs);
+            }));
+        }
+
+        CutoffUpdate cutoffUpdate;
+        cutoffUpdate.datasetCutoff = datasetCutoff;
+        cutoffUpdate.cellMarkersCutoff = cellMarkersCutoff;
+        cutoffUpdate.numberOfRecalculatedPairs = 0;
+        cutoffUpdate.numberOfPairs = 0;
+
+        for (int i = 0; i < futureCorrelations.length(); i++) {
+            QPair<QVector<QVector<QPair<QString, double>>>, int> updatedCorrelations = futureCorrelations[i].result();
+
+            cutoffUpdate.correlatedDatasets.append(updatedCorrelations.first);
+            cutoffUpdate.numberOfRecalculatedPairs += updatedCorrelations.second;
+            cutoffUpdate.numberOfPairs += expressionMatrices.at(i).getNumberOfClusters() * cellMarkersMatrix.getNumberOfClusters();
+        }
+
+        return cutoffUpdate;
+    }));
+}
+
+
+/**
+ * @brief Coordinator::applyCutoffUpdate - Takes over the correlations of a finished cutoff update and publishes them.
+ *        If datasets were added during the update, it is started again for all of them. Cutoffs requested meanwhile are applied next
+ */
+void Coordinator::applyCutoffUpdate() {
+    STAGE_SCOPE("Coordinator::applyCutoffUpdate");
+
+    CutoffUpdate cutoffUpdate = this->cutoffUpdateWatcher.result();
+
+    if (cutoffUpdate.correlatedDatasets.length() != this->informationCenter.correlatedDatasets.length()) {
+        if (!this->isCutoffChangePending) {
+            this->isCutoffChangePending = true;
+            this->pendingDatasetCutoff = cutoffUpdate.datasetCutoff;
+            this->pendingCellMarkersCutoff = cutoffUpdate.cellMarkersCutoff;
+        }
+    } else {
+        this->informationCenter.correlatedDatasets = cutoffUpdate.correlatedDatasets;
+        this->informationCenter.datasetCutoff = cutoffUpdate.datasetCutoff;
+        this->informationCenter.cellMarkersCutoff = cutoffUpdate.cellMarkersCutoff;
+
+        cout << "Correlated " << cutoffUpdate.numberOfRecalculatedPairs << " of " << cutoffUpdate.numberOfPairs << " cluster-type pairs again." << endl;
+    }
+
+    if (this->isCutoffChangePending) {
+        this->isCutoffChangePending = false;
+        this->startCutoffUpdate(this->pendingDatasetCutoff, this->pendingCellMarkersCutoff);
+        return;
+    }
+
+    this->publishInformationCenter();
+}
+
+
+/**
+ * @brief Coordinator::on_projectSaveRequested - Saves the current project. Only the results are stored, the files are not parsed again on loading
+ * @param projectFilePath - Path of the project file - an existing file is replaced
+ */
+void Coordinator::on_projectSaveRequested(const QString projectFilePath) {
+    STAGE_SCOPE("Coordinator::on_projectSaveRequested");
+
+    if (ProjectFileOperator::writeProjectFile(projectFilePath, this->informationCenter)) {
+        qDebug() << "Saved project to" << projectFilePath;
+    }
+}
+
+
+/**
+ * @brief Coordinator::on_projectFileUploaded - Opens a saved project. The file is mapped and used in place, nothing is parsed or correlated
+ * @param filePaths - List containing the path of the project file
+ */
+void Coordinator::on_projectFileUploaded(const QStringList filePaths) {
+    STAGE_SCOPE("Coordinator::on_projectFileUploaded");
+
+    qDebug() << "on_projectFileUploaded: received" << filePaths;
+
+    if (filePaths.isEmpty()) {
+        return;
+    }
+
+    InformationCenter loadedInformationCenter(this->informationCenter.configFile);
+
+    if (!ProjectFileOperator::readProjectFile(filePaths.first(), loadedInformationCenter)) {
+        return;
+    }
+
+    this->informationCenter = loadedInformationCenter;
+    this->geneDictionary.reset(new GeneDictionary(this->informationCenter.completeSetOfGeneIDs));
+
+    emit finishedFileParsing();
+    this->publishInformationCenter();
+
+    RunSummary::printRunSummary();
 }
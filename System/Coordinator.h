@@ -3,11 +3,16 @@
 
 #include <QFutureSynchronizer>
 #include <QFutureWatcher>
+#include <QFuture>
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QList>
+#include <QTemporaryDir>
+#include <QSharedPointer>
 
 #include "System/InformationCenter.h"
+#include "BioModels/GeneDictionary.h"
 
 /**
  * @brief The Coordinator class - This class is used to model the basic workflow and to concentrate the program logic in one place
@@ -17,10 +22,49 @@ class Coordinator : public QObject
     Q_OBJECT
 
 private:
+    // The correlation task returns the expression matrix of the dataset together with its correlations
+    typedef QPair<ExpressionMatrix, QVector<QVector<QPair<QString, double>>>> AnalyzedDataset;
+
+    // The parsing task hands its clusters over to the correlation pool and returns them together with the future of their analysis
+    typedef QPair<QVector<FeatureCollection>, QFuture<AnalyzedDataset>> ParsedDataset;
+
+    struct DatasetInFlight
+    {
+        int datasetIndex;
+        QFuture<ParsedDataset> futureParsedDataset;
+    };
+
+    // The cutoff task returns the correlations of every dataset at the new cutoffs
+    struct CutoffUpdate
+    {
+        double datasetCutoff;
+        double cellMarkersCutoff;
+        QVector<QVector<QVector<QPair<QString, double>>>> correlatedDatasets;
+        int numberOfRecalculatedPairs;
+        int numberOfPairs;
+    };
+
     InformationCenter informationCenter;
 
+    // Shared with the tasks of the datasets in flight, which add the genes of their datasets
+    QSharedPointer<GeneDictionary> geneDictionary;
+
     QFutureSynchronizer<QVector<FeatureCollection>> parsingThreadsWatcher;
-    QFutureSynchronizer<QVector<QVector<QPair<QString, double>>>> correlatorThreadsWatcher;
+
+    // Memory accounting for the datasets - reserved bytes belong to datasets in flight, retained bytes to finished datasets in memory
+    qint64 memoryBudgetBytes;
+    qint64 reservedBytes;
+    qint64 retainedBytes;
+    QVector<qint64> estimatedDatasetBytes;
+    QList<DatasetInFlight> datasetsInFlight;
+    QList<int> retainedDatasetIndices;
+    QTemporaryDir spillDirectory;
+
+    // Cutoffs are applied in the background - cutoffs requested meanwhile are applied once the running update finished
+    QFutureWatcher<CutoffUpdate> cutoffUpdateWatcher;
+    bool isCutoffChangePending;
+    double pendingDatasetCutoff;
+    double pendingCellMarkersCutoff;
 
     void parseDatasetFiles(const QStringList datasetFilePaths);
 
@@ -29,8 +73,14 @@ private:
     template<typename F>
     void parseFiles(const QStringList filePaths, const F & parsingFunction, const double cutoff);
     void saveInformationAfterParsingFinished();
-    void correlateDatasets(const QVector<QVector<FeatureCollection>> xClusterDatasets, const QVector<FeatureCollection> cellMarkersForTypes);
-    void saveInformationAfterCorrelatingFinished();
+    void processDatasets(const QStringList datasetFilePaths);
+    void freeMemoryBudget(const qint64 requiredBytes);
+    void saveOldestDatasetInFlight();
+    void spillDataset(const int datasetIndex);
+    bool loadMissingCellMarkers();
+    InformationCenterSnapshot createInformationCenterSnapshot();
+    void publishInformationCenter();
+    void startCutoffUpdate(const double datasetCutoff, const double cellMarkersCutoff);
 
 public:
     Coordinator(InformationCenter informationCenter);
@@ -39,7 +89,8 @@ signals:
     void finishedFileParsing();
     void finishedCellMarkerFileParsing();
     void finishedClusterFilesParsing();
-    void finishedCorrelating(const InformationCenter informationCenter);
+    void finishedCorrelating(const InformationCenterSnapshot informationCenterSnapshot);
+    void datasetSpilled(const InformationCenterSnapshot informationCenterSnapshot);
 
 public slots:
     // ################### INTERACTION WITH START DIALOG ########################
@@ -48,8 +99,17 @@ public slots:
     void on_projectFileUploaded(const QStringList filePaths);
     // ################### INTERACTION WITH START DIALOG ########################
 
+    // ################### INTERACTION WITH MAIN WINDOW #########################
+    void on_datasetRendered(const int datasetIndex);
+    void on_projectSaveRequested(const QString projectFilePath);
+    void on_cutoffsChanged(const double datasetCutoff, const double cellMarkersCutoff);
+    // ################### INTERACTION WITH MAIN WINDOW #########################
+
     // ######################### FILE PROCESSING ################################
     // ######################### FILE PROCESSING ################################
+
+private slots:
+    void applyCutoffUpdate();
 };
 
 #endif // COORDINATOR_H
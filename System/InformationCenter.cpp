@@ -1,7 +1,32 @@
 #include "InformationCenter.h"
 
 #include "System/ConfigFile.h"
+#include "Utils/FileOperators/SpillFileOperator.h"
 
 InformationCenter::InformationCenter(ConfigFile configFile)
-    : configFile (configFile)
+    : configFile (configFile),
+      cellMarkersCutoff (100),
+      datasetCutoff (15)
 {}
+
+/**
+ * @brief InformationCenter::getClusterCollections - Returns the clusters of the given dataset - spilled datasets are read back from disk,
+ *        datasets loaded from a project file are rebuilt from their expression matrix
+ * @param datasetIndex - Index of the dataset
+ * @return Clusters of the dataset
+ */
+QVector<FeatureCollection> InformationCenter::getClusterCollections(const int datasetIndex) const {
+    bool isSpilled = datasetIndex < this->spilledDatasetFilePaths.length() && !this->spilledDatasetFilePaths.at(datasetIndex).isEmpty();
+
+    if (isSpilled) {
+        return SpillFileOperator::readClusterCollections(this->spilledDatasetFilePaths.at(datasetIndex));
+    }
+
+    bool isLoadedFromProjectFile = this->xClusterCollections.at(datasetIndex).isEmpty() && datasetIndex < this->expressionMatrices.length();
+
+    if (isLoadedFromProjectFile) {
+        return this->expressionMatrices.at(datasetIndex).toClusterCollections();
+    }
+
+    return this->xClusterCollections.at(datasetIndex);
+}
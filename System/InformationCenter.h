@@ -5,9 +5,12 @@
 #include <QPair>
 #include <QString>
 #include <QStringList>
+#include <QSharedPointer>
+#include <QMetaType>
 
 #include "System/ConfigFile.h"
 #include "BioModels/FeatureCollection.h"
+#include "BioModels/ExpressionMatrix.h"
 
 struct InformationCenter
 {
@@ -16,14 +19,34 @@ struct InformationCenter
 
     QStringList datasetFilePaths;
 
+    // Run parameters - stored in project files
+    QString cellMarkersFilePath;
+    double cellMarkersCutoff;
+    double datasetCutoff;
+
     QStringList completeSetOfGeneIDs;
     QVector<FeatureCollection> cellMarkersForTypes;
+    // Full values of the cell markers - types are the columns
+    ExpressionMatrix cellMarkersMatrix;
     QVector<QVector<FeatureCollection>> xClusterCollections;
+    // Spill file for every dataset whose clusters have been moved to disk - empty if the clusters are in memory
+    QVector<QString> spilledDatasetFilePaths;
 
     // FIXME: This looks very ugly!
     QVector<QVector<QVector<QPair<QString, double>>>> correlatedDatasets;
 
+    // Genes x clusters matrix with the full values of every dataset - this is what the GUI shows and what project files store
+    QVector<ExpressionMatrix> expressionMatrices;
+    // Mapping of the project file the state was loaded from - strings and matrices point into it
+    QSharedPointer<const void> projectFileMapping;
+
     InformationCenter(ConfigFile configFile);
+
+    QVector<FeatureCollection> getClusterCollections(const int datasetIndex) const;
 };
 
+// Immutable state of a finished run - published by the Coordinator and read by the GUI without ever copying the data
+typedef QSharedPointer<const InformationCenter> InformationCenterSnapshot;
+Q_DECLARE_METATYPE(InformationCenterSnapshot)
+
 #endif // INFORMATIONCENTER_H
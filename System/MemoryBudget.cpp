@@ -0,0 +1,85 @@
+#include "MemoryBudget.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "System/ConfigFile.h"
+#include "Statistics/PseudoBulkAggregator.h"
+#include "Utils/FileOperators/Hdf5Reader.h"
+#include "Utils/FileOperators/MtxReader.h"
+
+namespace MemoryBudget {
+
+namespace {
+// A matrix entry is a 32 bit row and a 32 bit count - compressed or as text the file says nothing about that
+const qint64 entryBytes = 8;
+// A cell has its column offset, its barcode and its cluster
+const qint64 cellBytes = 64;
+// A feature has its name in the gene dictionary and the mean, fraction and variance of every cluster
+const qint64 featureBytes = 256;
+}
+
+/**
+ * @brief getBudgetBytes - Returns the configured memory budget or half of the physical memory if none is configured
+ * @param configFile - Config file containing the budget in megabytes
+ * @return Memory budget in bytes
+ */
+qint64 getBudgetBytes(ConfigFile configFile) {
+    if (configFile.memoryBudgetMegabytes > 0) {
+        return configFile.memoryBudgetMegabytes * 1024 * 1024;
+    }
+
+    qint64 numberOfPages = sysconf(_SC_PHYS_PAGES),
+           pageSize = sysconf(_SC_PAGESIZE);
+
+    return numberOfPages * pageSize / 2;
+}
+
+
+/**
+ * @brief estimateDatasetBytes - Estimates the memory a dataset occupies while it is parsed and correlated.
+ *        Only expressed features are kept, so twice the file size is a generous upper bound for the parsed collections and the correlation temporaries.
+ *        Per cell datasets hold their sparse matrix while they are aggregated - it is estimated from the sizes the matrix file states,
+ *        and only if they cannot be read from four times the size of the matrix file.
+ * @param datasetFilePath - Path to the cellranger differential expression file or to the clusters.csv of a per cell dataset
+ * @return Estimated number of bytes
+ */
+qint64 estimateDatasetBytes(QString datasetFilePath) {
+    if (PseudoBulkAggregator::isClusterAssignmentFile(datasetFilePath)) {
+        QFileInfo matrixInfo(PseudoBulkAggregator::findFeatureBarcodeMatrix(datasetFilePath));
+        qint64 numberOfFeatures, numberOfCells, numberOfEntries;
+
+        bool isSized = matrixInfo.isDir() ? MtxReader::readMatrixSizes(matrixInfo.filePath(), numberOfFeatures, numberOfCells, numberOfEntries)
+                                          : Hdf5Reader::readMatrixSizes(matrixInfo.filePath(), numberOfFeatures, numberOfCells, numberOfEntries);
+
+        if (isSized) {
+            return numberOfEntries * entryBytes + numberOfCells * cellBytes + numberOfFeatures * featureBytes;
+        }
+
+        if (matrixInfo.isDir()) {
+            QDir matrixDirectory(matrixInfo.filePath());
+            return qMax(QFileInfo(matrixDirectory.filePath("matrix.mtx.gz")).size(), QFileInfo(matrixDirectory.filePath("matrix.mtx")).size()) * 4;
+        }
+        return matrixInfo.size() * 4;
+    }
+
+    return QFileInfo(datasetFilePath).size() * 2;
+}
+
+
+/**
+ * @brief getPeakResidentSetBytes - Returns the highest resident set size the process has reached so far
+ * @return Peak resident set size in bytes
+ */
+qint64 getPeakResidentSetBytes() {
+    struct rusage resourceUsage;
+    getrusage(RUSAGE_SELF, &resourceUsage);
+
+    // Linux reports the maximum resident set size in kilobytes
+    return qint64(resourceUsage.ru_maxrss) * 1024;
+}
+
+}
@@ -0,0 +1,18 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QString>
+
+#include "System/ConfigFile.h"
+
+/**
+ * @brief The MemoryBudget namespace bundles the memory estimations that are used to throttle the number of datasets in flight
+ */
+namespace MemoryBudget
+{
+    extern qint64 getBudgetBytes(ConfigFile configFile);
+    extern qint64 estimateDatasetBytes(QString datasetFilePath);
+    extern qint64 getPeakResidentSetBytes();
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,367 @@
+#include "ParameterSweep.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+#include "BioModels/ExpressionMatrix.h"
+#include "BioModels/GeneDictionary.h"
+#include "Statistics/PseudoBulkAggregator.h"
+#include "Statistics/RankCache.h"
+#include "Utils/Helper.h"
+#include "Utils/FileOperators/CSVReader.h"
+
+namespace ParameterSweep {
+
+namespace {
+
+// Files are parsed with every positive value - the cutoffs of the grid are applied on the ranked values
+const double fullValuesCutoff = 0;
+
+struct GridPoint
+{
+    double clusterCutoff;
+    double referenceCutoff;
+    ExpressionComparator::CorrelationMethod correlationMethod;
+};
+
+// Top correlated types of every cluster at one grid point
+typedef QVector<QVector<QPair<QString, double>>> TopCorrelations;
+
+QString getMethodName(const ExpressionComparator::CorrelationMethod correlationMethod) {
+    return correlationMethod == ExpressionComparator::PearsonCorrelation ? "pearson" : "spearman";
+}
+
+/**
+ * @brief startRankCache - Parses a file on the parsing pool and ranks its values on the correlation pool
+ * @param parse - Parses the file with its full values
+ * @param geneDictionary - Dictionary shared by the reference and every dataset
+ * @return Future of the future of the rank cache
+ */
+template <typename Parse>
+QFuture<QFuture<RankCache>> startRankCache(Parse parse, QSharedPointer<GeneDictionary> geneDictionary) {
+    return ThreadPools::run(ThreadPools::ParsingPool, [parse, geneDictionary]() {
+        TRACE_SCOPE("ParameterSweep::parseFile");
+        QVector<FeatureCollection> collections = parse();
+
+        return ThreadPools::run(ThreadPools::CorrelationPool, [collections, geneDictionary]() {
+            TRACE_SCOPE("ParameterSweep::rankFile");
+            return RankCache(ExpressionMatrix(collections, *geneDictionary));
+        });
+    });
+}
+
+/**
+ * @brief writeSweepResults - Writes the top types of every cluster at every grid point as tab separated rows
+ * @return True if the file could be written
+ */
+bool writeSweepResults(QString filePath, const QStringList & datasetNames, const QVector<QStringList> & clusterIDs,
+                       const QVector<GridPoint> & gridPoints, const QVector<QVector<TopCorrelations>> & results) {
+    QFile sweepFile(filePath);
+
+    if (!sweepFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "PARAMETER SWEEP:" << filePath << "-" << sweepFile.errorString();
+        return false;
+    }
+
+    QTextStream sweepStream(&sweepFile);
+    sweepStream << "Dataset\tCluster\tClusterCutoff\tReferenceCutoff\tMethod\tRank\tType\tCorrelation\n";
+
+    for (int d = 0; d < datasetNames.length(); d++) {
+        for (int p = 0; p < gridPoints.length(); p++) {
+            const GridPoint & gridPoint = gridPoints[p];
+            const TopCorrelations & topCorrelations = results[d][p];
+
+            for (int i = 0; i < topCorrelations.length(); i++) {
+                for (int rank = 0; rank < topCorrelations[i].length(); rank++) {
+                    sweepStream << datasetNames[d] << '\t' << clusterIDs[d][i] << '\t' << gridPoint.clusterCutoff << '\t' << gridPoint.referenceCutoff << '\t'
+                                << getMethodName(gridPoint.correlationMethod) << '\t' << rank + 1 << '\t'
+                                << topCorrelations[i][rank].first << '\t' << topCorrelations[i][rank].second << '\n';
+                }
+            }
+        }
+    }
+
+    sweepStream.flush();
+    return sweepStream.status() == QTextStream::Ok;
+}
+
+/**
+ * @brief writeStability - Writes how stable the annotation of every cluster is across the grid:
+ *        the type that is ranked first most often and the share of grid points that agree with it,
+ *        the types that are most often among the top types and the mean jaccard index of every grid point's top types with them
+ * @return True if the file could be written
+ */
+bool writeStability(QString filePath, const QStringList & datasetNames, const QVector<QStringList> & clusterIDs,
+                    const QVector<QVector<TopCorrelations>> & results, const int numberOfTopTypes) {
+    QFile stabilityFile(filePath);
+
+    if (!stabilityFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "PARAMETER SWEEP:" << filePath << "-" << stabilityFile.errorString();
+        return false;
+    }
+
+    QTextStream stabilityStream(&stabilityFile);
+    stabilityStream << "Dataset\tCluster\tConsensusType\tTopTypeAgreement\tConsensusTopTypes\tTopTypesJaccard\n";
+
+    for (int d = 0; d < datasetNames.length(); d++) {
+        int numberOfGridPoints = results[d].length();
+
+        for (int i = 0; i < clusterIDs[d].length(); i++) {
+            // Count in grid order, so ties are broken by the first grid point a type appeared at
+            QStringList seenTypes;
+            QHash<QString, int> topTypeCounts, topTypesCounts;
+
+            for (int p = 0; p < numberOfGridPoints; p++) {
+                const QVector<QPair<QString, double>> & topCorrelations = results[d][p][i];
+
+                for (int rank = 0; rank < topCorrelations.length(); rank++) {
+                    const QString & type = topCorrelations[rank].first;
+
+                    if (!topTypesCounts.contains(type)) {
+                        seenTypes.append(type);
+                    }
+                    topTypesCounts[type]++;
+
+                    if (rank == 0) {
+                        topTypeCounts[type]++;
+                    }
+                }
+            }
+
+            QString consensusType;
+            for (const QString & type : seenTypes) {
+                if (topTypeCounts.value(type) > topTypeCounts.value(consensusType)) {
+                    consensusType = type;
+                }
+            }
+
+            QStringList consensusTopTypes = seenTypes;
+            std::stable_sort(consensusTopTypes.begin(), consensusTopTypes.end(), [&topTypesCounts](const QString & typeA, const QString & typeB) {
+                return topTypesCounts.value(typeA) > topTypesCounts.value(typeB);
+            });
+            consensusTopTypes = consensusTopTypes.mid(0, numberOfTopTypes);
+
+            QSet<QString> consensusTopTypeSet = QSet<QString>::fromList(consensusTopTypes);
+            double jaccardSum = 0;
+
+            for (int p = 0; p < numberOfGridPoints; p++) {
+                QSet<QString> topTypeSet;
+                for (const QPair<QString, double> & correlation : results[d][p][i]) {
+                    topTypeSet.insert(correlation.first);
+                }
+
+                int numberOfSharedTypes = QSet<QString>(topTypeSet).intersect(consensusTopTypeSet).size(),
+                    numberOfAllTypes = QSet<QString>(topTypeSet).unite(consensusTopTypeSet).size();
+
+                jaccardSum += numberOfAllTypes > 0 ? double(numberOfSharedTypes) / numberOfAllTypes : 1;
+            }
+
+            double topTypeAgreement = numberOfGridPoints > 0 ? double(topTypeCounts.value(consensusType)) / numberOfGridPoints : 0,
+                   topTypesJaccard = numberOfGridPoints > 0 ? jaccardSum / numberOfGridPoints : 0;
+
+            stabilityStream << datasetNames[d] << '\t' << clusterIDs[d][i] << '\t' << consensusType << '\t' << topTypeAgreement << '\t'
+                            << consensusTopTypes.join(',') << '\t' << topTypesJaccard << '\n';
+        }
+    }
+
+    stabilityStream.flush();
+    return stabilityStream.status() == QTextStream::Ok;
+}
+
+}
+
+
+/**
+ * @brief parseValueRange - Parses a list of values "5,10,15" or a range "start:stop:step" with inclusive stop, e.g. "5:30:5"
+ * @param valueRange - List or range
+ * @return Values in the given order - empty if the input is invalid
+ */
+QVector<double> parseValueRange(QString valueRange) {
+    QVector<double> values;
+    QStringList rangeBounds = valueRange.split(':');
+
+    if (rangeBounds.length() == 3) {
+        bool isValidStart = false, isValidStop = false, isValidStep = false;
+        double start = rangeBounds[0].toDouble(&isValidStart),
+               stop = rangeBounds[1].toDouble(&isValidStop),
+               step = rangeBounds[2].toDouble(&isValidStep);
+
+        if (!isValidStart || !isValidStop || !isValidStep || step <= 0) {
+            qDebug() << "PARAMETER SWEEP: Invalid range" << valueRange;
+            return QVector<double>();
+        }
+
+        // Multiplying instead of adding up the steps keeps the values free of accumulated rounding errors
+        for (int i = 0; start + i * step <= stop + step * 1e-9; i++) {
+            values.append(start + i * step);
+        }
+        return values;
+    }
+
+    for (QString value : valueRange.split(',', QString::SkipEmptyParts)) {
+        bool isValidValue = false;
+        values.append(value.trimmed().toDouble(&isValidValue));
+
+        if (!isValidValue) {
+            qDebug() << "PARAMETER SWEEP: Invalid value" << value;
+            return QVector<double>();
+        }
+    }
+
+    return values;
+}
+
+
+/**
+ * @brief parseCorrelationMethods - Parses a comma separated list of correlation methods
+ * @param correlationMethods - List of "spearman" and "pearson"
+ * @return Correlation methods - empty if one of them is unknown
+ */
+QVector<ExpressionComparator::CorrelationMethod> parseCorrelationMethods(QString correlationMethods) {
+    QVector<ExpressionComparator::CorrelationMethod> methods;
+
+    for (QString methodName : correlationMethods.split(',', QString::SkipEmptyParts)) {
+        methodName = methodName.trimmed().toLower();
+
+        if (methodName == "spearman") {
+            methods.append(ExpressionComparator::SpearmanCorrelation);
+        } else if (methodName == "pearson") {
+            methods.append(ExpressionComparator::PearsonCorrelation);
+        } else {
+            qDebug() << "PARAMETER SWEEP: Unknown correlation method" << methodName;
+            return QVector<ExpressionComparator::CorrelationMethod>();
+        }
+    }
+
+    return methods;
+}
+
+
+/**
+ * @brief runSweep - Parses the reference and every dataset once and evaluates every grid point on the correlation pool.
+ *        Writes "sweep.tsv" with the top types of every cluster at every grid point and "stability.tsv" with the stability of every cluster
+ * @param parameters - Reference, datasets, output directory and the axes of the grid
+ * @return 0 if both files have been written, 1 otherwise
+ */
+int runSweep(SweepParameters parameters) {
+    int numberOfDatasets = parameters.datasetFilePaths.length();
+
+    if (numberOfDatasets == 0 || parameters.clusterCutoffs.isEmpty() || parameters.referenceCutoffs.isEmpty() || parameters.correlationMethods.isEmpty()) {
+        qDebug() << "PARAMETER SWEEP: Datasets, cutoffs and correlation methods are required.";
+        return 1;
+    }
+
+    QDir outputDirectory(parameters.outputDirectoryPath);
+    if (!outputDirectory.mkpath(".")) {
+        qDebug() << "PARAMETER SWEEP: Could not create output directory" << parameters.outputDirectoryPath;
+        return 1;
+    }
+
+    QVector<GridPoint> gridPoints;
+    for (ExpressionComparator::CorrelationMethod correlationMethod : parameters.correlationMethods) {
+        for (double referenceCutoff : parameters.referenceCutoffs) {
+            for (double clusterCutoff : parameters.clusterCutoffs) {
+                gridPoints.append({ clusterCutoff, referenceCutoff, correlationMethod });
+            }
+        }
+    }
+
+    // Every file is parsed and ranked once - all grid points share the ranks
+    cout << "Parsing and ranking reference and " << numberOfDatasets << " datasets." << endl;
+    QSharedPointer<GeneDictionary> geneDictionary(new GeneDictionary());
+    QString referenceFilePath = parameters.referenceFilePath;
+
+    QFuture<QFuture<RankCache>> futureReference = startRankCache([referenceFilePath]() {
+        return CSVReader::getTissuesWithGeneExpression(referenceFilePath, fullValuesCutoff);
+    }, geneDictionary);
+
+    QVector<QFuture<QFuture<RankCache>>> futureDatasets;
+    QStringList datasetNames;
+    QSet<QString> usedDatasetNames;
+
+    for (int d = 0; d < numberOfDatasets; d++) {
+        QString datasetFilePath = parameters.datasetFilePaths[d];
+
+        futureDatasets.append(startRankCache([datasetFilePath]() {
+            return PseudoBulkAggregator::isClusterAssignmentFile(datasetFilePath) ? PseudoBulkAggregator::getClusterFeatureExpressions(datasetFilePath, fullValuesCutoff)
+                                                                                : CSVReader::getClusterFeatureExpressions(datasetFilePath, fullValuesCutoff);
+        }, geneDictionary));
+
+        // CellRanger names every dataset file the same, so duplicate names are made unique by their position
+        QString datasetName = Helper::chopFileName(datasetFilePath);
+        if (usedDatasetNames.contains(datasetName)) {
+            datasetName.append("_" + QString::number(d));
+        }
+        usedDatasetNames.insert(datasetName);
+        datasetNames.append(datasetName);
+    }
+
+    RankCache reference = futureReference.result().result();
+
+    QVector<RankCache> datasets;
+    QVector<QStringList> clusterIDs;
+    for (int d = 0; d < numberOfDatasets; d++) {
+        datasets.append(futureDatasets[d].result().result());
+        clusterIDs.append(datasets[d].getExpressionMatrix().getClusterIDs());
+    }
+
+    cout << "Evaluating " << gridPoints.length() << " grid points for " << numberOfDatasets << " datasets." << endl;
+    int numberOfTopTypes = qMax(1, parameters.numberOfTopTypes);
+
+    QVector<QVector<QFuture<TopCorrelations>>> futureResults(numberOfDatasets);
+    for (int d = 0; d < numberOfDatasets; d++) {
+        RankCache dataset = datasets[d];
+
+        for (const GridPoint & gridPoint : gridPoints) {
+            futureResults[d].append(ThreadPools::run(ThreadPools::CorrelationPool, [dataset, reference, gridPoint, numberOfTopTypes]() {
+                TRACE_SCOPE("ParameterSweep::evaluateGridPoint");
+
+                TopCorrelations topCorrelations = ExpressionComparator::findClusterTissueCorrelations(dataset, reference, gridPoint.clusterCutoff,
+                                                                                                     gridPoint.referenceCutoff, gridPoint.correlationMethod);
+                for (QVector<QPair<QString, double>> & clusterCorrelations : topCorrelations) {
+                    clusterCorrelations.resize(qMin(numberOfTopTypes, clusterCorrelations.length()));
+                }
+                return topCorrelations;
+            }));
+        }
+    }
+
+    QVector<QVector<TopCorrelations>> results(numberOfDatasets);
+    for (int d = 0; d < numberOfDatasets; d++) {
+        for (QFuture<TopCorrelations> & futureResult : futureResults[d]) {
+            results[d].append(futureResult.result());
+        }
+    }
+
+    QString sweepFilePath = outputDirectory.filePath("sweep.tsv"),
+            stabilityFilePath = outputDirectory.filePath("stability.tsv");
+
+    bool isWritten = writeSweepResults(sweepFilePath, datasetNames, clusterIDs, gridPoints, results)
+            && writeStability(stabilityFilePath, datasetNames, clusterIDs, results, numberOfTopTypes);
+
+    if (!isWritten) {
+        return 1;
+    }
+
+    cout << "Results: " << sweepFilePath.toStdString() << endl;
+    cout << "Stability: " << stabilityFilePath.toStdString() << endl;
+    return 0;
+}
+
+}
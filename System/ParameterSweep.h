@@ -0,0 +1,33 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Statistics/Expressioncomparator.h"
+
+/**
+ * @brief The ParameterSweep namespace annotates datasets for every combination of cluster cutoff, reference cutoff and correlation method.
+ *        The files are parsed once with their full values and the ranked genes are shared by every grid point. For every cluster it reports
+ *        how stable its top annotation is across the grid.
+ */
+namespace ParameterSweep
+{
+    struct SweepParameters
+    {
+        QString referenceFilePath;
+        QStringList datasetFilePaths;
+        QString outputDirectoryPath;
+        QVector<double> clusterCutoffs;
+        QVector<double> referenceCutoffs;
+        QVector<ExpressionComparator::CorrelationMethod> correlationMethods;
+        int numberOfTopTypes;
+    };
+
+    extern QVector<double> parseValueRange(QString valueRange);
+    extern QVector<ExpressionComparator::CorrelationMethod> parseCorrelationMethods(QString correlationMethods);
+    extern int runSweep(SweepParameters parameters);
+};
+
+#endif // PARAMETERSWEEP_H
@@ -0,0 +1,246 @@
+#include "PerfCounters.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace PerfCounters {
+
+namespace {
+
+std::atomic<bool> isCounting {false};
+
+QMutex stageMutex;
+QVector<StageCounters> stageCounters;
+QHash<QString, int> stageIndices;
+
+// Innermost running scope of the thread - genes are added to every scope of the chain
+thread_local CounterScope * currentScope = nullptr;
+
+/**
+ * @brief The ThreadCounters struct holds the counter group of a thread. The group is read with a single read() on its leader,
+ *        which returns the values of every counter that could be opened in the order they were opened
+ */
+struct ThreadCounters
+{
+    bool isOpened = false;
+    int leaderDescriptor = -1;
+    int descriptors[numberOfCounterTypes] = { -1, -1, -1, -1 };
+    // Position of every counter in the values read from the group - -1 if it could not be opened
+    int positions[numberOfCounterTypes] = { -1, -1, -1, -1 };
+
+    ~ThreadCounters() {
+#ifdef Q_OS_LINUX
+        for (int descriptor : this->descriptors) {
+            if (descriptor >= 0) {
+                close(descriptor);
+            }
+        }
+#endif
+    }
+};
+
+thread_local ThreadCounters threadCounters;
+
+#ifdef Q_OS_LINUX
+/**
+ * @brief openCounter - Opens a counter of the calling thread in user space
+ * @param config - Hardware event of the counter
+ * @param groupDescriptor - Leader of the group or -1 to open a new group
+ * @return Descriptor of the counter - negative if it could not be opened
+ */
+int openCounter(const quint64 config, const int groupDescriptor) {
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    // Kernel time is not counted, which keeps the counters available at the default perf_event_paranoid level
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    return int(syscall(__NR_perf_event_open, &attributes, 0, -1, groupDescriptor, 0));
+}
+#endif
+
+/**
+ * @brief openThreadCounters - Opens the counter group of the calling thread. Counters the cpu does not support are left out
+ * @return True if at least the cycle counter could be opened
+ */
+bool openThreadCounters() {
+    threadCounters.isOpened = true;
+
+#ifdef Q_OS_LINUX
+    const quint64 configs[numberOfCounterTypes] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    int numberOfOpenedCounters = 0;
+
+    for (int i = 0; i < numberOfCounterTypes; i++) {
+        int descriptor = openCounter(configs[i], threadCounters.leaderDescriptor);
+
+        if (descriptor < 0) {
+            // Without a leader there is no group - tell once and stop counting
+            if (i == Cycles) {
+                static std::atomic<bool> isReported {false};
+                if (!isReported.exchange(true)) {
+                    qDebug() << "PERF COUNTERS: perf_event_open failed -" << strerror(errno) << "- check /proc/sys/kernel/perf_event_paranoid";
+                }
+                return false;
+            }
+            continue;
+        }
+
+        if (i == Cycles) {
+            threadCounters.leaderDescriptor = descriptor;
+        }
+        threadCounters.descriptors[i] = descriptor;
+        threadCounters.positions[i] = numberOfOpenedCounters++;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief readThreadCounters - Reads the counter group of the calling thread
+ * @param values - Filled with the value of every counter - -1 for counters that are not available
+ * @return True if the group could be read
+ */
+bool readThreadCounters(qint64 values[numberOfCounterTypes]) {
+    if (!threadCounters.isOpened) {
+        openThreadCounters();
+    }
+
+    if (threadCounters.leaderDescriptor < 0) {
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    // Layout of a group read: number of counters followed by their values
+    quint64 buffer[1 + numberOfCounterTypes];
+    if (read(threadCounters.leaderDescriptor, buffer, sizeof(buffer)) < qint64(sizeof(quint64))) {
+        return false;
+    }
+
+    for (int i = 0; i < numberOfCounterTypes; i++) {
+        int position = threadCounters.positions[i];
+        values[i] = position >= 0 && quint64(position) < buffer[0] ? qint64(buffer[1 + position]) : -1;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
+
+
+/**
+ * @brief configurePerfCounters - Enables the counters if the config file asks for them
+ * @param configFile - Config file of the run
+ */
+void configurePerfCounters(ConfigFile configFile) {
+    isCounting.store(configFile.isPerfCounters);
+}
+
+
+/**
+ * @brief isEnabled - Returns whether stages are counted
+ * @return True if the counters are enabled
+ */
+bool isEnabled() {
+    return isCounting.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief addProcessedGenes - Adds genes to every running scope of the calling thread
+ * @param numberOfGenes - Number of genes the current stage has processed
+ */
+void addProcessedGenes(const qint64 numberOfGenes) {
+    for (CounterScope * scope = currentScope; scope != nullptr; scope = scope->outerScope) {
+        scope->processedGenes += numberOfGenes;
+    }
+}
+
+
+/**
+ * @brief getStageCounters - Returns the totals of every stage that has been counted so far
+ * @return Totals in the order the stages finished for the first time
+ */
+QVector<StageCounters> getStageCounters() {
+    QMutexLocker locker(&stageMutex);
+    return stageCounters;
+}
+
+
+/**
+ * @brief CounterScope::CounterScope - Reads the counters of the calling thread if counting is enabled
+ * @param name - Name of the stage - must be a string literal
+ */
+CounterScope::CounterScope(const char * name)
+    : name {nullptr}, processedGenes {0}, outerScope {nullptr}
+{
+    if (!isEnabled() || !readThreadCounters(this->startValues)) {
+        return;
+    }
+
+    this->name = name;
+    this->outerScope = currentScope;
+    currentScope = this;
+}
+
+
+/**
+ * @brief CounterScope::~CounterScope - Adds the counter values since the start of the scope to the totals of its stage
+ */
+CounterScope::~CounterScope() {
+    if (this->name == nullptr) {
+        return;
+    }
+
+    currentScope = this->outerScope;
+
+    qint64 endValues[numberOfCounterTypes];
+    if (!readThreadCounters(endValues)) {
+        return;
+    }
+
+    QMutexLocker locker(&stageMutex);
+
+    QString stageName = QString::fromLatin1(this->name);
+    if (!stageIndices.contains(stageName)) {
+        StageCounters newStageCounters = { stageName, 0, 0, { 0, 0, 0, 0 } };
+        stageIndices.insert(stageName, stageCounters.length());
+        stageCounters.append(newStageCounters);
+    }
+
+    StageCounters & stage = stageCounters[stageIndices.value(stageName)];
+    stage.numberOfCalls++;
+    stage.processedGenes += this->processedGenes;
+
+    for (int i = 0; i < numberOfCounterTypes; i++) {
+        if (endValues[i] < 0 || stage.values[i] < 0) {
+            stage.values[i] = -1;
+        } else {
+            stage.values[i] += endValues[i] - this->startValues[i];
+        }
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "System/ConfigFile.h"
+
+/**
+ * @brief The PerfCounters namespace measures stages with the hardware counters of the cpu (Linux perf_event_open): cycles, instructions,
+ *        cache misses and branch misses. Every thread opens its own counter group on first use and keeps it for its lifetime,
+ *        a scope reads the group once when it starts and once when it ends. Stages can report the number of genes they processed,
+ *        so the run summary can show misses per gene. Counting is off unless enabled in the config file.
+ */
+namespace PerfCounters
+{
+    enum CounterType { Cycles = 0, Instructions = 1, CacheMisses = 2, BranchMisses = 3 };
+    const int numberOfCounterTypes = 4;
+
+    struct StageCounters
+    {
+        QString name;
+        qint64 numberOfCalls;
+        qint64 processedGenes;
+        // Summed counter values of every call - -1 if the counter is not supported by the cpu
+        qint64 values[numberOfCounterTypes];
+    };
+
+    extern void configurePerfCounters(ConfigFile configFile);
+    extern bool isEnabled();
+    extern void addProcessedGenes(const qint64 numberOfGenes);
+    extern QVector<StageCounters> getStageCounters();
+
+    /**
+     * @brief The CounterScope class adds the counter values of the calling thread from its construction to its destruction to the totals of its stage
+     */
+    class CounterScope
+    {
+    private:
+        // Null if counting was disabled when the scope started
+        const char * name;
+        qint64 startValues[numberOfCounterTypes];
+        qint64 processedGenes;
+        CounterScope * outerScope;
+
+        friend void addProcessedGenes(const qint64 numberOfGenes);
+
+    public:
+        CounterScope(const char * name);
+        ~CounterScope();
+
+        CounterScope(const CounterScope &) = delete;
+        CounterScope & operator=(const CounterScope &) = delete;
+    };
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,81 @@
+#include "RunSummary.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "System/AllocationTracker.h"
+#include "System/MemoryBudget.h"
+#include "System/PerfCounters.h"
+#include "System/ThreadPools.h"
+
+namespace RunSummary {
+
+namespace {
+
+/**
+ * @brief printPerStage - Prints a counter per processed gene or - if the stage has not counted genes - in total
+ * @param name - Name of the counter
+ * @param value - Summed value of the counter - -1 if it is not supported
+ * @param processedGenes - Genes the stage has processed
+ */
+void printPerStage(const char * name, const qint64 value, const qint64 processedGenes) {
+    if (value < 0) {
+        cout << ", " << name << " n/a";
+    } else if (processedGenes > 0) {
+        cout << ", " << double(value) / processedGenes << " " << name << " / gene";
+    } else {
+        cout << ", " << value << " " << name;
+    }
+}
+
+}
+
+/**
+ * @brief printRunSummary - Prints the resource usage of the run so far
+ */
+void printRunSummary() {
+    cout << "\n########################### RUN SUMMARY ###########################\n";
+    cout << "Peak resident set size: " << MemoryBudget::getPeakResidentSetBytes() / (1024 * 1024) << " MB" << endl;
+
+    const char * poolNames[] = { "Parsing pool", "Correlation pool" };
+    for (ThreadPools::PoolType poolType : { ThreadPools::ParsingPool, ThreadPools::CorrelationPool }) {
+        ThreadPools::PoolUtilization poolUtilization = ThreadPools::getPoolUtilization(poolType);
+
+        cout << poolNames[poolType] << ": " << poolUtilization.maximumThreadCount << " threads, "
+             << poolUtilization.finishedTasks << " tasks, " << poolUtilization.busySeconds << " s busy, "
+             << int(poolUtilization.utilization * 100) << " % utilization" << endl;
+    }
+
+    if (AllocationTracker::isEnabled()) {
+        cout << "Allocations per stage (still live: not freed yet, keeps growing over runs if leaking):" << endl;
+        for (const AllocationTracker::StageAllocations & stage : AllocationTracker::getStageAllocations()) {
+            cout << "  " << stage.name.toStdString() << ": " << stage.numberOfAllocations << " allocations, "
+                 << double(stage.allocatedBytes) / (1024 * 1024) << " MB allocated, "
+                 << double(stage.peakLiveBytes) / (1024 * 1024) << " MB peak live, "
+                 << double(stage.liveBytes) / (1024 * 1024) << " MB still live" << endl;
+        }
+    }
+
+    if (!PerfCounters::isEnabled()) {
+        return;
+    }
+
+    // Counters only cover the thread a stage runs on - stages that wait for the pools show the waiting thread, the pool tasks show the work
+    cout << "Hardware counters per stage (thread of the stage only):" << endl;
+    for (const PerfCounters::StageCounters & stage : PerfCounters::getStageCounters()) {
+        const qint64 * values = stage.values;
+
+        cout << "  " << stage.name.toStdString() << ": " << stage.numberOfCalls << " calls, " << values[PerfCounters::Cycles] << " cycles";
+
+        if (values[PerfCounters::Instructions] >= 0 && values[PerfCounters::Cycles] > 0) {
+            cout << ", IPC " << double(values[PerfCounters::Instructions]) / values[PerfCounters::Cycles];
+        }
+
+        printPerStage("cache misses", values[PerfCounters::CacheMisses], stage.processedGenes);
+        printPerStage("branch misses", values[PerfCounters::BranchMisses], stage.processedGenes);
+        cout << endl;
+    }
+}
+
+}
@@ -0,0 +1,12 @@
+#ifndef RUNSUMMARY_H
+#define RUNSUMMARY_H
+
+/**
+ * @brief The RunSummary namespace prints the resource usage of a finished workflow run
+ */
+namespace RunSummary
+{
+    extern void printRunSummary();
+};
+
+#endif // RUNSUMMARY_H
@@ -0,0 +1,269 @@
+#include "SharedReference.h"
+
+#include <QDebug>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace SharedReference {
+
+namespace {
+
+const quint32 segmentMagic = 0x42444752; // "BDGR"
+
+// The segment is laid out as: header | collection entries | feature entries | UTF-16 string pool
+struct SegmentHeader
+{
+    quint32 magic;
+    quint32 numberOfCollections;
+    quint32 numberOfFeatures;
+    quint32 stringPoolLength;
+};
+
+struct CollectionEntry
+{
+    quint32 idOffset;
+    quint32 idLength;
+    quint32 firstFeature;
+    quint32 numberOfFeatures;
+};
+
+struct FeatureEntry
+{
+    quint32 idOffset;
+    quint32 idLength;
+    double count;
+};
+
+/**
+ * @brief writeCompletely - Writes the complete buffer to the descriptor at the given offset
+ * @return True if every byte has been written
+ */
+bool writeCompletely(int descriptor, const void * data, size_t size, off_t offset) {
+    const char * bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+        ssize_t writtenBytes = pwrite(descriptor, bytes, size, offset);
+        if (writtenBytes <= 0) {
+            return false;
+        }
+        bytes += writtenBytes;
+        offset += writtenBytes;
+        size -= size_t(writtenBytes);
+    }
+    return true;
+}
+
+/**
+ * @brief createAnonymousDescriptor - Creates an unnamed shared memory file. Falls back to an immediately unlinked POSIX shm object on kernels without memfd
+ * @return File descriptor or -1
+ */
+int createAnonymousDescriptor() {
+#ifdef MFD_ALLOW_SEALING
+    int memoryFileDescriptor = memfd_create("badger-reference", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memoryFileDescriptor >= 0) {
+        return memoryFileDescriptor;
+    }
+#endif
+    QByteArray name = QString("/badger-reference-%1").arg(getpid()).toLocal8Bit();
+    int descriptor = shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (descriptor >= 0) {
+        shm_unlink(name.constData());
+    }
+    return descriptor;
+}
+
+// The sections of a mapped segment follow each other without padding
+const CollectionEntry * getCollectionEntries(const char * segment) {
+    return reinterpret_cast<const CollectionEntry *>(segment + sizeof(SegmentHeader));
+}
+
+const FeatureEntry * getFeatureEntries(const char * segment) {
+    return reinterpret_cast<const FeatureEntry *>(getCollectionEntries(segment) + reinterpret_cast<const SegmentHeader *>(segment)->numberOfCollections);
+}
+
+const QChar * getStringPool(const char * segment) {
+    return reinterpret_cast<const QChar *>(getFeatureEntries(segment) + reinterpret_cast<const SegmentHeader *>(segment)->numberOfFeatures);
+}
+
+}
+
+
+/**
+ * @brief createSegment - Serializes the reference into a new shared memory segment. Gene IDs that occur in several types are stored once
+ * @param reference - Parsed reference
+ * @return Descriptor of the segment - it is inherited by forked processes - or -1 on failure
+ */
+int createSegment(QVector<FeatureCollection> reference) {
+    QVector<CollectionEntry> collectionEntries;
+    QVector<FeatureEntry> featureEntries;
+    QString stringPool;
+    QHash<QString, quint32> stringOffsets;
+
+    // Returns the pool offset of the given string and adds it to the pool if it has not been seen before
+    auto addString = [&stringPool, &stringOffsets](const QString & string) {
+        auto existingOffset = stringOffsets.constFind(string);
+        if (existingOffset != stringOffsets.constEnd()) {
+            return existingOffset.value();
+        }
+
+        quint32 offset = quint32(stringPool.length());
+        stringPool.append(string);
+        stringOffsets.insert(string, offset);
+        return offset;
+    };
+
+    collectionEntries.reserve(reference.length());
+
+    for (FeatureCollection & collection : reference) {
+        CollectionEntry collectionEntry;
+        collectionEntry.idOffset = addString(collection.ID);
+        collectionEntry.idLength = quint32(collection.ID.length());
+        collectionEntry.firstFeature = quint32(featureEntries.length());
+        collectionEntry.numberOfFeatures = quint32(collection.getNumberOfFeatures());
+        collectionEntries.append(collectionEntry);
+
+        for (int i = 0; i < collection.getNumberOfFeatures(); i++) {
+            QString featureID = collection.getFeatureID(i);
+
+            FeatureEntry featureEntry;
+            featureEntry.idOffset = addString(featureID);
+            featureEntry.idLength = quint32(featureID.length());
+            featureEntry.count = collection.getFeatureExpressionCount(i);
+            featureEntries.append(featureEntry);
+        }
+    }
+
+    SegmentHeader header;
+    header.magic = segmentMagic;
+    header.numberOfCollections = quint32(collectionEntries.length());
+    header.numberOfFeatures = quint32(featureEntries.length());
+    header.stringPoolLength = quint32(stringPool.length());
+
+    size_t collectionsOffset = sizeof(SegmentHeader),
+           featuresOffset = collectionsOffset + sizeof(CollectionEntry) * size_t(collectionEntries.length()),
+           stringPoolOffset = featuresOffset + sizeof(FeatureEntry) * size_t(featureEntries.length()),
+           segmentSize = stringPoolOffset + sizeof(QChar) * size_t(stringPool.length());
+
+    int descriptor = createAnonymousDescriptor();
+    if (descriptor < 0) {
+        qDebug() << "SHARED REFERENCE: Could not create shared memory segment.";
+        return -1;
+    }
+
+    bool isWritten = ftruncate(descriptor, off_t(segmentSize)) == 0
+            && writeCompletely(descriptor, &header, sizeof(SegmentHeader), 0)
+            && writeCompletely(descriptor, collectionEntries.constData(), sizeof(CollectionEntry) * size_t(collectionEntries.length()), off_t(collectionsOffset))
+            && writeCompletely(descriptor, featureEntries.constData(), sizeof(FeatureEntry) * size_t(featureEntries.length()), off_t(featuresOffset))
+            && writeCompletely(descriptor, stringPool.constData(), sizeof(QChar) * size_t(stringPool.length()), off_t(stringPoolOffset));
+
+    if (!isWritten) {
+        qDebug() << "SHARED REFERENCE: Could not write shared memory segment.";
+        close(descriptor);
+        return -1;
+    }
+
+#ifdef F_ADD_SEALS
+    // Nobody may change the reference once the workers have mapped it
+    fcntl(descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+    return descriptor;
+}
+
+
+/**
+ * @brief mapSegment - Maps the segment read-only. The mapping is kept for the lifetime of the process
+ * @param segmentDescriptor - Descriptor returned by createSegment
+ * @return View of the reference in the mapping - without types if the segment could not be mapped
+ */
+MappedReference mapSegment(int segmentDescriptor) {
+    struct stat segmentStatus;
+    if (fstat(segmentDescriptor, &segmentStatus) != 0 || size_t(segmentStatus.st_size) < sizeof(SegmentHeader)) {
+        qDebug() << "SHARED REFERENCE: Invalid shared memory segment.";
+        return MappedReference();
+    }
+
+    void * mapping = mmap(nullptr, size_t(segmentStatus.st_size), PROT_READ, MAP_SHARED, segmentDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        qDebug() << "SHARED REFERENCE: Could not map shared memory segment.";
+        return MappedReference();
+    }
+
+    const char * segment = static_cast<const char *>(mapping);
+
+    if (reinterpret_cast<const SegmentHeader *>(segment)->magic != segmentMagic) {
+        qDebug() << "SHARED REFERENCE: Unknown shared memory segment.";
+        munmap(mapping, size_t(segmentStatus.st_size));
+        return MappedReference();
+    }
+
+    return MappedReference(segment);
+}
+
+
+/**
+ * @brief MappedReference::MappedReference - View without types
+ */
+MappedReference::MappedReference()
+    : segment {nullptr}
+{}
+
+
+/**
+ * @brief MappedReference::MappedReference - View of the reference in the given mapping
+ * @param segment - Start of the mapped segment
+ */
+MappedReference::MappedReference(const char * segment)
+    : segment {segment}
+{}
+
+
+/**
+ * @brief MappedReference::getNumberOfTypes
+ * @return Number of types in the reference
+ */
+int MappedReference::getNumberOfTypes() const {
+    return this->segment == nullptr ? 0 : int(reinterpret_cast<const SegmentHeader *>(this->segment)->numberOfCollections);
+}
+
+
+/**
+ * @brief MappedReference::getTypeID - The ID is a raw data QString that points into the mapping instead of owning a copy of the characters
+ * @param typeIndex - Index of the type in the reference
+ * @return ID of the type
+ */
+QString MappedReference::getTypeID(const int typeIndex) const {
+    const CollectionEntry & collectionEntry = getCollectionEntries(this->segment)[typeIndex];
+    return QString::fromRawData(getStringPool(this->segment) + collectionEntry.idOffset, int(collectionEntry.idLength));
+}
+
+
+/**
+ * @brief MappedReference::getType - Rebuilds a type from its records in the mapping. Its IDs are raw data QStrings as well,
+ *        so only the feature list is allocated - it lives as long as the caller keeps the type
+ * @param typeIndex - Index of the type in the reference
+ * @return The type with all of its features
+ */
+FeatureCollection MappedReference::getType(const int typeIndex) const {
+    const FeatureEntry * featureEntries = getFeatureEntries(this->segment);
+    const QChar * stringPool = getStringPool(this->segment);
+
+    const CollectionEntry & collectionEntry = getCollectionEntries(this->segment)[typeIndex];
+    FeatureCollection type(QString::fromRawData(stringPool + collectionEntry.idOffset, int(collectionEntry.idLength)));
+
+    for (quint32 j = collectionEntry.firstFeature; j < collectionEntry.firstFeature + collectionEntry.numberOfFeatures; j++) {
+        const FeatureEntry & featureEntry = featureEntries[j];
+        type.addFeature(QString::fromRawData(stringPool + featureEntry.idOffset, int(featureEntry.idLength)), featureEntry.count);
+    }
+
+    return type;
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef SHAREDREFERENCE_H
+#define SHAREDREFERENCE_H
+
+#include <QString>
+#include <QVector>
+
+#include "BioModels/FeatureCollection.h"
+
+/**
+ * @brief The SharedReference namespace places a parsed reference in a read-only shared memory segment that several processes can map.
+ *        Workers read the types straight from the mapping, so neither the IDs nor the type records are copied per process.
+ */
+namespace SharedReference
+{
+    /**
+     * @brief The MappedReference class is a view of the reference in a mapped segment. A type is only rebuilt as FeatureCollection
+     *        while it is used, its IDs point into the mapping
+     */
+    class MappedReference
+    {
+    private:
+        const char * segment;
+
+    public:
+        MappedReference();
+        MappedReference(const char * segment);
+
+        int getNumberOfTypes() const;
+        QString getTypeID(const int typeIndex) const;
+        FeatureCollection getType(const int typeIndex) const;
+    };
+
+    extern int createSegment(QVector<FeatureCollection> reference);
+    extern MappedReference mapSegment(int segmentDescriptor);
+};
+
+#endif // SHAREDREFERENCE_H
@@ -0,0 +1,36 @@
+#ifndef STAGESCOPE_H
+#define STAGESCOPE_H
+
+#include "System/AllocationTracker.h"
+#include "System/PerfCounters.h"
+#include "System/Trace.h"
+
+/**
+ * @brief The StageScope class marks a pipeline stage for every instrumentation that is enabled - the trace, the hardware counters and the allocation tracker
+ */
+class StageScope
+{
+private:
+    Trace::TraceScope traceScope;
+    PerfCounters::CounterScope counterScope;
+    AllocationTracker::StageTag allocationTag;
+
+public:
+    /**
+     * @brief StageScope::StageScope
+     * @param name - Name of the stage - must be a string literal, only the pointer is stored
+     */
+    StageScope(const char * name)
+        : traceScope {name}, counterScope {name}, allocationTag {name}
+    {}
+
+    StageScope(const StageScope &) = delete;
+    StageScope & operator=(const StageScope &) = delete;
+};
+
+#define STAGE_SCOPE_VARIABLE(line) TRACE_SCOPE_CONCATENATE(stageScope, line)
+
+// Marks the rest of the enclosing block as a stage with the given name
+#define STAGE_SCOPE(name) StageScope STAGE_SCOPE_VARIABLE(__LINE__)(name)
+
+#endif // STAGESCOPE_H
@@ -0,0 +1,227 @@
+#include "ThreadPools.h"
+
+#include <QDebug>
+#include <QGlobalStatic>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <chrono>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "System/ConfigFile.h"
+#include "System/Trace.h"
+
+namespace ThreadPools {
+
+namespace {
+
+struct PoolState
+{
+    QThreadPool threadPool;
+    std::atomic<int> activeTasks {0};
+    std::atomic<qint64> finishedTasks {0};
+    std::atomic<qint64> busyNanoseconds {0};
+    std::atomic<int> nextCoreIndex {0};
+    // Cores the threads of the pool are pinned to - a slice of the allowed cores of its own
+    QVector<int> pinnedCores;
+};
+
+struct PoolStates
+{
+    PoolState states[2];
+};
+
+Q_GLOBAL_STATIC(PoolStates, poolStates)
+
+// Written once by configureThreadPools before any task runs
+QVector<int> allowedCores;
+bool isRestrictCores = false;
+bool isPinThreads = false;
+qint64 configuredNanoseconds = 0;
+
+// Tasks show up in the trace, the perf counters and the allocation tracker under the name of their pool
+const char * const taskNames[] = { "ParsingPool task", "CorrelationPool task" };
+
+qint64 currentNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief detectAllowedCores - Returns the cores the process may run on. This respects taskset and cgroup cpusets
+ * @return List of core numbers
+ */
+QVector<int> detectAllowedCores() {
+    QVector<int> cores;
+    cpu_set_t cpuMask;
+    CPU_ZERO(&cpuMask);
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuMask) == 0) {
+        for (int core = 0; core < CPU_SETSIZE; core++) {
+            if (CPU_ISSET(core, &cpuMask)) {
+                cores.append(core);
+            }
+        }
+    }
+    return cores;
+}
+
+}
+
+
+/**
+ * @brief parseCpuSet - Parses a cpu set in taskset list notation, e.g. "0-7,16,18-19"
+ * @param cpuSet - Cpu set in list notation
+ * @return List of core numbers - empty if the set was empty or invalid
+ */
+QVector<int> parseCpuSet(QString cpuSet) {
+    QVector<int> cores;
+
+    for (QString range : cpuSet.split(',', QString::SkipEmptyParts)) {
+        QStringList bounds = range.trimmed().split('-');
+        bool isValidFirstCore = false, isValidLastCore = false;
+        int firstCore = bounds.first().toInt(&isValidFirstCore),
+            lastCore = bounds.last().toInt(&isValidLastCore);
+
+        if (bounds.length() > 2 || !isValidFirstCore || !isValidLastCore || firstCore < 0 || lastCore >= CPU_SETSIZE) {
+            qDebug() << "THREAD POOLS: Ignoring invalid cpu range" << range;
+            continue;
+        }
+
+        for (int core = firstCore; core <= lastCore; core++) {
+            cores.append(core);
+        }
+    }
+
+    return cores;
+}
+
+
+/**
+ * @brief configureThreadPools - Sizes the pools from the config file. Without configured sizes the parsing pool gets up to four threads
+ *        and the correlation pool one thread per core the process may run on.
+ * @param configFile - Config file containing pool sizes, cpu set and pinning
+ */
+void configureThreadPools(ConfigFile configFile) {
+    allowedCores = parseCpuSet(configFile.cpuSet);
+    isRestrictCores = !allowedCores.isEmpty();
+    isPinThreads = configFile.isPinThreads;
+
+    if (!isRestrictCores) {
+        allowedCores = detectAllowedCores();
+    }
+
+    int numberOfCores = allowedCores.isEmpty() ? QThread::idealThreadCount() : allowedCores.length();
+
+    int parsingThreadCount = configFile.parsingThreadCount > 0 ? configFile.parsingThreadCount : qBound(1, numberOfCores, 4),
+        correlationThreadCount = configFile.correlationThreadCount > 0 ? configFile.correlationThreadCount : qMax(1, numberOfCores);
+
+    poolStates->states[ParsingPool].threadPool.setMaxThreadCount(parsingThreadCount);
+    poolStates->states[CorrelationPool].threadPool.setMaxThreadCount(correlationThreadCount);
+
+    // Pinned pools get disjoint slices of the cores sized by their thread counts - shared out in proportion if there are more threads than cores,
+    // a single core is shared by both
+    if (isPinThreads && !allowedCores.isEmpty()) {
+        int numberOfThreads = parsingThreadCount + correlationThreadCount,
+            parsingCoreCount = numberOfThreads <= numberOfCores ? parsingThreadCount
+                                                                : qBound(1, int(qint64(numberOfCores) * parsingThreadCount / numberOfThreads), qMax(1, numberOfCores - 1)),
+            correlationCoreCount = qMin(correlationThreadCount, qMax(1, numberOfCores - parsingCoreCount));
+
+        poolStates->states[ParsingPool].pinnedCores = allowedCores.mid(0, parsingCoreCount);
+        poolStates->states[CorrelationPool].pinnedCores = numberOfCores > 1 ? allowedCores.mid(parsingCoreCount, correlationCoreCount) : allowedCores;
+
+        qDebug() << "Thread pools pinned: parsing to" << poolStates->states[ParsingPool].pinnedCores << "correlation to" << poolStates->states[CorrelationPool].pinnedCores;
+    }
+
+    configuredNanoseconds = currentNanoseconds();
+
+    qDebug() << "Thread pools: parsing" << parsingThreadCount << "threads, correlation" << correlationThreadCount << "threads on" << numberOfCores << "cores"
+             << (isPinThreads ? "(pinned)" : "");
+}
+
+
+/**
+ * @brief getThreadPool - Returns the pool of the given type
+ * @param poolType - One of ParsingPool or CorrelationPool
+ * @return The pool - owned by this namespace
+ */
+QThreadPool * getThreadPool(const PoolType poolType) {
+    return &poolStates->states[poolType].threadPool;
+}
+
+
+/**
+ * @brief getPoolUtilization - Returns the counters of the given pool
+ * @param poolType - One of ParsingPool or CorrelationPool
+ * @return Thread count, task counters and the share of the available thread time that was spent on tasks since the pools were configured
+ */
+PoolUtilization getPoolUtilization(const PoolType poolType) {
+    PoolState & poolState = poolStates->states[poolType];
+
+    PoolUtilization poolUtilization;
+    poolUtilization.maximumThreadCount = poolState.threadPool.maxThreadCount();
+    poolUtilization.activeTasks = poolState.activeTasks.load();
+    poolUtilization.finishedTasks = poolState.finishedTasks.load();
+    poolUtilization.busySeconds = poolState.busyNanoseconds.load() / 1e9;
+
+    double availableSeconds = (currentNanoseconds() - configuredNanoseconds) / 1e9 * poolUtilization.maximumThreadCount;
+    poolUtilization.utilization = availableSeconds > 0 ? poolUtilization.busySeconds / availableSeconds : 0;
+
+    return poolUtilization;
+}
+
+
+/**
+ * @brief TaskScope::TaskScope - Marks a task as running. The first task on a pool thread restricts the thread to the configured cores
+ *        or - if pinning is enabled - pins it to the next core of the slice of its pool
+ * @param poolType - Pool the task runs on
+ */
+TaskScope::TaskScope(const PoolType poolType)
+    : poolType {poolType}, startNanoseconds {currentNanoseconds()}, counterScope {taskNames[poolType]}, allocationTag {taskNames[poolType]}
+{
+    PoolState & poolState = poolStates->states[poolType];
+    poolState.activeTasks++;
+
+    // Pool threads only ever serve a single pool, so a thread local flag is enough
+    thread_local bool isThreadPlaced = false;
+
+    if (!isThreadPlaced && (isRestrictCores || isPinThreads) && !allowedCores.isEmpty()) {
+        cpu_set_t cpuMask;
+        CPU_ZERO(&cpuMask);
+
+        if (isPinThreads) {
+            CPU_SET(poolState.pinnedCores[poolState.nextCoreIndex++ % poolState.pinnedCores.length()], &cpuMask);
+        } else {
+            for (int core : allowedCores) {
+                CPU_SET(core, &cpuMask);
+            }
+        }
+
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuMask);
+        isThreadPlaced = true;
+    }
+}
+
+
+/**
+ * @brief TaskScope::~TaskScope - Marks the task as finished and accounts its run time - also in the trace, if tracing is enabled
+ */
+TaskScope::~TaskScope() {
+    PoolState & poolState = poolStates->states[this->poolType];
+    qint64 endNanoseconds = currentNanoseconds();
+
+    if (Trace::isEnabled()) {
+        Trace::recordEvent(taskNames[this->poolType], this->startNanoseconds, endNanoseconds);
+    }
+
+    poolState.busyNanoseconds += endNanoseconds - this->startNanoseconds;
+    poolState.finishedTasks++;
+    poolState.activeTasks--;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef THREADPOOLS_H
+#define THREADPOOLS_H
+
+#include <QFuture>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+#include "System/AllocationTracker.h"
+#include "System/ConfigFile.h"
+#include "System/PerfCounters.h"
+
+/**
+ * @brief The ThreadPools namespace owns the thread pools Badger runs its work on - one for I/O bound parsing, one for CPU bound correlation.
+ *        The pools are sized from the config file or the cores the process may run on, their threads can be pinned to single cores.
+ */
+namespace ThreadPools
+{
+    enum PoolType { ParsingPool = 0, CorrelationPool = 1 };
+
+    struct PoolUtilization
+    {
+        int maximumThreadCount;
+        int activeTasks;
+        qint64 finishedTasks;
+        double busySeconds;
+        double utilization;
+    };
+
+    /**
+     * @brief The TaskScope class accounts a running task for the utilization counters and pins its thread on first use.
+     *        If enabled, the hardware counters and the allocations of the task are added to the stage of its pool
+     */
+    class TaskScope
+    {
+    private:
+        PoolType poolType;
+        qint64 startNanoseconds;
+        PerfCounters::CounterScope counterScope;
+        AllocationTracker::StageTag allocationTag;
+
+    public:
+        TaskScope(const PoolType poolType);
+        ~TaskScope();
+    };
+
+    extern void configureThreadPools(ConfigFile configFile);
+    extern QVector<int> parseCpuSet(QString cpuSet);
+    extern QThreadPool * getThreadPool(const PoolType poolType);
+    extern PoolUtilization getPoolUtilization(const PoolType poolType);
+
+    /**
+     * @brief run - Runs the given function on the given pool
+     * @param poolType - Pool that should run the function
+     * @param function - Function without arguments - bind them with a lambda
+     * @return Future of the function result
+     */
+    template <typename Function>
+    auto run(const PoolType poolType, Function function) -> QFuture<decltype(function())> {
+        return QtConcurrent::run(getThreadPool(poolType), [poolType, function]() {
+            TaskScope taskScope(poolType);
+            return function();
+        });
+    }
+};
+
+#endif // THREADPOOLS_H
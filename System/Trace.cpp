@@ -0,0 +1,320 @@
+#include "Trace.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace Trace {
+
+std::atomic<bool> isTracing {false};
+
+namespace {
+
+struct TraceEvent
+{
+    const char * name;
+    qint64 startNanoseconds;
+    qint64 durationNanoseconds;
+};
+
+// Events are stored in chunks that are never moved, so the writer can read them while the thread goes on recording
+const int eventsPerChunk = 4096;
+
+struct EventChunk
+{
+    TraceEvent events[eventsPerChunk];
+    std::atomic<EventChunk *> nextChunk {nullptr};
+};
+
+/**
+ * @brief The ThreadBuffer struct holds the events of a single thread. Only the owning thread appends, it publishes every event
+ *        by a release store of the number of events - the writer reads up to that number
+ */
+struct ThreadBuffer
+{
+    qint64 threadID;
+    QByteArray threadName;
+    EventChunk * firstChunk;
+    // Chunk the next event goes to - only used by the owning thread
+    EventChunk * currentChunk;
+    std::atomic<qint64> numberOfEvents {0};
+};
+
+/**
+ * @brief The Registry struct knows the buffer of every thread that has recorded an event. Buffers live until the process ends,
+ *        so the events of finished threads are still written
+ */
+struct Registry
+{
+    QMutex mutex;
+    std::vector<ThreadBuffer *> threadBuffers;
+    QString traceFilePath;
+    QStringList mergedTraceFilePaths;
+    qint64 startNanoseconds = 0;
+};
+
+// Never destroyed, pool threads may still record while static objects are torn down
+Registry & getRegistry() {
+    static Registry * registry = new Registry();
+    return *registry;
+}
+
+thread_local ThreadBuffer * threadBuffer = nullptr;
+
+qint64 getThreadID() {
+    return qint64(syscall(SYS_gettid));
+}
+
+/**
+ * @brief registerThread - Creates and registers the buffer of the calling thread
+ * @return Buffer of the calling thread
+ */
+ThreadBuffer * registerThread() {
+    ThreadBuffer * newThreadBuffer = new ThreadBuffer();
+    newThreadBuffer->threadID = getThreadID();
+    newThreadBuffer->firstChunk = new EventChunk();
+    newThreadBuffer->currentChunk = newThreadBuffer->firstChunk;
+
+    char threadName[64] = { 0 };
+    if (pthread_getname_np(pthread_self(), threadName, sizeof(threadName)) == 0) {
+        newThreadBuffer->threadName = QByteArray(threadName);
+    }
+
+    Registry & registry = getRegistry();
+    QMutexLocker locker(&registry.mutex);
+    registry.threadBuffers.push_back(newThreadBuffer);
+
+    return newThreadBuffer;
+}
+
+/**
+ * @brief escapeJson - Escapes quotes and backslashes of names that end up in JSON strings
+ */
+QByteArray escapeJson(QByteArray text) {
+    return text.replace('\\', "\\\\").replace('"', "\\\"");
+}
+
+}
+
+
+/**
+ * @brief currentNanoseconds - Clock of the trace, the same monotonic clock the thread pools account their tasks with
+ * @return Nanoseconds since an arbitrary point in time
+ */
+qint64 currentNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * @brief recordEvent - Appends a finished event to the buffer of the calling thread
+ * @param name - Name of the event - must outlive the trace, e.g. a string literal
+ * @param startNanoseconds - Start of the event
+ * @param endNanoseconds - End of the event
+ */
+void recordEvent(const char * name, const qint64 startNanoseconds, const qint64 endNanoseconds) {
+    if (threadBuffer == nullptr) {
+        threadBuffer = registerThread();
+    }
+
+    qint64 eventIndex = threadBuffer->numberOfEvents.load(std::memory_order_relaxed);
+    int chunkPosition = int(eventIndex % eventsPerChunk);
+
+    // Continue in the next chunk - chunks that are left over from before a reset are reused
+    if (chunkPosition == 0 && eventIndex > 0) {
+        EventChunk * nextChunk = threadBuffer->currentChunk->nextChunk.load(std::memory_order_relaxed);
+
+        if (nextChunk == nullptr) {
+            nextChunk = new EventChunk();
+            threadBuffer->currentChunk->nextChunk.store(nextChunk, std::memory_order_release);
+        }
+        threadBuffer->currentChunk = nextChunk;
+    }
+
+    threadBuffer->currentChunk->events[chunkPosition] = { name, startNanoseconds, endNanoseconds - startNanoseconds };
+    threadBuffer->numberOfEvents.store(eventIndex + 1, std::memory_order_release);
+}
+
+
+/**
+ * @brief startTracing - Starts recording trace events
+ * @param traceFilePath - File writeTrace writes the trace to
+ */
+void startTracing(const QString traceFilePath) {
+    Registry & registry = getRegistry();
+
+    {
+        QMutexLocker locker(&registry.mutex);
+        registry.traceFilePath = traceFilePath;
+        registry.startNanoseconds = currentNanoseconds();
+    }
+
+    isTracing.store(true);
+}
+
+
+/**
+ * @brief getTraceFilePath - Returns the file the trace is written to
+ * @return File path - empty if tracing has not been started
+ */
+QString getTraceFilePath() {
+    Registry & registry = getRegistry();
+    QMutexLocker locker(&registry.mutex);
+
+    return registry.traceFilePath;
+}
+
+
+/**
+ * @brief getProcessTraceFilePath - Returns the file a forked process writes its own trace to
+ * @param processID - ID of the forked process
+ * @return File path next to the trace file
+ */
+QString getProcessTraceFilePath(const qint64 processID) {
+    return getTraceFilePath() + "." + QString::number(processID);
+}
+
+
+/**
+ * @brief addMergedTraceFile - Registers the trace of another process whose events are merged into the trace by writeTrace.
+ *        The file is removed after merging, files that do not exist (e.g. of crashed processes) are skipped
+ * @param traceFilePath - Trace written by the other process
+ */
+void addMergedTraceFile(const QString traceFilePath) {
+    Registry & registry = getRegistry();
+    QMutexLocker locker(&registry.mutex);
+
+    registry.mergedTraceFilePaths.append(traceFilePath);
+}
+
+
+/**
+ * @brief resetAfterFork - Drops the events inherited from the parent process and takes over the buffer of the calling thread,
+ *        which is the only thread of a forked process
+ */
+void resetAfterFork() {
+    // Processes are forked before any other thread exists, so the mutex cannot be held by a thread that is gone now
+    Registry & registry = getRegistry();
+    QMutexLocker locker(&registry.mutex);
+
+    registry.mergedTraceFilePaths.clear();
+
+    for (ThreadBuffer * registeredThreadBuffer : registry.threadBuffers) {
+        registeredThreadBuffer->numberOfEvents.store(0);
+        registeredThreadBuffer->currentChunk = registeredThreadBuffer->firstChunk;
+    }
+
+    if (threadBuffer != nullptr) {
+        threadBuffer->threadID = getThreadID();
+    }
+}
+
+
+/**
+ * @brief writeTrace - Writes the trace to the file given on start and merges the traces of other processes into it
+ * @return True if tracing is disabled or the trace has been written
+ */
+bool writeTrace() {
+    if (!isEnabled()) {
+        return true;
+    }
+
+    return writeTrace(getTraceFilePath());
+}
+
+
+/**
+ * @brief writeTrace - Writes every event recorded so far as Chrome trace event JSON. Threads may go on recording meanwhile,
+ *        their later events are simply not part of this trace
+ * @param traceFilePath - Destination of the trace
+ * @return True if the trace has been written
+ */
+bool writeTrace(const QString traceFilePath) {
+    Registry & registry = getRegistry();
+    QMutexLocker locker(&registry.mutex);
+
+    QByteArray processID = QByteArray::number(qint64(getpid()));
+    QByteArray trace("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool isFirstEvent = true;
+
+    auto appendEvent = [&](const QByteArray & event) {
+        if (!isFirstEvent) {
+            trace.append(",\n");
+        }
+        trace.append(event);
+        isFirstEvent = false;
+    };
+
+    for (ThreadBuffer * registeredThreadBuffer : registry.threadBuffers) {
+        qint64 numberOfEvents = registeredThreadBuffer->numberOfEvents.load(std::memory_order_acquire);
+        QByteArray threadID = QByteArray::number(registeredThreadBuffer->threadID);
+
+        if (numberOfEvents == 0) {
+            continue;
+        }
+
+        if (!registeredThreadBuffer->threadName.isEmpty()) {
+            appendEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + processID + ",\"tid\":" + threadID
+                        + ",\"args\":{\"name\":\"" + escapeJson(registeredThreadBuffer->threadName) + "\"}}");
+        }
+
+        EventChunk * chunk = registeredThreadBuffer->firstChunk;
+        for (qint64 i = 0; i < numberOfEvents; i++) {
+            if (i > 0 && i % eventsPerChunk == 0) {
+                chunk = chunk->nextChunk.load(std::memory_order_acquire);
+            }
+
+            const TraceEvent & event = chunk->events[i % eventsPerChunk];
+            appendEvent("{\"name\":\"" + escapeJson(event.name) + "\",\"cat\":\"badger\",\"ph\":\"X\",\"pid\":" + processID + ",\"tid\":" + threadID
+                        + ",\"ts\":" + QByteArray::number((event.startNanoseconds - registry.startNanoseconds) / 1000.0, 'f', 3)
+                        + ",\"dur\":" + QByteArray::number(event.durationNanoseconds / 1000.0, 'f', 3) + "}");
+        }
+    }
+
+    // Events of other processes, e.g. batch workers - they started from the same clock, so they line up with the events of this process
+    for (const QString & mergedTraceFilePath : registry.mergedTraceFilePaths) {
+        QFile mergedTraceFile(mergedTraceFilePath);
+
+        if (!mergedTraceFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        for (const QJsonValue & event : QJsonDocument::fromJson(mergedTraceFile.readAll()).object().value("traceEvents").toArray()) {
+            appendEvent(QJsonDocument(event.toObject()).toJson(QJsonDocument::Compact));
+        }
+
+        mergedTraceFile.remove();
+    }
+    registry.mergedTraceFilePaths.clear();
+
+    trace.append("\n]}\n");
+
+    QSaveFile traceFile(traceFilePath);
+
+    if (!traceFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "TRACE:" << traceFilePath << "-" << traceFile.errorString();
+        return false;
+    }
+
+    traceFile.write(trace);
+    return traceFile.commit();
+}
+
+}
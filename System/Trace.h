@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <atomic>
+
+/**
+ * @brief The Trace namespace records where the time of a run goes and writes it as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+ *        Stages are marked with TRACE_SCOPE, which records name, thread, start and duration into a buffer owned by the recording thread -
+ *        recording takes no lock. While tracing is disabled a scope costs a single relaxed atomic load.
+ */
+namespace Trace
+{
+    extern std::atomic<bool> isTracing;
+
+    inline bool isEnabled() {
+        return isTracing.load(std::memory_order_relaxed);
+    }
+
+    extern qint64 currentNanoseconds();
+    extern void recordEvent(const char * name, const qint64 startNanoseconds, const qint64 endNanoseconds);
+
+    extern void startTracing(const QString traceFilePath);
+    extern QString getTraceFilePath();
+    extern QString getProcessTraceFilePath(const qint64 processID);
+    extern void addMergedTraceFile(const QString traceFilePath);
+    extern void resetAfterFork();
+
+    extern bool writeTrace();
+    extern bool writeTrace(const QString traceFilePath);
+
+    /**
+     * @brief The TraceScope class records the time from its construction to its destruction as a trace event
+     */
+    class TraceScope
+    {
+    private:
+        // Null if tracing was disabled when the scope started
+        const char * name;
+        qint64 startNanoseconds;
+
+    public:
+        /**
+         * @brief TraceScope::TraceScope
+         * @param name - Name of the stage - must be a string literal, only the pointer is stored
+         */
+        TraceScope(const char * name)
+            : name {isEnabled() ? name : nullptr}, startNanoseconds {this->name ? currentNanoseconds() : 0}
+        {}
+
+        ~TraceScope() {
+            if (this->name) {
+                recordEvent(this->name, this->startNanoseconds, currentNanoseconds());
+            }
+        }
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope & operator=(const TraceScope &) = delete;
+    };
+};
+
+#define TRACE_SCOPE_CONCATENATE(prefix, line) prefix##line
+#define TRACE_SCOPE_VARIABLE(line) TRACE_SCOPE_CONCATENATE(traceScope, line)
+
+// Records the rest of the enclosing block as a trace event with the given name
+#define TRACE_SCOPE(name) Trace::TraceScope TRACE_SCOPE_VARIABLE(__LINE__)(name)
+
+#endif // TRACE_H
@@ -2,16 +2,44 @@
 #include <QDebug>
 #include <QString>
 #include <QStringList>
+#include <QtConcurrent/QtConcurrent>
 
 #include "TabWidget.h"
 #include "ui_TabWidget.h"
 #include "BioModels/FeatureCollection.h"
+#include "BioModels/ExpressionMatrix.h"
+#include "Graphics/ExpressionHeatmap.h"
+#include "System/Trace.h"
 
 TabWidget::TabWidget(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::TabWidget)
+    ui(new Ui::TabWidget),
+    isHeatmapPopulated {false},
+    isGeneSearchDeferred {false}
 {
     ui->setupUi(this);
+
+    // The view shows the expression table through the filter - rows are hidden by a mask instead of one by one
+    this->geneFilterProxyModel.setSourceModel(&this->geneExpressionTableModel);
+    this->ui->tableViewGeneExpressions->setModel(&this->geneFilterProxyModel);
+
+    // Clicking a cluster header sorts by its expression counts - the table starts in its original order
+    this->ui->tableViewGeneExpressions->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    this->ui->tableViewGeneExpressions->setSortingEnabled(true);
+
+    // An empty index until the table is populated
+    this->geneSearchIndexWatcher.setFuture(QtConcurrent::run([]() {
+        return QSharedPointer<const GeneSearchIndex>(new GeneSearchIndex());
+    }));
+    QObject::connect(&this->geneSearchIndexWatcher, &QFutureWatcherBase::finished, this, &TabWidget::startDeferredGeneSearch);
+
+    this->searchDebounceTimer.setSingleShot(true);
+    this->searchDebounceTimer.setInterval(150);
+    QObject::connect(&this->searchDebounceTimer, &QTimer::timeout, this, &TabWidget::startGeneSearch);
+    QObject::connect(&this->geneSearchWatcher, &QFutureWatcherBase::finished, this, &TabWidget::applyGeneSearchResult);
+
+    // Fixed row heights keep the view from measuring every one of the (possibly tens of thousands) rows
+    this->ui->tableViewGeneExpressions->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
 }
 
 TabWidget::~TabWidget()
@@ -24,7 +52,9 @@ TabWidget::~TabWidget()
  * @param correlations - List of clusters with corresponding type corrlations - sorted.
  * @param numberOfItems - Number of items that should be shown in the table.
  */
-void TabWidget::populateTableTypeCorrelations(QVector<QVector<QPair<QString, double>>> correlations, int numberOfItems) {
+void TabWidget::populateTableTypeCorrelations(const QVector<QVector<QPair<QString, double>>> & correlations, int numberOfItems) {
+    TRACE_SCOPE("TabWidget::populateTableTypeCorrelations");
+
     int numberOfClusters = correlations.length();
 
     this->ui->tableWidgetTypeCorrelations->setColumnCount(numberOfClusters);
@@ -42,7 +72,7 @@ void TabWidget::populateTableTypeCorrelations(QVector<QVector<QPair<QString, dou
     // Go through the top n of every cluster and populate the table with it
     for (int i = 0; i < correlations.length(); i++) {
         for (int j = 0; j < numberOfClusters; j++) {
-            QPair<QString, double> type = correlations[i][j];
+            const QPair<QString, double> & type = correlations[i][j];
             QString cell = QString::number(type.second) + ": " + type.first;
 
             // A TableWidgetItem is needed for every cell
@@ -58,113 +88,114 @@ void TabWidget::populateTableTypeCorrelations(QVector<QVector<QPair<QString, dou
 
 
 /**
- * @brief TabWidget::populateTableGeneExpressions - Populates the gene expression table with the gene expression counts
- * * @param geneExpressions - list of clusters with corresponding gene expression counts - unsorted.
+ * @brief TabWidget::populateTableGeneExpressions - Populates the gene expression table with the gene expression counts.
+ *        The table view reads from the expression matrix on demand - no item is created per cell
+ * @param expressionMatrix - Expression counts of the dataset, either built from its clusters or mapped from a project file
  */
-void TabWidget::populateTableGeneExpressions(QVector<FeatureCollection> geneExpressions, QStringList completeGeneIDs) {
-    int numberOfClusters = geneExpressions.length();
-    int numberOfGeneIDs = completeGeneIDs.length();
+void TabWidget::populateTableGeneExpressions(const ExpressionMatrix & expressionMatrix) {
+    TRACE_SCOPE("TabWidget::populateTableGeneExpressions");
 
-    // Resize the table according to the given number of clusters and gene IDs
-    this->ui->tableWidgetGeneExpressions->setColumnCount(numberOfClusters);
-    this->ui->tableWidgetGeneExpressions->setRowCount(numberOfGeneIDs);
+    QStringList completeGeneIDs = expressionMatrix.getGeneIDs();
 
-    // Create header with cluster numbers
-    QStringList clusterNameHeaderItems;
-    for (int i = 1; i < numberOfClusters + 1; i++) {
-        clusterNameHeaderItems.append("Cluster " + QString::number(i));
-    }
+    this->geneExpressionTableModel.setExpressionMatrix(expressionMatrix);
+    this->isHeatmapPopulated = false;
 
-    // Add the headers to the table
-    this->ui->tableWidgetGeneExpressions->setHorizontalHeaderLabels(clusterNameHeaderItems);
-    this->ui->tableWidgetGeneExpressions->setVerticalHeaderLabels(completeGeneIDs);
+    // The search index is built in the background, searches that start before it is finished are deferred until it is
+    this->geneSearchIndexWatcher.setFuture(QtConcurrent::run([completeGeneIDs]() {
+        return QSharedPointer<const GeneSearchIndex>(new GeneSearchIndex(completeGeneIDs));
+    }));
 
-    // Go through the list of all gathered gene IDs
-    // REMEMBER: UAGH 3 for loops
-    for (int i = 0; i < numberOfGeneIDs; i++) {
-        QString currentHeaderGeneID = completeGeneIDs[i];
-
-        // And go through every cluster and check whether the gene is expressed or not
-        for (int j = 0; j < numberOfClusters; j++) {
-            bool isGeneExpressed = false;
-
-            // Search for the current gene ID in the cluster -> Only contains IDs of expressed genes
-            for (int k = 0; k < geneExpressions[j].getNumberOfFeatures(); k++) {
-                QString currentClusterGeneID = geneExpressions[j].getFeature(k).ID;
-                bool isSameString = currentHeaderGeneID.compare(currentClusterGeneID) == 0;
-
-                // If the ID has been found (which means it is expressed in the cluster)
-                if (isSameString) {
-                    isGeneExpressed = true;
-                    double geneExpressionCount = geneExpressions[j].getFeatureExpressionCount(k);
-
-                    // Add a new TableWidgetItem to the corresponding cell containing the gene expression count
-                    QTableWidgetItem * tableWidgetItem = new QTableWidgetItem(0);
-                    tableWidgetItem->setData(Qt::DisplayRole, geneExpressionCount);
-
-                    this->ui->tableWidgetGeneExpressions->setItem(i, j, tableWidgetItem);
-                }
-            }
+    this->ui->tableViewGeneExpressions->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+}
 
-            // If the gene is not found (which means its not expressed in the cluster), add a placeholder to the cell
-            if (!isGeneExpressed) {
-                QTableWidgetItem * tableWidgetItem = new QTableWidgetItem(0);
-                tableWidgetItem->setData(Qt::DisplayRole, "< 1");
 
-                this->ui->tableWidgetGeneExpressions->setItem(i, j, tableWidgetItem);
-            }
-        }
+/**
+ * @brief TabWidget::on_pushButtonHeatmap_toggled - Switches between the gene expression table and the heatmap. The heatmap reads the same
+ *        expression matrix as the table and is only built the first time it is shown
+ * @param isChecked - True if the heatmap should be shown
+ */
+void TabWidget::on_pushButtonHeatmap_toggled(bool isChecked) {
+    if (isChecked && !this->isHeatmapPopulated) {
+        this->ui->heatmapGeneExpressions->setExpressionMatrix(this->geneExpressionTableModel.getExpressionMatrix());
+        this->isHeatmapPopulated = true;
     }
 
-    this->ui->tableWidgetGeneExpressions->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    this->ui->heatmapGeneExpressions->setVisible(isChecked);
+    this->ui->comboBoxHeatmapPooling->setVisible(isChecked);
+    this->ui->tableViewGeneExpressions->setVisible(!isChecked);
+    this->ui->lineEditGeneID->setEnabled(!isChecked);
 }
 
 
-#include <iostream>
+/**
+ * @brief TabWidget::on_comboBoxHeatmapPooling_currentIndexChanged - Switches the heatmap between max and mean pooling of zoomed out genes
+ * @param index - Index of the pooling mode - matches ExpressionHeatmap::PoolingMode
+ */
+void TabWidget::on_comboBoxHeatmapPooling_currentIndexChanged(int index) {
+    this->ui->heatmapGeneExpressions->setPoolingMode(ExpressionHeatmap::PoolingMode(index));
+}
+
 
 /**
- * @brief TabWidget::on_lineEditGeneID_textEdited - When the line edit text has been edited the corresponding table is filtered according to the line edit content
+ * @brief TabWidget::on_lineEditGeneID_textEdited - When the line edit text has been edited the search is (re)scheduled. Queries are debounced,
+ *        so fast typing only searches once the user pauses
  * @param lineEditContent - The string that is currently written in the line edit - Used to filter the table
  */
 void TabWidget::on_lineEditGeneID_textChanged(const QString & lineEditContent) {
-    // Reset the previously hidden rows
-    for (int i = 0; i < this->ui->tableWidgetGeneExpressions->rowCount(); i++) {
-        this->ui->tableWidgetGeneExpressions->setRowHidden(i, false);
-    }
+    Q_UNUSED(lineEditContent)
 
-    // Read search string from line edit
-    QString searchString = lineEditContent.toLower();
+    this->searchDebounceTimer.start();
+}
 
-    // In case the user deleted the search string, just unhide the rows and return
-    if (searchString == " ") {
+
+/**
+ * @brief TabWidget::startGeneSearch - Searches the comma separated gene IDs of the line edit in the gene search index on a worker thread.
+ *        A newer search replaces the running one on the watcher, so outdated results are never applied.
+ *        While the index is still being built the search is deferred - the GUI thread never waits for it
+ */
+void TabWidget::startGeneSearch() {
+    if (!this->geneSearchIndexWatcher.isFinished()) {
+        this->isGeneSearchDeferred = true;
         return;
     }
 
-    QStringList searchStrings = searchString.split(",");
+    QStringList searchStrings = this->ui->lineEditGeneID->text().split(",");
+    QSharedPointer<const GeneSearchIndex> geneSearchIndex = this->geneSearchIndexWatcher.result();
 
-    // Filter list of gene IDs for search string and hide rows that don't contain it
-    for (int i = 0; i < this->ui->tableWidgetGeneExpressions->rowCount(); i++) {
-        bool isContainsAtLeastOneSearchString = false;
-        for (QString string : searchStrings) {
-            if (this->ui->tableWidgetGeneExpressions->verticalHeaderItem(i)->text().toLower().contains(string)) {
-                isContainsAtLeastOneSearchString = true;
-            }
-        }
-        if (!isContainsAtLeastOneSearchString) {
-            this->ui->tableWidgetGeneExpressions->setRowHidden(i, true);
-        }
+    this->geneSearchWatcher.setFuture(QtConcurrent::run([geneSearchIndex, searchStrings]() {
+        return geneSearchIndex->findMatchingGenes(searchStrings);
+    }));
+}
+
+
+/**
+ * @brief TabWidget::startDeferredGeneSearch - Starts the search that was requested while the index was being built
+ */
+void TabWidget::startDeferredGeneSearch() {
+    if (this->isGeneSearchDeferred) {
+        this->isGeneSearchDeferred = false;
+        this->startGeneSearch();
     }
+}
+
 
+/**
+ * @brief TabWidget::applyGeneSearchResult - Applies the result of the search as row mask to the gene expression table
+ */
+void TabWidget::applyGeneSearchResult() {
+    this->geneFilterProxyModel.setRowMask(this->geneSearchWatcher.result());
 }
 
 /**
- * @brief TabWidget::on_tableWidgetGeneExpressions_cellDoubleClicked - Adds the gene ID (header item) for the clicked item to the list of selected IDs - handles duplicates and autocomplete
- * @param row - Index of row that was clicked - used to get the corresponding header item (gene ID)
- * @param column - Unused
+ * @brief TabWidget::on_tableViewGeneExpressions_doubleClicked - Adds the gene ID (header item) for the clicked item to the list of selected IDs - handles duplicates and autocomplete
+ * @param index - Cell that was clicked - its row is used to get the corresponding gene ID
  */
-void TabWidget::on_tableWidgetGeneExpressions_cellDoubleClicked(int row, int column) {
+void TabWidget::on_tableViewGeneExpressions_doubleClicked(const QModelIndex & index) {
+    // The view shows the filtered and sorted rows, the gene index refers to the expression matrix
+    int geneIndex = this->geneExpressionTableModel.getGeneIndex(this->geneFilterProxyModel.mapToSource(index).row());
+
     QString currentLineEditText = this->ui->lineEditGeneID->text(),
-            headerItemForSelectedRow = this->ui->tableWidgetGeneExpressions->verticalHeaderItem(row)->text().toLower(),
+            headerItemForSelectedRow = this->geneExpressionTableModel.getExpressionMatrix().getGeneID(geneIndex).toLower(),
             newLineEditText;
 
     QStringList currentGeneIDs = currentLineEditText.split(",");
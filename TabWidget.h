@@ -8,8 +8,17 @@
 #include <QTableWidgetItem>
 #include <QStringList>
 #include <QObject>
+#include <QModelIndex>
+#include <QTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QBitArray>
+#include <QSharedPointer>
 
 #include "BioModels/FeatureCollection.h"
+#include "GeneExpressionTableModel.h"
+#include "GeneFilterProxyModel.h"
+#include "Utils/GeneSearchIndex.h"
 
 namespace Ui {
 class TabWidget;
@@ -23,17 +32,36 @@ public:
     explicit TabWidget(QWidget *parent = nullptr);
     ~TabWidget();
 
-    void populateTableTypeCorrelations(QVector<QVector<QPair<QString, double>>> correlations, int numberOfItems);
+    void populateTableTypeCorrelations(const QVector<QVector<QPair<QString, double>>> & correlations, int numberOfItems);
 
-    void populateTableGeneExpressions(QVector<FeatureCollection> geneExpressions, QStringList completeGeneIDs);
+    void populateTableGeneExpressions(const ExpressionMatrix & expressionMatrix);
 
 private slots:
     void on_lineEditGeneID_textChanged(const QString &arg1);
 
-    void on_tableWidgetGeneExpressions_cellDoubleClicked(int row, int column);
+    void on_tableViewGeneExpressions_doubleClicked(const QModelIndex & index);
+
+    void on_pushButtonHeatmap_toggled(bool isChecked);
+
+    void on_comboBoxHeatmapPooling_currentIndexChanged(int index);
+
+    void startGeneSearch();
+
+    void startDeferredGeneSearch();
+
+    void applyGeneSearchResult();
 
 private:
     Ui::TabWidget *ui;
+    GeneExpressionTableModel geneExpressionTableModel;
+    GeneFilterProxyModel geneFilterProxyModel;
+    bool isHeatmapPopulated;
+
+    // Searches are deferred while the index is being built and started once it is finished
+    QFutureWatcher<QSharedPointer<const GeneSearchIndex>> geneSearchIndexWatcher;
+    bool isGeneSearchDeferred;
+    QTimer searchDebounceTimer;
+    QFutureWatcher<QBitArray> geneSearchWatcher;
 };
 
 #endif // TABWIDGET_H
@@ -0,0 +1,498 @@
+#include "DatasetGenerator.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace DatasetGenerator {
+
+/**
+ * @brief getProfileName - Returns the name of a reference profile as it is written to the reference and ground truth files
+ * @param profileIndex - Index of the profile
+ * @return Name of the profile
+ */
+QByteArray getProfileName(int profileIndex) {
+    return "Profile " + QByteArray::number(profileIndex + 1);
+}
+
+namespace {
+
+// Markers of a profile are kept as min-heap of (enrichment, gene index), so the least enriched one is replaced first
+typedef QPair<double, int> MarkerCandidate;
+
+/**
+ * @brief drawBaseExpression - Draws the expression of a gene relative to the scale of the counts
+ * @param generator - Generator of the gene
+ * @param parameters - Distribution and its spread
+ * @return Relative expression - median 1 for log-normal, mean 1 for gamma distributed expressions
+ */
+double drawBaseExpression(std::mt19937 & generator, const GeneratorParameters & parameters) {
+    if (parameters.distribution == GammaDistribution) {
+        double shape = 1 / (parameters.spread * parameters.spread);
+        std::gamma_distribution<double> gammaDistribution(shape, 1 / shape);
+        return gammaDistribution(generator);
+    }
+
+    std::lognormal_distribution<double> logNormalDistribution(0, parameters.spread);
+    return logNormalDistribution(generator);
+}
+
+/**
+ * @brief drawProfileCounts - Draws the base expression of a gene and its count in every reference profile
+ * @param generator - Generator of the gene, seeded with the seed and the index of the gene
+ * @param standardNormalDistribution - Distribution of the profile factors - its spare value is dropped first
+ * @param parameters - Distribution, sparsity and scale of the reference
+ * @param profileCounts - Filled with the count of the gene in every profile
+ * @param profileFactors - Filled with the factor of every profile - 0 for profiles that do not express the gene
+ */
+void drawProfileCounts(std::mt19937 & generator, std::normal_distribution<double> & standardNormalDistribution, const GeneratorParameters & parameters,
+                       QVector<double> & profileCounts, QVector<double> & profileFactors) {
+    std::uniform_real_distribution<double> uniformDistribution(0, 1);
+
+    // The normal distribution keeps a spare value - it must not leak into the next gene
+    standardNormalDistribution.reset();
+
+    double baseExpression = drawBaseExpression(generator, parameters);
+
+    for (int i = 0; i < parameters.numberOfProfiles; i++) {
+        double profileFactor = std::exp(parameters.profileSpread * standardNormalDistribution(generator));
+        bool isExpressed = uniformDistribution(generator) >= parameters.referenceSparsity;
+
+        profileCounts[i] = isExpressed ? parameters.referenceScale * baseExpression * profileFactor : 0;
+        profileFactors[i] = isExpressed ? profileFactor : 0;
+    }
+}
+
+
+/**
+ * @brief hasValidParameters - Checks sizes, sparsities and distributions of the parameters
+ * @param parameters - Parameters to check
+ * @return True if files can be generated from the parameters
+ */
+bool hasValidParameters(const GeneratorParameters & parameters) {
+    bool isValidSize = parameters.numberOfGenes > 0 && parameters.numberOfClusters > 0 && parameters.numberOfProfiles > 0 && parameters.numberOfMarkersPerProfile >= 0
+                       && parameters.numberOfCells >= 0 && parameters.countsPerCell > 0;
+    bool isValidSparsity = parameters.clusterSparsity >= 0 && parameters.clusterSparsity < 1 && parameters.referenceSparsity >= 0 && parameters.referenceSparsity < 1;
+    bool isValidDistribution = parameters.clusterScale > 0 && parameters.referenceScale > 0 && parameters.spread > 0
+                               && parameters.profileSpread >= 0 && parameters.clusterNoise >= 0;
+
+    if (!isValidSize || !isValidSparsity || !isValidDistribution) {
+        qDebug() << "DATASET GENERATOR: Invalid parameters.";
+        return false;
+    }
+    return true;
+}
+
+
+QByteArray getGeneID(int geneIndex) {
+    return QString("ENSG%1").arg(geneIndex, 11, 10, QChar('0')).toUtf8();
+}
+
+QByteArray getGeneName(int geneIndex) {
+    return "GENE" + QByteArray::number(geneIndex + 1);
+}
+
+/**
+ * @brief openOutputFile - Opens a file of the output directory for writing
+ * @param file - File with the path already set
+ * @return True if the file is open
+ */
+bool openOutputFile(QFile & file) {
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "DATASET GENERATOR:" << file.fileName() << "-" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief closeOutputFile - Flushes and closes a written file
+ * @param file - Open file
+ * @return True if every write succeeded
+ */
+bool closeOutputFile(QFile & file) {
+    file.flush();
+
+    bool isWritten = file.error() == QFileDevice::NoError;
+    if (!isWritten) {
+        qDebug() << "DATASET GENERATOR:" << file.fileName() << "-" << file.errorString();
+    }
+
+    file.close();
+    return isWritten;
+}
+
+
+/**
+ * @brief writeCellFiles - Writes the cells as uncompressed feature-barcode matrix directory and the profile every cell was drawn from
+ * @param sparseMatrix - Cells as sampled by generateCells into an empty dictionary, so its rows are the genes in the order of their index
+ * @param cellProfiles - Profile of every cell
+ * @param outputDirectory - Directory the matrix directory and the ground truth of the cells are written to
+ * @return True if every file has been written
+ */
+bool writeCellFiles(const SparseMatrix & sparseMatrix, const QVector<int> & cellProfiles, const QDir & outputDirectory) {
+    QDir matrixDirectory(outputDirectory.filePath(cellMatrixDirectoryName));
+    if (!matrixDirectory.mkpath(".")) {
+        qDebug() << "DATASET GENERATOR: Could not create output directory" << matrixDirectory.path();
+        return false;
+    }
+
+    QFile matrixFile(matrixDirectory.filePath("matrix.mtx")),
+          featuresFile(matrixDirectory.filePath("features.tsv")),
+          barcodesFile(matrixDirectory.filePath("barcodes.tsv")),
+          cellGroundTruthFile(outputDirectory.filePath(cellGroundTruthFileName));
+
+    if (!openOutputFile(matrixFile) || !openOutputFile(featuresFile) || !openOutputFile(barcodesFile) || !openOutputFile(cellGroundTruthFile)) {
+        return false;
+    }
+
+    const QStringList & geneNames = sparseMatrix.getGeneIDs();
+    for (int gene = 0; gene < geneNames.length(); gene++) {
+        featuresFile.write(getGeneID(gene) + '\t' + geneNames[gene].toUtf8() + "\tGene Expression\n");
+    }
+
+    // Coordinates are one based, the lines are written in large pieces
+    QByteArray lines = "%%MatrixMarket matrix coordinate integer general\n";
+    lines.append(QByteArray::number(sparseMatrix.getNumberOfGenes())).append(' ')
+         .append(QByteArray::number(sparseMatrix.getNumberOfCells())).append(' ')
+         .append(QByteArray::number(sparseMatrix.getNumberOfNonZeros())).append('\n');
+
+    const quint32 * geneIndices = sparseMatrix.getGeneIndices();
+    const float * values = sparseMatrix.getValues();
+
+    for (int c = 0; c < sparseMatrix.getNumberOfCells(); c++) {
+        QByteArray cellColumn = ' ' + QByteArray::number(c + 1) + ' ';
+
+        for (qint64 k = sparseMatrix.getColumnStart(c); k < sparseMatrix.getColumnEnd(c); k++) {
+            lines.append(QByteArray::number(geneIndices[k] + 1)).append(cellColumn).append(QByteArray::number(qint64(values[k]))).append('\n');
+        }
+
+        if (lines.size() > 1024 * 1024) {
+            matrixFile.write(lines);
+            lines.resize(0);
+        }
+    }
+    matrixFile.write(lines);
+
+    cellGroundTruthFile.write("Barcode\tProfile\n");
+    for (int c = 0; c < sparseMatrix.getNumberOfCells(); c++) {
+        QByteArray cellBarcode = sparseMatrix.getCellBarcodes()[c].toUtf8();
+
+        barcodesFile.write(cellBarcode + '\n');
+        cellGroundTruthFile.write(cellBarcode + '\t' + getProfileName(cellProfiles[c]) + '\n');
+    }
+
+    bool isMatrixWritten = closeOutputFile(matrixFile),
+         isFeaturesFileWritten = closeOutputFile(featuresFile),
+         isBarcodesFileWritten = closeOutputFile(barcodesFile),
+         isCellGroundTruthWritten = closeOutputFile(cellGroundTruthFile);
+
+    return isMatrixWritten && isFeaturesFileWritten && isBarcodesFileWritten && isCellGroundTruthWritten;
+}
+
+}
+
+
+/**
+ * @brief parseDistribution - Parses the name of an expression distribution
+ * @param distributionName - "lognormal" or "gamma"
+ * @param distribution - Set to the parsed distribution
+ * @return True if the name is known
+ */
+bool parseDistribution(QString distributionName, ExpressionDistribution & distribution) {
+    distributionName = distributionName.trimmed().toLower();
+
+    if (distributionName == "lognormal") {
+        distribution = LogNormalDistribution;
+    } else if (distributionName == "gamma") {
+        distribution = GammaDistribution;
+    } else {
+        qDebug() << "DATASET GENERATOR: Unknown distribution" << distributionName;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief generateFiles - Writes the dataset, reference, marker and ground truth file into the output directory.
+ *        Every profile scales the base expression of a gene by its own log-normal factor, every cluster scales the counts of its profile
+ *        by a further log-normal factor. Log2 fold changes are calculated against the mean of the other clusters, p values shrink with them.
+ *        The markers of a profile are the genes with the highest profile factor, the ground truth names the profile of every cluster.
+ *        If cells are requested they are sampled by generateCells and written as feature-barcode matrix with their own ground truth.
+ * @param parameters - Size, sparsity, distributions and seed
+ * @param outputDirectoryPath - Directory the files are written to - created if necessary
+ * @return True if every file has been written
+ */
+bool generateFiles(const GeneratorParameters & parameters, const QString outputDirectoryPath) {
+    int numberOfGenes = parameters.numberOfGenes,
+        numberOfClusters = parameters.numberOfClusters,
+        numberOfProfiles = parameters.numberOfProfiles,
+        numberOfMarkersPerProfile = parameters.numberOfMarkersPerProfile;
+
+    if (!hasValidParameters(parameters)) {
+        return false;
+    }
+
+    QDir outputDirectory(outputDirectoryPath);
+    if (!outputDirectory.mkpath(".")) {
+        qDebug() << "DATASET GENERATOR: Could not create output directory" << outputDirectoryPath;
+        return false;
+    }
+
+    QFile datasetFile(outputDirectory.filePath(datasetFileName)),
+          referenceFile(outputDirectory.filePath(referenceFileName)),
+          markerFile(outputDirectory.filePath(markerFileName)),
+          groundTruthFile(outputDirectory.filePath(groundTruthFileName));
+
+    if (!openOutputFile(datasetFile) || !openOutputFile(referenceFile) || !openOutputFile(markerFile) || !openOutputFile(groundTruthFile)) {
+        return false;
+    }
+
+    // Profile every cluster is drawn from
+    std::mt19937 clusterGenerator(parameters.seed);
+    std::uniform_int_distribution<int> profileDistribution(0, numberOfProfiles - 1);
+
+    QVector<int> clusterProfiles(numberOfClusters);
+    for (int i = 0; i < numberOfClusters; i++) {
+        clusterProfiles[i] = profileDistribution(clusterGenerator);
+    }
+
+    // Title lines - cellranger numbers its clusters from 1
+    QByteArray line("Feature ID,Feature Name");
+    for (int i = 0; i < numberOfClusters; i++) {
+        QByteArray clusterName = "Cluster " + QByteArray::number(i + 1);
+        line.append(',').append(clusterName).append(" Mean Counts")
+            .append(',').append(clusterName).append(" Log2 fold change")
+            .append(',').append(clusterName).append(" Adjusted p value");
+    }
+    datasetFile.write(line.append('\n'));
+
+    line = "Gene ID\tGene Name";
+    for (int i = 0; i < numberOfProfiles; i++) {
+        line.append('\t').append(getProfileName(i));
+    }
+    referenceFile.write(line.append('\n'));
+
+    QVector<std::vector<MarkerCandidate>> profileMarkers(numberOfProfiles);
+    QVector<double> profileCounts(numberOfProfiles),
+                    profileFactors(numberOfProfiles),
+                    clusterCounts(numberOfClusters);
+
+    std::normal_distribution<double> standardNormalDistribution(0, 1);
+    std::uniform_real_distribution<double> uniformDistribution(0, 1);
+
+    for (int gene = 0; gene < numberOfGenes; gene++) {
+        std::seed_seq geneSeed { parameters.seed, quint32(gene) };
+        std::mt19937 generator(geneSeed);
+
+        drawProfileCounts(generator, standardNormalDistribution, parameters, profileCounts, profileFactors);
+
+        for (int i = 0; i < numberOfProfiles; i++) {
+            double profileFactor = profileFactors[i];
+
+            if (profileFactor == 0 || numberOfMarkersPerProfile == 0) {
+                continue;
+            }
+
+            std::vector<MarkerCandidate> & markers = profileMarkers[i];
+            if (int(markers.size()) < numberOfMarkersPerProfile) {
+                markers.push_back(qMakePair(profileFactor, gene));
+                std::push_heap(markers.begin(), markers.end(), std::greater<MarkerCandidate>());
+            } else if (profileFactor > markers.front().first) {
+                std::pop_heap(markers.begin(), markers.end(), std::greater<MarkerCandidate>());
+                markers.back() = qMakePair(profileFactor, gene);
+                std::push_heap(markers.begin(), markers.end(), std::greater<MarkerCandidate>());
+            }
+        }
+
+        double clusterCountSum = 0;
+        for (int i = 0; i < numberOfClusters; i++) {
+            double clusterFactor = std::exp(parameters.clusterNoise * standardNormalDistribution(generator));
+            bool isDetected = uniformDistribution(generator) >= parameters.clusterSparsity;
+
+            clusterCounts[i] = isDetected ? parameters.clusterScale * profileCounts[clusterProfiles[i]] / parameters.referenceScale * clusterFactor : 0;
+            clusterCountSum += clusterCounts[i];
+        }
+
+        QByteArray geneID = getGeneID(gene),
+                   geneName = getGeneName(gene);
+
+        line.resize(0);
+        line.append(geneID).append(',').append(geneName);
+        for (int i = 0; i < numberOfClusters; i++) {
+            double meanCountOfOtherClusters = numberOfClusters > 1 ? (clusterCountSum - clusterCounts[i]) / (numberOfClusters - 1) : 0;
+            double log2FoldChange = std::log2((clusterCounts[i] + 1) / (meanCountOfOtherClusters + 1));
+            double pValue = qMin(1.0, uniformDistribution(generator) * std::exp(-2 * std::abs(log2FoldChange)));
+
+            line.append(',').append(QByteArray::number(clusterCounts[i], 'g', 6))
+                .append(',').append(QByteArray::number(log2FoldChange, 'g', 6))
+                .append(',').append(QByteArray::number(pValue, 'g', 6));
+        }
+        datasetFile.write(line.append('\n'));
+
+        line.resize(0);
+        line.append(geneID).append('\t').append(geneName);
+        for (int i = 0; i < numberOfProfiles; i++) {
+            line.append('\t').append(QByteArray::number(profileCounts[i], 'g', 6));
+        }
+        referenceFile.write(line.append('\n'));
+    }
+
+    // Marker file in the column layout the CSVReader expects: tissue in column 1, cell type in column 5 and the markers in column 7
+    markerFile.write("speciesType\ttissueType\tUberonOntologyID\tcancerType\tcellType\tcellName\tCellOntologyID\tcellMarker\tgeneID\n");
+    for (int i = 0; i < numberOfProfiles; i++) {
+        std::vector<MarkerCandidate> & markers = profileMarkers[i];
+
+        if (markers.empty()) {
+            continue;
+        }
+
+        std::sort_heap(markers.begin(), markers.end(), std::greater<MarkerCandidate>());
+
+        QByteArrayList markerNames;
+        for (const MarkerCandidate & marker : markers) {
+            markerNames.append(getGeneName(marker.second));
+        }
+
+        line = "Human\tSynthetic\tNA\tNormal cell\tNormal cell\t" + getProfileName(i) + "\tNA\t";
+        markerFile.write(line.append(markerNames.join(", ")).append("\tNA\n"));
+    }
+
+    // Clusters are named the way the CSVReader names them
+    groundTruthFile.write("Cluster\tProfile\n");
+    for (int i = 0; i < numberOfClusters; i++) {
+        groundTruthFile.write("Cluster" + QByteArray::number(i) + '\t' + getProfileName(clusterProfiles[i]) + '\n');
+    }
+
+    bool isDatasetWritten = closeOutputFile(datasetFile),
+         isReferenceWritten = closeOutputFile(referenceFile),
+         isMarkerFileWritten = closeOutputFile(markerFile),
+         isGroundTruthWritten = closeOutputFile(groundTruthFile);
+
+    if (!isDatasetWritten || !isReferenceWritten || !isMarkerFileWritten || !isGroundTruthWritten) {
+        return false;
+    }
+
+    if (parameters.numberOfCells == 0) {
+        return true;
+    }
+
+    // The cells are the only matrix that is held in memory - the dictionary is empty, so the rows of the matrix are the genes in order
+    GeneDictionary geneDictionary;
+    SparseMatrix sparseMatrix;
+    QVector<int> cellProfiles;
+
+    return generateCells(parameters, geneDictionary, sparseMatrix, cellProfiles) && writeCellFiles(sparseMatrix, cellProfiles, outputDirectory);
+}
+
+
+/**
+ * @brief generateCells - Samples the single cells of the dataset from the reference profiles that generateFiles writes for the same parameters.
+ *        Every cell picks a random profile and draws its counts from the expression of the profile, like the reads of a library are drawn from its transcripts,
+ *        so shallow cells express fewer genes. The genes are added to the dictionary by their name, the way the feature-barcode matrix readers add them
+ * @param parameters - Size and seed of the reference, number of cells and counts per cell
+ * @param geneDictionary - Dictionary the rows of the matrix refer to - e.g. the one the reference profiles of the annotation have been built with
+ * @param sparseMatrix - Filled with the counts of every cell
+ * @param cellProfiles - Filled with the profile every cell has been drawn from
+ * @return True if the cells have been generated
+ */
+bool generateCells(const GeneratorParameters & parameters, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix, QVector<int> & cellProfiles) {
+    int numberOfGenes = parameters.numberOfGenes,
+        numberOfProfiles = parameters.numberOfProfiles,
+        numberOfCells = parameters.numberOfCells,
+        countsPerCell = parameters.countsPerCell;
+
+    if (!hasValidParameters(parameters)) {
+        return false;
+    }
+
+    // Cumulative counts of every profile over the genes, profile by profile - a uniform draw up to the total count picks a gene by binary search
+    std::vector<double> cumulativeCounts(size_t(numberOfProfiles) * size_t(numberOfGenes));
+    QVector<double> profileCounts(numberOfProfiles),
+                    profileFactors(numberOfProfiles);
+    QStringList geneNames;
+
+    std::normal_distribution<double> standardNormalDistribution(0, 1);
+
+    for (int gene = 0; gene < numberOfGenes; gene++) {
+        std::seed_seq geneSeed { parameters.seed, quint32(gene) };
+        std::mt19937 generator(geneSeed);
+
+        drawProfileCounts(generator, standardNormalDistribution, parameters, profileCounts, profileFactors);
+
+        for (int i = 0; i < numberOfProfiles; i++) {
+            size_t position = size_t(i) * size_t(numberOfGenes) + size_t(gene);
+            cumulativeCounts[position] = profileCounts[i] + (gene > 0 ? cumulativeCounts[position - 1] : 0);
+        }
+
+        geneNames.append(QString::fromUtf8(getGeneName(gene)));
+    }
+
+    QVector<int> geneRows = geneDictionary.insertGenes(geneNames);
+
+    // Three seed values never collide with the two of a gene generator
+    std::seed_seq cellSeed { parameters.seed, quint32(0), quint32(0) };
+    std::mt19937 cellGenerator(cellSeed);
+    std::uniform_int_distribution<int> profileDistribution(0, numberOfProfiles - 1);
+
+    QStringList cellBarcodes;
+    std::vector<qint64> columnOffsets(size_t(numberOfCells) + 1, 0);
+    std::vector<quint32> geneIndices;
+    std::vector<float> values;
+    std::vector<int> cellGenes(size_t(countsPerCell), 0);
+
+    cellProfiles.resize(numberOfCells);
+    cellBarcodes.reserve(numberOfCells);
+
+    for (int c = 0; c < numberOfCells; c++) {
+        int profile = profileDistribution(cellGenerator);
+        const double * profileCumulativeCounts = cumulativeCounts.data() + size_t(profile) * size_t(numberOfGenes);
+        double profileCount = profileCumulativeCounts[numberOfGenes - 1];
+
+        // Profiles that express no gene at all yield empty cells
+        if (profileCount > 0) {
+            std::uniform_real_distribution<double> countDistribution(0, profileCount);
+
+            for (int & gene : cellGenes) {
+                gene = int(std::upper_bound(profileCumulativeCounts, profileCumulativeCounts + numberOfGenes, countDistribution(cellGenerator)) - profileCumulativeCounts);
+                gene = std::min(gene, numberOfGenes - 1);
+            }
+            std::sort(cellGenes.begin(), cellGenes.end());
+
+            // Every gene once with the number of its draws
+            for (size_t k = 0; k < cellGenes.size();) {
+                size_t end = k;
+                while (end < cellGenes.size() && cellGenes[end] == cellGenes[k]) {
+                    end++;
+                }
+
+                geneIndices.push_back(quint32(geneRows[cellGenes[k]]));
+                values.push_back(float(end - k));
+                k = end;
+            }
+        }
+
+        columnOffsets[size_t(c) + 1] = qint64(geneIndices.size());
+        cellProfiles[c] = profile;
+        cellBarcodes.append(QString("CELL%1-1").arg(c + 1));
+    }
+
+    sparseMatrix = SparseMatrix(geneDictionary.getGeneIDs(), cellBarcodes, std::move(columnOffsets), std::move(geneIndices), std::move(values));
+    return true;
+}
+
+}
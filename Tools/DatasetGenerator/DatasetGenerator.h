@@ -0,0 +1,68 @@
+#ifndef DATASETGENERATOR_H
+#define DATASETGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+
+/**
+ * @brief The DatasetGenerator namespace writes synthetic input files in the formats Badger reads: a cellranger differential expression file,
+ *        a tab separated reference of expression profiles and a cell marker file. The clusters of the dataset are noisy copies of randomly chosen
+ *        reference profiles, so annotations have a known answer. Every gene draws from its own generator seeded with the seed and its index,
+ *        which makes the files reproducible and lets them be written row by row without holding the matrices in memory.
+ *        Optionally single cells are sampled from the reference profiles as well and written as feature-barcode matrix.
+ */
+namespace DatasetGenerator
+{
+    enum ExpressionDistribution { LogNormalDistribution = 0, GammaDistribution = 1 };
+
+    struct GeneratorParameters
+    {
+        int numberOfGenes = 20000;
+        int numberOfClusters = 20;
+        int numberOfProfiles = 50;
+        // Number of markers written for every reference profile - the genes most enriched in the profile
+        int numberOfMarkersPerProfile = 20;
+
+        // Share of counts that are zero
+        double clusterSparsity = 0.3;
+        double referenceSparsity = 0.2;
+
+        // Scale of the counts - the median of log-normal, the mean of gamma distributed counts
+        double clusterScale = 10;
+        double referenceScale = 60;
+
+        // Distribution of the base expression of the genes and its spread - sigma of the log-normal, coefficient of variation of the gamma distribution
+        ExpressionDistribution distribution = LogNormalDistribution;
+        double spread = 1.5;
+        // Sigma of the log factor that separates the profiles from the base expression
+        double profileSpread = 1;
+        // Sigma of the log factor that separates a cluster from the profile it was drawn from
+        double clusterNoise = 0.5;
+
+        // Single cells of the feature-barcode matrix - none are written by default. Every cell draws its counts from the expression of a random profile
+        int numberOfCells = 0;
+        int countsPerCell = 1000;
+
+        quint32 seed = 1;
+    };
+
+    // Files that are written into the output directory
+    const char * const datasetFileName = "differential_expression.csv";
+    const char * const referenceFileName = "reference.tsv";
+    const char * const markerFileName = "markers.tsv";
+    const char * const groundTruthFileName = "ground_truth.tsv";
+    const char * const cellMatrixDirectoryName = "filtered_feature_bc_matrix";
+    const char * const cellGroundTruthFileName = "cell_ground_truth.tsv";
+
+    extern QByteArray getProfileName(int profileIndex);
+    extern bool parseDistribution(QString distributionName, ExpressionDistribution & distribution);
+    extern bool generateFiles(const GeneratorParameters & parameters, const QString outputDirectoryPath);
+    extern bool generateCells(const GeneratorParameters & parameters, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix, QVector<int> & cellProfiles);
+};
+
+#endif // DATASETGENERATOR_H
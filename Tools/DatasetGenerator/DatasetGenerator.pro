@@ -0,0 +1,25 @@
+# Generator of synthetic input files - built separately from the application:
+#   qmake Tools/DatasetGenerator/DatasetGenerator.pro && make && ./DatasetGenerator --genes 50000 --clusters 200 --profiles 2000 data/
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = DatasetGenerator
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Sources are included relative to the repository root
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    ../../BioModels/GeneDictionary.cpp \
+    ../../BioModels/SparseMatrix.cpp \
+    DatasetGenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    ../../BioModels/GeneDictionary.h \
+    ../../BioModels/SparseMatrix.h \
+    DatasetGenerator.h
@@ -0,0 +1,82 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QString>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "Tools/DatasetGenerator/DatasetGenerator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    DatasetGenerator::GeneratorParameters defaults;
+
+    QCommandLineParser commandLineParser;
+    commandLineParser.setApplicationDescription("Writes a synthetic cellranger dataset, a reference, a marker file and the ground truth of the clusters - optionally single cells as feature-barcode matrix.");
+    commandLineParser.addHelpOption();
+
+    QCommandLineOption genesOption("genes", "Number of genes.", "number", QString::number(defaults.numberOfGenes)),
+                       clustersOption("clusters", "Number of clusters of the dataset.", "number", QString::number(defaults.numberOfClusters)),
+                       profilesOption("profiles", "Number of reference profiles.", "number", QString::number(defaults.numberOfProfiles)),
+                       markersOption("markers", "Number of markers per reference profile.", "number", QString::number(defaults.numberOfMarkersPerProfile)),
+                       clusterSparsityOption("cluster-sparsity", "Share of zero counts in the dataset.", "share", QString::number(defaults.clusterSparsity)),
+                       referenceSparsityOption("reference-sparsity", "Share of zero counts in the reference.", "share", QString::number(defaults.referenceSparsity)),
+                       clusterScaleOption("cluster-scale", "Typical mean count of the dataset.", "count", QString::number(defaults.clusterScale)),
+                       referenceScaleOption("reference-scale", "Typical count of the reference.", "count", QString::number(defaults.referenceScale)),
+                       distributionOption("distribution", "Distribution of the gene expressions (lognormal, gamma).", "name", "lognormal"),
+                       spreadOption("spread", "Sigma of the log-normal or coefficient of variation of the gamma distribution.", "value", QString::number(defaults.spread)),
+                       profileSpreadOption("profile-spread", "Sigma of the log factor that separates the profiles.", "value", QString::number(defaults.profileSpread)),
+                       clusterNoiseOption("cluster-noise", "Sigma of the log factor that separates a cluster from its profile.", "value", QString::number(defaults.clusterNoise)),
+                       cellsOption("cells", "Number of single cells of the feature-barcode matrix.", "number", QString::number(defaults.numberOfCells)),
+                       countsPerCellOption("counts-per-cell", "Counts drawn for every single cell.", "number", QString::number(defaults.countsPerCell)),
+                       seedOption("seed", "Seed of the generator.", "number", QString::number(defaults.seed));
+    commandLineParser.addOptions({ genesOption, clustersOption, profilesOption, markersOption, clusterSparsityOption, referenceSparsityOption,
+                                   clusterScaleOption, referenceScaleOption, distributionOption, spreadOption, profileSpreadOption, clusterNoiseOption,
+                                   cellsOption, countsPerCellOption, seedOption });
+    commandLineParser.addPositionalArgument("output", "Directory the files are written to.");
+    commandLineParser.process(application);
+
+    if (commandLineParser.positionalArguments().length() != 1) {
+        commandLineParser.showHelp(1);
+    }
+
+    DatasetGenerator::GeneratorParameters parameters;
+    parameters.numberOfGenes = commandLineParser.value(genesOption).toInt();
+    parameters.numberOfClusters = commandLineParser.value(clustersOption).toInt();
+    parameters.numberOfProfiles = commandLineParser.value(profilesOption).toInt();
+    parameters.numberOfMarkersPerProfile = commandLineParser.value(markersOption).toInt();
+    parameters.clusterSparsity = commandLineParser.value(clusterSparsityOption).toDouble();
+    parameters.referenceSparsity = commandLineParser.value(referenceSparsityOption).toDouble();
+    parameters.clusterScale = commandLineParser.value(clusterScaleOption).toDouble();
+    parameters.referenceScale = commandLineParser.value(referenceScaleOption).toDouble();
+    parameters.spread = commandLineParser.value(spreadOption).toDouble();
+    parameters.profileSpread = commandLineParser.value(profileSpreadOption).toDouble();
+    parameters.clusterNoise = commandLineParser.value(clusterNoiseOption).toDouble();
+    parameters.numberOfCells = commandLineParser.value(cellsOption).toInt();
+    parameters.countsPerCell = commandLineParser.value(countsPerCellOption).toInt();
+    parameters.seed = commandLineParser.value(seedOption).toUInt();
+
+    if (!DatasetGenerator::parseDistribution(commandLineParser.value(distributionOption), parameters.distribution)) {
+        return 1;
+    }
+
+    QString outputDirectoryPath = commandLineParser.positionalArguments().first();
+
+    cout << "Generating " << parameters.numberOfGenes << " genes x " << parameters.numberOfClusters << " clusters and "
+         << parameters.numberOfProfiles << " reference profiles." << endl;
+
+    if (parameters.numberOfCells > 0) {
+        cout << "Sampling " << parameters.numberOfCells << " cells with " << parameters.countsPerCell << " counts each." << endl;
+    }
+
+    if (!DatasetGenerator::generateFiles(parameters, outputDirectoryPath)) {
+        return 1;
+    }
+
+    cout << "Files written to " << outputDirectoryPath.toStdString() << endl;
+    return 0;
+}
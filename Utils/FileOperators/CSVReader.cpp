@@ -3,12 +3,14 @@
 #include <QDebug>
 #include <QString>
 #include <QFile>
+#include <QIODevice>
 #include <QByteArray>
 #include <QStringList>
 #include <QList>
 
 #include "BioModels/FeatureCollection.h"
 #include "BioModels/Celltype.h"
+#include "System/Trace.h"
 
 namespace CSVReader {
 
@@ -19,6 +21,7 @@ namespace CSVReader {
  * @return
  */
 QVector<FeatureCollection> getClusterFeatureExpressions(QString csvFilePath, double cutOff) {
+    TRACE_SCOPE("CSVReader::getClusterFeatureExpressions");
 
     // Open file
     QFile csvFile(csvFilePath);
@@ -29,8 +32,21 @@ QVector<FeatureCollection> getClusterFeatureExpressions(QString csvFilePath, dou
         exit(1);
     }
 
+    return parseClusterFeatureExpressions(csvFile, cutOff);
+}
+
+
+/**
+ * @brief CSVReader::parseClusterFeatureExpressions - Parses cellranger cluster feature expressions from an already opened device (file, buffer, socket data)
+ * @param csvDevice - Readable device positioned at the title line
+ * @param cutOff - Features with a mean count below or equal to this value are dropped
+ * @return List of clusters with their expressed features
+ */
+QVector<FeatureCollection> parseClusterFeatureExpressions(QIODevice & csvDevice, double cutOff) {
+    TRACE_SCOPE("CSVReader::parseClusterFeatureExpressions");
+
     // Skip title line
-    QByteArray line = csvFile.readLine();
+    QByteArray line = csvDevice.readLine();
     QList<QByteArray> splitLine = line.split(',');
 
     // Each cluster contains its expressed features
@@ -52,10 +68,15 @@ QVector<FeatureCollection> getClusterFeatureExpressions(QString csvFilePath, dou
     }
 
     // Start parsing cluster file
-    while (!csvFile.atEnd()) {
-        line = csvFile.readLine();
+    while (!csvDevice.atEnd()) {
+        line = csvDevice.readLine();
         splitLine = line.split(',');
 
+        // Skip incomplete lines (e.g. trailing empty lines) instead of reading past the split line
+        if (splitLine.length() < numberOfColumns) {
+            continue;
+        }
+
         // Check the expression for each feature in the clusters and add the feature in case its expressed
         for (int i = 0; i < numberOfClusters; i++) {
             double featureMeanCount = splitLine.at(clusterColumnNumbers[i]).toDouble();
@@ -79,6 +100,8 @@ QVector<FeatureCollection> getClusterFeatureExpressions(QString csvFilePath, dou
  * @return
  */
 QVector<CellType> getCellTypesWithMarkers(QString csvFilePath) {
+    TRACE_SCOPE("CSVReader::getCellTypesWithMarkers");
+
     // Open file
     QFile csvFile(csvFilePath);
 
@@ -119,6 +142,7 @@ QVector<CellType> getCellTypesWithMarkers(QString csvFilePath) {
  * @return Hash of cell marker to list of every tissue / cell type.
  */
 QHash <QString, QVector<QPair<QString, QString>>> sortCsvByMarker(QString csvFilePath) {
+    TRACE_SCOPE("CSVReader::sortCsvByMarker");
 
     // Open file
     QFile csvFile(csvFilePath);
@@ -176,6 +200,7 @@ QHash <QString, QVector<QPair<QString, QString>>> sortCsvByMarker(QString csvFil
  * @param csvFilePath
  */
 QVector<FeatureCollection> getTissuesWithGeneExpression(QString csvFilePath, double cutOff) {
+    TRACE_SCOPE("CSVReader::getTissuesWithGeneExpression");
 
     // Open file
     QFile csvFile(csvFilePath);
@@ -6,6 +6,7 @@
 #include <QString>
 #include <QPair>
 #include <QHash>
+#include <QIODevice>
 
 #include "BioModels/FeatureCollection.h"
 #include "BioModels/Celltype.h"
@@ -13,6 +14,7 @@
 namespace CSVReader
 {
     extern QVector<FeatureCollection> getClusterFeatureExpressions(QString csvFilePath, double cutOff);
+    extern QVector<FeatureCollection> parseClusterFeatureExpressions(QIODevice & csvDevice, double cutOff);
 //  extern QVector<Cluster> getClusterFeatureExpressions(QString csvFilePath);
 
     extern QVector<CellType> getCellTypesWithMarkers(QString csvFilePath);
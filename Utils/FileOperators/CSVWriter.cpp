@@ -0,0 +1,41 @@
+#include "CSVWriter.h"
+
+#include <QDebug>
+#include <QString>
+#include <QFile>
+#include <QTextStream>
+
+namespace CSVWriter {
+
+/**
+ * @brief writeClusterTissueCorrelations - Writes the top n correlated types of every cluster as tab separated rows "cluster, rank, type, correlation"
+ * @param csvFilePath - Path of the output file - an existing file is overwritten
+ * @param clusters - Clusters the correlations belong to - used for the cluster IDs
+ * @param correlations - Sorted type correlations for every cluster as returned by the ExpressionComparator
+ * @param numberOfTopTypes - Number of best correlated types that are written per cluster
+ * @return True if the file could be written
+ */
+bool writeClusterTissueCorrelations(QString csvFilePath, QVector<FeatureCollection> clusters, QVector<QVector<QPair<QString, double>>> correlations, int numberOfTopTypes) {
+    QFile csvFile(csvFilePath);
+
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "CSV WRITER:" << csvFilePath << "-" << csvFile.errorString();
+        return false;
+    }
+
+    QTextStream csvStream(&csvFile);
+    csvStream << "Cluster\tRank\tType\tCorrelation\n";
+
+    for (int i = 0; i < correlations.length(); i++) {
+        int numberOfWrittenTypes = qMin(numberOfTopTypes, correlations[i].length());
+
+        for (int rank = 0; rank < numberOfWrittenTypes; rank++) {
+            csvStream << clusters[i].ID << '\t' << rank + 1 << '\t' << correlations[i][rank].first << '\t' << correlations[i][rank].second << '\n';
+        }
+    }
+
+    csvStream.flush();
+    return csvStream.status() == QTextStream::Ok;
+}
+
+}
@@ -0,0 +1,15 @@
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <QVector>
+#include <QPair>
+#include <QString>
+
+#include "BioModels/FeatureCollection.h"
+
+namespace CSVWriter
+{
+    extern bool writeClusterTissueCorrelations(QString csvFilePath, QVector<FeatureCollection> clusters, QVector<QVector<QPair<QString, double>>> correlations, int numberOfTopTypes);
+};
+
+#endif // CSVWRITER_H
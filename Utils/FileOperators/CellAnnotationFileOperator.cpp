@@ -0,0 +1,160 @@
+#include "CellAnnotationFileOperator.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <vector>
+
+#include "System/Trace.h"
+
+namespace CellAnnotationFileOperator {
+
+namespace {
+const quint32 cellAnnotationFileMagic = 0x42444743; // "BDGC"
+const quint32 cellAnnotationFileVersion = 1;
+const int rawDataBytes = 1 << 30;
+
+/**
+ * @brief writeArray - Writes an array of numbers in little endian byte order - straight from memory on little endian machines
+ * @param stream - Stream positioned behind the header
+ * @param array - Numbers to write
+ */
+template<typename T>
+void writeArray(QDataStream & stream, const std::vector<T> & array) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    const char * data = reinterpret_cast<const char *>(array.data());
+
+    // Raw data is written in pieces, its size is an int
+    for (size_t written = 0; written < array.size() * sizeof(T); written += rawDataBytes) {
+        stream.writeRawData(data + written, int(qMin(size_t(rawDataBytes), array.size() * sizeof(T) - written)));
+    }
+#else
+    for (const T & value : array) {
+        stream << value;
+    }
+#endif
+}
+
+
+/**
+ * @brief readArray - Reads an array of numbers in little endian byte order - straight into memory on little endian machines
+ * @param stream - Stream positioned at the array
+ * @param array - Sized to the number of values that are read
+ */
+template<typename T>
+void readArray(QDataStream & stream, std::vector<T> & array) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    char * data = reinterpret_cast<char *>(array.data());
+
+    for (size_t read = 0; read < array.size() * sizeof(T); read += rawDataBytes) {
+        int pieceBytes = int(qMin(size_t(rawDataBytes), array.size() * sizeof(T) - read));
+
+        if (stream.readRawData(data + read, pieceBytes) != pieceBytes) {
+            stream.setStatus(QDataStream::ReadPastEnd);
+            return;
+        }
+    }
+#else
+    for (T & value : array) {
+        stream >> value;
+    }
+#endif
+}
+}
+
+/**
+ * @brief writeCellAnnotations - Writes the best profiles of every cell to a cell annotation file
+ * @param cellAnnotationFilePath - Path of the file - an existing file is overwritten
+ * @param cellAnnotations - Best profiles of every cell
+ * @return True if the file has been written completely
+ */
+bool writeCellAnnotations(const QString cellAnnotationFilePath, const CellAnnotator::CellAnnotations & cellAnnotations) {
+    TRACE_SCOPE("CellAnnotationFileOperator::writeCellAnnotations");
+
+    QFile cellAnnotationFile(cellAnnotationFilePath);
+
+    if (!cellAnnotationFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "CELL ANNOTATION FILE:" << cellAnnotationFilePath << "-" << cellAnnotationFile.errorString();
+        return false;
+    }
+
+    // Barcodes are plain ASCII - one line each takes half the space of a string list
+    QByteArray cellBarcodes = cellAnnotations.cellBarcodes.join('\n').toLatin1();
+
+    QDataStream cellAnnotationStream(&cellAnnotationFile);
+    cellAnnotationStream.setByteOrder(QDataStream::LittleEndian);
+    cellAnnotationStream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    cellAnnotationStream << cellAnnotationFileMagic << cellAnnotationFileVersion
+                         << quint32(cellAnnotations.cellBarcodes.length()) << quint32(cellAnnotations.numberOfTopProfiles)
+                         << cellAnnotations.profileIDs << cellBarcodes;
+
+    writeArray(cellAnnotationStream, cellAnnotations.profileIndices);
+    writeArray(cellAnnotationStream, cellAnnotations.scores);
+
+    return cellAnnotationStream.status() == QDataStream::Ok;
+}
+
+
+/**
+ * @brief readCellAnnotations - Reads the best profiles of every cell back from a cell annotation file
+ * @param cellAnnotationFilePath - Path of the file
+ * @param cellAnnotations - Filled with the best profiles of every cell
+ * @return True if the file has been read completely
+ */
+bool readCellAnnotations(const QString cellAnnotationFilePath, CellAnnotator::CellAnnotations & cellAnnotations) {
+    TRACE_SCOPE("CellAnnotationFileOperator::readCellAnnotations");
+
+    QFile cellAnnotationFile(cellAnnotationFilePath);
+
+    if (!cellAnnotationFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "CELL ANNOTATION FILE:" << cellAnnotationFilePath << "-" << cellAnnotationFile.errorString();
+        return false;
+    }
+
+    QDataStream cellAnnotationStream(&cellAnnotationFile);
+    cellAnnotationStream.setByteOrder(QDataStream::LittleEndian);
+    cellAnnotationStream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic, version, numberOfCells, numberOfTopProfiles;
+    cellAnnotationStream >> magic >> version;
+
+    if (magic != cellAnnotationFileMagic || version != cellAnnotationFileVersion) {
+        qDebug() << "CELL ANNOTATION FILE:" << cellAnnotationFilePath << "- unknown format";
+        return false;
+    }
+
+    QByteArray cellBarcodes;
+    cellAnnotationStream >> numberOfCells >> numberOfTopProfiles >> cellAnnotations.profileIDs >> cellBarcodes;
+
+    // The counts of the header are only trusted if the rest of the file holds that many values - a broken header must not allocate gigabytes
+    quint64 numberOfValues = quint64(numberOfCells) * numberOfTopProfiles,
+            valueBytes = sizeof(quint16) + sizeof(float);
+
+    if (cellAnnotationStream.status() != QDataStream::Ok || numberOfValues * valueBytes != quint64(cellAnnotationFile.size() - cellAnnotationFile.pos())) {
+        qDebug() << "CELL ANNOTATION FILE:" << cellAnnotationFilePath << "- header does not match the file size";
+        return false;
+    }
+
+    cellAnnotations.cellBarcodes = numberOfCells > 0 ? QString::fromLatin1(cellBarcodes).split('\n') : QStringList();
+    cellAnnotations.numberOfTopProfiles = int(numberOfTopProfiles);
+    cellAnnotations.profileIndices.resize(size_t(numberOfCells) * numberOfTopProfiles);
+    cellAnnotations.scores.resize(size_t(numberOfCells) * numberOfTopProfiles);
+
+    readArray(cellAnnotationStream, cellAnnotations.profileIndices);
+    readArray(cellAnnotationStream, cellAnnotations.scores);
+
+    if (cellAnnotationStream.status() != QDataStream::Ok || cellAnnotations.cellBarcodes.length() != int(numberOfCells)) {
+        qDebug() << "CELL ANNOTATION FILE:" << cellAnnotationFilePath << "- file is truncated";
+        return false;
+    }
+
+    return true;
+}
+
+}
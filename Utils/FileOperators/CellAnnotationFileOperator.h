@@ -0,0 +1,19 @@
+#ifndef CELLANNOTATIONFILEOPERATOR_H
+#define CELLANNOTATIONFILEOPERATOR_H
+
+#include <QString>
+
+#include "Statistics/CellAnnotator.h"
+
+/**
+ * @brief The CellAnnotationFileOperator namespace writes the best profiles of every cell to a compact binary file and reads them back.
+ *        After a small header (profile IDs and cell barcodes) the file holds the 16 bit profile indices and the float scores of every cell
+ *        as two little endian arrays, cell by cell, so other tools can map them directly
+ */
+namespace CellAnnotationFileOperator
+{
+    extern bool writeCellAnnotations(const QString cellAnnotationFilePath, const CellAnnotator::CellAnnotations & cellAnnotations);
+    extern bool readCellAnnotations(const QString cellAnnotationFilePath, CellAnnotator::CellAnnotations & cellAnnotations);
+};
+
+#endif // CELLANNOTATIONFILEOPERATOR_H
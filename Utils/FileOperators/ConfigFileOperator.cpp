@@ -43,11 +43,25 @@ ConfigFile readConfigFile(QString configFilePath) {
     // Config identifiers
     QString projectLocation       = "project_location",
             markerFile            = "marker_file",
-            clusterExpressionFile = "cluster_expression_file";
+            clusterExpressionFile = "cluster_expression_file",
+            memoryBudget          = "memory_budget_mb",
+            spillRenderedDatasets = "spill_rendered_datasets",
+            parsingThreads        = "parsing_threads",
+            correlationThreads    = "correlation_threads",
+            cpuSet                = "cpu_set",
+            pinThreads            = "pin_threads",
+            perfCounters          = "perf_counters";
 
     // Gather information from config file
     QString cellMarkersFilePath,
             clusterExpressionFilePath;
+    qint64 memoryBudgetMegabytes = 0;
+    bool isSpillRenderedDatasets = false;
+    int parsingThreadCount = 0,
+        correlationThreadCount = 0;
+    QString cpuSetValue;
+    bool isPinThreads = false;
+    bool isPerfCounters = false;
 
     // Start parsing cluster file
     while (!csvFile.atEnd()) {
@@ -68,10 +82,31 @@ ConfigFile readConfigFile(QString configFilePath) {
             cellMarkersFilePath = value;
         else if (identifier == clusterExpressionFile)
             clusterExpressionFilePath = value;
+        else if (identifier == memoryBudget)
+            memoryBudgetMegabytes = value.toLongLong();
+        else if (identifier == spillRenderedDatasets)
+            isSpillRenderedDatasets = value == "true";
+        else if (identifier == parsingThreads)
+            parsingThreadCount = value.toInt();
+        else if (identifier == correlationThreads)
+            correlationThreadCount = value.toInt();
+        else if (identifier == cpuSet)
+            cpuSetValue = value;
+        else if (identifier == pinThreads)
+            isPinThreads = value == "true";
+        else if (identifier == perfCounters)
+            isPerfCounters = value == "true";
     }
 
     // Assemble config file and return it
     ConfigFile configFile(cellMarkersFilePath, clusterExpressionFilePath);
+    configFile.memoryBudgetMegabytes = memoryBudgetMegabytes;
+    configFile.isSpillRenderedDatasets = isSpillRenderedDatasets;
+    configFile.parsingThreadCount = parsingThreadCount;
+    configFile.correlationThreadCount = correlationThreadCount;
+    configFile.cpuSet = cpuSetValue;
+    configFile.isPinThreads = isPinThreads;
+    configFile.isPerfCounters = isPerfCounters;
     return configFile;
 }
 
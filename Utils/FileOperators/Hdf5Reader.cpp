@@ -0,0 +1,597 @@
+#include "Hdf5Reader.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QFuture>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <utility>
+#include <vector>
+
+#ifdef BADGER_HDF5
+#include <hdf5.h>
+#endif
+
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+
+namespace Hdf5Reader {
+
+#ifdef BADGER_HDF5
+namespace {
+
+// Entries per hyperslab - rounded to whole chunks of the file, so no chunk is decompressed twice
+const hsize_t blockEntries = 4 * 1024 * 1024;
+
+// Row of entries whose feature is no gene, they are removed after reading
+const quint32 droppedGeneIndex = 0xFFFFFFFF;
+
+// CSC arrays of a single matrix group
+struct GenomeMatrix
+{
+    std::vector<qint64> columnOffsets;
+    std::vector<quint32> geneIndices;
+    std::vector<float> values;
+};
+
+/**
+ * @brief The Handle class closes an HDF5 identifier when it goes out of scope
+ */
+class Handle
+{
+private:
+    hid_t identifier;
+    herr_t (*closeIdentifier)(hid_t);
+
+public:
+    Handle(const hid_t identifier, herr_t (*closeIdentifier)(hid_t))
+        : identifier {identifier}, closeIdentifier {closeIdentifier}
+    {}
+
+    ~Handle() {
+        if (this->identifier >= 0) {
+            this->closeIdentifier(this->identifier);
+        }
+    }
+
+    operator hid_t() const {
+        return this->identifier;
+    }
+
+    bool isValid() const {
+        return this->identifier >= 0;
+    }
+
+    Handle(const Handle &) = delete;
+    Handle & operator=(const Handle &) = delete;
+};
+
+bool isLinkExists(const hid_t location, const char * name) {
+    return H5Lexists(location, name, H5P_DEFAULT) > 0;
+}
+
+/**
+ * @brief getLength - Returns the number of elements of a one dimensional dataset
+ * @return Number of elements - -1 if the dataset is not one dimensional
+ */
+qint64 getLength(const hid_t dataset) {
+    Handle space(H5Dget_space(dataset), H5Sclose);
+    hsize_t dimensions[1];
+
+    if (!space.isValid() || H5Sget_simple_extent_ndims(space) != 1 || H5Sget_simple_extent_dims(space, dimensions, nullptr) < 0) {
+        return -1;
+    }
+    return qint64(dimensions[0]);
+}
+
+/**
+ * @brief getBlockLength - Returns the entries of a hyperslab - whole chunks of the dataset if it is chunked
+ */
+hsize_t getBlockLength(const hid_t dataset) {
+    Handle creationProperties(H5Dget_create_plist(dataset), H5Pclose);
+    hsize_t chunkDimensions[1];
+
+    if (creationProperties.isValid() && H5Pget_layout(creationProperties) == H5D_CHUNKED
+            && H5Pget_chunk(creationProperties, 1, chunkDimensions) == 1 && chunkDimensions[0] > 0) {
+        return qMax(hsize_t(1), blockEntries / chunkDimensions[0]) * chunkDimensions[0];
+    }
+    return blockEntries;
+}
+
+/**
+ * @brief readHyperslab - Reads a range of a one dimensional dataset, converted to the given memory type
+ * @param buffer - Destination of count elements of the memory type
+ * @return True if the range has been read
+ */
+bool readHyperslab(const hid_t dataset, const hid_t memoryType, const hsize_t start, const hsize_t count, void * buffer) {
+    Handle fileSpace(H5Dget_space(dataset), H5Sclose);
+    Handle memorySpace(H5Screate_simple(1, &count, nullptr), H5Sclose);
+
+    return fileSpace.isValid() && memorySpace.isValid()
+           && H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &start, nullptr, &count, nullptr) >= 0
+           && H5Dread(dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, buffer) >= 0;
+}
+
+/**
+ * @brief readStrings - Reads a one dimensional dataset of fixed or variable length strings
+ * @param location - Group of the dataset
+ * @param name - Name of the dataset
+ * @param strings - Filled with the strings
+ * @return True if the dataset has been read
+ */
+bool readStrings(const hid_t location, const char * name, QStringList & strings) {
+    if (!isLinkExists(location, name)) {
+        return false;
+    }
+
+    Handle dataset(H5Dopen2(location, name, H5P_DEFAULT), H5Dclose);
+    if (!dataset.isValid()) {
+        return false;
+    }
+
+    qint64 length = getLength(dataset);
+    Handle fileType(H5Dget_type(dataset), H5Tclose);
+
+    if (length < 0 || !fileType.isValid() || H5Tget_class(fileType) != H5T_STRING) {
+        return false;
+    }
+
+    strings.clear();
+    strings.reserve(int(length));
+    Handle memoryType(H5Tcopy(H5T_C_S1), H5Tclose);
+
+    if (H5Tis_variable_str(fileType) > 0) {
+        H5Tset_size(memoryType, H5T_VARIABLE);
+        std::vector<char *> buffer(size_t(length), nullptr);
+
+        if (H5Dread(dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data()) < 0) {
+            return false;
+        }
+
+        for (const char * string : buffer) {
+            strings.append(QString::fromUtf8(string));
+        }
+
+        Handle space(H5Dget_space(dataset), H5Sclose);
+        H5Dvlen_reclaim(memoryType, space, H5P_DEFAULT, buffer.data());
+        return true;
+    }
+
+    // cellranger writes null padded fixed length strings
+    size_t stringSize = H5Tget_size(fileType);
+    H5Tset_size(memoryType, stringSize);
+    H5Tset_strpad(memoryType, H5T_STR_NULLPAD);
+    std::vector<char> buffer(size_t(length) * stringSize);
+
+    if (H5Dread(dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data()) < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < size_t(length); i++) {
+        const char * string = buffer.data() + i * stringSize;
+        strings.append(QString::fromUtf8(string, int(qstrnlen(string, uint(stringSize)))));
+    }
+    return true;
+}
+
+/**
+ * @brief mapFeaturesToGenes - Replaces the feature numbers of a block in place by their rows in the gene dictionary
+ * @param geneIndices - Block of feature numbers as read from the file
+ * @param numberOfEntries - Entries of the block
+ * @param featureGeneIndices - Dictionary row of every feature - -1 for features that are no genes
+ * @return Number of entries of features that are no genes - -1 if a feature number is out of range
+ */
+qint64 mapFeaturesToGenes(quint32 * geneIndices, const qint64 numberOfEntries, const QVector<int> featureGeneIndices) {
+    TRACE_SCOPE("Hdf5Reader::mapFeaturesToGenes");
+
+    quint32 numberOfFeatures = quint32(featureGeneIndices.length());
+    qint64 numberOfDroppedEntries = 0;
+
+    for (qint64 k = 0; k < numberOfEntries; k++) {
+        if (geneIndices[k] >= numberOfFeatures) {
+            return -1;
+        }
+
+        int geneIndex = featureGeneIndices[int(geneIndices[k])];
+
+        if (geneIndex < 0) {
+            geneIndices[k] = droppedGeneIndex;
+            numberOfDroppedEntries++;
+        } else {
+            geneIndices[k] = quint32(geneIndex);
+        }
+    }
+
+    return numberOfDroppedEntries;
+}
+
+/**
+ * @brief removeDroppedEntries - Removes the entries of features that are no genes and moves the columns together
+ */
+void removeDroppedEntries(std::vector<qint64> & columnOffsets, std::vector<quint32> & geneIndices, std::vector<float> & values) {
+    qint64 writePosition = 0;
+
+    for (size_t j = 0; j + 1 < columnOffsets.size(); j++) {
+        qint64 columnStart = columnOffsets[j],
+               columnEnd = columnOffsets[j + 1];
+        columnOffsets[j] = writePosition;
+
+        for (qint64 k = columnStart; k < columnEnd; k++) {
+            if (geneIndices[size_t(k)] != droppedGeneIndex) {
+                geneIndices[size_t(writePosition)] = geneIndices[size_t(k)];
+                values[size_t(writePosition)] = values[size_t(k)];
+                writePosition++;
+            }
+        }
+    }
+
+    columnOffsets.back() = writePosition;
+    geneIndices.resize(size_t(writePosition));
+    values.resize(size_t(writePosition));
+}
+
+/**
+ * @brief readMatrixArrays - Reads the CSC arrays in hyperslabs straight into their destination. The library is only called from this thread -
+ *        it is not thread safe unless built so - while the feature numbers of every block are mapped to genes on the parsing pool
+ * @param matrixGroup - Group with the datasets data, indices and indptr
+ * @param featureGeneIndices - Dictionary row of every feature - -1 for features that are no genes
+ * @param numberOfCells - Number of barcodes
+ * @return True if the arrays have been read
+ */
+bool readMatrixArrays(const hid_t matrixGroup, const QString h5FilePath, const QVector<int> featureGeneIndices, const int numberOfCells,
+                      std::vector<qint64> & columnOffsets, std::vector<quint32> & geneIndices, std::vector<float> & values) {
+    if (!isLinkExists(matrixGroup, "data") || !isLinkExists(matrixGroup, "indices") || !isLinkExists(matrixGroup, "indptr")) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- data, indices or indptr is missing";
+        return false;
+    }
+
+    Handle dataDataset(H5Dopen2(matrixGroup, "data", H5P_DEFAULT), H5Dclose),
+           indicesDataset(H5Dopen2(matrixGroup, "indices", H5P_DEFAULT), H5Dclose),
+           indptrDataset(H5Dopen2(matrixGroup, "indptr", H5P_DEFAULT), H5Dclose);
+    qint64 numberOfEntries = getLength(dataDataset);
+
+    if (numberOfEntries < 0 || getLength(indicesDataset) != numberOfEntries || getLength(indptrDataset) != qint64(numberOfCells) + 1) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- the lengths of data, indices and indptr do not match" << numberOfCells << "barcodes";
+        return false;
+    }
+
+    columnOffsets.resize(size_t(numberOfCells) + 1);
+    if (!readHyperslab(indptrDataset, H5T_NATIVE_INT64, 0, hsize_t(numberOfCells) + 1, columnOffsets.data())) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- indptr could not be read";
+        return false;
+    }
+
+    bool isOffsetsValid = columnOffsets.front() == 0 && columnOffsets.back() == numberOfEntries;
+    for (size_t j = 0; j < size_t(numberOfCells) && isOffsetsValid; j++) {
+        isOffsetsValid = columnOffsets[j] <= columnOffsets[j + 1];
+    }
+
+    if (!isOffsetsValid) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- indptr is not a valid CSC column pointer";
+        return false;
+    }
+
+    geneIndices.resize(size_t(numberOfEntries));
+    values.resize(size_t(numberOfEntries));
+
+    hsize_t blockLength = getBlockLength(indicesDataset);
+    QVector<QFuture<qint64>> futureDroppedEntries;
+    bool isRead = true;
+
+    // HDF5 converts the 64 bit indices and the integer counts while reading, so the blocks land in the matrix without further copies
+    for (hsize_t start = 0; start < hsize_t(numberOfEntries) && isRead; start += blockLength) {
+        hsize_t count = qMin(blockLength, hsize_t(numberOfEntries) - start);
+        quint32 * blockGeneIndices = geneIndices.data() + start;
+
+        isRead = readHyperslab(indicesDataset, H5T_NATIVE_UINT32, start, count, blockGeneIndices)
+                 && readHyperslab(dataDataset, H5T_NATIVE_FLOAT, start, count, values.data() + start);
+
+        if (isRead) {
+            futureDroppedEntries.append(ThreadPools::run(ThreadPools::ParsingPool, [blockGeneIndices, count, featureGeneIndices]() {
+                return mapFeaturesToGenes(blockGeneIndices, qint64(count), featureGeneIndices);
+            }));
+        }
+    }
+
+    // The tasks write into the arrays, so they are waited for on every path
+    qint64 numberOfDroppedEntries = 0;
+    bool isMapped = true;
+
+    for (QFuture<qint64> & futureDroppedEntry : futureDroppedEntries) {
+        qint64 droppedEntries = futureDroppedEntry.result();
+        isMapped = isMapped && droppedEntries >= 0;
+        numberOfDroppedEntries += qMax(droppedEntries, qint64(0));
+    }
+
+    if (!isRead || !isMapped) {
+        qDebug() << "HDF5 READER:" << h5FilePath << (isRead ? "- feature index out of range" : "- data or indices could not be read");
+        return false;
+    }
+
+    if (numberOfDroppedEntries > 0) {
+        removeDroppedEntries(columnOffsets, geneIndices, values);
+    }
+
+    return true;
+}
+
+/**
+ * @brief getMatrixGroupNames - Returns the groups that hold a matrix: cellranger 3 and later write the group "matrix", cellranger 2 writes one group per genome
+ * @param file - Open HDF5 file
+ * @return Names of the groups - empty if the file has none
+ */
+QList<QByteArray> getMatrixGroupNames(const hid_t file) {
+    QList<QByteArray> matrixGroupNames;
+    H5G_info_t fileInfo;
+
+    if (isLinkExists(file, "matrix")) {
+        matrixGroupNames.append("matrix");
+    } else if (H5Gget_info(file, &fileInfo) >= 0) {
+        for (hsize_t i = 0; i < fileInfo.nlinks; i++) {
+            char groupName[256] = { 0 };
+            if (H5Lget_name_by_idx(file, ".", H5_INDEX_NAME, H5_ITER_INC, i, groupName, sizeof(groupName), H5P_DEFAULT) > 0) {
+                matrixGroupNames.append(QByteArray(groupName));
+            }
+        }
+    }
+
+    return matrixGroupNames;
+}
+
+/**
+ * @brief getDatasetLength - Returns the number of elements of a one dimensional dataset of a group
+ * @return Number of elements - -1 if the dataset is missing or not one dimensional
+ */
+qint64 getDatasetLength(const hid_t location, const char * name) {
+    if (!isLinkExists(location, name)) {
+        return -1;
+    }
+
+    Handle dataset(H5Dopen2(location, name, H5P_DEFAULT), H5Dclose);
+    return dataset.isValid() ? getLength(dataset) : -1;
+}
+
+/**
+ * @brief readMatrixGroup - Reads the features, barcodes and CSC arrays of a matrix group - "matrix" or a genome of cellranger 2.
+ *        Genes are known by their upper case name like in the cluster and reference files - features of the same name share a row
+ * @param file - Open HDF5 file
+ * @param matrixGroupName - Name of the group in the file
+ * @param geneDictionary - Dictionary of the project that assigns the rows
+ * @param cellBarcodes - Filled with the barcodes of the group
+ * @param genomeMatrix - Filled with the CSC arrays of the group
+ * @return True if the group has been read
+ */
+bool readMatrixGroup(const hid_t file, const QByteArray matrixGroupName, const QString h5FilePath, GeneDictionary & geneDictionary,
+                     QStringList & cellBarcodes, GenomeMatrix & genomeMatrix) {
+    Handle matrixGroup(H5Gopen2(file, matrixGroupName.constData(), H5P_DEFAULT), H5Gclose);
+    if (!matrixGroup.isValid()) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "-" << matrixGroupName << "is no group";
+        return false;
+    }
+
+    QStringList featureNames, featureTypes;
+    bool isFeaturesRead;
+
+    if (isLinkExists(matrixGroup, "features")) {
+        Handle featuresGroup(H5Gopen2(matrixGroup, "features", H5P_DEFAULT), H5Gclose);
+        isFeaturesRead = featuresGroup.isValid() && readStrings(featuresGroup, "name", featureNames)
+                         && (!isLinkExists(featuresGroup, "feature_type") || readStrings(featuresGroup, "feature_type", featureTypes));
+    } else {
+        isFeaturesRead = readStrings(matrixGroup, "gene_names", featureNames);
+    }
+
+    if (!isFeaturesRead || !readStrings(matrixGroup, "barcodes", cellBarcodes) || (!featureTypes.isEmpty() && featureTypes.length() != featureNames.length())) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "-" << matrixGroupName << "- features or barcodes are missing";
+        return false;
+    }
+
+    // Features of other types (e.g. antibody capture) have no row
+    QStringList geneIDs;
+    QVector<int> geneFeatureNumbers;
+
+    for (int i = 0; i < featureNames.length(); i++) {
+        if (featureTypes.isEmpty() || featureTypes[i] == "Gene Expression") {
+            geneIDs.append(featureNames[i].toUpper());
+            geneFeatureNumbers.append(i);
+        }
+    }
+
+    QVector<int> featureGeneIndices(featureNames.length(), -1);
+    QVector<int> geneIndices = geneDictionary.insertGenes(geneIDs);
+
+    for (int k = 0; k < geneIndices.length(); k++) {
+        featureGeneIndices[geneFeatureNumbers[k]] = geneIndices[k];
+    }
+
+    return readMatrixArrays(matrixGroup, h5FilePath, featureGeneIndices, cellBarcodes.length(),
+                            genomeMatrix.columnOffsets, genomeMatrix.geneIndices, genomeMatrix.values);
+}
+
+/**
+ * @brief mergeGenomeMatrices - Joins the genomes of the same cells into one matrix - every cell holds the entries of all genomes.
+ *        A single genome is moved into the matrix without copying
+ * @param genomeMatrices - CSC arrays of every genome - emptied
+ */
+void mergeGenomeMatrices(QVector<GenomeMatrix> & genomeMatrices, std::vector<qint64> & columnOffsets, std::vector<quint32> & geneIndices, std::vector<float> & values) {
+    if (genomeMatrices.length() == 1) {
+        columnOffsets.swap(genomeMatrices.first().columnOffsets);
+        geneIndices.swap(genomeMatrices.first().geneIndices);
+        values.swap(genomeMatrices.first().values);
+        return;
+    }
+
+    size_t numberOfColumns = genomeMatrices.first().columnOffsets.size() - 1,
+           numberOfEntries = 0;
+
+    for (const GenomeMatrix & genomeMatrix : genomeMatrices) {
+        numberOfEntries += genomeMatrix.values.size();
+    }
+
+    columnOffsets.assign(numberOfColumns + 1, 0);
+    geneIndices.reserve(numberOfEntries);
+    values.reserve(numberOfEntries);
+
+    for (size_t j = 0; j < numberOfColumns; j++) {
+        for (const GenomeMatrix & genomeMatrix : genomeMatrices) {
+            size_t columnStart = size_t(genomeMatrix.columnOffsets[j]),
+                   columnEnd = size_t(genomeMatrix.columnOffsets[j + 1]);
+
+            geneIndices.insert(geneIndices.end(), genomeMatrix.geneIndices.begin() + columnStart, genomeMatrix.geneIndices.begin() + columnEnd);
+            values.insert(values.end(), genomeMatrix.values.begin() + columnStart, genomeMatrix.values.begin() + columnEnd);
+        }
+        columnOffsets[j + 1] = qint64(values.size());
+    }
+
+    genomeMatrices.clear();
+}
+
+}
+#endif
+
+
+/**
+ * @brief isAvailable - Returns whether HDF5 files can be read
+ * @return True if built with HDF5 support
+ */
+bool isAvailable() {
+#ifdef BADGER_HDF5
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief readFeatureBarcodeMatrix - Reads a cellranger HDF5 feature-barcode matrix into a genes x cells sparse matrix.
+ *        Only "Gene Expression" features become rows, they are added to the gene dictionary by their upper case name, so the matrix shares its rows
+ *        with the other datasets of the project.
+ * @param h5FilePath - Path of the .h5 file
+ * @param geneDictionary - Dictionary of the project that assigns the rows
+ * @param sparseMatrix - Filled with the counts of every cell
+ * @return True if the matrix has been read
+ */
+bool readFeatureBarcodeMatrix(const QString h5FilePath, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix) {
+#ifdef BADGER_HDF5
+    TRACE_SCOPE("Hdf5Reader::readFeatureBarcodeMatrix");
+
+    // Errors are reported by the reader instead of the error stack of the library
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+    Handle file(H5Fopen(QFile::encodeName(h5FilePath).constData(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+    if (!file.isValid()) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- could not be opened as HDF5 file";
+        return false;
+    }
+
+    QList<QByteArray> matrixGroupNames = getMatrixGroupNames(file);
+
+    if (matrixGroupNames.isEmpty()) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- no matrix group";
+        return false;
+    }
+
+    // The genomes of a multi genome reference hold the same cells - they are read one after the other and merged cell by cell
+    QStringList cellBarcodes;
+    QVector<GenomeMatrix> genomeMatrices(matrixGroupNames.length());
+
+    for (int i = 0; i < matrixGroupNames.length(); i++) {
+        QStringList genomeCellBarcodes;
+
+        if (!readMatrixGroup(file, matrixGroupNames[i], h5FilePath, geneDictionary, genomeCellBarcodes, genomeMatrices[i])) {
+            return false;
+        }
+
+        if (i == 0) {
+            cellBarcodes = genomeCellBarcodes;
+        } else if (genomeCellBarcodes != cellBarcodes) {
+            qDebug() << "HDF5 READER:" << h5FilePath << "- the genomes" << matrixGroupNames.first() << "and" << matrixGroupNames[i] << "hold different barcodes";
+            return false;
+        }
+    }
+
+    std::vector<qint64> columnOffsets;
+    std::vector<quint32> matrixGeneIndices;
+    std::vector<float> values;
+    mergeGenomeMatrices(genomeMatrices, columnOffsets, matrixGeneIndices, values);
+
+    // Taken after the insertion, so every gene of this matrix has a row
+    sparseMatrix = SparseMatrix(geneDictionary.getGeneIDs(), cellBarcodes, std::move(columnOffsets), std::move(matrixGeneIndices), std::move(values));
+    return true;
+#else
+    Q_UNUSED(geneDictionary)
+    Q_UNUSED(sparseMatrix)
+
+    qDebug() << "HDF5 READER:" << h5FilePath << "- Badger has been built without HDF5 support (qmake CONFIG+=hdf5)";
+    return false;
+#endif
+}
+
+
+
+/**
+ * @brief readMatrixSizes - Reads only the lengths of the datasets of an HDF5 feature-barcode matrix - e.g. to estimate its memory.
+ *        The features and entries of all genomes of cellranger 2 are summed up
+ * @param h5FilePath - Path of the .h5 file
+ * @param numberOfFeatures - Set to the number of features
+ * @param numberOfCells - Set to the number of cells
+ * @param numberOfEntries - Set to the number of non-zero entries
+ * @return True if the lengths have been read
+ */
+bool readMatrixSizes(const QString h5FilePath, qint64 & numberOfFeatures, qint64 & numberOfCells, qint64 & numberOfEntries) {
+#ifdef BADGER_HDF5
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+    Handle file(H5Fopen(QFile::encodeName(h5FilePath).constData(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+    QList<QByteArray> matrixGroupNames = file.isValid() ? getMatrixGroupNames(file) : QList<QByteArray>();
+    bool isRead = !matrixGroupNames.isEmpty();
+
+    numberOfFeatures = 0;
+    numberOfCells = 0;
+    numberOfEntries = 0;
+
+    for (const QByteArray & matrixGroupName : matrixGroupNames) {
+        Handle matrixGroup(H5Gopen2(file, matrixGroupName.constData(), H5P_DEFAULT), H5Gclose);
+        if (!matrixGroup.isValid()) {
+            isRead = false;
+            break;
+        }
+
+        qint64 groupFeatures = getDatasetLength(matrixGroup, "gene_names");
+        if (isLinkExists(matrixGroup, "features")) {
+            Handle featuresGroup(H5Gopen2(matrixGroup, "features", H5P_DEFAULT), H5Gclose);
+            groupFeatures = featuresGroup.isValid() ? getDatasetLength(featuresGroup, "name") : -1;
+        }
+
+        qint64 groupEntries = getDatasetLength(matrixGroup, "data"),
+               groupColumns = getDatasetLength(matrixGroup, "indptr");
+
+        if (groupFeatures < 0 || groupEntries < 0 || groupColumns < 1) {
+            isRead = false;
+            break;
+        }
+
+        numberOfFeatures += groupFeatures;
+        numberOfCells = groupColumns - 1;
+        numberOfEntries += groupEntries;
+    }
+
+    if (!isRead) {
+        qDebug() << "HDF5 READER:" << h5FilePath << "- sizes of the matrix could not be read";
+    }
+    return isRead;
+#else
+    Q_UNUSED(numberOfFeatures)
+    Q_UNUSED(numberOfCells)
+    Q_UNUSED(numberOfEntries)
+
+    qDebug() << "HDF5 READER:" << h5FilePath << "- Badger has been built without HDF5 support (qmake CONFIG+=hdf5)";
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef HDF5READER_H
+#define HDF5READER_H
+
+#include <QString>
+
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+
+/**
+ * @brief The Hdf5Reader namespace reads cellranger's HDF5 feature-barcode matrices (filtered_feature_bc_matrix.h5) of cellranger 3 and later
+ *        as well as the per genome layout of cellranger 2, whose genomes are merged into one matrix. The file already holds the CSC arrays,
+ *        they are read in hyperslabs aligned to the chunks of the file straight into the sparse matrix - there is no text to parse.
+ *        HDF5 support is only compiled in when building with "qmake CONFIG+=hdf5".
+ */
+namespace Hdf5Reader
+{
+    extern bool isAvailable();
+    extern bool readFeatureBarcodeMatrix(const QString h5FilePath, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix);
+    extern bool readMatrixSizes(const QString h5FilePath, qint64 & numberOfFeatures, qint64 & numberOfCells, qint64 & numberOfEntries);
+};
+
+#endif // HDF5READER_H
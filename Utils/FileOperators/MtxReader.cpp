@@ -0,0 +1,522 @@
+#include "MtxReader.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFuture>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
+
+namespace MtxReader {
+
+namespace {
+
+// Uncompressed bytes per parsed chunk
+const int chunkBytes = 8 * 1024 * 1024;
+
+/**
+ * @brief The ParsedChunk struct holds the entries of a chunk of complete lines of the Matrix Market file
+ */
+struct ParsedChunk
+{
+    std::vector<quint32> geneIndices;
+    std::vector<quint32> cellIndices;
+    std::vector<float> values;
+    // Entries of the chunk including the ones of features that are no genes
+    qint64 numberOfEntries = 0;
+    bool isValid = true;
+};
+
+/**
+ * @brief findFile - Returns the first of the given files that exists in the directory
+ * @return File path - empty if none of the files exists
+ */
+QString findFile(const QDir & directory, const QStringList & fileNames) {
+    for (const QString & fileName : fileNames) {
+        if (QFile::exists(directory.filePath(fileName))) {
+            return directory.filePath(fileName);
+        }
+    }
+    return QString();
+}
+
+/**
+ * @brief readGzipFile - Reads a whole file that is gzip compressed or uncompressed
+ * @param filePath - Path of the file
+ * @param content - Filled with the uncompressed content
+ * @return True if the file has been read
+ */
+bool readGzipFile(const QString filePath, QByteArray & content) {
+    gzFile file = gzopen(QFile::encodeName(filePath).constData(), "rb");
+
+    if (file == nullptr) {
+        qDebug() << "MTX READER:" << filePath << "- could not be opened";
+        return false;
+    }
+
+    int numberOfBytes;
+    content.clear();
+
+    do {
+        int oldSize = content.size();
+        content.resize(oldSize + chunkBytes);
+        numberOfBytes = gzread(file, content.data() + oldSize, unsigned(chunkBytes));
+        content.resize(oldSize + qMax(numberOfBytes, 0));
+    } while (numberOfBytes > 0);
+
+    if (numberOfBytes < 0) {
+        int errorNumber;
+        qDebug() << "MTX READER:" << filePath << "-" << gzerror(file, &errorNumber);
+    }
+
+    gzclose(file);
+    return numberOfBytes == 0;
+}
+
+/**
+ * @brief readLines - Reads the non-empty lines of a gzip compressed or uncompressed text file
+ */
+bool readLines(const QString filePath, QList<QByteArray> & lines) {
+    QByteArray content;
+
+    if (!readGzipFile(filePath, content)) {
+        return false;
+    }
+
+    lines.clear();
+    for (const QByteArray & line : content.split('\n')) {
+        if (!line.trimmed().isEmpty()) {
+            lines.append(line.trimmed());
+        }
+    }
+    return true;
+}
+
+bool isSpace(const char character) {
+    return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+}
+
+/**
+ * @brief parseUnsigned - Parses an unsigned number and moves the position behind it - leading spaces and tabs are skipped
+ * @return True if a number has been found
+ */
+bool parseUnsigned(const char *& position, const char * end, quint64 & value) {
+    while (position < end && (*position == ' ' || *position == '\t')) {
+        position++;
+    }
+
+    const char * start = position;
+    value = 0;
+
+    while (position < end && *position >= '0' && *position <= '9') {
+        value = value * 10 + quint64(*position - '0');
+        position++;
+    }
+
+    return position != start;
+}
+
+/**
+ * @brief parseValue - Parses a count and moves the position behind it. cellranger writes integer counts, real values take the slower general path
+ * @return True if a number has been found
+ */
+bool parseValue(const char *& position, const char * end, float & value) {
+    while (position < end && (*position == ' ' || *position == '\t')) {
+        position++;
+    }
+
+    const char * start = position;
+    quint64 integerValue;
+
+    if (parseUnsigned(position, end, integerValue) && (position == end || isSpace(*position))) {
+        value = float(integerValue);
+        return true;
+    }
+
+    // Signed values or values with fraction or exponent
+    position = start;
+    while (position < end && !isSpace(*position)) {
+        position++;
+    }
+
+    bool isNumber = false;
+    value = QByteArray::fromRawData(start, int(position - start)).toFloat(&isNumber);
+    return isNumber;
+}
+
+/**
+ * @brief parseChunk - Parses the entries of a chunk of complete lines. Features are mapped to their rows in the gene dictionary,
+ *        entries of features that are no genes are counted but dropped
+ * @param chunk - Lines "feature cell value" with 1-based feature and cell numbers
+ * @param featureGeneIndices - Dictionary row of every feature - -1 for features that are no genes
+ * @param numberOfCells - Number of cells given in the size line
+ * @return Entries of the chunk - invalid if a line is malformed or out of range
+ */
+ParsedChunk parseChunk(const QByteArray chunk, const QVector<int> featureGeneIndices, const int numberOfCells) {
+    TRACE_SCOPE("MtxReader::parseChunk");
+
+    ParsedChunk parsedChunk;
+    // Lines of a cellranger matrix take about 12 bytes
+    parsedChunk.geneIndices.reserve(size_t(chunk.size() / 12));
+    parsedChunk.cellIndices.reserve(size_t(chunk.size() / 12));
+    parsedChunk.values.reserve(size_t(chunk.size() / 12));
+
+    const char * position = chunk.constData();
+    const char * end = position + chunk.size();
+
+    while (position < end) {
+        if (isSpace(*position)) {
+            position++;
+            continue;
+        }
+
+        quint64 featureNumber, cellNumber;
+        float value;
+
+        if (!parseUnsigned(position, end, featureNumber) || !parseUnsigned(position, end, cellNumber) || !parseValue(position, end, value)
+                || featureNumber == 0 || featureNumber > quint64(featureGeneIndices.length()) || cellNumber == 0 || cellNumber > quint64(numberOfCells)) {
+            parsedChunk.isValid = false;
+            return parsedChunk;
+        }
+
+        while (position < end && *position != '\n') {
+            position++;
+        }
+
+        parsedChunk.numberOfEntries++;
+
+        int geneIndex = featureGeneIndices[int(featureNumber - 1)];
+        if (geneIndex < 0) {
+            continue;
+        }
+
+        parsedChunk.geneIndices.push_back(quint32(geneIndex));
+        parsedChunk.cellIndices.push_back(quint32(cellNumber - 1));
+        parsedChunk.values.push_back(value);
+    }
+
+    return parsedChunk;
+}
+
+/**
+ * @brief readHeader - Reads the banner, the comments and the size line of a Matrix Market file
+ * @param matrixFile - Opened file
+ * @param pending - Filled with the bytes read behind the size line
+ * @param sizes - Filled with the number of features, cells and entries
+ * @return True if the file holds a general real or integer coordinate matrix
+ */
+bool readHeader(gzFile matrixFile, const QString matrixFilePath, QByteArray & pending, qint64 sizes[3]) {
+    bool isBannerRead = false;
+
+    while (true) {
+        int lineEnd = pending.indexOf('\n');
+
+        if (lineEnd < 0) {
+            int oldSize = pending.size();
+            pending.resize(oldSize + chunkBytes);
+            int numberOfBytes = gzread(matrixFile, pending.data() + oldSize, unsigned(chunkBytes));
+            pending.resize(oldSize + qMax(numberOfBytes, 0));
+
+            if (numberOfBytes <= 0) {
+                qDebug() << "MTX READER:" << matrixFilePath << "- incomplete header";
+                return false;
+            }
+            continue;
+        }
+
+        QByteArray line = pending.left(lineEnd).trimmed();
+        pending.remove(0, lineEnd + 1);
+
+        if (!isBannerRead) {
+            QByteArray banner = line.toLower();
+
+            if (!banner.startsWith("%%matrixmarket matrix coordinate") || banner.contains("pattern") || banner.contains("complex") || !banner.contains("general")) {
+                qDebug() << "MTX READER:" << matrixFilePath << "- not a general real or integer coordinate matrix";
+                return false;
+            }
+
+            isBannerRead = true;
+            continue;
+        }
+
+        if (line.isEmpty() || line.startsWith('%')) {
+            continue;
+        }
+
+        QList<QByteArray> splitLine = line.simplified().split(' ');
+        bool isNumber = splitLine.length() == 3;
+
+        for (int i = 0; i < 3 && isNumber; i++) {
+            sizes[i] = splitLine[i].toLongLong(&isNumber);
+        }
+
+        if (!isNumber) {
+            qDebug() << "MTX READER:" << matrixFilePath << "- invalid size line";
+        }
+        return isNumber;
+    }
+}
+
+/**
+ * @brief readEntries - Decompresses the entries on this thread and parses them in chunks on the parsing pool. The chunks are appended in file order,
+ *        cellranger writes the entries cell by cell, which then already is CSC order. Files in any other order are sorted by cell afterwards,
+ *        which takes a second copy of the matrix
+ * @param matrixFile - File positioned behind the size line
+ * @param pending - Bytes read behind the size line
+ * @param numberOfEntries - Number of entries given in the size line
+ * @param columnOffsets - Filled with the start of every cell
+ * @param geneIndices - Filled with the row of every value
+ * @param values - Filled with the counts
+ * @return True if every entry has been read
+ */
+bool readEntries(gzFile matrixFile, const QString matrixFilePath, QByteArray pending, const qint64 numberOfEntries, const QVector<int> featureGeneIndices,
+                 const int numberOfCells, std::vector<qint64> & columnOffsets, std::vector<quint32> & geneIndices, std::vector<float> & values) {
+    // Counts per cell until all entries are read, shifted by one to become offsets in place
+    columnOffsets.assign(size_t(numberOfCells) + 1, 0);
+    geneIndices.reserve(size_t(numberOfEntries));
+    values.reserve(size_t(numberOfEntries));
+
+    // Cell of every value - only needed once the entries turn out to be unsorted
+    std::vector<quint32> cellIndices;
+    bool isSortedByCell = true;
+    quint32 lastCellIndex = 0;
+    qint64 numberOfReadEntries = 0;
+    bool isValid = true;
+
+    auto appendChunk = [&](const ParsedChunk & parsedChunk) {
+        numberOfReadEntries += parsedChunk.numberOfEntries;
+
+        if (!parsedChunk.isValid || numberOfReadEntries > numberOfEntries) {
+            isValid = false;
+            return;
+        }
+
+        for (quint32 cellIndex : parsedChunk.cellIndices) {
+            if (isSortedByCell && cellIndex < lastCellIndex) {
+                // Every entry so far has been sorted, so their cells follow from the counts
+                isSortedByCell = false;
+                cellIndices.reserve(geneIndices.capacity());
+
+                for (int j = 0; j < numberOfCells; j++) {
+                    cellIndices.insert(cellIndices.end(), size_t(columnOffsets[size_t(j) + 1]), quint32(j));
+                }
+            }
+
+            if (!isSortedByCell) {
+                cellIndices.push_back(cellIndex);
+            }
+
+            columnOffsets[size_t(cellIndex) + 1]++;
+            lastCellIndex = cellIndex;
+        }
+
+        geneIndices.insert(geneIndices.end(), parsedChunk.geneIndices.begin(), parsedChunk.geneIndices.end());
+        values.insert(values.end(), parsedChunk.values.begin(), parsedChunk.values.end());
+    };
+
+    // Two chunks per thread keep every thread busy while this thread decompresses
+    int maximumChunksInFlight = 2 * ThreadPools::getThreadPool(ThreadPools::ParsingPool)->maxThreadCount();
+    QQueue<QFuture<ParsedChunk>> futureParsedChunks;
+    bool isEndOfFile = false;
+
+    while (isValid && !(isEndOfFile && futureParsedChunks.isEmpty())) {
+        if (!isEndOfFile) {
+            int oldSize = pending.size();
+            pending.resize(oldSize + chunkBytes);
+            int numberOfBytes = gzread(matrixFile, pending.data() + oldSize, unsigned(chunkBytes));
+            pending.resize(oldSize + qMax(numberOfBytes, 0));
+
+            if (numberOfBytes < 0) {
+                int errorNumber;
+                qDebug() << "MTX READER:" << matrixFilePath << "-" << gzerror(matrixFile, &errorNumber);
+                return false;
+            }
+            isEndOfFile = numberOfBytes == 0;
+
+            // Chunks end behind their last complete line, the rest is carried over to the next chunk
+            int chunkEnd = isEndOfFile ? pending.size() : pending.lastIndexOf('\n') + 1;
+
+            if (chunkEnd > 0) {
+                QByteArray chunk = pending;
+                pending = chunk.mid(chunkEnd);
+                chunk.truncate(chunkEnd);
+
+                futureParsedChunks.enqueue(ThreadPools::run(ThreadPools::ParsingPool, [chunk, featureGeneIndices, numberOfCells]() {
+                    return parseChunk(chunk, featureGeneIndices, numberOfCells);
+                }));
+            }
+        }
+
+        // Bounded memory - the oldest chunk is appended before any further one is read
+        while (isValid && !futureParsedChunks.isEmpty() && (futureParsedChunks.length() >= maximumChunksInFlight || isEndOfFile)) {
+            appendChunk(futureParsedChunks.dequeue().result());
+        }
+    }
+
+    if (!isValid) {
+        qDebug() << "MTX READER:" << matrixFilePath << "- malformed entry or more entries than given in the size line";
+        return false;
+    }
+
+    if (numberOfReadEntries != numberOfEntries) {
+        qDebug() << "MTX READER:" << matrixFilePath << "- expected" << numberOfEntries << "entries, found" << numberOfReadEntries;
+        return false;
+    }
+
+    for (size_t j = 0; j < size_t(numberOfCells); j++) {
+        columnOffsets[j + 1] += columnOffsets[j];
+    }
+
+    if (!isSortedByCell) {
+        std::vector<qint64> positions(columnOffsets.begin(), columnOffsets.end() - 1);
+        std::vector<quint32> sortedGeneIndices(geneIndices.size());
+        std::vector<float> sortedValues(values.size());
+
+        for (size_t k = 0; k < cellIndices.size(); k++) {
+            size_t position = size_t(positions[cellIndices[k]]++);
+            sortedGeneIndices[position] = geneIndices[k];
+            sortedValues[position] = values[k];
+        }
+
+        geneIndices.swap(sortedGeneIndices);
+        values.swap(sortedValues);
+    }
+
+    return true;
+}
+
+}
+
+
+/**
+ * @brief readFeatureBarcodeMatrix - Reads a cellranger feature-barcode matrix directory into a genes x cells sparse matrix.
+ *        Only "Gene Expression" features become rows, they are added to the gene dictionary by their upper case name, so the matrix shares its rows
+ *        with the other datasets of the project.
+ * @param matrixDirectoryPath - Directory with matrix.mtx(.gz), features.tsv(.gz) or genes.tsv(.gz) and barcodes.tsv(.gz)
+ * @param geneDictionary - Dictionary of the project that assigns the rows
+ * @param sparseMatrix - Filled with the counts of every cell
+ * @return True if the matrix has been read
+ */
+bool readFeatureBarcodeMatrix(const QString matrixDirectoryPath, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix) {
+    TRACE_SCOPE("MtxReader::readFeatureBarcodeMatrix");
+
+    QDir matrixDirectory(matrixDirectoryPath);
+    QString matrixFilePath = findFile(matrixDirectory, { "matrix.mtx.gz", "matrix.mtx" }),
+            featuresFilePath = findFile(matrixDirectory, { "features.tsv.gz", "features.tsv", "genes.tsv.gz", "genes.tsv" }),
+            barcodesFilePath = findFile(matrixDirectory, { "barcodes.tsv.gz", "barcodes.tsv" });
+
+    if (matrixFilePath.isEmpty() || featuresFilePath.isEmpty() || barcodesFilePath.isEmpty()) {
+        qDebug() << "MTX READER:" << matrixDirectoryPath << "- matrix.mtx, features.tsv or barcodes.tsv is missing";
+        return false;
+    }
+
+    QList<QByteArray> featureLines, barcodeLines;
+    if (!readLines(featuresFilePath, featureLines) || !readLines(barcodesFilePath, barcodeLines)) {
+        return false;
+    }
+
+    // Features of other types (e.g. antibody capture) have no row
+    QStringList geneIDs;
+    QVector<int> geneFeatureNumbers;
+
+    for (int i = 0; i < featureLines.length(); i++) {
+        QList<QByteArray> splitLine = featureLines[i].split('\t');
+
+        // Genes are known by their upper case name like in the cluster and reference files - features of the same name share a row
+        if (splitLine.length() < 3 || splitLine[2] == "Gene Expression") {
+            geneIDs.append(QString::fromUtf8(splitLine[splitLine.length() > 1 ? 1 : 0]).toUpper());
+            geneFeatureNumbers.append(i);
+        }
+    }
+
+    QVector<int> featureGeneIndices(featureLines.length(), -1);
+    QVector<int> geneIndices = geneDictionary.insertGenes(geneIDs);
+
+    for (int k = 0; k < geneIndices.length(); k++) {
+        featureGeneIndices[geneFeatureNumbers[k]] = geneIndices[k];
+    }
+
+    QStringList cellBarcodes;
+    cellBarcodes.reserve(barcodeLines.length());
+    for (const QByteArray & barcodeLine : barcodeLines) {
+        cellBarcodes.append(QString::fromLatin1(barcodeLine));
+    }
+
+    gzFile matrixFile = gzopen(QFile::encodeName(matrixFilePath).constData(), "rb");
+
+    if (matrixFile == nullptr) {
+        qDebug() << "MTX READER:" << matrixFilePath << "- could not be opened";
+        return false;
+    }
+    gzbuffer(matrixFile, 1024 * 1024);
+
+    QByteArray pending;
+    qint64 sizes[3];
+    std::vector<qint64> columnOffsets;
+    std::vector<quint32> matrixGeneIndices;
+    std::vector<float> values;
+
+    bool isRead = readHeader(matrixFile, matrixFilePath, pending, sizes);
+
+    if (isRead && (sizes[0] != featureLines.length() || sizes[1] != cellBarcodes.length())) {
+        qDebug() << "MTX READER:" << matrixFilePath << "- size line does not match" << featureLines.length() << "features and" << cellBarcodes.length() << "barcodes";
+        isRead = false;
+    }
+
+    isRead = isRead && readEntries(matrixFile, matrixFilePath, pending, sizes[2], featureGeneIndices, cellBarcodes.length(), columnOffsets, matrixGeneIndices, values);
+    gzclose(matrixFile);
+
+    if (!isRead) {
+        return false;
+    }
+
+    // Taken after the insertion, so every gene of this matrix has a row
+    sparseMatrix = SparseMatrix(geneDictionary.getGeneIDs(), cellBarcodes, std::move(columnOffsets), std::move(matrixGeneIndices), std::move(values));
+    return true;
+}
+
+
+
+/**
+ * @brief readMatrixSizes - Reads only the size line of the Matrix Market file of a feature-barcode matrix directory - e.g. to estimate its memory
+ * @param matrixDirectoryPath - Directory with matrix.mtx(.gz)
+ * @param numberOfFeatures - Set to the number of features
+ * @param numberOfCells - Set to the number of cells
+ * @param numberOfEntries - Set to the number of non-zero entries
+ * @return True if the size line has been read
+ */
+bool readMatrixSizes(const QString matrixDirectoryPath, qint64 & numberOfFeatures, qint64 & numberOfCells, qint64 & numberOfEntries) {
+    QString matrixFilePath = findFile(QDir(matrixDirectoryPath), { "matrix.mtx.gz", "matrix.mtx" });
+    gzFile matrixFile = matrixFilePath.isEmpty() ? nullptr : gzopen(QFile::encodeName(matrixFilePath).constData(), "rb");
+
+    if (matrixFile == nullptr) {
+        qDebug() << "MTX READER:" << matrixDirectoryPath << "- matrix.mtx could not be opened";
+        return false;
+    }
+
+    QByteArray pending;
+    qint64 sizes[3];
+    bool isRead = readHeader(matrixFile, matrixFilePath, pending, sizes);
+    gzclose(matrixFile);
+
+    if (isRead) {
+        numberOfFeatures = sizes[0];
+        numberOfCells = sizes[1];
+        numberOfEntries = sizes[2];
+    }
+    return isRead;
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef MTXREADER_H
+#define MTXREADER_H
+
+#include <QString>
+
+#include "BioModels/GeneDictionary.h"
+#include "BioModels/SparseMatrix.h"
+
+/**
+ * @brief The MtxReader namespace reads the per cell counts of a cellranger feature-barcode matrix directory (filtered_feature_bc_matrix/:
+ *        matrix.mtx.gz, features.tsv.gz, barcodes.tsv.gz - or the uncompressed files of older cellranger versions).
+ *        The Matrix Market file is decompressed on the fly and parsed in chunks on the parsing pool, so only a bounded number of chunks
+ *        is held besides the matrix itself.
+ */
+namespace MtxReader
+{
+    extern bool readFeatureBarcodeMatrix(const QString matrixDirectoryPath, GeneDictionary & geneDictionary, SparseMatrix & sparseMatrix);
+    extern bool readMatrixSizes(const QString matrixDirectoryPath, qint64 & numberOfFeatures, qint64 & numberOfCells, qint64 & numberOfEntries);
+};
+
+#endif // MTXREADER_H
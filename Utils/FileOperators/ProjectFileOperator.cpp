@@ -0,0 +1,419 @@
+#include "ProjectFileOperator.h"
+
+#include <QDebug>
+#include <QByteArray>
+#include <QHash>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "System/InformationCenter.h"
+#include "BioModels/ExpressionMatrix.h"
+
+namespace ProjectFileOperator {
+
+namespace {
+
+const quint32 projectFileMagic = 0x42444750; // "BDGP"
+const quint32 projectFileVersion = 2;
+// Files of version 1 are still read - they are written as the current version on the next save
+const quint32 firstProjectFileVersion = 1;
+
+// Matrices start at cache line boundaries so they can be used in place with aligned loads
+const quint64 matrixAlignment = 64;
+
+// The file is laid out as: header | dataset entries | cluster entries | correlation entries | gene entries | type entries |
+// UTF-16 string pool | matrices. Everything is stored in host byte order, the magic number rejects files of the other byte order.
+struct StringEntry
+{
+    quint32 offset;
+    quint32 length;
+};
+
+struct ProjectHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 headerSize;
+    quint32 numberOfGenes;
+    quint32 numberOfTypes;
+    quint32 numberOfDatasets;
+    quint32 numberOfClusters;
+    quint32 numberOfCorrelations;
+    double cellMarkersCutoff;
+    double datasetCutoff;
+    StringEntry cellMarkersFilePath;
+    quint64 datasetsOffset;
+    quint64 clustersOffset;
+    quint64 correlationsOffset;
+    quint64 genesOffset;
+    quint64 typesOffset;
+    quint64 stringPoolOffset;
+    quint64 stringPoolLength;
+    quint64 fileSize;
+};
+
+struct DatasetEntry
+{
+    StringEntry filePath;
+    quint32 firstCluster;
+    quint32 numberOfClusters;
+    // The rows of a matrix are the first genes of the dictionary - later datasets may have added more
+    quint32 numberOfGenes;
+    quint32 reserved;
+    // Row-wise genes x clusters floats
+    quint64 matrixOffset;
+};
+
+// Dataset entry of version 1 - every matrix has a row for every gene of the dictionary
+struct DatasetEntryVersion1
+{
+    StringEntry filePath;
+    quint32 firstCluster;
+    quint32 numberOfClusters;
+    quint64 matrixOffset;
+};
+
+struct ClusterEntry
+{
+    StringEntry ID;
+    quint32 firstCorrelation;
+    quint32 numberOfCorrelations;
+};
+
+struct CorrelationEntry
+{
+    quint32 typeIndex;
+    quint32 reserved;
+    double correlation;
+};
+
+quint64 alignUp(quint64 offset, quint64 alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief writeBlock - Appends the bytes of a table to the file
+ * @return True if every byte has been written
+ */
+bool writeBlock(QSaveFile & projectFile, const void * data, quint64 size) {
+    return size == 0 || projectFile.write(static_cast<const char *>(data), qint64(size)) == qint64(size);
+}
+
+}
+
+
+/**
+ * @brief writeProjectFile - Writes the results of the current project. The file is replaced atomically, so a failed save never destroys an older project file.
+ *        Strings are stored once in a string pool, types are referenced by index from the correlations
+ * @param projectFilePath - Path of the project file
+ * @param informationCenter - State of the project
+ * @return True if the file has been written completely
+ */
+bool writeProjectFile(QString projectFilePath, const InformationCenter & informationCenter) {
+    const QStringList & geneIDs = informationCenter.completeSetOfGeneIDs;
+    int numberOfDatasets = informationCenter.expressionMatrices.length();
+
+    QVector<DatasetEntry> datasetEntries;
+    QVector<ClusterEntry> clusterEntries;
+    QVector<CorrelationEntry> correlationEntries;
+    QVector<StringEntry> geneEntries, typeEntries;
+    QString stringPool;
+    QHash<QString, quint32> stringOffsets, typeIndices;
+
+    // Returns the pool entry of the given string and adds it to the pool if it has not been seen before
+    auto addString = [&stringPool, &stringOffsets](const QString & string) {
+        auto existingOffset = stringOffsets.constFind(string);
+        quint32 offset = existingOffset != stringOffsets.constEnd() ? existingOffset.value() : quint32(stringPool.length());
+
+        if (existingOffset == stringOffsets.constEnd()) {
+            stringPool.append(string);
+            stringOffsets.insert(string, offset);
+        }
+
+        return StringEntry { offset, quint32(string.length()) };
+    };
+
+    geneEntries.reserve(geneIDs.length());
+    for (const QString & geneID : geneIDs) {
+        geneEntries.append(addString(geneID));
+    }
+
+    for (int i = 0; i < numberOfDatasets; i++) {
+        const ExpressionMatrix & expressionMatrix = informationCenter.expressionMatrices.at(i);
+        const QVector<QVector<QPair<QString, double>>> & correlations = informationCenter.correlatedDatasets.at(i);
+
+        // Every matrix has its rows in the first genes of the dictionary
+        if (expressionMatrix.getNumberOfGenes() > geneIDs.length()) {
+            qDebug() << "PROJECT FILE:" << projectFilePath << "- dataset" << i << "does not match the gene dictionary.";
+            return false;
+        }
+
+        DatasetEntry datasetEntry;
+        datasetEntry.filePath = addString(informationCenter.datasetFilePaths.value(i));
+        datasetEntry.firstCluster = quint32(clusterEntries.length());
+        datasetEntry.numberOfClusters = quint32(expressionMatrix.getNumberOfClusters());
+        datasetEntry.numberOfGenes = quint32(expressionMatrix.getNumberOfGenes());
+        datasetEntry.reserved = 0;
+        datasetEntry.matrixOffset = 0;
+        datasetEntries.append(datasetEntry);
+
+        for (int j = 0; j < expressionMatrix.getNumberOfClusters(); j++) {
+            QVector<QPair<QString, double>> clusterCorrelations = correlations.value(j);
+
+            ClusterEntry clusterEntry;
+            clusterEntry.ID = addString(expressionMatrix.getClusterID(j));
+            clusterEntry.firstCorrelation = quint32(correlationEntries.length());
+            clusterEntry.numberOfCorrelations = quint32(clusterCorrelations.length());
+            clusterEntries.append(clusterEntry);
+
+            for (const QPair<QString, double> & correlation : clusterCorrelations) {
+                if (!typeIndices.contains(correlation.first)) {
+                    typeIndices.insert(correlation.first, quint32(typeEntries.length()));
+                    typeEntries.append(addString(correlation.first));
+                }
+
+                correlationEntries.append({ typeIndices.value(correlation.first), 0, correlation.second });
+            }
+        }
+    }
+
+    ProjectHeader header;
+    header.magic = projectFileMagic;
+    header.version = projectFileVersion;
+    header.headerSize = sizeof(ProjectHeader);
+    header.numberOfGenes = quint32(geneEntries.length());
+    header.numberOfTypes = quint32(typeEntries.length());
+    header.numberOfDatasets = quint32(datasetEntries.length());
+    header.numberOfClusters = quint32(clusterEntries.length());
+    header.numberOfCorrelations = quint32(correlationEntries.length());
+    header.cellMarkersCutoff = informationCenter.cellMarkersCutoff;
+    header.datasetCutoff = informationCenter.datasetCutoff;
+    header.cellMarkersFilePath = addString(informationCenter.cellMarkersFilePath);
+
+    header.datasetsOffset = sizeof(ProjectHeader);
+    header.clustersOffset = header.datasetsOffset + sizeof(DatasetEntry) * quint64(datasetEntries.length());
+    header.correlationsOffset = header.clustersOffset + sizeof(ClusterEntry) * quint64(clusterEntries.length());
+    header.genesOffset = header.correlationsOffset + sizeof(CorrelationEntry) * quint64(correlationEntries.length());
+    header.typesOffset = header.genesOffset + sizeof(StringEntry) * quint64(geneEntries.length());
+    header.stringPoolOffset = header.typesOffset + sizeof(StringEntry) * quint64(typeEntries.length());
+    header.stringPoolLength = quint64(stringPool.length());
+
+    quint64 fileSize = header.stringPoolOffset + sizeof(QChar) * header.stringPoolLength;
+    for (DatasetEntry & datasetEntry : datasetEntries) {
+        datasetEntry.matrixOffset = alignUp(fileSize, matrixAlignment);
+        fileSize = datasetEntry.matrixOffset + sizeof(float) * quint64(datasetEntry.numberOfGenes) * datasetEntry.numberOfClusters;
+    }
+    header.fileSize = fileSize;
+
+    QSaveFile projectFile(projectFilePath);
+
+    if (!projectFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "-" << projectFile.errorString();
+        return false;
+    }
+
+    bool isWritten = writeBlock(projectFile, &header, sizeof(ProjectHeader))
+            && writeBlock(projectFile, datasetEntries.constData(), sizeof(DatasetEntry) * quint64(datasetEntries.length()))
+            && writeBlock(projectFile, clusterEntries.constData(), sizeof(ClusterEntry) * quint64(clusterEntries.length()))
+            && writeBlock(projectFile, correlationEntries.constData(), sizeof(CorrelationEntry) * quint64(correlationEntries.length()))
+            && writeBlock(projectFile, geneEntries.constData(), sizeof(StringEntry) * quint64(geneEntries.length()))
+            && writeBlock(projectFile, typeEntries.constData(), sizeof(StringEntry) * quint64(typeEntries.length()))
+            && writeBlock(projectFile, stringPool.constData(), sizeof(QChar) * header.stringPoolLength);
+
+    // The matrices are written as they are in memory - padded to their aligned offsets
+    for (int i = 0; isWritten && i < numberOfDatasets; i++) {
+        const DatasetEntry & datasetEntry = datasetEntries[i];
+        QByteArray padding(int(datasetEntry.matrixOffset - quint64(projectFile.pos())), '\0');
+
+        isWritten = writeBlock(projectFile, padding.constData(), quint64(padding.length()))
+                && writeBlock(projectFile, informationCenter.expressionMatrices.at(i).getValues(), sizeof(float) * quint64(datasetEntry.numberOfGenes) * datasetEntry.numberOfClusters);
+    }
+
+    if (!isWritten || !projectFile.commit()) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- could not be written:" << projectFile.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief readProjectFile - Maps the project file and builds the information center on top of it. Matrices and strings are not copied,
+ *        they point into the mapping, which lives as long as anything refers to it
+ * @param projectFilePath - Path of the project file
+ * @param informationCenter - Information center that receives the project - only changed if the file is valid
+ * @return True if the project has been opened
+ */
+bool readProjectFile(QString projectFilePath, InformationCenter & informationCenter) {
+    int descriptor = open(projectFilePath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (descriptor < 0) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- could not be opened.";
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(descriptor, &fileStatus) != 0 || quint64(fileStatus.st_size) < sizeof(ProjectHeader)) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- is no project file.";
+        close(descriptor);
+        return false;
+    }
+
+    size_t mappingSize = size_t(fileStatus.st_size);
+    void * mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- could not be mapped.";
+        return false;
+    }
+
+    QSharedPointer<const void> projectFileMapping(mapping, [mappingSize](const void * mapping) {
+        munmap(const_cast<void *>(mapping), mappingSize);
+    });
+
+    const char * projectData = static_cast<const char *>(mapping);
+    const ProjectHeader * header = reinterpret_cast<const ProjectHeader *>(projectData);
+
+    bool isKnownVersion = header->version == projectFileVersion || header->version == firstProjectFileVersion;
+
+    if (header->magic != projectFileMagic || !isKnownVersion || header->headerSize != sizeof(ProjectHeader)
+            || header->fileSize != quint64(fileStatus.st_size)) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- unknown format or version.";
+        return false;
+    }
+
+    // Every table has to lie completely within the file
+    quint64 fileSize = header->fileSize;
+    auto isInside = [fileSize](quint64 offset, quint64 count, quint64 elementSize) {
+        return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    };
+
+    bool isFirstVersion = header->version == firstProjectFileVersion;
+
+    bool isValid = isInside(header->datasetsOffset, header->numberOfDatasets, isFirstVersion ? sizeof(DatasetEntryVersion1) : sizeof(DatasetEntry))
+            && isInside(header->clustersOffset, header->numberOfClusters, sizeof(ClusterEntry))
+            && isInside(header->correlationsOffset, header->numberOfCorrelations, sizeof(CorrelationEntry))
+            && isInside(header->genesOffset, header->numberOfGenes, sizeof(StringEntry))
+            && isInside(header->typesOffset, header->numberOfTypes, sizeof(StringEntry))
+            && isInside(header->stringPoolOffset, header->stringPoolLength, sizeof(QChar));
+
+    if (!isValid) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- is damaged.";
+        return false;
+    }
+
+    const ClusterEntry * clusterEntries = reinterpret_cast<const ClusterEntry *>(projectData + header->clustersOffset);
+    const CorrelationEntry * correlationEntries = reinterpret_cast<const CorrelationEntry *>(projectData + header->correlationsOffset);
+    const StringEntry * geneEntries = reinterpret_cast<const StringEntry *>(projectData + header->genesOffset);
+    const StringEntry * typeEntries = reinterpret_cast<const StringEntry *>(projectData + header->typesOffset);
+    const QChar * stringPool = reinterpret_cast<const QChar *>(projectData + header->stringPoolOffset);
+    quint64 stringPoolLength = header->stringPoolLength;
+
+    // Strings are used in place - an entry outside of the pool marks the file as damaged
+    auto toString = [stringPool, stringPoolLength, &isValid](const StringEntry & stringEntry) {
+        if (quint64(stringEntry.offset) + stringEntry.length > stringPoolLength) {
+            isValid = false;
+            return QString();
+        }
+        return QString::fromRawData(stringPool + stringEntry.offset, int(stringEntry.length));
+    };
+
+    InformationCenter loadedInformationCenter(informationCenter.configFile);
+    loadedInformationCenter.projectFileMapping = projectFileMapping;
+    loadedInformationCenter.cellMarkersFilePath = toString(header->cellMarkersFilePath);
+    loadedInformationCenter.cellMarkersCutoff = header->cellMarkersCutoff;
+    loadedInformationCenter.datasetCutoff = header->datasetCutoff;
+
+    loadedInformationCenter.completeSetOfGeneIDs.reserve(int(header->numberOfGenes));
+    for (quint32 i = 0; i < header->numberOfGenes; i++) {
+        loadedInformationCenter.completeSetOfGeneIDs.append(toString(geneEntries[i]));
+    }
+
+    QStringList typeIDs;
+    typeIDs.reserve(int(header->numberOfTypes));
+    for (quint32 i = 0; i < header->numberOfTypes; i++) {
+        typeIDs.append(toString(typeEntries[i]));
+    }
+
+    int numberOfDatasets = int(header->numberOfDatasets);
+
+    // Dataset entries of version 1 are converted - their matrices span the whole dictionary
+    QVector<DatasetEntry> datasetEntries(numberOfDatasets);
+    for (int i = 0; i < numberOfDatasets; i++) {
+        if (isFirstVersion) {
+            const DatasetEntryVersion1 & datasetEntry = reinterpret_cast<const DatasetEntryVersion1 *>(projectData + header->datasetsOffset)[i];
+            datasetEntries[i] = { datasetEntry.filePath, datasetEntry.firstCluster, datasetEntry.numberOfClusters, header->numberOfGenes, 0, datasetEntry.matrixOffset };
+        } else {
+            datasetEntries[i] = reinterpret_cast<const DatasetEntry *>(projectData + header->datasetsOffset)[i];
+        }
+    }
+
+    loadedInformationCenter.xClusterCollections.resize(numberOfDatasets);
+    loadedInformationCenter.spilledDatasetFilePaths.resize(numberOfDatasets);
+    loadedInformationCenter.correlatedDatasets.resize(numberOfDatasets);
+    loadedInformationCenter.expressionMatrices.reserve(numberOfDatasets);
+
+    for (int i = 0; isValid && i < numberOfDatasets; i++) {
+        const DatasetEntry & datasetEntry = datasetEntries[i];
+
+        isValid = quint64(datasetEntry.firstCluster) + datasetEntry.numberOfClusters <= header->numberOfClusters
+                && datasetEntry.numberOfGenes <= header->numberOfGenes
+                && datasetEntry.matrixOffset % matrixAlignment == 0
+                && isInside(datasetEntry.matrixOffset, quint64(datasetEntry.numberOfGenes) * datasetEntry.numberOfClusters, sizeof(float));
+
+        if (!isValid) {
+            break;
+        }
+
+        loadedInformationCenter.datasetFilePaths.append(toString(datasetEntry.filePath));
+
+        QStringList clusterIDs;
+        QVector<QVector<QPair<QString, double>>> & correlations = loadedInformationCenter.correlatedDatasets[i];
+        correlations.resize(int(datasetEntry.numberOfClusters));
+
+        for (quint32 j = 0; j < datasetEntry.numberOfClusters; j++) {
+            const ClusterEntry & clusterEntry = clusterEntries[datasetEntry.firstCluster + j];
+            clusterIDs.append(toString(clusterEntry.ID));
+
+            if (quint64(clusterEntry.firstCorrelation) + clusterEntry.numberOfCorrelations > header->numberOfCorrelations) {
+                isValid = false;
+                break;
+            }
+
+            correlations[int(j)].reserve(int(clusterEntry.numberOfCorrelations));
+            for (quint32 k = 0; k < clusterEntry.numberOfCorrelations; k++) {
+                const CorrelationEntry & correlationEntry = correlationEntries[clusterEntry.firstCorrelation + k];
+
+                if (correlationEntry.typeIndex >= header->numberOfTypes) {
+                    isValid = false;
+                    break;
+                }
+                correlations[int(j)].append(qMakePair(typeIDs[int(correlationEntry.typeIndex)], correlationEntry.correlation));
+            }
+        }
+
+        const float * matrixValues = reinterpret_cast<const float *>(projectData + datasetEntry.matrixOffset);
+        QStringList matrixGeneIDs = loadedInformationCenter.completeSetOfGeneIDs.mid(0, int(datasetEntry.numberOfGenes));
+        loadedInformationCenter.expressionMatrices.append(ExpressionMatrix(matrixGeneIDs, clusterIDs, matrixValues, projectFileMapping));
+    }
+
+    if (!isValid) {
+        qDebug() << "PROJECT FILE:" << projectFilePath << "- is damaged.";
+        return false;
+    }
+
+    informationCenter = loadedInformationCenter;
+    return true;
+}
+
+}
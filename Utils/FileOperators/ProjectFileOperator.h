@@ -0,0 +1,18 @@
+#ifndef PROJECTFILEOPERATOR_H
+#define PROJECTFILEOPERATOR_H
+
+#include <QString>
+
+#include "System/InformationCenter.h"
+
+/**
+ * @brief The ProjectFileOperator namespace saves the results of a run to a binary project file and opens them again.
+ *        The file is laid out so that it can be mapped and used in place: matrices and strings are read directly from the mapping.
+ */
+namespace ProjectFileOperator
+{
+    extern bool writeProjectFile(QString projectFilePath, const InformationCenter & informationCenter);
+    extern bool readProjectFile(QString projectFilePath, InformationCenter & informationCenter);
+};
+
+#endif // PROJECTFILEOPERATOR_H
@@ -0,0 +1,109 @@
+#include "SpillFileOperator.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QDataStream>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace SpillFileOperator {
+
+namespace {
+const quint32 spillFileMagic = 0x42444753; // "BDGS"
+const quint32 spillFileVersion = 1;
+}
+
+/**
+ * @brief writeClusterCollections - Writes the clusters of a dataset to a spill file.
+ *        Every feature ID is stored once in a gene table, the features only reference it by index.
+ * @param spillFilePath - Path of the spill file - an existing file is overwritten
+ * @param clusterCollections - Clusters of the dataset
+ * @return True if the file has been written completely
+ */
+bool writeClusterCollections(QString spillFilePath, QVector<FeatureCollection> clusterCollections) {
+    QFile spillFile(spillFilePath);
+
+    if (!spillFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "SPILL FILE:" << spillFilePath << "-" << spillFile.errorString();
+        return false;
+    }
+
+    // Collect the gene table - most genes are expressed in several clusters
+    QStringList featureIDs;
+    QHash<QString, quint32> featureIndices;
+
+    for (FeatureCollection & cluster : clusterCollections) {
+        for (int i = 0; i < cluster.getNumberOfFeatures(); i++) {
+            QString featureID = cluster.getFeatureID(i);
+
+            if (!featureIndices.contains(featureID)) {
+                featureIndices.insert(featureID, quint32(featureIDs.length()));
+                featureIDs.append(featureID);
+            }
+        }
+    }
+
+    QDataStream spillStream(&spillFile);
+    spillStream << spillFileMagic << spillFileVersion << featureIDs << quint32(clusterCollections.length());
+
+    for (FeatureCollection & cluster : clusterCollections) {
+        spillStream << cluster.ID << quint32(cluster.getNumberOfFeatures());
+
+        for (int i = 0; i < cluster.getNumberOfFeatures(); i++) {
+            spillStream << featureIndices.value(cluster.getFeatureID(i)) << cluster.getFeatureExpressionCount(i);
+        }
+    }
+
+    return spillStream.status() == QDataStream::Ok;
+}
+
+
+/**
+ * @brief readClusterCollections - Reads the clusters of a dataset back from its spill file
+ * @param spillFilePath - Path of the spill file
+ * @return Clusters of the dataset - empty if the file could not be read
+ */
+QVector<FeatureCollection> readClusterCollections(QString spillFilePath) {
+    QVector<FeatureCollection> clusterCollections;
+    QFile spillFile(spillFilePath);
+
+    if (!spillFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "SPILL FILE:" << spillFilePath << "-" << spillFile.errorString();
+        return clusterCollections;
+    }
+
+    QDataStream spillStream(&spillFile);
+    quint32 magic, version, numberOfClusters;
+    QStringList featureIDs;
+
+    spillStream >> magic >> version;
+    if (magic != spillFileMagic || version != spillFileVersion) {
+        qDebug() << "SPILL FILE:" << spillFilePath << "- unknown format";
+        return clusterCollections;
+    }
+
+    spillStream >> featureIDs >> numberOfClusters;
+    clusterCollections.reserve(int(numberOfClusters));
+
+    for (quint32 i = 0; i < numberOfClusters && spillStream.status() == QDataStream::Ok; i++) {
+        QString clusterID;
+        quint32 numberOfFeatures;
+        spillStream >> clusterID >> numberOfFeatures;
+
+        FeatureCollection cluster(clusterID);
+        for (quint32 j = 0; j < numberOfFeatures; j++) {
+            quint32 featureIndex;
+            double expressionCount;
+            spillStream >> featureIndex >> expressionCount;
+
+            cluster.addFeature(featureIDs.value(int(featureIndex)), expressionCount);
+        }
+        clusterCollections.append(cluster);
+    }
+
+    return clusterCollections;
+}
+
+}
@@ -0,0 +1,18 @@
+#ifndef SPILLFILEOPERATOR_H
+#define SPILLFILEOPERATOR_H
+
+#include <QString>
+#include <QVector>
+
+#include "BioModels/FeatureCollection.h"
+
+/**
+ * @brief The SpillFileOperator namespace moves parsed datasets to a compact binary file and back
+ */
+namespace SpillFileOperator
+{
+    extern bool writeClusterCollections(QString spillFilePath, QVector<FeatureCollection> clusterCollections);
+    extern QVector<FeatureCollection> readClusterCollections(QString spillFilePath);
+};
+
+#endif // SPILLFILEOPERATOR_H
@@ -0,0 +1,122 @@
+#include "GeneSearchIndex.h"
+
+#include <QBitArray>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QStringRef>
+#include <QVector>
+
+#include <algorithm>
+
+GeneSearchIndex::GeneSearchIndex() {}
+
+/**
+ * @brief GeneSearchIndex::GeneSearchIndex - Builds the suffix array. Suffixes never cross gene boundaries, so a match always lies within a single gene ID
+ * @param geneIDs - Gene IDs in row order - the returned gene indices refer to this order
+ */
+GeneSearchIndex::GeneSearchIndex(const QStringList & geneIDs) {
+    int numberOfSuffixes = 0;
+
+    this->lowerCaseGeneIDs.reserve(geneIDs.length());
+    for (const QString & geneID : geneIDs) {
+        this->lowerCaseGeneIDs.append(geneID.toLower());
+        numberOfSuffixes += geneID.length();
+    }
+
+    this->suffixes.reserve(numberOfSuffixes);
+    for (int i = 0; i < this->lowerCaseGeneIDs.length(); i++) {
+        for (int offset = 0; offset < this->lowerCaseGeneIDs[i].length(); offset++) {
+            this->suffixes.append({ i, offset });
+        }
+    }
+
+    const QStringList & lowerCaseGeneIDs = this->lowerCaseGeneIDs;
+    std::sort(this->suffixes.begin(), this->suffixes.end(), [&lowerCaseGeneIDs](const Suffix & a, const Suffix & b) {
+        return lowerCaseGeneIDs[a.geneIndex].midRef(a.offset).compare(lowerCaseGeneIDs[b.geneIndex].midRef(b.offset)) < 0;
+    });
+}
+
+
+int GeneSearchIndex::getNumberOfGenes() const {
+    return this->lowerCaseGeneIDs.length();
+}
+
+
+/**
+ * @brief GeneSearchIndex::findSuffixRange - Binary searches the suffixes that start with the given term
+ * @param term - Lower-cased, non-empty search term
+ * @return First and one past the last position in the suffix array
+ */
+QPair<int, int> GeneSearchIndex::findSuffixRange(const QString & term) const {
+    const QStringList & lowerCaseGeneIDs = this->lowerCaseGeneIDs;
+    int termLength = term.length();
+
+    auto first = std::lower_bound(this->suffixes.begin(), this->suffixes.end(), term, [&lowerCaseGeneIDs](const Suffix & suffix, const QString & term) {
+        return lowerCaseGeneIDs[suffix.geneIndex].midRef(suffix.offset).compare(term) < 0;
+    });
+
+    auto last = std::upper_bound(first, this->suffixes.end(), term, [&lowerCaseGeneIDs, termLength](const QString & term, const Suffix & suffix) {
+        return lowerCaseGeneIDs[suffix.geneIndex].midRef(suffix.offset, termLength).compare(term) > 0;
+    });
+
+    return qMakePair(int(first - this->suffixes.begin()), int(last - this->suffixes.begin()));
+}
+
+
+/**
+ * @brief GeneSearchIndex::findGenesContaining - Finds every gene whose ID contains the term - case insensitive
+ * @param term - Search term
+ * @return Sorted indices of the matching genes
+ */
+QVector<int> GeneSearchIndex::findGenesContaining(const QString & term) const {
+    QVector<int> geneIndices;
+    QString lowerCaseTerm = term.toLower();
+
+    if (lowerCaseTerm.isEmpty()) {
+        return geneIndices;
+    }
+
+    QPair<int, int> suffixRange = this->findSuffixRange(lowerCaseTerm);
+    geneIndices.reserve(suffixRange.second - suffixRange.first);
+
+    for (int i = suffixRange.first; i < suffixRange.second; i++) {
+        geneIndices.append(this->suffixes[i].geneIndex);
+    }
+
+    // A gene that contains the term more than once has several matching suffixes
+    std::sort(geneIndices.begin(), geneIndices.end());
+    geneIndices.erase(std::unique(geneIndices.begin(), geneIndices.end()), geneIndices.end());
+
+    return geneIndices;
+}
+
+
+/**
+ * @brief GeneSearchIndex::findMatchingGenes - Marks every gene that contains at least one of the terms
+ * @param terms - Search terms - empty terms are ignored
+ * @return One bit per gene - all bits are set if there is no non-empty term
+ */
+QBitArray GeneSearchIndex::findMatchingGenes(const QStringList & terms) const {
+    QBitArray matchingGenes(this->getNumberOfGenes(), false);
+    bool isAnyTerm = false;
+
+    for (const QString & term : terms) {
+        QString trimmedTerm = term.trimmed();
+
+        if (trimmedTerm.isEmpty()) {
+            continue;
+        }
+
+        isAnyTerm = true;
+        for (int geneIndex : this->findGenesContaining(trimmedTerm)) {
+            matchingGenes.setBit(geneIndex);
+        }
+    }
+
+    if (!isAnyTerm) {
+        matchingGenes.fill(true);
+    }
+
+    return matchingGenes;
+}
@@ -0,0 +1,38 @@
+#ifndef GENESEARCHINDEX_H
+#define GENESEARCHINDEX_H
+
+#include <QBitArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The GeneSearchIndex class is a generalized suffix array over lower-cased gene IDs. A substring query is a binary search
+ *        for the range of suffixes starting with the term.
+ *        The index is immutable once built and can be queried from any thread.
+ */
+class GeneSearchIndex
+{
+private:
+    struct Suffix
+    {
+        int geneIndex;
+        int offset;
+    };
+
+    QStringList lowerCaseGeneIDs;
+    QVector<Suffix> suffixes;
+
+    QPair<int, int> findSuffixRange(const QString & term) const;
+
+public:
+    GeneSearchIndex();
+    GeneSearchIndex(const QStringList & geneIDs);
+
+    int getNumberOfGenes() const;
+
+    QVector<int> findGenesContaining(const QString & term) const;
+    QBitArray findMatchingGenes(const QStringList & terms) const;
+};
+
+#endif // GENESEARCHINDEX_H
@@ -5,6 +5,7 @@
 #include <QPair>
 #include <QString>
 #include <functional>
+#include <cstring>
 
 #include "BioModels/Celltype.h"
 #include "BioModels/Feature.h"
@@ -72,6 +73,47 @@ FeatureCollection sortFeaturesByExpression(FeatureCollection featureCollection)
     return sortedCollection;
 }
 
+/**
+ * @brief calculateSortPermutation - Sorts the indices of the keys ascending by key with a stable LSD radix sort (4 passes of 8 bits).
+ *        The float bits are flipped into unsigned integers that compare like the floats, NaN sorts before every number.
+ * @param keys - Keys to sort by
+ * @return Permutation - the i-th element is the index of the i-th smallest key
+ */
+QVector<int> calculateSortPermutation(const QVector<float> & keys) {
+    int numberOfKeys = keys.length();
+
+    // Map every float onto an unsigned integer with the same order: negative floats get all bits flipped, positive ones only the sign bit
+    QVector<quint32> radixKeys(numberOfKeys);
+    for (int i = 0; i < numberOfKeys; i++) {
+        quint32 bits;
+        std::memcpy(&bits, &keys[i], sizeof(bits));
+        radixKeys[i] = keys[i] != keys[i] ? 0 : (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u;
+    }
+
+    QVector<int> permutation(numberOfKeys), sortedPermutation(numberOfKeys);
+    for (int i = 0; i < numberOfKeys; i++) {
+        permutation[i] = i;
+    }
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        int bucketOffsets[257] = {0};
+
+        for (int i = 0; i < numberOfKeys; i++) {
+            bucketOffsets[((radixKeys[permutation[i]] >> shift) & 0xFF) + 1]++;
+        }
+        for (int bucket = 0; bucket < 256; bucket++) {
+            bucketOffsets[bucket + 1] += bucketOffsets[bucket];
+        }
+        for (int i = 0; i < numberOfKeys; i++) {
+            sortedPermutation[bucketOffsets[(radixKeys[permutation[i]] >> shift) & 0xFF]++] = permutation[i];
+        }
+
+        permutation.swap(sortedPermutation);
+    }
+
+    return permutation;
+}
+
 /**
  * @brief Sorter::findHighestLikelyCellTypeMapping
  * @param clustersWithCellTypeMappingLikelihoods
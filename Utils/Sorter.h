@@ -20,6 +20,8 @@ namespace Sorter
 
     extern QVector<int> calculateRanks(QVector<double> numbers);
 
+    extern QVector<int> calculateSortPermutation(const QVector<float> & keys);
+
     extern QVector<QPair<Feature, Feature>> findEquallyExpressedFeatures(FeatureCollection collectionOne, FeatureCollection collecionTwo);
 };
 
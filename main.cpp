@@ -1,6 +1,11 @@
 ﻿#include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDebug>
 #include <QDir>
 #include <QObject>
+#include <QThread>
 
 #include "Mainwindow.h"
 #include "StartDialog.h"
@@ -9,11 +14,156 @@
 #include "Utils/FileOperators/ConfigFileOperator.h"
 #include "System/Coordinator.h"
 #include "System/InformationCenter.h"
+#include "System/AnnotationServer.h"
+#include "System/BatchRunner.h"
+#include "System/CellAnnotationRunner.h"
+#include "System/ParameterSweep.h"
+#include "System/PerfCounters.h"
+#include "System/ThreadPools.h"
+#include "System/Trace.h"
 
 int main(int argc, char *argv[])
 {
+    // ++++++++++++++++++++++++++++++++++++++++  PARSE COMMAND LINE  +++++++++++++++++++++++++++++++++++++++++++
+    // The arguments are parsed before any application object exists because headless modes must not create a QApplication
+    QStringList arguments;
+    for (int i = 0; i < argc; i++) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    QCommandLineParser commandLineParser;
+    QCommandLineOption daemonOption("daemon", "Run as resident annotation daemon listening on the given local socket.", "socket name"),
+                       referenceOption("reference", "Reference file that is kept resident by the daemon (repeatable).", "file path"),
+                       referenceCutoffOption("reference-cutoff", "Cutoff used to parse references.", "cutoff", "100"),
+                       clusterCutoffOption("cluster-cutoff", "Cutoff used to parse datasets.", "cutoff", "15"),
+                       batchOption("batch", "Annotate the given datasets without GUI and write the results to the given directory.", "output directory"),
+                       workersOption("workers", "Number of worker processes used in batch mode.", "number", QString::number(QThread::idealThreadCount())),
+                       topTypesOption("top", "Number of best correlated types reported per cluster.", "number", "5"),
+                       reportsOption("reports", "Render a correlation chart and a marker heatmap per dataset in batch mode (png or pdf).", "format"),
+                       sweepOption("sweep", "Annotate the given datasets for every combination of cutoffs and methods and write the results to the given directory.", "output directory"),
+                       clusterCutoffsOption("cluster-cutoffs", "Cluster cutoffs of the sweep as list or start:stop:step range.", "values", "15"),
+                       referenceCutoffsOption("reference-cutoffs", "Reference cutoffs of the sweep as list or start:stop:step range.", "values", "100"),
+                       methodsOption("methods", "Correlation methods of the sweep (spearman, pearson).", "methods", "spearman"),
+                       annotateCellsOption("annotate-cells", "Score every cell of the given feature-barcode matrices against the reference or the marker file and write the best types per cell to the given directory.", "output directory"),
+                       markersOption("markers", "Marker file whose cell types are scored instead of a reference when annotating cells.", "file path"),
+                       traceOption("trace", "Record the stages of the run and write them as Chrome trace to the given file (or set BADGER_TRACE).", "file path");
+    commandLineParser.addOptions({ daemonOption, referenceOption, referenceCutoffOption, clusterCutoffOption,
+                                   batchOption, workersOption, topTypesOption, reportsOption,
+                                   sweepOption, clusterCutoffsOption, referenceCutoffsOption, methodsOption,
+                                   annotateCellsOption, markersOption, traceOption });
+    commandLineParser.addPositionalArgument("datasets", "Dataset files that are annotated in batch or sweep mode, feature-barcode matrices when annotating cells.", "[datasets...]");
+    commandLineParser.parse(arguments);
+
+    // Every mode reports at least the best type per cluster or cell
+    bool isValidNumberOfTopTypes = false;
+    int numberOfTopTypes = commandLineParser.value(topTypesOption).toInt(&isValidNumberOfTopTypes);
+
+    if (!isValidNumberOfTopTypes || numberOfTopTypes < 1) {
+        qDebug() << "Invalid value for --top:" << commandLineParser.value(topTypesOption) << "- at least one type has to be reported";
+        return 1;
+    }
+
+    // The trace is recorded for every mode and written when the run ends
+    QString traceFilePath = commandLineParser.isSet(traceOption) ? commandLineParser.value(traceOption) : QString::fromLocal8Bit(qgetenv("BADGER_TRACE"));
+    if (!traceFilePath.isEmpty()) {
+        Trace::startTracing(traceFilePath);
+    }
+
+    // ++++++++++++++++++++++++++++++++++++++++++++  BATCH MODE  +++++++++++++++++++++++++++++++++++++++++++++++
+    // The batch runner forks its workers, so no application object (and therefore no thread) may exist yet
+    if (commandLineParser.isSet(batchOption)) {
+        BatchRunner::BatchParameters batchParameters;
+        batchParameters.referenceFilePath = commandLineParser.value(referenceOption);
+        batchParameters.datasetFilePaths = commandLineParser.positionalArguments();
+        batchParameters.outputDirectoryPath = commandLineParser.value(batchOption);
+        batchParameters.numberOfWorkers = commandLineParser.value(workersOption).toInt();
+        batchParameters.numberOfTopTypes = numberOfTopTypes;
+        batchParameters.referenceCutoff = commandLineParser.value(referenceCutoffOption).toDouble();
+        batchParameters.clusterCutoff = commandLineParser.value(clusterCutoffOption).toDouble();
+        batchParameters.reportFormat = commandLineParser.value(reportsOption);
+
+        int batchResult = BatchRunner::runBatch(batchParameters);
+        Trace::writeTrace();
+        return batchResult;
+    }
+
+    // +++++++++++++++++++++++++++++++++++++++++++  SWEEP MODE  ++++++++++++++++++++++++++++++++++++++++++++++++
+    if (commandLineParser.isSet(sweepOption)) {
+        // The grid is evaluated on the thread pools, configured like for the GUI
+        QString configFilePath = QDir::homePath().append("/.badger.conf");
+        ConfigFile configFile = ConfigFileOperator::isConfigFileExists(configFilePath) ? ConfigFileOperator::readConfigFile(configFilePath)
+                                                                                        : ConfigFileOperator::initializeConfigFile();
+        ThreadPools::configureThreadPools(configFile);
+        PerfCounters::configurePerfCounters(configFile);
+
+        ParameterSweep::SweepParameters sweepParameters;
+        sweepParameters.referenceFilePath = commandLineParser.value(referenceOption);
+        sweepParameters.datasetFilePaths = commandLineParser.positionalArguments();
+        sweepParameters.outputDirectoryPath = commandLineParser.value(sweepOption);
+        sweepParameters.clusterCutoffs = ParameterSweep::parseValueRange(commandLineParser.value(clusterCutoffsOption));
+        sweepParameters.referenceCutoffs = ParameterSweep::parseValueRange(commandLineParser.value(referenceCutoffsOption));
+        sweepParameters.correlationMethods = ParameterSweep::parseCorrelationMethods(commandLineParser.value(methodsOption));
+        sweepParameters.numberOfTopTypes = numberOfTopTypes;
+
+        int sweepResult = ParameterSweep::runSweep(sweepParameters);
+        Trace::writeTrace();
+        return sweepResult;
+    }
+
+    // ++++++++++++++++++++++++++++++++++++++++  CELL ANNOTATION MODE  ++++++++++++++++++++++++++++++++++++++++++
+    if (commandLineParser.isSet(annotateCellsOption)) {
+        // The cells are scored on the thread pools, configured like for the GUI
+        QString configFilePath = QDir::homePath().append("/.badger.conf");
+        ConfigFile configFile = ConfigFileOperator::isConfigFileExists(configFilePath) ? ConfigFileOperator::readConfigFile(configFilePath)
+                                                                                        : ConfigFileOperator::initializeConfigFile();
+        ThreadPools::configureThreadPools(configFile);
+        PerfCounters::configurePerfCounters(configFile);
+
+        CellAnnotationRunner::CellAnnotationParameters cellAnnotationParameters;
+        cellAnnotationParameters.referenceFilePath = commandLineParser.value(referenceOption);
+        cellAnnotationParameters.markerFilePath = commandLineParser.value(markersOption);
+        cellAnnotationParameters.matrixPaths = commandLineParser.positionalArguments();
+        cellAnnotationParameters.outputDirectoryPath = commandLineParser.value(annotateCellsOption);
+        cellAnnotationParameters.referenceCutoff = commandLineParser.value(referenceCutoffOption).toDouble();
+        cellAnnotationParameters.numberOfTopProfiles = numberOfTopTypes;
+
+        int cellAnnotationResult = CellAnnotationRunner::runCellAnnotation(cellAnnotationParameters);
+        Trace::writeTrace();
+        return cellAnnotationResult;
+    }
+
+    // +++++++++++++++++++++++++++++++++++++++++++  DAEMON MODE  +++++++++++++++++++++++++++++++++++++++++++++++
+    if (commandLineParser.isSet(daemonOption)) {
+        QCoreApplication coreApplication(argc, argv);
+
+        // The daemon shares the pool configuration with the GUI
+        QString configFilePath = QDir::homePath().append("/.badger.conf");
+        ConfigFile configFile = ConfigFileOperator::isConfigFileExists(configFilePath) ? ConfigFileOperator::readConfigFile(configFilePath)
+                                                                                        : ConfigFileOperator::initializeConfigFile();
+        ThreadPools::configureThreadPools(configFile);
+        PerfCounters::configurePerfCounters(configFile);
+
+        AnnotationServer annotationServer(commandLineParser.value(clusterCutoffOption).toDouble());
+
+        // Every reference is parsed once and stays resident for the lifetime of the daemon
+        for (QString referenceFilePath : commandLineParser.values(referenceOption)) {
+            annotationServer.loadReference(referenceFilePath, commandLineParser.value(referenceCutoffOption).toDouble());
+        }
+
+        if (!annotationServer.listen(commandLineParser.value(daemonOption))) {
+            return 1;
+        }
+
+        int daemonResult = coreApplication.exec();
+        Trace::writeTrace();
+        return daemonResult;
+    }
+
     QApplication application(argc, argv);
 
+    // Snapshots are passed between threads, so Qt has to know how to queue them
+    qRegisterMetaType<InformationCenterSnapshot>("InformationCenterSnapshot");
+
     // Declaration of the used widgets
     MainWindow mainWindow;
     StartDialog startDialog;
@@ -42,6 +192,9 @@ int main(int argc, char *argv[])
     }
 
     // ++++++++++++++++++++++++++++++++++++++++  CREATE PROGRAM BASICS  ++++++++++++++++++++++++++++++++++++++++
+    // Parsing and correlation run on their own pools, sized and placed as given in the config file
+    ThreadPools::configureThreadPools(configFile);
+    PerfCounters::configurePerfCounters(configFile);
 
     // InformationCenter is used to store all relevant software data
     InformationCenter informationCenter(configFile);
@@ -52,14 +205,25 @@ int main(int argc, char *argv[])
     // +++++++++++++++++++++++++++++++++++++  BUILD SIGNAL AND SLOT LOGIC  +++++++++++++++++++++++++++++++++++++
     // StartDialog -> Coordinator
     QObject::connect(&startDialog, &StartDialog::runNewProject, &coordinator, &Coordinator::on_newProjectStarted);
+    QObject::connect(&startDialog, &StartDialog::loadProject, &coordinator, &Coordinator::on_projectFileUploaded);
 
     // Coordinator -> Main Window
     QObject::connect(&coordinator, &Coordinator::finishedFileParsing, &mainWindow, &MainWindow::on_clusterFileParsed);
 
     // Coordinator -> Main Window
     QObject::connect(&coordinator, &Coordinator::finishedCorrelating, &mainWindow, &MainWindow::on_correlatingFinished);
+    QObject::connect(&coordinator, &Coordinator::datasetSpilled, &mainWindow, &MainWindow::on_datasetSpilled);
+
+    // Main Window -> Coordinator
+    QObject::connect(&mainWindow, &MainWindow::datasetRendered, &coordinator, &Coordinator::on_datasetRendered);
+    QObject::connect(&mainWindow, &MainWindow::saveProject, &coordinator, &Coordinator::on_projectSaveRequested);
+    QObject::connect(&mainWindow, &MainWindow::addDatasets, &coordinator, &Coordinator::on_filesUploaded);
+    QObject::connect(&mainWindow, &MainWindow::cutoffsChanged, &coordinator, &Coordinator::on_cutoffsChanged);
 
     // At this point, the complete control over the system workflow is handed over to the Coordinator
 
-    return application.exec();
+    // The exit buttons of the frameless windows quit the event loop, so the trace of the session is written here
+    int applicationResult = application.exec();
+    Trace::writeTrace();
+    return applicationResult;
 }